@@ -0,0 +1,66 @@
+/**
+ * @file batchBenchmark.cpp
+ * @brief Benchmark of BatchRunner: throughput of headless jobs as the number of concurrent jobs grows.
+ *
+ * Every job places three built-in shapes next to each other, merges them with welding
+ * and writes the result to a binary STL file in the temporary directory. The shapes
+ * cycle through the supported types, so the shape cache is warm after the first jobs
+ * and the time goes into merging and writing. The files are removed afterwards.
+ *
+ * Options:
+ *   --jobs     Jobs per batch (default 500).
+ *   --threads  Comma-separated numbers of concurrent jobs (default 1,4,0); 0 uses every core.
+ */
+
+#include "batchRunner.h"
+#include "benchmark.h"
+#include "controller.h"
+
+#include <QDir>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+
+int runBatchBenchmark(const BenchmarkArgs& args)
+{
+    const int count = std::max(1, std::atoi(argumentValue(args, "jobs", "500").c_str()));
+    const std::vector<long long> threadCounts = parseCounts(argumentValue(args, "threads", "1,4,0"));
+
+    QDir directory(QDir::temp().filePath("qtvtk_benchmark_batch"));
+    directory.mkpath(".");
+
+    const QStringList shapes = ShapeController::supportedShapes();
+    std::vector<BatchRunner::Job> jobs(count);
+    for (int i = 0; i < count; ++i)
+    {
+        BatchRunner::Job& job = jobs[i];
+        job.name = QString("job%1").arg(i);
+        job.output = directory.filePath(job.name + ".stl");
+        job.hasColor = true;
+        job.color = { (i % 7) / 6.0, (i % 5) / 4.0, (i % 3) / 2.0 };
+        for (int p = 0; p < 3; ++p)
+        {
+            BatchRunner::Part part;
+            part.shape = shapes[(i + p) % shapes.size()];
+            part.position = { 40.0 * p, 0.0, 0.0 };
+            part.orientation = { 0.0, 15.0 * (i % 24), 0.0 };
+            job.parts.push_back(part);
+        }
+    }
+
+    std::printf("%8s %8s %12s %10s %12s\n", "jobs", "threads", "time (s)", "failed", "jobs/s");
+
+    for (long long threads : threadCounts)
+    {
+        const BatchRunner::Report report = BatchRunner::run(jobs, static_cast<unsigned>(std::max(0LL, threads)));
+        std::printf("%8zu %8u %12.3f %10zu %12.1f\n",
+                    report.jobs.size(), report.threads, report.seconds, report.failed, report.jobsPerSecond());
+
+        recordMetric(std::to_string(threads) + "/jobs_per_s", report.jobsPerSecond(), "jobs/s", true);
+    }
+
+    directory.removeRecursively();
+    return 0;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderer.h>
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @class Stopwatch
+ * @brief Measures wall-clock time from construction or the last restart.
+ */
+class Stopwatch
+{
+public:
+    Stopwatch() : mStart(std::chrono::steady_clock::now()) {}
+
+    /// @brief Starts measuring again from now.
+    void restart() { mStart = std::chrono::steady_clock::now(); }
+
+    /// @brief Returns the elapsed time in milliseconds.
+    double elapsedMs() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mStart).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point mStart;
+};
+
+/**
+ * @brief Command-line arguments passed to a benchmark suite (without the suite name).
+ */
+using BenchmarkArgs = std::vector<std::string>;
+
+/**
+ * @brief Returns the value following a "--name" option, or the fallback if absent.
+ */
+std::string argumentValue(const BenchmarkArgs& args, const std::string& name, const std::string& fallback);
+
+/**
+ * @brief Parses a comma-separated list of counts such as "10000,50000".
+ */
+std::vector<long long> parseCounts(const std::string& list);
+
+/**
+ * @brief Creates an offscreen render window with a single renderer.
+ *
+ * @param renderer Receives the renderer added to the window.
+ * @return vtkSmartPointer<vtkRenderWindow> The offscreen window.
+ */
+vtkSmartPointer<vtkRenderWindow> createOffscreenWindow(vtkSmartPointer<vtkRenderer>& renderer);
+
+/**
+ * @brief Returns the resident memory of the process in bytes, or 0 where unsupported.
+ */
+std::size_t residentMemoryBytes();
+
+/**
+ * @brief Builds a triangulated height field of count facets with three unshared points per facet.
+ */
+vtkSmartPointer<vtkPolyData> makeHeightFieldMesh(long long count);
+
+/**
+ * @brief Records a measurement for the JSON report and the baseline comparison.
+ *
+ * The name is prefixed with the running suite, e.g. "scene/10000/frame_ms", and must
+ * be stable between runs so baselines can be matched.
+ *
+ * @param name Identifier of the measurement within the suite.
+ * @param value The measured value.
+ * @param unit Unit of the value, e.g. "ms" or "MB/s".
+ * @param higherIsBetter True for throughputs, false for times and memory.
+ */
+void recordMetric(const std::string& name, double value, const std::string& unit, bool higherIsBetter = false);
+
+/// Stress test of the Scene store: add, update and render 10k-100k objects.
+int runSceneBenchmark(const BenchmarkArgs& args);
+
+/// Frame time and memory of instanced versus per-actor rendering of one primitive.
+int runInstancingBenchmark(const BenchmarkArgs& args);
+
+/// Read throughput of StlReader versus vtkSTLReader on generated 1M-50M facet files.
+int runStlBenchmark(const BenchmarkArgs& args);
+
+/// Write throughput of StlWriter versus vtkSTLWriter on generated 1M-50M facet meshes.
+int runStlWriteBenchmark(const BenchmarkArgs& args);
+
+/// Generation and cached lookup time of ShapeController::createShape for every shape type.
+int runShapeBenchmark(const BenchmarkArgs& args);
+
+/// Cost of box widget drags and of baking their transform into meshes of growing size.
+int runTransformBenchmark(const BenchmarkArgs& args);
+
+/// Merge time of MeshMerger and frame time of merged versus separate parts.
+int runMergeBenchmark(const BenchmarkArgs& args);
+
+/// Hierarchy build, pick latency and refit time of ScenePicker on scenes of many meshes.
+int runPickBenchmark(const BenchmarkArgs& args);
+
+/// Full check and incremental update time of InterferenceChecker as objects move.
+int runInterferenceBenchmark(const BenchmarkArgs& args);
+
+/// Recording, memory and undo/redo time of History on large meshes.
+int runHistoryBenchmark(const BenchmarkArgs& args);
+
+/// Jobs per second of BatchRunner with increasing numbers of concurrent jobs.
+int runBatchBenchmark(const BenchmarkArgs& args);
+
+/// Memory per triangle of the default versus the compact MeshStorage, and the conversion time.
+int runStorageBenchmark(const BenchmarkArgs& args);
+
+/// Time per frame of dragging a shape parameter through a persistent pipeline versus regenerating the shape.
+int runEditBenchmark(const BenchmarkArgs& args);
+
+/// Generation time of PrimitiveSource versus the VTK sources at resolutions of 50-2000.
+int runPrimitiveBenchmark(const BenchmarkArgs& args);
+
+/// Point normals of MeshNormals versus vtkPolyDataNormals, cached lookups, and rotated versus recomputed normals on bake.
+int runNormalsBenchmark(const BenchmarkArgs& args);
+
+/// Weld, cleanup, orientation and hole filling of MeshRepair versus the VTK filters on damaged meshes.
+int runRepairBenchmark(const BenchmarkArgs& args);
+
+/// Reopen time of a mesh mapped from its MeshFile cache versus parsed again by StlReader.
+int runMeshFileBenchmark(const BenchmarkArgs& args);
+
+/// Full and incremental saves of ProjectFile, and the table read that shows a project before its meshes.
+int runProjectBenchmark(const BenchmarkArgs& args);
@@ -0,0 +1,102 @@
+/**
+ * @file editBenchmark.cpp
+ * @brief Benchmark of live shape editing: a parameter drag through a persistent pipeline versus full regeneration.
+ *
+ * Each case drags one parameter of a finely tessellated shape across its range. "rebuild"
+ * builds and runs a new pipeline for every value, as generating the shape from scratch
+ * does; "live" keeps one pipeline alive and pushes each value into it, as ShapeEditor does,
+ * so only the stages the parameter feeds re-execute. Times are per value, i.e. per frame
+ * of the drag.
+ *
+ * Options:
+ *   --steps  Values per drag (default 60).
+ *   --error  Chordal error of the tessellation in model units (default 0.001).
+ */
+
+#include "benchmark.h"
+#include "model.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+
+namespace
+{
+
+/**
+ * @brief A shape and the parameter dragged on it.
+ */
+struct EditCase
+{
+    const char* name;
+    std::unique_ptr<Shape> shape;
+    std::size_t parameter;
+};
+
+/**
+ * @brief Returns the value of a drag step, sweeping the middle half of the parameter's range.
+ */
+double dragValue(const ShapeParameter& parameter, int step, int steps)
+{
+    const double range = parameter.maximum - parameter.minimum;
+    return parameter.minimum + range * (0.25 + 0.5 * step / std::max(1, steps - 1));
+}
+
+} // namespace
+
+
+int runEditBenchmark(const BenchmarkArgs& args)
+{
+    const int steps = std::max(1, std::atoi(argumentValue(args, "steps", "60").c_str()));
+    const double error = std::atof(argumentValue(args, "error", "0.001").c_str());
+    const TessellationPolicy policy = TessellationPolicy::fromChordalError(error);
+
+    EditCase cases[] = {
+        { "doughnut_tube_radius", std::make_unique<Doughnut>(6, 3), 1 },
+        { "tube_radius", std::make_unique<Tube>(2, 5), 0 },
+        { "tube_length", std::make_unique<Tube>(2, 5), 1 },
+        { "curved_cylinder_radius", std::make_unique<CurvedCylinder>(0.1), 0 },
+    };
+
+    std::printf("%-24s %12s %14s %14s %10s\n", "drag", "cells", "rebuild (ms)", "live (ms)", "speedup");
+
+    for (EditCase& edit : cases)
+    {
+        const ShapeParameter parameter = edit.shape->parameters()[edit.parameter];
+
+        std::unique_ptr<Shape> rebuilt = edit.shape->clone();
+        vtkIdType cells = 0;
+        Stopwatch stopwatch;
+        for (int step = 0; step < steps; ++step)
+        {
+            rebuilt->setParameter(edit.parameter, dragValue(parameter, step, steps));
+            vtkSmartPointer<vtkPolyData> mesh = rebuilt->createMesh(policy);
+            cells = mesh->GetNumberOfCells();
+        }
+        const double rebuildMs = stopwatch.elapsedMs() / steps;
+
+        // The pipeline is built and run once before the drag, as ShapeEditor::open() does
+        std::unique_ptr<Shape> live = edit.shape->clone();
+        ShapePipeline pipeline = live->createPipeline();
+        live->configurePipeline(pipeline, policy);
+        pipeline.update();
+
+        stopwatch.restart();
+        for (int step = 0; step < steps; ++step)
+        {
+            live->setParameter(edit.parameter, dragValue(parameter, step, steps));
+            live->configurePipeline(pipeline, policy);
+            pipeline.update();
+        }
+        const double liveMs = stopwatch.elapsedMs() / steps;
+
+        std::printf("%-24s %12lld %14.3f %14.3f %10.2f\n", edit.name, static_cast<long long>(cells), rebuildMs, liveMs, rebuildMs / liveMs);
+
+        recordMetric(std::string(edit.name) + "/rebuild_ms", rebuildMs, "ms");
+        recordMetric(std::string(edit.name) + "/live_ms", liveMs, "ms");
+    }
+
+    return 0;
+}
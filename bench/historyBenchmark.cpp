@@ -0,0 +1,108 @@
+/**
+ * @file historyBenchmark.cpp
+ * @brief Benchmark of History: cost of recording edits and of undoing and redoing them on large meshes.
+ *
+ * One object with a height field mesh gets a series of transform edits followed by a
+ * bake of its transform into the geometry. The memory the history references is
+ * reported after the transforms, which should stay near zero whatever the mesh size,
+ * and after the bake, which should grow by the baked points only since the connectivity
+ * is shared. Every edit is then undone and redone; both should take constant time.
+ *
+ * A drag is then simulated on a fresh history: frames sharing a merge key that each
+ * replace the mesh, as shape parameter edits do. They must merge into one undo step
+ * holding the first and the last mesh only; the suite fails otherwise.
+ *
+ * Options:
+ *   --facets   Comma-separated facet counts (default 100000,1000000).
+ *   --steps    Transform edits recorded (default 1000).
+ *   --frames   Frames of the simulated drag (default 20).
+ */
+
+#include "benchmark.h"
+#include "history.h"
+#include "scene.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+
+int runHistoryBenchmark(const BenchmarkArgs& args)
+{
+    const std::vector<long long> counts = parseCounts(argumentValue(args, "facets", "100000,1000000"));
+    const int steps = std::max(1, std::atoi(argumentValue(args, "steps", "1000").c_str()));
+    const int frames = std::max(2, std::atoi(argumentValue(args, "frames", "20").c_str()));
+
+    std::printf("%10s %8s %12s %14s %14s %12s %12s %12s %12s\n",
+                "facets", "steps", "record (us)", "moves (KiB)", "bake (MiB)", "undo (us)", "redo (us)",
+                "drag steps", "drag (MiB)");
+
+    for (long long facets : counts)
+    {
+        Scene scene;
+        History history(scene);
+        const ObjectId id = scene.addObject(makeHeightFieldMesh(facets));
+
+        Stopwatch stopwatch;
+        for (int step = 0; step < steps; ++step)
+        {
+            const double position[3] = { 0.01 * step, 0.0, 0.0 };
+            history.begin("Move", { id });
+            scene.setPosition(id, position);
+            history.commit();
+        }
+        const double recordUs = 1000.0 * stopwatch.elapsedMs() / steps;
+        const double movesKiB = history.statistics().bytes / 1024.0;
+
+        const double matrix[16] = { 1, 0, 0, 1, 0, 1, 0, 2, 0, 0, 1, 3, 0, 0, 0, 1 };
+        scene.setUserMatrix(id, matrix);
+        history.begin("Bake transform", { id });
+        scene.bakeUserMatrix(id);
+        history.commit();
+        const double bakeMiB = (history.statistics().bytes - movesKiB * 1024.0) / (1024.0 * 1024.0);
+
+        const int edits = static_cast<int>(history.statistics().undoSteps);
+        stopwatch.restart();
+        while (history.canUndo())
+            history.undo();
+        const double undoUs = 1000.0 * stopwatch.elapsedMs() / std::max(1, edits);
+
+        stopwatch.restart();
+        while (history.canRedo())
+            history.redo();
+        const double redoUs = 1000.0 * stopwatch.elapsedMs() / std::max(1, edits);
+
+        // A drag whose every frame replaces the mesh, merged by its key
+        Scene dragScene;
+        History dragHistory(dragScene);
+        const ObjectId dragged = dragScene.addObject(makeHeightFieldMesh(facets));
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            const double frameMatrix[16] = { 1, 0, 0, 0.01, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+            dragHistory.begin("Edit shape", { dragged }, "drag");
+            dragScene.setUserMatrix(dragged, frameMatrix);
+            dragScene.bakeUserMatrix(dragged);
+            dragHistory.commit();
+        }
+        const History::Statistics drag = dragHistory.statistics();
+        const double dragMiB = drag.bytes / (1024.0 * 1024.0);
+
+        std::printf("%10lld %8d %12.2f %14.1f %14.1f %12.2f %12.2f %12zu %12.1f\n",
+                    facets, steps, recordUs, movesKiB, bakeMiB, undoUs, redoUs, drag.undoSteps, dragMiB);
+
+        if (drag.undoSteps != 1)
+        {
+            std::fprintf(stderr, "A drag of %d frames left %zu undo steps instead of 1\n", frames, drag.undoSteps);
+            return 1;
+        }
+
+        const std::string prefix = std::to_string(facets) + "/";
+        recordMetric(prefix + "record_us", recordUs, "us");
+        recordMetric(prefix + "undo_us", undoUs, "us");
+        recordMetric(prefix + "redo_us", redoUs, "us");
+        recordMetric(prefix + "bake_mib", bakeMiB, "MiB");
+        recordMetric(prefix + "drag_mib", dragMiB, "MiB");
+    }
+
+    return 0;
+}
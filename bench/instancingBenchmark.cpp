@@ -0,0 +1,130 @@
+/**
+ * @file instancingBenchmark.cpp
+ * @brief Compares instanced and per-actor rendering of one repeated primitive.
+ *
+ * For each count, the same grid of copies is rendered once with one actor per copy
+ * and once through a single InstanceBatch. Frame time and resident memory growth are
+ * reported for both modes; instanced numbers should stay nearly flat.
+ *
+ * Options:
+ *   --counts  Comma-separated instance counts (default 1000,5000,10000,50000).
+ *   --shape   Shape type to repeat (default Sphere).
+ *   --frames  Number of frames averaged (default 5).
+ *   --modes   "actors", "instanced" or "both" (default both).
+ */
+
+#include "benchmark.h"
+#include "controller.h"
+#include "scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+
+namespace
+{
+
+struct ModeResult
+{
+    double buildMs;
+    double firstFrameMs;
+    double frameMs;
+    double memoryMiB;
+};
+
+ModeResult measure(vtkSmartPointer<vtkPolyData> mesh, long long count, int frames, bool instanced)
+{
+    const std::size_t memoryBefore = residentMemoryBytes();
+
+    vtkSmartPointer<vtkRenderer> renderer;
+    vtkSmartPointer<vtkRenderWindow> window = createOffscreenWindow(renderer);
+    Scene scene(renderer);
+
+    double bounds[6];
+    mesh->GetBounds(bounds);
+    const double spacing = 1.5 * std::max({ bounds[1] - bounds[0], bounds[3] - bounds[2], bounds[5] - bounds[4] });
+    const long long side = static_cast<long long>(std::ceil(std::cbrt(static_cast<double>(count))));
+
+    Stopwatch stopwatch;
+    for (long long i = 0; i < count; ++i)
+    {
+        const ObjectId id = instanced ? scene.addInstance(mesh) : scene.addObject(mesh);
+        const double position[3] = { (i % side) * spacing, ((i / side) % side) * spacing, (i / (side * side)) * spacing };
+        scene.setPosition(id, position);
+    }
+    scene.syncToVtk();
+
+    ModeResult result;
+    result.buildMs = stopwatch.elapsedMs();
+
+    renderer->ResetCamera();
+
+    stopwatch.restart();
+    window->Render();
+    result.firstFrameMs = stopwatch.elapsedMs();
+
+    stopwatch.restart();
+    for (int frame = 0; frame < frames; ++frame)
+        window->Render();
+    result.frameMs = stopwatch.elapsedMs() / frames;
+
+    const std::size_t memoryAfter = residentMemoryBytes();
+    result.memoryMiB = memoryAfter > memoryBefore ? (memoryAfter - memoryBefore) / (1024.0 * 1024.0) : 0.0;
+
+    return result;
+}
+
+void recordMode(const char* mode, long long count, const ModeResult& result)
+{
+    const std::string prefix = std::string(mode) + "/" + std::to_string(count) + "/";
+    recordMetric(prefix + "build_ms", result.buildMs, "ms");
+    recordMetric(prefix + "first_frame_ms", result.firstFrameMs, "ms");
+    recordMetric(prefix + "frame_ms", result.frameMs, "ms");
+    recordMetric(prefix + "memory_mib", result.memoryMiB, "MiB");
+}
+
+} // namespace
+
+
+int runInstancingBenchmark(const BenchmarkArgs& args)
+{
+    const std::vector<long long> counts = parseCounts(argumentValue(args, "counts", "1000,5000,10000,50000"));
+    const QString shapeType = QString::fromStdString(argumentValue(args, "shape", "Sphere"));
+    const int frames = std::max(1, std::atoi(argumentValue(args, "frames", "5").c_str()));
+    const std::string modes = argumentValue(args, "modes", "both");
+
+    ShapeController controller;
+    vtkSmartPointer<vtkPolyDataMapper> mapper = controller.createShape(shapeType);
+    if (!mapper)
+    {
+        std::fprintf(stderr, "Unsupported shape type: %s\n", qPrintable(shapeType));
+        return 1;
+    }
+    vtkSmartPointer<vtkPolyData> mesh = mapper->GetInput();
+
+    std::printf("%-10s %10s %12s %14s %12s %14s\n",
+                "mode", "instances", "build (ms)", "first (ms)", "frame (ms)", "memory (MiB)");
+
+    for (long long count : counts)
+    {
+        if (modes != "instanced")
+        {
+            const ModeResult actors = measure(mesh, count, frames, false);
+            std::printf("%-10s %10lld %12.1f %14.1f %12.2f %14.1f\n",
+                        "actors", count, actors.buildMs, actors.firstFrameMs, actors.frameMs, actors.memoryMiB);
+            recordMode("actors", count, actors);
+        }
+
+        if (modes != "actors")
+        {
+            const ModeResult instances = measure(mesh, count, frames, true);
+            std::printf("%-10s %10lld %12.1f %14.1f %12.2f %14.1f\n",
+                        "instanced", count, instances.buildMs, instances.firstFrameMs, instances.frameMs, instances.memoryMiB);
+            recordMode("instanced", count, instances);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file interferenceBenchmark.cpp
+ * @brief Benchmark of InterferenceChecker: full check of a scene and incremental updates after moves.
+ *
+ * A grid of objects sharing one height field mesh, each rotated about Z, is laid out
+ * with neighbors overlapping by a tenth of their size, so most neighbors interfere.
+ * "full" is the first update, which fills the grid and tests every overlapping pair.
+ * Then a few objects at a time are jittered around their place and the checker is
+ * updated; the update time should follow the number of moved objects, not the scene size.
+ *
+ * Options:
+ *   --objects  Comma-separated object counts (default 1000,10000).
+ *   --facets   Facets of the shared mesh (default 2000).
+ *   --moves    Comma-separated numbers of objects moved per update (default 1,10,100).
+ *   --steps    Updates measured per number of moved objects (default 50).
+ *   --threads  Worker threads of the narrow phase; 0 uses every core (default 0).
+ */
+
+#include "benchmark.h"
+#include "interferenceChecker.h"
+#include "meshBvhCache.h"
+#include "scene.h"
+
+#include <vtkMath.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+
+int runInterferenceBenchmark(const BenchmarkArgs& args)
+{
+    const std::vector<long long> counts = parseCounts(argumentValue(args, "objects", "1000,10000"));
+    const long long facets = std::max(1LL, std::atoll(argumentValue(args, "facets", "2000").c_str()));
+    const std::vector<long long> moves = parseCounts(argumentValue(args, "moves", "1,10,100"));
+    const int steps = std::max(1, std::atoi(argumentValue(args, "steps", "50").c_str()));
+    const unsigned threads = static_cast<unsigned>(std::max(0, std::atoi(argumentValue(args, "threads", "0").c_str())));
+
+    const vtkSmartPointer<vtkPolyData> mesh = makeHeightFieldMesh(facets);
+    double bounds[6];
+    mesh->GetBounds(bounds);
+    const double extent = std::max(bounds[1] - bounds[0], bounds[3] - bounds[2]);
+    const double spacing = 0.9 * extent;
+    const double center[2] = { (bounds[0] + bounds[1]) / 2, (bounds[2] + bounds[3]) / 2 };
+
+    std::printf("%8s %8s %12s %12s %12s %14s %10s\n",
+                "objects", "moved", "full (ms)", "pairs", "colliding", "update (ms)", "tests");
+
+    for (long long count : counts)
+    {
+        Scene scene;
+        std::mt19937 random(42);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+        // Objects rotate about the mesh origin, a corner of the height field, so centers are moved onto the grid
+        const long long side = static_cast<long long>(std::ceil(std::sqrt(static_cast<double>(count))));
+        std::vector<std::array<double, 3>> home;
+        home.reserve(count);
+        for (long long i = 0; i < count; ++i)
+        {
+            const ObjectId id = scene.addObject(mesh);
+            const double orientation[3] = { 0.0, 0.0, 360.0 * unit(random) };
+            const double radians = vtkMath::RadiansFromDegrees(orientation[2]);
+            home.push_back({
+                (i % side) * spacing - (center[0] * std::cos(radians) - center[1] * std::sin(radians)),
+                (i / side) * spacing - (center[0] * std::sin(radians) + center[1] * std::cos(radians)),
+                0.0,
+            });
+            scene.setPosition(id, home.back().data());
+            scene.setOrientation(id, orientation);
+        }
+
+        MeshBvhCache cache;
+        InterferenceChecker checker(scene, cache, threads);
+        Stopwatch stopwatch;
+        checker.update();
+        const double fullMs = stopwatch.elapsedMs();
+
+        const std::string prefix = std::to_string(count) + "/";
+        recordMetric(prefix + "full_ms", fullMs, "ms");
+
+        for (long long moved : moves)
+        {
+            moved = std::min(moved, count);
+            double totalMs = 0.0;
+            std::size_t tests = 0;
+            for (int step = 0; step < steps; ++step)
+            {
+                for (long long i = 0; i < moved; ++i)
+                {
+                    const std::size_t index = static_cast<std::size_t>(unit(random) * count) % count;
+                    const double position[3] = { home[index][0] + 0.1 * extent * (unit(random) - 0.5),
+                                                 home[index][1] + 0.1 * extent * (unit(random) - 0.5),
+                                                 home[index][2] + 0.1 * extent * (unit(random) - 0.5) };
+                    scene.setPosition(scene.objects()[index], position);
+                }
+
+                stopwatch.restart();
+                checker.update();
+                totalMs += stopwatch.elapsedMs();
+                tests += checker.statistics().tests;
+            }
+
+            const InterferenceChecker::Statistics statistics = checker.statistics();
+            const double updateMs = totalMs / steps;
+            std::printf("%8lld %8lld %12.1f %12zu %12zu %14.3f %10.1f\n",
+                        count, moved, fullMs, statistics.pairs, statistics.colliding, updateMs,
+                        static_cast<double>(tests) / steps);
+
+            recordMetric(prefix + std::to_string(moved) + "/update_ms", updateMs, "ms");
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,327 @@
+/**
+ * @file main.cpp
+ * @brief Entry point of the benchmark executable.
+ *
+ * Usage: QtVTKBenchmark <suite> [options]
+ *
+ * The suite "all" runs every suite in turn with the options given.
+ *
+ * Global options:
+ *   --software   Force Mesa's llvmpipe software rasterizer, so results are comparable
+ *                on machines without a GPU or display.
+ *   --json       Write every recorded measurement to this file as JSON.
+ *   --baseline   Compare the measurements with a JSON file written earlier by --json;
+ *                the exit code is 2 if any of them regressed.
+ *   --tolerance  Change in percent beyond which a measurement counts as regressed (default 10).
+ *   --trace      Record trace spans during the run and write them to this file as Chrome trace JSON.
+ */
+
+#include "benchmark.h"
+#include "trace.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+
+std::string argumentValue(const BenchmarkArgs& args, const std::string& name, const std::string& fallback)
+{
+    for (std::size_t i = 0; i + 1 < args.size(); ++i)
+    {
+        if (args[i] == "--" + name)
+            return args[i + 1];
+    }
+    return fallback;
+}
+
+
+std::vector<long long> parseCounts(const std::string& list)
+{
+    std::vector<long long> counts;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (!item.empty())
+            counts.push_back(std::atoll(item.c_str()));
+    }
+    return counts;
+}
+
+
+vtkSmartPointer<vtkRenderWindow> createOffscreenWindow(vtkSmartPointer<vtkRenderer>& renderer)
+{
+    renderer = vtkSmartPointer<vtkRenderer>::New();
+
+    vtkSmartPointer<vtkRenderWindow> window = vtkSmartPointer<vtkRenderWindow>::New();
+    window->SetOffScreenRendering(1);
+    window->SetSize(800, 600);
+    window->AddRenderer(renderer);
+    return window;
+}
+
+
+std::size_t residentMemoryBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.WorkingSetSize;
+    return 0;
+#else
+    std::ifstream statm("/proc/self/statm");
+    std::size_t pages = 0;
+    std::size_t residentPages = 0;
+    if (statm >> pages >> residentPages)
+        return residentPages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return 0;
+#endif
+}
+
+
+namespace
+{
+
+/**
+ * @brief One measurement recorded by a suite.
+ */
+struct Metric
+{
+    std::string name;
+    double value;
+    std::string unit;
+    bool higherIsBetter;
+};
+
+std::vector<Metric> recordedMetrics;
+std::string runningSuite;
+
+} // namespace
+
+
+void recordMetric(const std::string& name, double value, const std::string& unit, bool higherIsBetter)
+{
+    recordedMetrics.push_back({ runningSuite + "/" + name, value, unit, higherIsBetter });
+}
+
+
+/**
+ * @brief Writes the recorded measurements and a description of the machine as JSON.
+ */
+static bool writeReport(const std::string& path, bool software)
+{
+    QJsonObject host;
+    host["cpu"] = QSysInfo::currentCpuArchitecture();
+    host["os"] = QSysInfo::prettyProductName();
+    host["name"] = QSysInfo::machineHostName();
+    host["threads"] = static_cast<int>(std::thread::hardware_concurrency());
+    host["software"] = software;
+
+    QJsonArray metrics;
+    for (const Metric& metric : recordedMetrics)
+    {
+        QJsonObject entry;
+        entry["name"] = QString::fromStdString(metric.name);
+        entry["value"] = metric.value;
+        entry["unit"] = QString::fromStdString(metric.unit);
+        entry["better"] = metric.higherIsBetter ? "higher" : "lower";
+        metrics.append(entry);
+    }
+
+    QJsonObject report;
+    report["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["host"] = host;
+    report["metrics"] = metrics;
+
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        std::fprintf(stderr, "Could not write %s: %s\n", path.c_str(), qPrintable(file.errorString()));
+        return false;
+    }
+    file.write(QJsonDocument(report).toJson());
+    return true;
+}
+
+
+/**
+ * @brief Compares the recorded measurements with a report written earlier.
+ *
+ * Measurements missing from the baseline are listed as new and never fail.
+ *
+ * @param path The baseline report.
+ * @param tolerance Relative change beyond which a measurement regressed, e.g. 0.1.
+ * @return int 0 if nothing regressed, 2 if something did, 1 if the baseline cannot be read.
+ */
+static int compareWithBaseline(const std::string& path, double tolerance)
+{
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        std::fprintf(stderr, "Could not read %s: %s\n", path.c_str(), qPrintable(file.errorString()));
+        return 1;
+    }
+
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+    if (!document.isObject())
+    {
+        std::fprintf(stderr, "Could not parse %s: %s\n", path.c_str(), qPrintable(error.errorString()));
+        return 1;
+    }
+
+    std::map<std::string, double> baseline;
+    for (const QJsonValue& value : document.object()["metrics"].toArray())
+    {
+        const QJsonObject entry = value.toObject();
+        baseline[entry["name"].toString().toStdString()] = entry["value"].toDouble();
+    }
+
+    std::printf("\n%-48s %14s %14s %10s  %s\n", "metric", "baseline", "current", "change", "status");
+
+    int regressions = 0;
+    for (const Metric& metric : recordedMetrics)
+    {
+        const auto found = baseline.find(metric.name);
+        if (found == baseline.end())
+        {
+            std::printf("%-48s %14s %14.4g %10s  new\n", metric.name.c_str(), "-", metric.value, "-");
+            continue;
+        }
+
+        const double reference = found->second;
+        const double change = reference != 0.0 ? (metric.value - reference) / reference : 0.0;
+        const double worsening = metric.higherIsBetter ? -change : change;
+
+        const char* status = "ok";
+        if (worsening > tolerance)
+        {
+            status = "REGRESSED";
+            ++regressions;
+        }
+        else if (worsening < -tolerance)
+        {
+            status = "improved";
+        }
+
+        std::printf("%-48s %14.4g %14.4g %+9.1f%%  %s\n", metric.name.c_str(), reference, metric.value, change * 100.0, status);
+    }
+
+    std::printf("\n%d of %zu measurements regressed by more than %.1f%%\n",
+                regressions, recordedMetrics.size(), tolerance * 100.0);
+    return regressions > 0 ? 2 : 0;
+}
+
+
+/**
+ * @brief Selects Mesa's software rasterizer for every window created afterwards.
+ */
+static void useSoftwareRendering()
+{
+#ifdef _WIN32
+    _putenv_s("LIBGL_ALWAYS_SOFTWARE", "1");
+    _putenv_s("GALLIUM_DRIVER", "llvmpipe");
+#else
+    setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+    setenv("GALLIUM_DRIVER", "llvmpipe", 1);
+#endif
+}
+
+
+int main(int argc, char** argv)
+{
+    const std::map<std::string, std::function<int(const BenchmarkArgs&)>> suites = {
+        { "scene", runSceneBenchmark },
+        { "instancing", runInstancingBenchmark },
+        { "stl", runStlBenchmark },
+        { "stlwrite", runStlWriteBenchmark },
+        { "shapes", runShapeBenchmark },
+        { "transform", runTransformBenchmark },
+        { "merge", runMergeBenchmark },
+        { "pick", runPickBenchmark },
+        { "interference", runInterferenceBenchmark },
+        { "history", runHistoryBenchmark },
+        { "batch", runBatchBenchmark },
+        { "storage", runStorageBenchmark },
+        { "edit", runEditBenchmark },
+        { "primitives", runPrimitiveBenchmark },
+        { "normals", runNormalsBenchmark },
+        { "repair", runRepairBenchmark },
+        { "meshcache", runMeshFileBenchmark },
+        { "project", runProjectBenchmark },
+    };
+
+    const std::string selected = argc >= 2 ? argv[1] : "";
+    if (selected != "all" && !suites.count(selected))
+    {
+        std::fprintf(stderr, "Usage: %s <suite> [options]\nSuites: all", argv[0]);
+        for (const auto& suite : suites)
+            std::fprintf(stderr, " %s", suite.first.c_str());
+        std::fprintf(stderr, "\n");
+        return 1;
+    }
+
+    const BenchmarkArgs args(argv + 2, argv + argc);
+
+    const bool software = std::find(args.begin(), args.end(), "--software") != args.end();
+    if (software)
+        useSoftwareRendering();
+
+    const std::string tracePath = argumentValue(args, "trace", "");
+    Trace::setEnabled(!tracePath.empty());
+
+    int status = 0;
+    for (const auto& suite : suites)
+    {
+        if (selected != "all" && suite.first != selected)
+            continue;
+
+        if (selected == "all")
+            std::printf("\n== %s ==\n", suite.first.c_str());
+
+        runningSuite = suite.first;
+        status = std::max(status, suite.second(args));
+    }
+
+    if (!tracePath.empty())
+    {
+        const QString error = Trace::exportChromeJson(QString::fromStdString(tracePath));
+        if (!error.isEmpty())
+        {
+            std::fprintf(stderr, "Could not write %s: %s\n", tracePath.c_str(), qPrintable(error));
+            status = std::max(status, 1);
+        }
+    }
+
+    const std::string jsonPath = argumentValue(args, "json", "");
+    if (!jsonPath.empty() && !writeReport(jsonPath, software))
+        status = std::max(status, 1);
+
+    const std::string baselinePath = argumentValue(args, "baseline", "");
+    if (!baselinePath.empty())
+    {
+        const double tolerance = std::atof(argumentValue(args, "tolerance", "10").c_str()) / 100.0;
+        status = std::max(status, compareWithBaseline(baselinePath, tolerance));
+    }
+
+    return status;
+}
@@ -0,0 +1,129 @@
+/**
+ * @file mergeBenchmark.cpp
+ * @brief Benchmark of MeshMerger: merge time and the frame time won by drawing one mapper.
+ *
+ * For each count, a grid of copies of one shape, each with its own rotation, is
+ * rendered with one actor per copy. The copies are then merged into one mesh the way
+ * the merge button does it, and the merged mesh is rendered with a single actor.
+ *
+ * Options:
+ *   --counts  Comma-separated part counts (default 100,1000,5000).
+ *   --shape   Shape type of the parts (default Cube).
+ *   --frames  Number of frames averaged (default 5).
+ *   --threads MeshMerger worker threads; 0 uses every core (default 0).
+ */
+
+#include "benchmark.h"
+#include "controller.h"
+#include "meshMerger.h"
+#include "scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+
+namespace
+{
+
+/**
+ * @brief Renders the scene once to upload it, then returns the average time of the following frames.
+ */
+double frameTime(vtkRenderWindow* window, vtkRenderer* renderer, int frames)
+{
+    renderer->ResetCamera();
+    window->Render();
+
+    Stopwatch stopwatch;
+    for (int frame = 0; frame < frames; ++frame)
+        window->Render();
+    return stopwatch.elapsedMs() / frames;
+}
+
+} // namespace
+
+
+int runMergeBenchmark(const BenchmarkArgs& args)
+{
+    const std::vector<long long> counts = parseCounts(argumentValue(args, "counts", "100,1000,5000"));
+    const QString shapeType = QString::fromStdString(argumentValue(args, "shape", "Cube"));
+    const int frames = std::max(1, std::atoi(argumentValue(args, "frames", "5").c_str()));
+
+    MeshMerger::Options options;
+    options.threads = static_cast<unsigned>(std::max(0, std::atoi(argumentValue(args, "threads", "0").c_str())));
+
+    ShapeController controller;
+    vtkSmartPointer<vtkPolyDataMapper> mapper = controller.createShape(shapeType);
+    if (!mapper)
+    {
+        std::fprintf(stderr, "Unsupported shape type: %s\n", qPrintable(shapeType));
+        return 1;
+    }
+    vtkSmartPointer<vtkPolyData> mesh = mapper->GetInput();
+
+    double bounds[6];
+    mesh->GetBounds(bounds);
+    const double spacing = 1.5 * std::max({ bounds[1] - bounds[0], bounds[3] - bounds[2], bounds[5] - bounds[4] });
+
+    std::printf("%8s %12s %12s %12s %16s %16s %10s\n",
+                "parts", "cells", "welded", "merge (ms)", "separate (ms)", "merged (ms)", "speedup");
+
+    for (long long count : counts)
+    {
+        // One actor per part
+        vtkSmartPointer<vtkRenderer> renderer;
+        vtkSmartPointer<vtkRenderWindow> window = createOffscreenWindow(renderer);
+        Scene scene(renderer);
+
+        const long long side = static_cast<long long>(std::ceil(std::cbrt(static_cast<double>(count))));
+        for (long long i = 0; i < count; ++i)
+        {
+            const ObjectId id = scene.addObject(mesh);
+            const double position[3] = { (i % side) * spacing, ((i / side) % side) * spacing, (i / (side * side)) * spacing };
+            const double orientation[3] = { 0.0, (i * 37) % 360, 0.0 };
+            scene.setPosition(id, position);
+            scene.setOrientation(id, orientation);
+        }
+        scene.syncToVtk();
+        const double separateMs = frameTime(window, renderer, frames);
+
+        // Merge as the merge button does
+        std::vector<MeshMerger::Part> parts(scene.objects().size());
+        for (std::size_t i = 0; i < parts.size(); ++i)
+        {
+            const ObjectId id = scene.objects()[i];
+            parts[i].mesh = scene.mesh(id);
+            scene.getWorldMatrix(id, parts[i].matrix.data());
+        }
+
+        options.weldTolerance = MeshMerger::defaultWeldTolerance(parts);
+        Stopwatch stopwatch;
+        const MeshMerger::Result result = MeshMerger::merge(parts, options);
+        const double mergeMs = stopwatch.elapsedMs();
+        if (!result.ok())
+        {
+            std::fprintf(stderr, "MeshMerger failed: %s\n", qPrintable(result.error));
+            return 1;
+        }
+
+        // One actor for everything
+        vtkSmartPointer<vtkRenderer> mergedRenderer;
+        vtkSmartPointer<vtkRenderWindow> mergedWindow = createOffscreenWindow(mergedRenderer);
+        Scene mergedScene(mergedRenderer);
+        mergedScene.addObject(result.mesh);
+        mergedScene.syncToVtk();
+        const double mergedMs = frameTime(mergedWindow, mergedRenderer, frames);
+
+        std::printf("%8lld %12zu %12zu %12.1f %16.2f %16.2f %9.1fx\n",
+                    count, result.cells, result.weldedPoints, mergeMs, separateMs, mergedMs,
+                    mergedMs > 0.0 ? separateMs / mergedMs : 0.0);
+
+        const std::string prefix = std::to_string(count) + "/";
+        recordMetric(prefix + "merge_ms", mergeMs, "ms");
+        recordMetric(prefix + "separate_frame_ms", separateMs, "ms");
+        recordMetric(prefix + "merged_frame_ms", mergedMs, "ms");
+    }
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+/**
+ * @file meshFileBenchmark.cpp
+ * @brief Benchmark of reopening a mesh from its MeshFile cache versus parsing the STL file again.
+ *
+ * For each facet count a height field is written as binary STL and as MeshFile with
+ * float and with quantized positions, all to the temporary directory. "stl" is
+ * StlReader::read() on every core; "map" is MeshFile::read(), which returns once the
+ * file is mapped, and "map+touch" additionally reads every position and id once, so
+ * the pages really come in. The page cache is warm for all of them, as when a file is
+ * reopened during a session.
+ *
+ * Options:
+ *   --counts   Comma-separated facet counts (default 1000000,5000000).
+ *   --keep     Keep the generated files.
+ */
+
+#include "benchmark.h"
+#include "meshFile.h"
+#include "stlReader.h"
+#include "stlWriter.h"
+
+#include <QDir>
+#include <QFile>
+#include <QString>
+
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkPoints.h>
+#include <vtkTypeInt32Array.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+
+namespace
+{
+
+/**
+ * @brief Reads every position and connectivity id of a mesh once; returns their sum so the reads are not optimized away.
+ */
+double touchMesh(vtkPolyData* mesh)
+{
+    vtkFloatArray* coordinates = vtkFloatArray::SafeDownCast(mesh->GetPoints()->GetData());
+    const float* xyz = coordinates->GetPointer(0);
+    double sum = 0.0;
+    for (vtkIdType i = 0; i < 3 * coordinates->GetNumberOfTuples(); ++i)
+        sum += xyz[i];
+
+    vtkTypeInt32Array* connectivity = mesh->GetPolys()->GetConnectivityArray32();
+    const std::int32_t* ids = connectivity->GetPointer(0);
+    for (vtkIdType i = 0; i < connectivity->GetNumberOfValues(); ++i)
+        sum += ids[i];
+    return sum;
+}
+
+} // namespace
+
+
+int runMeshFileBenchmark(const BenchmarkArgs& args)
+{
+    const std::vector<long long> counts = parseCounts(argumentValue(args, "counts", "1000000,5000000"));
+    const bool keep = std::find(args.begin(), args.end(), "--keep") != args.end();
+
+    std::printf("%12s %-10s %-10s %10s %12s %10s\n", "facets", "positions", "method", "MB", "time (ms)", "speedup");
+
+    for (long long count : counts)
+    {
+        const vtkSmartPointer<vtkPolyData> mesh = makeHeightFieldMesh(count);
+        const QString stlPath = QDir::temp().filePath(QString("qtvtk_benchmark_cache_%1.stl").arg(count));
+        const StlWriter::Result written = StlWriter::write(stlPath, mesh);
+        if (!written.ok())
+        {
+            std::fprintf(stderr, "Could not write %s: %s\n", qPrintable(stlPath), qPrintable(written.error));
+            return 1;
+        }
+        const std::string prefix = std::to_string(count) + "/";
+
+        Stopwatch stopwatch;
+        const StlReader::Result parsed = StlReader::read(stlPath);
+        const double stlMs = stopwatch.elapsedMs();
+        if (!parsed.mesh)
+        {
+            std::fprintf(stderr, "StlReader failed: %s\n", qPrintable(parsed.error));
+            return 1;
+        }
+        std::printf("%12lld %-10s %-10s %10.1f %12.1f %10s\n", count, "float", "stl", parsed.bytes / 1.0e6, stlMs, "1.00");
+        recordMetric(prefix + "stl_ms", stlMs, "ms");
+
+        for (bool quantized : { false, true })
+        {
+            const char* positions = quantized ? "quantized" : "float";
+            const QString cachePath = QDir::temp().filePath(QString("qtvtk_benchmark_cache_%1_%2.mesh").arg(count).arg(positions));
+
+            MeshFile::WriteOptions options;
+            options.quantizePositions = quantized;
+            const MeshFile::Result cached = MeshFile::write(cachePath, parsed.mesh, options);
+            if (!cached.ok())
+            {
+                std::fprintf(stderr, "MeshFile::write failed: %s\n", qPrintable(cached.error));
+                return 1;
+            }
+
+            stopwatch.restart();
+            MeshFile::Result mapped = MeshFile::read(cachePath);
+            const double mapMs = stopwatch.elapsedMs();
+            if (!mapped.ok())
+            {
+                std::fprintf(stderr, "MeshFile::read failed: %s\n", qPrintable(mapped.error));
+                return 1;
+            }
+            const double sum = touchMesh(mapped.mesh);
+            const double touchMs = stopwatch.elapsedMs();
+
+            std::printf("%12lld %-10s %-10s %10.1f %12.2f %10.1f\n", count, positions, "map", cached.bytes / 1.0e6, mapMs, stlMs / mapMs);
+            std::printf("%12lld %-10s %-10s %10.1f %12.2f %10.1f  (sum %g)\n", count, positions, "map+touch", cached.bytes / 1.0e6, touchMs, stlMs / touchMs, sum);
+            recordMetric(prefix + positions + "/map_ms", mapMs, "ms");
+            recordMetric(prefix + positions + "/touch_ms", touchMs, "ms");
+            recordMetric(prefix + positions + "/file_mb", cached.bytes / 1.0e6, "MB");
+
+            if (!keep)
+                QFile::remove(cachePath);
+        }
+
+        if (!keep)
+            QFile::remove(stlPath);
+    }
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+/**
+ * @file normalsBenchmark.cpp
+ * @brief Benchmark of MeshNormals versus vtkPolyDataNormals, of cached lookups, and of baking rigid transforms.
+ *
+ * The meshes are height fields with three unshared points per facet, as STL files are
+ * read. "vtk" merges the coincident points with vtkCleanPolyData and runs
+ * vtkPolyDataNormals, which is what smooth shading of such a mesh takes with VTK;
+ * "native" is MeshNormals::compute() on increasing numbers of threads, which matches
+ * positions itself. "cached" is a MeshNormalsCache lookup of the unchanged mesh.
+ *
+ * "rotate" bakes a rotation into the mesh with normals, transforming them along with
+ * the points as Scene::bakedMesh() does; "recompute" bakes it into the mesh without
+ * normals and computes them again.
+ *
+ * Options:
+ *   --counts   Comma-separated facet counts (default 100000,1000000).
+ *   --threads  Comma-separated thread counts of the native normals; 0 uses every core (default 1,0).
+ *   --angle    Feature angle in degrees (default 30).
+ */
+
+#include "benchmark.h"
+#include "meshNormals.h"
+#include "meshNormalsCache.h"
+#include "parallel.h"
+
+#include <vtkCleanPolyData.h>
+#include <vtkNew.h>
+#include <vtkPolyDataNormals.h>
+#include <vtkTransform.h>
+#include <vtkTransformPolyDataFilter.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+
+namespace
+{
+
+/**
+ * @brief Returns the mesh transformed by a rotation about a tilted axis.
+ */
+vtkSmartPointer<vtkPolyData> rotated(vtkPolyData* mesh)
+{
+    vtkNew<vtkTransform> transform;
+    transform->RotateWXYZ(30.0, 1.0, 2.0, 3.0);
+
+    vtkNew<vtkTransformPolyDataFilter> transformFilter;
+    transformFilter->SetInputData(mesh);
+    transformFilter->SetTransform(transform);
+    transformFilter->Update();
+
+    vtkSmartPointer<vtkPolyData> result = vtkSmartPointer<vtkPolyData>::New();
+    result->ShallowCopy(transformFilter->GetOutput());
+    return result;
+}
+
+} // namespace
+
+
+int runNormalsBenchmark(const BenchmarkArgs& args)
+{
+    const std::vector<long long> counts = parseCounts(argumentValue(args, "counts", "100000,1000000"));
+    const std::vector<long long> threadCounts = parseCounts(argumentValue(args, "threads", "1,0"));
+    const double angle = std::atof(argumentValue(args, "angle", "30").c_str());
+
+    std::printf("%12s %10s %12s %8s %12s %10s\n", "facets", "method", "threads", "points", "time (ms)", "speedup");
+
+    for (long long count : counts)
+    {
+        vtkSmartPointer<vtkPolyData> mesh = makeHeightFieldMesh(count);
+        const std::string prefix = std::to_string(count) + "/";
+
+        Stopwatch stopwatch;
+        vtkNew<vtkCleanPolyData> clean;
+        clean->SetInputData(mesh);
+        vtkNew<vtkPolyDataNormals> normals;
+        normals->SetInputConnection(clean->GetOutputPort());
+        normals->SetFeatureAngle(angle);
+        normals->Update();
+        const double vtkMs = stopwatch.elapsedMs();
+        std::printf("%12lld %10s %12s %8lld %12.1f %10s\n", count, "vtk", "-",
+                    static_cast<long long>(normals->GetOutput()->GetNumberOfPoints()), vtkMs, "1.00");
+        recordMetric(prefix + "vtk_ms", vtkMs, "ms");
+
+        vtkSmartPointer<vtkPolyData> shaded;
+        for (long long threads : threadCounts)
+        {
+            MeshNormals::Options options;
+            options.featureAngle = angle;
+            options.threads = static_cast<unsigned>(std::max(0LL, threads));
+
+            stopwatch.restart();
+            shaded = MeshNormals::compute(mesh, options);
+            const double nativeMs = stopwatch.elapsedMs();
+
+            const unsigned used = threads > 0 ? static_cast<unsigned>(threads) : parallelThreadCount();
+            std::printf("%12lld %10s %12u %8lld %12.1f %10.2f\n", count, "native", used,
+                        static_cast<long long>(shaded->GetNumberOfPoints()), nativeMs, vtkMs / nativeMs);
+            recordMetric(prefix + "native/" + std::to_string(threads) + "_ms", nativeMs, "ms");
+        }
+
+        MeshNormalsCache cache;
+        cache.setFeatureAngle(angle);
+        cache.get(mesh);
+        stopwatch.restart();
+        cache.get(mesh);
+        const double cachedMs = stopwatch.elapsedMs();
+        std::printf("%12lld %10s %12s %8s %12.4f\n", count, "cached", "-", "-", cachedMs);
+        recordMetric(prefix + "cached_ms", cachedMs, "ms");
+
+        stopwatch.restart();
+        rotated(shaded);
+        const double rotateMs = stopwatch.elapsedMs();
+
+        stopwatch.restart();
+        MeshNormals::Options options;
+        options.featureAngle = angle;
+        MeshNormals::compute(rotated(mesh), options);
+        const double recomputeMs = stopwatch.elapsedMs();
+
+        std::printf("%12lld %10s %12s %8s %12.1f\n", count, "rotate", "-", "-", rotateMs);
+        std::printf("%12lld %10s %12s %8s %12.1f %10.2f\n", count, "recompute", "-", "-", recomputeMs, recomputeMs / rotateMs);
+        recordMetric(prefix + "rotate_ms", rotateMs, "ms");
+        recordMetric(prefix + "recompute_ms", recomputeMs, "ms");
+    }
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file pickBenchmark.cpp
+ * @brief Benchmark of ScenePicker: hierarchy build, pick latency and refit after moves.
+ *
+ * A grid of objects sharing one height field mesh, each rotated about Z, is picked
+ * with rays cast from above at random points of random objects. "build" is the first
+ * pick, which builds the top level and the mesh hierarchy. "pick" is the average and
+ * worst latency of the following picks. A tenth of the objects is then moved;
+ * "refit" is the pick right after, which refits the top level first.
+ *
+ * Options:
+ *   --objects  Comma-separated object counts (default 100,1000).
+ *   --facets   Facets of the shared mesh (default 200000).
+ *   --picks    Number of picks measured (default 1000).
+ */
+
+#include "benchmark.h"
+#include "scene.h"
+#include "scenePicker.h"
+
+#include <vtkMath.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+
+int runPickBenchmark(const BenchmarkArgs& args)
+{
+    const std::vector<long long> counts = parseCounts(argumentValue(args, "objects", "100,1000"));
+    const long long facets = std::max(1LL, std::atoll(argumentValue(args, "facets", "200000").c_str()));
+    const int picks = std::max(1, std::atoi(argumentValue(args, "picks", "1000").c_str()));
+
+    const vtkSmartPointer<vtkPolyData> mesh = makeHeightFieldMesh(facets);
+    double bounds[6];
+    mesh->GetBounds(bounds);
+    const double extent = std::max(bounds[1] - bounds[0], bounds[3] - bounds[2]);
+    const double spacing = 1.2 * extent;
+    const double center[2] = { (bounds[0] + bounds[1]) / 2, (bounds[2] + bounds[3]) / 2 };
+
+    std::printf("%8s %14s %12s %12s %14s %12s %8s\n",
+                "objects", "triangles", "build (ms)", "pick (us)", "worst (us)", "refit (ms)", "hits");
+
+    for (long long count : counts)
+    {
+        Scene scene;
+        std::mt19937 random(42);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+        // Objects rotate about the mesh origin, a corner of the height field, so centers are moved onto the grid
+        const long long side = static_cast<long long>(std::ceil(std::sqrt(static_cast<double>(count))));
+        for (long long i = 0; i < count; ++i)
+        {
+            const ObjectId id = scene.addObject(mesh);
+            const double orientation[3] = { 0.0, 0.0, 360.0 * unit(random) };
+            const double radians = vtkMath::RadiansFromDegrees(orientation[2]);
+            const double position[3] = {
+                (i % side) * spacing - (center[0] * std::cos(radians) - center[1] * std::sin(radians)),
+                (i / side) * spacing - (center[0] * std::sin(radians) + center[1] * std::cos(radians)),
+                0.0,
+            };
+            scene.setPosition(id, position);
+            scene.setOrientation(id, orientation);
+        }
+
+        // Rays from above, slightly tilted, at points within reach of the mesh around an object's center
+        auto castRay = [&](ScenePicker& picker) {
+            const long long i = static_cast<long long>(unit(random) * count) % count;
+            const double angle = 2.0 * vtkMath::Pi() * unit(random);
+            const double radius = 0.4 * extent * unit(random);
+            const double target[3] = { (i % side) * spacing + radius * std::cos(angle),
+                                       (i / side) * spacing + radius * std::sin(angle), 0.0 };
+            const double direction[3] = { 0.01 * (unit(random) - 0.5), 0.01 * (unit(random) - 0.5), -1.0 };
+            const double height = 2.0 * extent;
+            const double origin[3] = { target[0] - height * direction[0], target[1] - height * direction[1], height };
+            return picker.pick(origin, direction);
+        };
+
+        MeshBvhCache cache;
+        ScenePicker picker(scene, cache);
+        Stopwatch stopwatch;
+        castRay(picker);
+        const double buildMs = stopwatch.elapsedMs();
+
+        double totalUs = 0.0;
+        double worstUs = 0.0;
+        int hits = 0;
+        for (int i = 0; i < picks; ++i)
+        {
+            stopwatch.restart();
+            const ScenePicker::Hit hit = castRay(picker);
+            const double us = stopwatch.elapsedMs() * 1000.0;
+            totalUs += us;
+            worstUs = std::max(worstUs, us);
+            hits += hit.hit() ? 1 : 0;
+        }
+
+        for (std::size_t i = 0; i < scene.objects().size(); i += 10)
+        {
+            const ObjectId id = scene.objects()[i];
+            double position[3];
+            scene.getPosition(id, position);
+            position[2] += 0.1 * extent;
+            scene.setPosition(id, position);
+        }
+        stopwatch.restart();
+        castRay(picker);
+        const double refitMs = stopwatch.elapsedMs();
+
+        const ScenePicker::Statistics statistics = picker.statistics();
+        const double averageUs = totalUs / picks;
+        std::printf("%8lld %14lld %12.1f %12.2f %14.2f %12.3f %7.1f%%\n",
+                    count, count * static_cast<long long>(statistics.triangles), buildMs, averageUs, worstUs,
+                    refitMs, 100.0 * hits / picks);
+
+        const std::string prefix = std::to_string(count) + "/";
+        recordMetric(prefix + "build_ms", buildMs, "ms");
+        recordMetric(prefix + "pick_us", averageUs, "us");
+        recordMetric(prefix + "pick_worst_us", worstUs, "us");
+        recordMetric(prefix + "refit_ms", refitMs, "ms");
+    }
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file primitiveBenchmark.cpp
+ * @brief Benchmark of PrimitiveSource versus the VTK sources it replaces, at growing resolutions.
+ *
+ * For each primitive and resolution, "vtk" is the time of the VTK source or filter the
+ * built-in shape used before (vtkSphereSource, vtkConeSource, vtkCylinderSource, a
+ * vtkTubeFilter around a vtkLineSource and a vtkParametricFunctionSource sampling a
+ * vtkParametricTorus), and "native" the time of PrimitiveSource::generate() for the
+ * same primitive. The sphere and torus use the resolution in both directions, so their
+ * point count grows with its square.
+ *
+ * Options:
+ *   --resolutions  Comma-separated resolutions (default 50,100,500,1000,2000).
+ *   --repeat       Number of repetitions averaged (default 3).
+ *   --threads      Worker threads of the native generator; 0 uses every core (default 0).
+ */
+
+#include "benchmark.h"
+#include "primitiveSource.h"
+
+#include <vtkConeSource.h>
+#include <vtkCylinderSource.h>
+#include <vtkLineSource.h>
+#include <vtkParametricFunctionSource.h>
+#include <vtkParametricTorus.h>
+#include <vtkSphereSource.h>
+#include <vtkTubeFilter.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+
+namespace
+{
+
+/**
+ * @brief Returns a primitive of the given kind and resolution with the dimensions of the default shapes.
+ */
+Primitive primitiveOf(Primitive::Kind kind, int resolution)
+{
+    Primitive primitive;
+    primitive.kind = kind;
+    primitive.resolution = resolution;
+    primitive.secondaryResolution = resolution;
+    switch (kind)
+    {
+    case Primitive::Kind::Sphere: primitive.radius = 5.0; break;
+    case Primitive::Kind::Cone: primitive.radius = 0.5; break;
+    case Primitive::Kind::Cylinder: primitive.radius = 5.0; primitive.height = 20.0; break;
+    case Primitive::Kind::Tube: primitive.radius = 2.0; primitive.height = 5.0; break;
+    case Primitive::Kind::Torus: primitive.radius = 6.0; primitive.minorRadius = 3.0; break;
+    }
+    return primitive;
+}
+
+/**
+ * @brief Generates a primitive with the VTK source or filter the built-in shape used before.
+ */
+vtkSmartPointer<vtkPolyData> generateWithVtk(const Primitive& primitive)
+{
+    vtkSmartPointer<vtkAlgorithm> output;
+    switch (primitive.kind)
+    {
+    case Primitive::Kind::Sphere:
+    {
+        vtkSmartPointer<vtkSphereSource> sphereSource = vtkSmartPointer<vtkSphereSource>::New();
+        sphereSource->SetRadius(primitive.radius);
+        sphereSource->SetThetaResolution(primitive.resolution);
+        sphereSource->SetPhiResolution(primitive.secondaryResolution);
+        output = sphereSource;
+        break;
+    }
+    case Primitive::Kind::Cone:
+    {
+        vtkSmartPointer<vtkConeSource> coneSource = vtkSmartPointer<vtkConeSource>::New();
+        coneSource->SetRadius(primitive.radius);
+        coneSource->SetHeight(primitive.height);
+        coneSource->SetResolution(primitive.resolution);
+        output = coneSource;
+        break;
+    }
+    case Primitive::Kind::Cylinder:
+    {
+        vtkSmartPointer<vtkCylinderSource> cylinderSource = vtkSmartPointer<vtkCylinderSource>::New();
+        cylinderSource->SetRadius(primitive.radius);
+        cylinderSource->SetHeight(primitive.height);
+        cylinderSource->SetResolution(primitive.resolution);
+        output = cylinderSource;
+        break;
+    }
+    case Primitive::Kind::Tube:
+    {
+        vtkSmartPointer<vtkLineSource> lineSource = vtkSmartPointer<vtkLineSource>::New();
+        lineSource->SetPoint1(0.0, 0.0, 0.0);
+        lineSource->SetPoint2(0.0, primitive.height, 0.0);
+        vtkSmartPointer<vtkTubeFilter> tubeFilter = vtkSmartPointer<vtkTubeFilter>::New();
+        tubeFilter->SetInputConnection(lineSource->GetOutputPort());
+        tubeFilter->SetRadius(primitive.radius);
+        tubeFilter->SetNumberOfSides(primitive.resolution);
+        output = tubeFilter;
+        break;
+    }
+    case Primitive::Kind::Torus:
+    {
+        vtkSmartPointer<vtkParametricTorus> torus = vtkSmartPointer<vtkParametricTorus>::New();
+        torus->SetRingRadius(primitive.radius);
+        torus->SetCrossSectionRadius(primitive.minorRadius);
+        vtkSmartPointer<vtkParametricFunctionSource> functionSource = vtkSmartPointer<vtkParametricFunctionSource>::New();
+        functionSource->SetParametricFunction(torus);
+        functionSource->SetUResolution(primitive.resolution);
+        functionSource->SetVResolution(primitive.secondaryResolution);
+        output = functionSource;
+        break;
+    }
+    }
+
+    output->Update();
+    return vtkPolyData::SafeDownCast(output->GetOutputDataObject(0));
+}
+
+/**
+ * @brief Returns the mean time in milliseconds of generating a mesh, and its number of points.
+ */
+double timeGeneration(const std::function<vtkSmartPointer<vtkPolyData>()>& generate, int repeat, vtkIdType& points)
+{
+    Stopwatch stopwatch;
+    for (int i = 0; i < repeat; ++i)
+        points = generate()->GetNumberOfPoints();
+    return stopwatch.elapsedMs() / repeat;
+}
+
+} // namespace
+
+
+int runPrimitiveBenchmark(const BenchmarkArgs& args)
+{
+    const std::vector<long long> resolutions = parseCounts(argumentValue(args, "resolutions", "50,100,500,1000,2000"));
+    const int repeat = std::max(1, std::atoi(argumentValue(args, "repeat", "3").c_str()));
+    const unsigned threads = static_cast<unsigned>(std::max(0, std::atoi(argumentValue(args, "threads", "0").c_str())));
+
+    const std::pair<const char*, Primitive::Kind> kinds[] = {
+        { "sphere", Primitive::Kind::Sphere },
+        { "cone", Primitive::Kind::Cone },
+        { "cylinder", Primitive::Kind::Cylinder },
+        { "tube", Primitive::Kind::Tube },
+        { "torus", Primitive::Kind::Torus },
+    };
+
+    std::printf("%-10s %12s %12s %14s %14s %10s\n", "primitive", "resolution", "points", "vtk (ms)", "native (ms)", "speedup");
+
+    for (const auto& [name, kind] : kinds)
+    {
+        for (long long resolution : resolutions)
+        {
+            const Primitive primitive = primitiveOf(kind, static_cast<int>(std::min<long long>(resolution, PrimitiveSource::MaxResolution)));
+
+            vtkIdType points = 0;
+            const double vtkMs = timeGeneration([&] { return generateWithVtk(primitive); }, repeat, points);
+            const double nativeMs = timeGeneration([&] { return PrimitiveSource::generate(primitive, threads); }, repeat, points);
+
+            std::printf("%-10s %12lld %12lld %14.3f %14.3f %10.2f\n",
+                        name, resolution, static_cast<long long>(points), vtkMs, nativeMs, vtkMs / std::max(nativeMs, 1e-6));
+
+            const std::string prefix = std::string(name) + "/" + std::to_string(resolution) + "/";
+            recordMetric(prefix + "vtk_ms", vtkMs, "ms");
+            recordMetric(prefix + "native_ms", nativeMs, "ms");
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file projectBenchmark.cpp
+ * @brief Benchmark of saving and opening projects with ProjectFile.
+ *
+ * For each object count, objects spread over a fixed set of height field meshes are
+ * saved to a project in the temporary directory. "save" is the first save, writing
+ * every mesh; "move" saves again after every object moved, which only rewrites the
+ * table; "edit" saves after one mesh was modified. "table" is ProjectFile::read(),
+ * after which a viewer shows every object as a box, and "meshes" maps every mesh file
+ * with MeshFile::read() as ProjectLoader does.
+ *
+ * Options:
+ *   --counts   Comma-separated object counts (default 1000,10000).
+ *   --meshes   Number of distinct meshes (default 100).
+ *   --facets   Facets per mesh (default 20000).
+ *   --keep     Keep the generated project.
+ */
+
+#include "benchmark.h"
+#include "meshFile.h"
+#include "projectFile.h"
+#include "scene.h"
+
+#include <QDir>
+#include <QFile>
+#include <QString>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+
+int runProjectBenchmark(const BenchmarkArgs& args)
+{
+    const std::vector<long long> counts = parseCounts(argumentValue(args, "counts", "1000,10000"));
+    const int meshCount = std::max(1, std::atoi(argumentValue(args, "meshes", "100").c_str()));
+    const long long facets = std::max(1LL, std::atoll(argumentValue(args, "facets", "20000").c_str()));
+    const bool keep = std::find(args.begin(), args.end(), "--keep") != args.end();
+
+    std::vector<vtkSmartPointer<vtkPolyData>> meshes;
+    for (int i = 0; i < meshCount; ++i)
+        meshes.push_back(makeHeightFieldMesh(facets));
+
+    std::printf("%10s %-8s %12s %10s %10s\n", "objects", "step", "time (ms)", "meshes", "MB");
+
+    for (long long count : counts)
+    {
+        Scene scene;
+        for (long long i = 0; i < count; ++i)
+        {
+            const ObjectId id = scene.addObject(meshes[static_cast<std::size_t>(i % meshCount)]);
+            const double position[3] = { (i % 100) * 60.0, (i / 100) * 60.0, 0.0 };
+            scene.setPosition(id, position);
+        }
+        const std::vector<ObjectId> objects = scene.objects();
+        const QString path = QDir::temp().filePath(QString("qtvtk_benchmark_project_%1.qvtk").arg(count));
+        const std::string prefix = std::to_string(count) + "/";
+
+        ProjectFile project;
+        auto save = [&](const char* step) {
+            Stopwatch stopwatch;
+            const ProjectFile::SaveResult result = project.save(path, scene, objects);
+            const double ms = stopwatch.elapsedMs();
+            if (!result.ok())
+            {
+                std::fprintf(stderr, "ProjectFile::save failed: %s\n", qPrintable(result.error));
+                return false;
+            }
+            std::printf("%10lld %-8s %12.2f %10zu %10.1f\n", count, step, ms, result.meshesWritten, result.bytesWritten / 1.0e6);
+            recordMetric(prefix + step + "_ms", ms, "ms");
+            return true;
+        };
+
+        if (!save("save"))
+            return 1;
+
+        for (ObjectId id : objects)
+        {
+            double position[3];
+            scene.getPosition(id, position);
+            position[2] += 1.0;
+            scene.setPosition(id, position);
+        }
+        if (!save("move"))
+            return 1;
+
+        meshes.front()->Modified();
+        if (!save("edit"))
+            return 1;
+
+        Stopwatch stopwatch;
+        const ProjectFile::Contents contents = ProjectFile::read(path);
+        const double tableMs = stopwatch.elapsedMs();
+        if (!contents.ok())
+        {
+            std::fprintf(stderr, "ProjectFile::read failed: %s\n", qPrintable(contents.error));
+            return 1;
+        }
+        std::printf("%10lld %-8s %12.2f %10zu %10.3f\n", count, "table", tableMs, contents.meshes.size(), contents.bytes / 1.0e6);
+        recordMetric(prefix + "table_ms", tableMs, "ms");
+
+        const QDir directory(ProjectFile::meshDirectory(path));
+        stopwatch.restart();
+        for (const ProjectFile::Mesh& mesh : contents.meshes)
+        {
+            const MeshFile::Result mapped = MeshFile::read(directory.filePath(mesh.file));
+            if (!mapped.ok())
+            {
+                std::fprintf(stderr, "MeshFile::read failed: %s\n", qPrintable(mapped.error));
+                return 1;
+            }
+        }
+        const double meshesMs = stopwatch.elapsedMs();
+        std::printf("%10lld %-8s %12.2f %10zu %10s\n", count, "meshes", meshesMs, contents.meshes.size(), "");
+        recordMetric(prefix + "meshes_ms", meshesMs, "ms");
+
+        if (!keep)
+        {
+            QDir(ProjectFile::meshDirectory(path)).removeRecursively();
+            QFile::remove(path);
+        }
+    }
+
+    return 0;
+}
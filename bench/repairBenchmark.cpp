@@ -0,0 +1,139 @@
+/**
+ * @file repairBenchmark.cpp
+ * @brief Benchmark of MeshRepair versus the equivalent VTK filters on damaged STL-like meshes.
+ *
+ * The meshes are height fields with three unshared points per facet, as STL files are
+ * read, damaged in a fixed pattern: every 97th facet is reversed, every 101st repeated,
+ * every 211th left out, which opens a small hole, and every 499th collapsed onto an
+ * edge. "vtk" is vtkCleanPolyData, vtkPolyDataNormals with consistent ordering and
+ * vtkFillHolesFilter; "native" is MeshRepair::repair() on increasing numbers of threads,
+ * whose steps are listed for the last thread count.
+ *
+ * Options:
+ *   --counts   Comma-separated facet counts (default 100000,1000000).
+ *   --threads  Comma-separated thread counts of the native repair; 0 uses every core (default 1,0).
+ */
+
+#include "benchmark.h"
+#include "meshRepair.h"
+#include "parallel.h"
+
+#include <vtkCellArray.h>
+#include <vtkCleanPolyData.h>
+#include <vtkFillHolesFilter.h>
+#include <vtkNew.h>
+#include <vtkPolyDataNormals.h>
+#include <vtkTypeInt32Array.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+
+
+namespace
+{
+
+/**
+ * @brief Returns the height field soup of count facets with reversed, repeated, missing and collapsed facets.
+ */
+vtkSmartPointer<vtkPolyData> makeDamagedMesh(long long count)
+{
+    vtkSmartPointer<vtkPolyData> mesh = makeHeightFieldMesh(count);
+
+    std::vector<std::int32_t> ids;
+    ids.reserve(static_cast<std::size_t>(3 * count + 3 * (count / 101 + 1)));
+    for (long long facet = 0; facet < count; ++facet)
+    {
+        if (facet % 211 == 0)
+            continue;
+
+        std::int32_t corner[3] = {
+            static_cast<std::int32_t>(3 * facet),
+            static_cast<std::int32_t>(3 * facet + 1),
+            static_cast<std::int32_t>(3 * facet + 2) };
+        if (facet % 97 == 0)
+            std::swap(corner[1], corner[2]);
+        if (facet % 499 == 0)
+            corner[2] = corner[1];
+
+        ids.insert(ids.end(), corner, corner + 3);
+        if (facet % 101 == 0)
+            ids.insert(ids.end(), corner, corner + 3);
+    }
+
+    vtkSmartPointer<vtkTypeInt32Array> offsets = vtkSmartPointer<vtkTypeInt32Array>::New();
+    offsets->SetNumberOfValues(static_cast<vtkIdType>(ids.size() / 3 + 1));
+    for (vtkIdType cell = 0; cell < offsets->GetNumberOfValues(); ++cell)
+        offsets->SetValue(cell, static_cast<std::int32_t>(3 * cell));
+    vtkSmartPointer<vtkTypeInt32Array> connectivity = vtkSmartPointer<vtkTypeInt32Array>::New();
+    connectivity->SetNumberOfValues(static_cast<vtkIdType>(ids.size()));
+    std::copy(ids.begin(), ids.end(), connectivity->GetPointer(0));
+
+    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+    polys->SetData(offsets, connectivity);
+    mesh->SetPolys(polys);
+    return mesh;
+}
+
+} // namespace
+
+
+int runRepairBenchmark(const BenchmarkArgs& args)
+{
+    const std::vector<long long> counts = parseCounts(argumentValue(args, "counts", "100000,1000000"));
+    const std::vector<long long> threadCounts = parseCounts(argumentValue(args, "threads", "1,0"));
+
+    std::printf("%12s %10s %8s %10s %12s %10s\n", "facets", "method", "threads", "triangles", "time (ms)", "speedup");
+
+    for (long long count : counts)
+    {
+        vtkSmartPointer<vtkPolyData> mesh = makeDamagedMesh(count);
+        const std::string prefix = std::to_string(count) + "/";
+
+        Stopwatch stopwatch;
+        vtkNew<vtkCleanPolyData> clean;
+        clean->SetInputData(mesh);
+        clean->SetTolerance(1e-6);
+        vtkNew<vtkPolyDataNormals> orient;
+        orient->SetInputConnection(clean->GetOutputPort());
+        orient->ConsistencyOn();
+        orient->SplittingOff();
+        orient->ComputePointNormalsOff();
+        vtkNew<vtkFillHolesFilter> fill;
+        fill->SetInputConnection(orient->GetOutputPort());
+        fill->SetHoleSize(0.01 * mesh->GetLength());
+        fill->Update();
+        const double vtkMs = stopwatch.elapsedMs();
+        std::printf("%12lld %10s %8s %10lld %12.1f %10s\n", count, "vtk", "-",
+                    static_cast<long long>(fill->GetOutput()->GetNumberOfCells()), vtkMs, "1.00");
+        recordMetric(prefix + "vtk_ms", vtkMs, "ms");
+
+        MeshRepair::Result result;
+        for (long long threads : threadCounts)
+        {
+            MeshRepair::Options options;
+            options.threads = static_cast<unsigned>(std::max(0LL, threads));
+
+            stopwatch.restart();
+            result = MeshRepair::repair(mesh, options);
+            const double nativeMs = stopwatch.elapsedMs();
+            if (!result.ok())
+            {
+                std::fprintf(stderr, "Repair failed: %s\n", qPrintable(result.error));
+                return 1;
+            }
+
+            const unsigned used = threads > 0 ? static_cast<unsigned>(threads) : parallelThreadCount();
+            std::printf("%12lld %10s %8u %10lld %12.1f %10.2f\n", count, "native", used,
+                        static_cast<long long>(result.mesh->GetNumberOfPolys()), nativeMs, vtkMs / nativeMs);
+            recordMetric(prefix + "native/" + std::to_string(threads) + "_ms", nativeMs, "ms");
+        }
+
+        for (const MeshRepair::Step& step : result.steps)
+            std::printf("%12s %-64s %10.1f ms\n", "", qPrintable(step.description), step.seconds * 1000.0);
+        recordMetric(prefix + "open_edges", static_cast<double>(result.openEdges), "edges");
+    }
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file sceneBenchmark.cpp
+ * @brief Stress benchmark of the Scene store.
+ *
+ * Options:
+ *   --counts  Comma-separated object counts (default 10000,25000,50000,100000).
+ *   --shape   Shape type added to the scene (default Cube).
+ *   --frames  Number of frames averaged for the render time (default 5).
+ */
+
+#include "benchmark.h"
+#include "controller.h"
+#include "scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+
+int runSceneBenchmark(const BenchmarkArgs& args)
+{
+    const std::vector<long long> counts = parseCounts(argumentValue(args, "counts", "10000,25000,50000,100000"));
+    const QString shapeType = QString::fromStdString(argumentValue(args, "shape", "Cube"));
+    const int frames = std::max(1, std::atoi(argumentValue(args, "frames", "5").c_str()));
+
+    ShapeController controller;
+    vtkSmartPointer<vtkPolyDataMapper> mapper = controller.createShape(shapeType);
+    if (!mapper)
+    {
+        std::fprintf(stderr, "Unsupported shape type: %s\n", qPrintable(shapeType));
+        return 1;
+    }
+    vtkSmartPointer<vtkPolyData> mesh = mapper->GetInput();
+
+    std::printf("%10s %12s %14s %16s %14s %14s\n",
+                "objects", "add (ms)", "update (ms)", "update 1% (ms)", "first (ms)", "frame (ms)");
+
+    for (long long count : counts)
+    {
+        vtkSmartPointer<vtkRenderer> renderer;
+        vtkSmartPointer<vtkRenderWindow> window = createOffscreenWindow(renderer);
+        Scene scene(renderer);
+
+        const int side = static_cast<int>(std::ceil(std::cbrt(static_cast<double>(count))));
+
+        // Add every object on a grid and push the initial state to VTK
+        Stopwatch stopwatch;
+        for (long long i = 0; i < count; ++i)
+        {
+            const ObjectId id = scene.addObject(mesh);
+            const double position[3] = { (i % side) * 60.0, ((i / side) % side) * 60.0, (i / (side * side)) * 60.0 };
+            const double rgb[3] = { (i % 255) / 255.0, 0.5, 0.5 };
+            scene.setPosition(id, position);
+            scene.setColor(id, rgb);
+        }
+        scene.syncToVtk();
+        const double addMs = stopwatch.elapsedMs();
+
+        // Move every object
+        stopwatch.restart();
+        for (ObjectId id : scene.objects())
+        {
+            double position[3];
+            scene.getPosition(id, position);
+            position[2] += 1.0;
+            scene.setPosition(id, position);
+        }
+        scene.syncToVtk();
+        const double updateMs = stopwatch.elapsedMs();
+
+        // Move one percent of the objects: only those are synced
+        stopwatch.restart();
+        const std::vector<ObjectId>& objects = scene.objects();
+        for (std::size_t i = 0; i < objects.size(); i += 100)
+        {
+            const double rgb[3] = { 1.0, 0.0, 0.0 };
+            scene.setColor(objects[i], rgb);
+        }
+        scene.syncToVtk();
+        const double partialMs = stopwatch.elapsedMs();
+
+        renderer->ResetCamera();
+
+        stopwatch.restart();
+        window->Render();
+        const double firstFrameMs = stopwatch.elapsedMs();
+
+        stopwatch.restart();
+        for (int frame = 0; frame < frames; ++frame)
+            window->Render();
+        const double frameMs = stopwatch.elapsedMs() / frames;
+
+        std::printf("%10lld %12.1f %14.1f %16.2f %14.1f %14.1f\n",
+                    count, addMs, updateMs, partialMs, firstFrameMs, frameMs);
+
+        const std::string prefix = std::to_string(count) + "/";
+        recordMetric(prefix + "add_ms", addMs, "ms");
+        recordMetric(prefix + "update_ms", updateMs, "ms");
+        recordMetric(prefix + "update_partial_ms", partialMs, "ms");
+        recordMetric(prefix + "first_frame_ms", firstFrameMs, "ms");
+        recordMetric(prefix + "frame_ms", frameMs, "ms");
+    }
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file shapeBenchmark.cpp
+ * @brief Benchmark of ShapeController::createShape for every supported shape type.
+ *
+ * For each type, "create" is the time of a call that misses the cache and runs the
+ * VTK source, measured on a fresh controller per repetition; "cached" is the time of
+ * a call served from the cache.
+ *
+ * Then a batch of distinct shapes, cycling through the types with growing dimensions
+ * so that no two share a mesh, is generated with ShapeController::createShapes() on
+ * increasing numbers of threads, on a fresh controller each time.
+ *
+ * Options:
+ *   --repeat   Number of repetitions averaged (default 20).
+ *   --batch    Shapes generated per batch (default 10000).
+ *   --threads  Comma-separated thread counts of the batch; 0 uses every core (default 1,2,4,0).
+ */
+
+#include "benchmark.h"
+#include "controller.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+
+namespace
+{
+
+/**
+ * @brief Returns a shape of the given index: the types in turn, each a little larger than the previous one.
+ */
+std::shared_ptr<const Shape> batchShape(std::size_t index)
+{
+    const double size = 1.0 + 0.001 * static_cast<double>(index / 9);
+    switch (index % 9)
+    {
+    case 0: return std::make_shared<Cube>(30 * size, 40 * size, 50 * size);
+    case 1: return std::make_shared<Sphere>(5 * size);
+    case 2: return std::make_shared<Hemisphere>(5 * size);
+    case 3: return std::make_shared<Cone>(30 * size);
+    case 4: return std::make_shared<Pyramid>(4 * size, 15 * size);
+    case 5: return std::make_shared<Cylinder>(5 * size, 20 * size);
+    case 6: return std::make_shared<Tube>(2 * size, 5 * size);
+    case 7: return std::make_shared<Doughnut>(6 * size, 3 * size);
+    default: return std::make_shared<CurvedCylinder>(0.1 * size);
+    }
+}
+
+} // namespace
+
+
+int runShapeBenchmark(const BenchmarkArgs& args)
+{
+    const int repeat = std::max(1, std::atoi(argumentValue(args, "repeat", "20").c_str()));
+
+    std::printf("%-16s %12s %14s %14s\n", "shape", "cells", "create (ms)", "cached (ms)");
+
+    for (const QString& shapeType : ShapeController::supportedShapes())
+    {
+        vtkIdType cells = 0;
+
+        Stopwatch stopwatch;
+        for (int i = 0; i < repeat; ++i)
+        {
+            ShapeController controller;
+            vtkSmartPointer<vtkPolyDataMapper> mapper = controller.createShape(shapeType);
+            cells = mapper->GetInput()->GetNumberOfPolys() + mapper->GetInput()->GetNumberOfStrips();
+        }
+        const double createMs = stopwatch.elapsedMs() / repeat;
+
+        ShapeController controller;
+        controller.createShape(shapeType);
+
+        stopwatch.restart();
+        for (int i = 0; i < repeat; ++i)
+            controller.createShape(shapeType);
+        const double cachedMs = stopwatch.elapsedMs() / repeat;
+
+        std::printf("%-16s %12lld %14.3f %14.4f\n", qPrintable(shapeType), static_cast<long long>(cells), createMs, cachedMs);
+
+        const std::string prefix = QString(shapeType).replace(' ', '_').toStdString() + "/";
+        recordMetric(prefix + "create_ms", createMs, "ms");
+        recordMetric(prefix + "cached_ms", cachedMs, "ms");
+    }
+
+    const long long batch = std::max(1, std::atoi(argumentValue(args, "batch", "10000").c_str()));
+    const std::vector<long long> threadCounts = parseCounts(argumentValue(args, "threads", "1,2,4,0"));
+
+    std::vector<ShapeController::ShapeRequest> requests(static_cast<std::size_t>(batch));
+    for (std::size_t i = 0; i < requests.size(); ++i)
+        requests[i].shape = batchShape(i);
+
+    std::printf("\n%-10s %8s %14s %14s %10s\n", "batch", "threads", "time (ms)", "shapes/s", "speedup");
+
+    double singleMs = 0.0;
+    for (long long threads : threadCounts)
+    {
+        ShapeController controller;
+        controller.cache().setCapacity(std::size_t(4) << 30);
+
+        Stopwatch stopwatch;
+        for (const ShapeController::MeshFuture& future : controller.createShapes(requests, static_cast<unsigned>(std::max(0LL, threads))))
+            future.wait();
+        const double batchMs = stopwatch.elapsedMs();
+        if (singleMs == 0.0)
+            singleMs = batchMs;
+
+        const unsigned used = threads > 0 ? static_cast<unsigned>(threads) : parallelThreadCount();
+        std::printf("%-10lld %8u %14.1f %14.0f %10.2f\n", batch, used, batchMs, batch / (batchMs / 1000.0), singleMs / batchMs);
+
+        recordMetric("batch/" + std::to_string(threads) + "/shapes_per_s", batch / (batchMs / 1000.0), "shapes/s", true);
+    }
+
+    return 0;
+}
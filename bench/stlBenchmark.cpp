@@ -0,0 +1,293 @@
+/**
+ * @file stlBenchmark.cpp
+ * @brief Compares StlReader and StlWriter with vtkSTLReader and vtkSTLWriter.
+ *
+ * Suite "stl": for each facet count a synthetic STL file is written to the temporary
+ * directory and read back once with each reader. Read time and throughput are reported;
+ * the files are removed afterwards unless --keep is given. 50M binary facets need about
+ * 2.5 GB of disk.
+ *
+ * Suite "stlwrite": for each facet count a synthetic mesh is built in memory and written
+ * as binary STL once with each writer.
+ *
+ * Options of "stl":
+ *   --counts   Comma-separated facet counts (default 1000000,5000000,10000000).
+ *   --format   "binary" or "ascii" (default binary).
+ *   --threads  StlReader worker threads; 0 uses every core (default 0).
+ *   --readers  "stlreader", "vtk" or "both" (default both).
+ *   --keep     Keep the generated files.
+ *
+ * Options of "stlwrite":
+ *   --counts   Comma-separated facet counts (default 1000000,5000000,10000000).
+ *   --threads  StlWriter worker threads; 0 uses every core (default 0).
+ *   --writers  "stlwriter", "vtk" or "both" (default both).
+ */
+
+#include "benchmark.h"
+#include "stlReader.h"
+#include "stlWriter.h"
+
+#include <QDir>
+#include <QFile>
+#include <QString>
+
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkPoints.h>
+#include <vtkSTLReader.h>
+#include <vtkSTLWriter.h>
+#include <vtkTypeInt32Array.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+namespace
+{
+
+/**
+ * @brief Triangulated height field with count facets; two facets per grid cell.
+ */
+class HeightField
+{
+public:
+    explicit HeightField(long long count)
+        : mSide(std::max<long long>(1, static_cast<long long>(std::sqrt(count / 2.0)) + 1)) {}
+
+    /// Writes corner (0-2) of facet index to xyz.
+    void vertex(long long index, int corner, float* xyz) const
+    {
+        static const int upper[3][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 } };
+        static const int lower[3][2] = { { 1, 0 }, { 1, 1 }, { 0, 1 } };
+
+        const long long cell = index / 2;
+        const int* offset = (index % 2 == 0) ? upper[corner] : lower[corner];
+        const long long i = cell % mSide + offset[0];
+        const long long j = cell / mSide + offset[1];
+        xyz[0] = static_cast<float>(i);
+        xyz[1] = static_cast<float>(j);
+        xyz[2] = static_cast<float>(std::sin(i * 0.05) * std::cos(j * 0.05));
+    }
+
+private:
+    long long mSide;
+};
+
+} // namespace
+
+
+/**
+ * @brief Builds a height field mesh of count facets with three unshared points per facet.
+ */
+vtkSmartPointer<vtkPolyData> makeHeightFieldMesh(long long count)
+{
+    const HeightField field(count);
+
+    vtkSmartPointer<vtkFloatArray> coordinates = vtkSmartPointer<vtkFloatArray>::New();
+    coordinates->SetNumberOfComponents(3);
+    coordinates->SetNumberOfTuples(count * 3);
+    vtkSmartPointer<vtkTypeInt32Array> offsets = vtkSmartPointer<vtkTypeInt32Array>::New();
+    offsets->SetNumberOfValues(count + 1);
+    vtkSmartPointer<vtkTypeInt32Array> connectivity = vtkSmartPointer<vtkTypeInt32Array>::New();
+    connectivity->SetNumberOfValues(count * 3);
+
+    float* xyz = coordinates->GetPointer(0);
+    for (long long facet = 0; facet < count; ++facet)
+    {
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            field.vertex(facet, corner, xyz + 9 * facet + 3 * corner);
+            connectivity->SetValue(3 * facet + corner, static_cast<std::int32_t>(3 * facet + corner));
+        }
+        offsets->SetValue(facet, static_cast<std::int32_t>(3 * facet));
+    }
+    offsets->SetValue(count, static_cast<std::int32_t>(3 * count));
+
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetData(coordinates);
+    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+    polys->SetData(offsets, connectivity);
+
+    vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
+    mesh->SetPoints(points);
+    mesh->SetPolys(polys);
+    return mesh;
+}
+
+
+namespace
+{
+
+/**
+ * @brief Writes count facets of a triangulated height field, so neighbouring facets share points.
+ */
+bool writeStl(const QString& path, long long count, bool ascii)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    const HeightField field(count);
+
+    QByteArray buffer;
+    buffer.reserve(1 << 22);
+
+    if (ascii)
+    {
+        buffer.append("solid benchmark\n");
+        char line[128];
+        for (long long facet = 0; facet < count; ++facet)
+        {
+            buffer.append("  facet normal 0 0 1\n    outer loop\n");
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                float xyz[3];
+                field.vertex(facet, corner, xyz);
+                const int length = std::snprintf(line, sizeof(line), "      vertex %g %g %g\n", xyz[0], xyz[1], xyz[2]);
+                buffer.append(line, length);
+            }
+            buffer.append("    endloop\n  endfacet\n");
+
+            if (buffer.size() > (1 << 22))
+            {
+                file.write(buffer);
+                buffer.clear();
+            }
+        }
+        buffer.append("endsolid benchmark\n");
+    }
+    else
+    {
+        char header[80] = "QtVTKBenchmark binary STL";
+        buffer.append(header, sizeof(header));
+        const std::uint32_t facets = static_cast<std::uint32_t>(count);
+        buffer.append(reinterpret_cast<const char*>(&facets), sizeof(facets));
+
+        char record[50] = {};
+        for (long long facet = 0; facet < count; ++facet)
+        {
+            const float normal[3] = { 0.0f, 0.0f, 1.0f };
+            std::memcpy(record, normal, sizeof(normal));
+            for (int corner = 0; corner < 3; ++corner)
+                field.vertex(facet, corner, reinterpret_cast<float*>(record + 12 + 12 * corner));
+            buffer.append(record, sizeof(record));
+
+            if (buffer.size() > (1 << 22))
+            {
+                file.write(buffer);
+                buffer.clear();
+            }
+        }
+    }
+
+    file.write(buffer);
+    return file.error() == QFileDevice::NoError;
+}
+
+} // namespace
+
+
+int runStlBenchmark(const BenchmarkArgs& args)
+{
+    const std::vector<long long> counts = parseCounts(argumentValue(args, "counts", "1000000,5000000,10000000"));
+    const bool ascii = argumentValue(args, "format", "binary") == "ascii";
+    const std::string readers = argumentValue(args, "readers", "both");
+    const bool keep = std::find(args.begin(), args.end(), "--keep") != args.end();
+
+    StlReader::Options options;
+    options.threads = static_cast<unsigned>(std::max(0, std::atoi(argumentValue(args, "threads", "0").c_str())));
+
+    std::printf("%-10s %-7s %12s %10s %12s %10s\n", "reader", "format", "facets", "MB", "time (ms)", "MB/s");
+
+    for (long long count : counts)
+    {
+        const QString path = QDir::temp().filePath(QString("qtvtk_benchmark_%1.stl").arg(count));
+        if (!writeStl(path, count, ascii))
+        {
+            std::fprintf(stderr, "Could not write %s\n", qPrintable(path));
+            return 1;
+        }
+
+        const double megabytes = QFile(path).size() / 1.0e6;
+        const char* format = ascii ? "ascii" : "binary";
+
+        if (readers != "vtk")
+        {
+            Stopwatch stopwatch;
+            const StlReader::Result result = StlReader::read(path, options);
+            const double ms = stopwatch.elapsedMs();
+            if (!result.mesh)
+                std::fprintf(stderr, "StlReader failed: %s\n", qPrintable(result.error));
+            std::printf("%-10s %-7s %12lld %10.1f %12.1f %10.1f\n", "StlReader", format, count, megabytes, ms, megabytes / (ms / 1000.0));
+            recordMetric(std::string("stlreader/") + format + "/" + std::to_string(count) + "/read_mbps", megabytes / (ms / 1000.0), "MB/s", true);
+        }
+
+        if (readers != "stlreader")
+        {
+            Stopwatch stopwatch;
+            vtkSmartPointer<vtkSTLReader> reader = vtkSmartPointer<vtkSTLReader>::New();
+            reader->SetFileName(path.toStdString().c_str());
+            reader->Update();
+            const double ms = stopwatch.elapsedMs();
+            std::printf("%-10s %-7s %12lld %10.1f %12.1f %10.1f\n", "vtk", format, count, megabytes, ms, megabytes / (ms / 1000.0));
+            recordMetric(std::string("vtk/") + format + "/" + std::to_string(count) + "/read_mbps", megabytes / (ms / 1000.0), "MB/s", true);
+        }
+
+        if (!keep)
+            QFile::remove(path);
+    }
+
+    return 0;
+}
+
+
+int runStlWriteBenchmark(const BenchmarkArgs& args)
+{
+    const std::vector<long long> counts = parseCounts(argumentValue(args, "counts", "1000000,5000000,10000000"));
+    const std::string writers = argumentValue(args, "writers", "both");
+
+    StlWriter::Options options;
+    options.threads = static_cast<unsigned>(std::max(0, std::atoi(argumentValue(args, "threads", "0").c_str())));
+
+    std::printf("%-10s %12s %10s %12s %10s\n", "writer", "facets", "MB", "time (ms)", "MB/s");
+
+    for (long long count : counts)
+    {
+        const vtkSmartPointer<vtkPolyData> mesh = makeHeightFieldMesh(count);
+        const QString path = QDir::temp().filePath(QString("qtvtk_benchmark_write_%1.stl").arg(count));
+
+        if (writers != "vtk")
+        {
+            Stopwatch stopwatch;
+            const StlWriter::Result result = StlWriter::write(path, mesh, options);
+            const double ms = stopwatch.elapsedMs();
+            if (!result.ok())
+                std::fprintf(stderr, "StlWriter failed: %s\n", qPrintable(result.error));
+            const double megabytes = QFile(path).size() / 1.0e6;
+            std::printf("%-10s %12lld %10.1f %12.1f %10.1f\n", "StlWriter", count, megabytes, ms, megabytes / (ms / 1000.0));
+            recordMetric("stlwriter/" + std::to_string(count) + "/write_mbps", megabytes / (ms / 1000.0), "MB/s", true);
+            QFile::remove(path);
+        }
+
+        if (writers != "stlwriter")
+        {
+            Stopwatch stopwatch;
+            vtkSmartPointer<vtkSTLWriter> writer = vtkSmartPointer<vtkSTLWriter>::New();
+            writer->SetFileName(path.toStdString().c_str());
+            writer->SetFileTypeToBinary();
+            writer->SetInputData(mesh);
+            writer->Write();
+            const double ms = stopwatch.elapsedMs();
+            const double megabytes = QFile(path).size() / 1.0e6;
+            std::printf("%-10s %12lld %10.1f %12.1f %10.1f\n", "vtk", count, megabytes, ms, megabytes / (ms / 1000.0));
+            recordMetric("vtk/" + std::to_string(count) + "/write_mbps", megabytes / (ms / 1000.0), "MB/s", true);
+            QFile::remove(path);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file storageBenchmark.cpp
+ * @brief Benchmark of MeshStorage: memory per triangle of the default and compact storage.
+ *
+ * Every supported shape is generated in the default mode and measured as produced and
+ * after MeshStorage::compact(); then the same is done for height fields of increasing
+ * size, whose points are stored as doubles and whose cells use 64-bit ids as a VTK
+ * filter would leave them, together with the time of the conversion.
+ *
+ * Options:
+ *   --counts   Comma-separated facet counts of the height fields (default 1000000,10000000).
+ */
+
+#include "benchmark.h"
+#include "controller.h"
+#include "meshStorage.h"
+
+#include <vtkCellArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkPoints.h>
+#include <vtkTypeInt64Array.h>
+
+#include <cstdio>
+
+
+namespace
+{
+
+/**
+ * @brief Returns a copy of the mesh with double points and 64-bit cell ids.
+ */
+vtkSmartPointer<vtkPolyData> widen(vtkPolyData* mesh)
+{
+    // Copying into arrays of the wider types converts the values
+    vtkSmartPointer<vtkDoubleArray> coordinates = vtkSmartPointer<vtkDoubleArray>::New();
+    coordinates->DeepCopy(mesh->GetPoints()->GetData());
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetData(coordinates);
+
+    vtkSmartPointer<vtkTypeInt64Array> offsets = vtkSmartPointer<vtkTypeInt64Array>::New();
+    offsets->DeepCopy(mesh->GetPolys()->GetOffsetsArray());
+    vtkSmartPointer<vtkTypeInt64Array> connectivity = vtkSmartPointer<vtkTypeInt64Array>::New();
+    connectivity->DeepCopy(mesh->GetPolys()->GetConnectivityArray());
+    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+    polys->SetData(offsets, connectivity);
+
+    vtkSmartPointer<vtkPolyData> result = vtkSmartPointer<vtkPolyData>::New();
+    result->SetPoints(points);
+    result->SetPolys(polys);
+    return result;
+}
+
+/**
+ * @brief Prints one row of the table and records its memory per triangle.
+ */
+void report(const std::string& name, vtkPolyData* mesh, vtkPolyData* compact, double convertMs)
+{
+    const MeshStorage::Footprint before = MeshStorage::measure(mesh);
+    const MeshStorage::Footprint after = MeshStorage::measure(compact);
+    std::printf("%-20s %12zu %14.1f %14.1f %10.2f %14.3f\n", name.c_str(), before.triangles,
+                before.bytesPerTriangle(), after.bytesPerTriangle(),
+                after.bytes() > 0 ? static_cast<double>(before.bytes()) / after.bytes() : 0.0, convertMs);
+
+    recordMetric(name + "/default_bytes_per_triangle", before.bytesPerTriangle(), "B");
+    recordMetric(name + "/compact_bytes_per_triangle", after.bytesPerTriangle(), "B");
+}
+
+} // namespace
+
+
+int runStorageBenchmark(const BenchmarkArgs& args)
+{
+    const std::vector<long long> counts = parseCounts(argumentValue(args, "counts", "1000000,10000000"));
+
+    MeshStorage::setMode(MeshStorage::Mode::Default);
+
+    std::printf("%-20s %12s %14s %14s %10s %14s\n", "mesh", "triangles", "default (B/t)", "compact (B/t)", "ratio", "convert (ms)");
+
+    for (const QString& shapeType : ShapeController::supportedShapes())
+    {
+        vtkSmartPointer<vtkPolyData> mesh = ShapeController::makeShape(shapeType)->createMesh();
+
+        Stopwatch stopwatch;
+        vtkSmartPointer<vtkPolyData> compact = MeshStorage::compact(mesh);
+        const double convertMs = stopwatch.elapsedMs();
+
+        report(QString(shapeType).replace(' ', '_').toStdString(), mesh, compact, convertMs);
+    }
+
+    for (long long count : counts)
+    {
+        vtkSmartPointer<vtkPolyData> mesh = widen(makeHeightFieldMesh(count));
+
+        Stopwatch stopwatch;
+        vtkSmartPointer<vtkPolyData> compact = MeshStorage::compact(mesh);
+        const double convertMs = stopwatch.elapsedMs();
+
+        report("heightfield/" + std::to_string(count), mesh, compact, convertMs);
+        recordMetric("heightfield/" + std::to_string(count) + "/convert_ms", convertMs, "ms");
+    }
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file transformBenchmark.cpp
+ * @brief Benchmark of box widget drags on meshes of growing size.
+ *
+ * A BoxWidgetCallback is driven without an interactor: the box representation's
+ * transform is set to a small rotation per step and the callback receives the same
+ * events a drag produces. "drag" is the callback time per InteractionEvent, "frame"
+ * adds the offscreen render of the previewed transform, and "release" is the
+ * EndInteractionEvent, which bakes the transform into the mesh.
+ *
+ * Options:
+ *   --counts  Comma-separated facet counts (default 10000,100000,1000000).
+ *   --events  Number of interaction events per drag (default 50).
+ */
+
+#include "benchmark.h"
+#include "boxWidgetCallback.h"
+#include "scene.h"
+
+#include <vtkBoxRepresentation.h>
+#include <vtkBoxWidget2.h>
+#include <vtkTransform.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+
+int runTransformBenchmark(const BenchmarkArgs& args)
+{
+    const std::vector<long long> counts = parseCounts(argumentValue(args, "counts", "10000,100000,1000000"));
+    const int events = std::max(1, std::atoi(argumentValue(args, "events", "50").c_str()));
+
+    std::printf("%12s %12s %12s %14s\n", "facets", "drag (ms)", "frame (ms)", "release (ms)");
+
+    for (long long count : counts)
+    {
+        vtkSmartPointer<vtkRenderer> renderer;
+        vtkSmartPointer<vtkRenderWindow> window = createOffscreenWindow(renderer);
+        Scene scene(renderer);
+
+        const ObjectId id = scene.addObject(makeHeightFieldMesh(count));
+        scene.syncToVtk();
+        renderer->ResetCamera();
+        window->Render();
+
+        vtkNew<vtkBoxRepresentation> representation;
+        representation->PlaceWidget(scene.actor(id)->GetBounds());
+        vtkNew<vtkBoxWidget2> widget;
+        widget->SetRepresentation(representation);
+
+        vtkNew<BoxWidgetCallback> callback;
+        callback->TargetScene = &scene;
+        callback->TargetObject = id;
+        callback->Mode = BoxWidgetCallback::BakeMode::OnRelease;
+
+        callback->Execute(widget, vtkCommand::StartInteractionEvent, nullptr);
+
+        vtkNew<vtkTransform> transform;
+        double dragMs = 0.0;
+        double frameMs = 0.0;
+        for (int event = 0; event < events; ++event)
+        {
+            transform->RotateZ(0.5);
+            representation->SetTransform(transform);
+
+            Stopwatch stopwatch;
+            callback->Execute(widget, vtkCommand::InteractionEvent, nullptr);
+            dragMs += stopwatch.elapsedMs();
+
+            window->Render();
+            frameMs += stopwatch.elapsedMs();
+        }
+        dragMs /= events;
+        frameMs /= events;
+
+        Stopwatch stopwatch;
+        callback->Execute(widget, vtkCommand::EndInteractionEvent, nullptr);
+        const double releaseMs = stopwatch.elapsedMs();
+
+        std::printf("%12lld %12.3f %12.2f %14.1f\n", count, dragMs, frameMs, releaseMs);
+
+        const std::string prefix = std::to_string(count) + "/";
+        recordMetric(prefix + "drag_ms", dragMs, "ms");
+        recordMetric(prefix + "frame_ms", frameMs, "ms");
+        recordMetric(prefix + "release_ms", releaseMs, "ms");
+    }
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "model.h"
+#include "scene.h"
+#include "shapeCache.h"
+
+#include <vtkPolyData.h>
+#include <vtkRenderer.h>
+#include <vtkWeakPointer.h>
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+
+/**
+ * @class AdaptiveTessellation
+ * @brief Regenerates parametric shapes at the resolution their size on screen calls for.
+ *
+ * Tracked objects remember the Shape they were generated from. update() converts a
+ * pixel tolerance into a chordal error in the object's model units, from the camera
+ * and the object's world scale, and regenerates the mesh through the ShapeCache with
+ * the matching TessellationPolicy: close shapes get more segments, distant ones fewer.
+ *
+ * To keep zooming from regenerating on every frame, an object is only regenerated
+ * once the error it calls for differs from the error of its current mesh by more than
+ * the hysteresis factor, either way. Regeneration is skipped while the user interacts
+ * and limited by a time budget per update; the rest waits for the next update.
+ *
+ * Objects stop being tracked when their mesh is replaced by anything else, such as a
+ * baked transform, so edits are never overwritten. Instanced objects are not tracked.
+ */
+class AdaptiveTessellation
+{
+public:
+    /**
+     * @brief Snapshot of the tessellation counters.
+     */
+    struct Statistics
+    {
+        std::size_t tracked = 0;       ///< Objects whose resolution is adapted.
+        std::size_t regenerations = 0; ///< Meshes swapped for another resolution.
+    };
+
+    /// Default tolerated deviation from the true surface, in pixels.
+    static constexpr double DefaultPixelError = 0.5;
+
+    /// Default factor the wanted error may drift from the current one before regenerating.
+    static constexpr double DefaultHysteresis = 2.0;
+
+    /// Time an update may spend regenerating meshes, in milliseconds.
+    static constexpr double BudgetMs = 8.0;
+
+    /**
+     * @brief Constructs the manager.
+     *
+     * @param cache Cache the meshes are generated through.
+     */
+    explicit AdaptiveTessellation(ShapeCache& cache);
+
+    AdaptiveTessellation(const AdaptiveTessellation&) = delete;
+    AdaptiveTessellation& operator=(const AdaptiveTessellation&) = delete;
+
+    /// @brief Enables or disables adaptation. Disabled, update() restores the default resolutions.
+    void setEnabled(bool enabled) { mEnabled = enabled; }
+    bool isEnabled() const { return mEnabled; }
+
+    /// @brief Tells whether the user is interacting; no mesh is regenerated meanwhile.
+    void setInteracting(bool interacting) { mInteracting = interacting; }
+
+    /**
+     * @brief Sets the tolerated deviation from the true surface, in pixels.
+     */
+    void setPixelError(double pixels);
+    double pixelError() const { return mPixelError; }
+
+    /**
+     * @brief Sets how far the wanted error may drift before an object is regenerated.
+     *
+     * @param factor Ratio between the wanted and the current error; values below 1 are clamped to 1.
+     */
+    void setHysteresis(double factor);
+
+    /**
+     * @brief Starts adapting the resolution of an object.
+     *
+     * @param id The object; it must currently show the shape's mesh.
+     * @param shape The shape the object's mesh was generated from.
+     * @param mesh The object's current mesh.
+     * @param error Chordal error the mesh was generated for; 0 for the default resolution.
+     */
+    void track(ObjectId id, std::unique_ptr<Shape> shape, vtkPolyData* mesh, double error = 0.0);
+
+    /**
+     * @brief Returns a copy of the shape an object shows, if it still shows a tracked shape's mesh.
+     *
+     * @param scene The scene the object belongs to.
+     * @param id The object.
+     * @param error Receives the chordal error its mesh was generated for, 0 for the default resolution; may be null.
+     * @return std::unique_ptr<Shape> The shape, or nullptr if the object is not tracked or its mesh was replaced.
+     */
+    std::unique_ptr<Shape> trackedShape(const Scene& scene, ObjectId id, double* error = nullptr) const;
+
+    /**
+     * @brief Stops adapting the resolution of an object. Its current mesh is kept.
+     */
+    void untrack(ObjectId id);
+
+    /**
+     * @brief Regenerates the tracked objects whose resolution no longer suits the view.
+     *
+     * Must be called from the thread that renders, before the scene is synced.
+     *
+     * @param scene The scene the objects belong to.
+     * @param renderer The renderer whose camera and viewport define the screen.
+     * @return std::size_t Number of objects regenerated.
+     */
+    std::size_t update(Scene& scene, vtkRenderer* renderer);
+
+    /**
+     * @brief Returns true if the last update() ran out of time before every object was handled.
+     */
+    bool hasPendingWork() const { return mPending; }
+
+    /**
+     * @brief Returns the current counters.
+     */
+    Statistics statistics() const;
+
+private:
+    struct Entry
+    {
+        std::unique_ptr<Shape> shape;
+        vtkWeakPointer<vtkPolyData> mesh; ///< The mesh last assigned to the object.
+        ShapeKey key;                     ///< Key of that mesh.
+        double error = 0.0;               ///< Chordal error it was generated for; 0 for the default resolution.
+    };
+
+    ShapeCache& mCache;
+    std::unordered_map<ObjectId, Entry> mEntries;
+
+    bool mEnabled = true;
+    bool mInteracting = false;
+    bool mPending = false;
+    double mPixelError = DefaultPixelError;
+    double mHysteresis = DefaultHysteresis;
+    std::size_t mRegenerations = 0;
+};
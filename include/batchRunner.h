@@ -0,0 +1,136 @@
+#pragma once
+
+#include <QString>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @class BatchRunner
+ * @brief Runs modeling jobs without a GUI: builds parts from shapes and STL files, transforms, merges and exports them.
+ *
+ * A job places one or more parts, each a built-in shape of ShapeController or a loaded
+ * STL file, with the same position, orientation and scale semantics as scene objects,
+ * merges them into one mesh through MeshMerger and writes it as binary STL, optionally
+ * with its color in every facet's attribute word.
+ *
+ * Jobs run concurrently, one per worker thread, and each job runs its own steps on its
+ * worker alone. Shapes come from a shared ShapeCache and every STL file is read once
+ * however many jobs use it. No window, renderer or OpenGL context is created.
+ *
+ * A job's output depends only on its description, never on scheduling, so the same job
+ * file always produces byte-identical files.
+ *
+ * Job files are JSON:
+ * @code
+ * {
+ *   "outputDirectory": "out",
+ *   "jobs": [
+ *     {
+ *       "name": "bracket",
+ *       "output": "bracket.stl",
+ *       "color": [0.8, 0.2, 0.2],
+ *       "weld": true,
+ *       "parts": [
+ *         { "shape": "Cube", "scale": 2.0 },
+ *         { "load": "boss.stl", "position": [0, 0, 1], "orientation": [90, 0, 0] }
+ *       ]
+ *     }
+ *   ]
+ * }
+ * @endcode
+ * Relative paths are resolved against the job file's directory, outputs against the
+ * output directory. Every key of a part but "shape" or "load" is optional, as are
+ * "name", "color" and "weld" (default true) of a job.
+ */
+class BatchRunner
+{
+public:
+    /**
+     * @brief One part of a job: a shape or a file, and where it is placed.
+     */
+    struct Part
+    {
+        QString shape;                                   ///< Name of a built-in shape, or empty.
+        QString load;                                    ///< Path of an STL file, used if shape is empty.
+        std::array<double, 3> position = { 0, 0, 0 };
+        std::array<double, 3> orientation = { 0, 0, 0 }; ///< Degrees about X, Y and Z, applied Y, X, Z like scene objects.
+        double scale = 1.0;
+    };
+
+    /**
+     * @brief One output file and the parts merged into it.
+     */
+    struct Job
+    {
+        QString name;                              ///< Name used in reports; defaults to the output's file name.
+        QString output;                            ///< Path of the STL file written.
+        std::vector<Part> parts;
+        bool weld = true;                          ///< Weld coincident points of the merged parts.
+        bool hasColor = false;
+        std::array<double, 3> color = { 1, 1, 1 }; ///< Written to every facet if hasColor is set.
+    };
+
+    /**
+     * @brief Outcome of reading a job file.
+     */
+    struct JobFile
+    {
+        std::vector<Job> jobs;
+        QString error;          ///< Reason for the failure, empty on success.
+
+        /// @brief Returns true if the file was read and every job is valid.
+        bool ok() const { return error.isEmpty(); }
+    };
+
+    /**
+     * @brief Outcome of one job.
+     */
+    struct JobResult
+    {
+        QString name;
+        QString output;
+        QString error;          ///< Reason for the failure, empty on success.
+        std::size_t facets = 0; ///< Facets written.
+        double seconds = 0.0;   ///< Wall-clock time of the job.
+
+        /// @brief Returns true if the output was written.
+        bool ok() const { return error.isEmpty(); }
+    };
+
+    /**
+     * @brief Outcome of a batch.
+     */
+    struct Report
+    {
+        std::vector<JobResult> jobs; ///< In the order of the job file.
+        std::size_t failed = 0;      ///< Jobs that did not write their output.
+        std::size_t facets = 0;      ///< Facets written by all jobs.
+        double seconds = 0.0;        ///< Wall-clock time of the batch.
+        unsigned threads = 0;        ///< Jobs run concurrently.
+
+        /// @brief Returns the number of jobs finished per second, failed ones included.
+        double jobsPerSecond() const { return seconds > 0.0 ? jobs.size() / seconds : 0.0; }
+    };
+
+    /**
+     * @brief Reads and validates a job file.
+     *
+     * Unknown shapes, parts without a source, missing outputs and outputs written by more
+     * than one job are reported as errors, so a batch never starts half valid.
+     *
+     * @param path Path of the JSON job file.
+     * @return JobFile The jobs with absolute paths, or an error message.
+     */
+    static JobFile readJobFile(const QString& path);
+
+    /**
+     * @brief Runs jobs concurrently and reports on each of them.
+     *
+     * @param jobs The jobs.
+     * @param threads Jobs run at the same time; 0 uses every core.
+     * @return Report The outcome of every job and the batch throughput.
+     */
+    static Report run(const std::vector<Job>& jobs, unsigned threads = 0);
+};
@@ -5,7 +5,12 @@
 #include <vtkTransform.h>
 #include <vtkActor.h>
 #include <vtkBoxRepresentation.h>
-#include <vtkTransformPolyDataFilter.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+
+#include "history.h"
+#include "scene.h"
+#include "trace.h"
 
 
 
@@ -13,14 +18,28 @@
  * @class BoxWidgetCallback
  * @brief Callback class derived from vtkCommand, which responds when the vtkBoxWidget2 is manipulated.
  *
- * This class provides functionality to update the associated vtkActor's geometry
- * in response to manipulations on the vtkBoxWidget2. The transformation of the
- * vtkBoxWidget2 is extracted and applied to the vtkActor's underlying polydata.
+ * While the box is dragged, its transformation is only written to the scene object's
+ * user matrix, so the preview costs a matrix update regardless of mesh size. Depending
+ * on the bake mode, the accumulated transform is then baked into the geometry once when
+ * the drag ends, lazily when the object is exported, or never. Each drag is recorded
+ * as one edit in the target history, if there is one.
+ *
+ * The callback must be observed for StartInteractionEvent, InteractionEvent and EndInteractionEvent.
  */
 class BoxWidgetCallback : public vtkCommand
 {
 public:
 
+    /**
+     * @brief When the box widget transform is baked into the object's geometry.
+     */
+    enum class BakeMode
+    {
+        OnRelease, ///< Bake once, when the drag ends.
+        OnExport,  ///< Keep the transform as a user matrix until the object is exported.
+        Never      ///< Keep the transform non-destructive; exports use a baked copy.
+    };
+
     /**
      * @brief Factory method to create a new instance of BoxWidgetCallback.
      *
@@ -35,41 +54,74 @@ public:
     /**
      * @brief Overridden Execute method which gets triggered when the associated vtkBoxWidget2 is manipulated.
      *
-     * This method extracts the transformation from the vtkBoxWidget2, applies it to the associated
-     * vtkActor's polydata, and then updates the actor with the transformed polydata.
+     * On StartInteractionEvent the object's current user matrix is remembered. On every
+     * InteractionEvent the box transform is combined with it and written as the new user
+     * matrix. On EndInteractionEvent the transform is baked if the mode is OnRelease, and
+     * the box is placed around the object's new bounds.
      *
      * @param caller vtkObject* which triggered the callback (expected to be vtkBoxWidget2).
-     * @param event Not used in this implementation.
+     * @param event The interaction event.
      * @param clientData Not used in this implementation.
      */
-    virtual void Execute(vtkObject* caller, unsigned long, void*) override
+    virtual void Execute(vtkObject* caller, unsigned long event, void*) override
     {
+        TRACE_SCOPE("BoxWidgetCallback::Execute", "ui");
+
+        if (!TargetScene || !TargetScene->contains(TargetObject))
+            return;
+
         vtkBoxWidget2* boxWidget = reinterpret_cast<vtkBoxWidget2*>(caller);
-        vtkSmartPointer<vtkTransform> t = vtkSmartPointer<vtkTransform>::New();
         vtkBoxRepresentation* boxRep = reinterpret_cast<vtkBoxRepresentation*>(boxWidget->GetRepresentation());
-        boxRep->GetTransform(t);
 
-        // Extract the actor's polydata
-        vtkPolyData* polydata = vtkPolyData::SafeDownCast(this->Actor->GetMapper()->GetInput());
+        if (event == vtkCommand::StartInteractionEvent)
+        {
+            // Remember the transform the drag starts from
+            double base[16];
+            TargetScene->getUserMatrix(TargetObject, base);
+            this->DragBase->DeepCopy(base);
+
+            if (TargetHistory)
+                TargetHistory->begin("Transform", { TargetObject });
+        }
+        else if (event == vtkCommand::InteractionEvent)
+        {
+            // The box transform is relative to where the box was placed, i.e. to DragBase
+            vtkSmartPointer<vtkTransform> t = vtkSmartPointer<vtkTransform>::New();
+            boxRep->GetTransform(t);
 
-        // Apply the transformation to the polydata
-        vtkSmartPointer<vtkTransformPolyDataFilter> transformFilter = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
-        transformFilter->SetInputData(polydata);
-        transformFilter->SetTransform(t);
-        transformFilter->Update();
+            vtkNew<vtkMatrix4x4> preview;
+            vtkMatrix4x4::Multiply4x4(t->GetMatrix(), this->DragBase, preview);
 
-        // Set the transformed polydata back to the actor
-        this->Actor->GetMapper()->SetInputDataObject(transformFilter->GetOutput());
+            TargetScene->setUserMatrix(TargetObject, preview->GetData());
+            TargetScene->syncToVtk();
+        }
+        else if (event == vtkCommand::EndInteractionEvent)
+        {
+            if (Mode == BakeMode::OnRelease)
+            {
+                TargetScene->bakeUserMatrix(TargetObject);
+                TargetScene->syncToVtk();
+            }
 
-        // Reset the box widget to match the transformed actor
-        boxWidget->GetRepresentation()->PlaceWidget(this->Actor->GetBounds());
+            if (TargetHistory)
+                TargetHistory->commit();
+
+            // Reset the box widget to match the transformed actor
+            if (vtkActor* actor = TargetScene->actor(TargetObject))
+                boxWidget->GetRepresentation()->PlaceWidget(actor->GetBounds());
+        }
     }
 
     /**
-     * @brief Default constructor initializing Actor to null.
+     * @brief Default constructor: no target, bake on release.
      */
-    BoxWidgetCallback(): Actor(0) {}
+    BoxWidgetCallback(): TargetScene(nullptr), TargetHistory(nullptr), TargetObject(InvalidObjectId), Mode(BakeMode::OnRelease) {}
 
-    vtkActor* Actor; ///< Pointer to the associated vtkActor whose polydata should be transformed.
-};
+    Scene* TargetScene;     ///< Scene holding the object being transformed.
+    History* TargetHistory; ///< History drags are recorded in; may be null.
+    ObjectId TargetObject;  ///< Object whose transform the box widget edits.
+    BakeMode Mode;          ///< When the transform is baked into the geometry.
 
+private:
+    vtkNew<vtkMatrix4x4> DragBase; ///< User matrix of the object when the drag started.
+};
@@ -1,31 +1,156 @@
 #pragma once
 
 #include "model.h"
+#include "shapeCache.h"
+#include <QObject>
 #include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
 
 /**
  * @class ShapeController
  * @brief Controller class responsible for managing and creating different shapes based on the given type.
  *
  * This class provides an interface to create various 3D shapes using the VTK library.
- * The shapes are determined based on their type given as QString.
+ * The shapes are determined based on their type given as QString. Generated meshes are
+ * kept in a ShapeCache, so repeated requests for the same shape share one mesh.
+ *
+ * Many shapes can be requested at once with createShapes(): the VTK sources are
+ * independent, so they run concurrently on a pool of worker threads in the background,
+ * and the finished meshes are handed back through futures or on the receiver's thread.
  */
 class ShapeController
 {
 public:
+    /**
+     * @brief A shape to generate in a batch and how finely to tessellate it.
+     */
+    struct ShapeRequest
+    {
+        std::shared_ptr<const Shape> shape;
+        TessellationPolicy policy;
+    };
+
+    /// Mesh of one request of a batch; null if the batch was canceled before the mesh was generated.
+    using MeshFuture = std::shared_future<vtkSmartPointer<vtkPolyData>>;
+
+    /// Called with the index of a request in its batch and the request's mesh.
+    using ShapeCallback = std::function<void(std::size_t index, vtkSmartPointer<vtkPolyData> mesh)>;
+
     /**
      * @brief Default constructor.
      */
     ShapeController() = default;
 
+    /**
+     * @brief Cancels the running batches and waits for their worker threads.
+     */
+    ~ShapeController();
+
+    ShapeController(const ShapeController&) = delete;
+    ShapeController& operator=(const ShapeController&) = delete;
+
     /**
      * @brief Creates and returns a shape based on the given type.
      *
+     * The returned mapper is new, but its input mesh is shared with every other
+     * shape of the same type and must not be modified in place.
+     *
      * @param shapeType QString representing the type of shape to create.
      * Supported types are "Cube", "Sphere", "Hemisphere", "Cone", "Pyramid",
      * "Cylinder", "Tube", "Doughnut", and "Curved Cylinder".
+     * @param policy How finely curved surfaces are tessellated; the default keeps each shape's fixed resolution.
      *
      * @return vtkSmartPointer<vtkPolyDataMapper> The created shape or nullptr if the type is unsupported.
      */
-    vtkSmartPointer<vtkPolyDataMapper> createShape(const QString& shapeType);
+    vtkSmartPointer<vtkPolyDataMapper> createShape(const QString& shapeType, const TessellationPolicy& policy = TessellationPolicy());
+
+    /**
+     * @brief Builds the Shape model for the given type with its default dimensions.
+     *
+     * @param shapeType QString representing the type of shape.
+     * @return std::unique_ptr<Shape> The shape, or nullptr if the type is unsupported.
+     */
+    static std::unique_ptr<Shape> makeShape(const QString& shapeType);
+
+    /**
+     * @brief Returns the names of all supported shape types.
+     */
+    static QStringList supportedShapes();
+
+    /**
+     * @brief Generates every supported shape on a background thread to warm the cache.
+     */
+    void prewarmCache();
+
+    /**
+     * @brief Generates many shapes concurrently in the background.
+     *
+     * Returns at once. Requests for the same geometry are generated once and share the
+     * mesh; meshes already cached are not generated again. Like createShape(), the meshes
+     * are shared through the cache and must not be modified in place.
+     *
+     * @param requests The shapes to generate.
+     * @param threads Worker threads of the batch; 0 uses every core.
+     * @return std::vector<MeshFuture> The mesh of every request, in the order of the requests.
+     */
+    std::vector<MeshFuture> createShapes(std::vector<ShapeRequest> requests, unsigned threads = 0);
+
+    /**
+     * @brief Generates many shapes concurrently in the background, delivering them on the receiver's thread.
+     *
+     * Returns at once. Finished meshes are handed to onShape in groups, through the
+     * receiver's event loop, so actors can be created for them on the GUI thread while
+     * the rest of the batch is generated. Requests are delivered in no particular order.
+     * Nothing is delivered once the receiver is destroyed or the batch is canceled.
+     *
+     * @param requests The shapes to generate.
+     * @param receiver Object on whose thread the callbacks run.
+     * @param onShape Called once per request with its index and mesh.
+     * @param onFinished Called after the last mesh was delivered, or once a canceled batch stopped; may be empty.
+     * @param threads Worker threads of the batch; 0 uses every core.
+     */
+    void createShapes(std::vector<ShapeRequest> requests, QObject* receiver, ShapeCallback onShape,
+                      std::function<void()> onFinished = std::function<void()>(), unsigned threads = 0);
+
+    /**
+     * @brief Stops every running batch; requests not generated yet get a null mesh or are not delivered.
+     */
+    void cancelBatches();
+
+    /**
+     * @brief Returns the mesh cache used by this controller.
+     */
+    ShapeCache& cache() { return mCache; }
+
+private:
+    /// Meshes generated by a block of a batch, with the indices of the requests they answer.
+    using Delivery = std::vector<std::pair<std::size_t, vtkSmartPointer<vtkPolyData>>>;
+
+    /// A running batch: its coordinating thread and whether it finished.
+    struct Batch
+    {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> done;
+    };
+
+    void startBatch(std::vector<ShapeRequest> requests, unsigned threads,
+                    std::function<void(Delivery&&)> deliver, std::function<void()> finished);
+    void reapBatches();
+
+    ShapeCache mCache;
+
+    std::mutex mBatchMutex;
+    std::vector<Batch> mBatches;
+    std::atomic<std::uint64_t> mBatchGeneration{ 0 }; ///< Incremented by cancelBatches(); batches started earlier stop.
 };
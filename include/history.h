@@ -0,0 +1,191 @@
+#pragma once
+
+#include "scene.h"
+
+#include <vtkSmartPointer.h>
+#include <vtkObject.h>
+#include <vtkPolyData.h>
+
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class History
+ * @brief Undo/redo stack of scene edits that stores object states, sharing meshes instead of copying them.
+ *
+ * An edit is recorded by calling begin() with the objects it will touch, editing the
+ * scene, and calling commit(). The history keeps the state of each touched object
+ * before and after the edit: transform, material and, only if it changed, the mesh.
+ * A transform edit therefore costs a few matrices whatever the size of the mesh.
+ *
+ * Meshes are kept by reference. Scene meshes are treated as immutable: edits produce
+ * new vtkPolyData that share the point, normal and connectivity arrays they leave
+ * unchanged, e.g. Scene::bakedMesh() shares the connectivity. The history references
+ * those arrays, so a state costs only the arrays its edit replaced, and undo and redo
+ * swap pointers in constant time whatever the mesh size.
+ *
+ * The memory of the arrays referenced by the history, each counted once however many
+ * states share it, is capped; the oldest edits are forgotten first. Consecutive edits
+ * with the same merge key on the same objects, such as the steps of a slider drag,
+ * are merged into one until seal() is called.
+ */
+class History
+{
+public:
+    /**
+     * @brief Snapshot of the history's counters.
+     */
+    struct Statistics
+    {
+        std::size_t undoSteps = 0;     ///< Edits that can be undone.
+        std::size_t redoSteps = 0;     ///< Edits that can be redone.
+        std::size_t buffers = 0;       ///< Distinct mesh arrays referenced.
+        std::size_t bytes = 0;         ///< Memory of the referenced arrays and the recorded states.
+        std::size_t capacityBytes = 0; ///< Cap on bytes.
+        std::size_t forgotten = 0;     ///< Edits dropped to stay under the cap.
+    };
+
+    /// Default cap on the history's memory.
+    static constexpr std::size_t DefaultCapacityBytes = std::size_t(512) * 1024 * 1024;
+
+    /**
+     * @brief Constructs an empty history of a scene.
+     *
+     * @param scene The scene edits are recorded on; must outlive the history.
+     * @param capacityBytes Cap on the memory the history references.
+     */
+    explicit History(Scene& scene, std::size_t capacityBytes = DefaultCapacityBytes);
+
+    /**
+     * @brief Starts recording an edit by saving the state of the objects it touches.
+     *
+     * An edit begun while another is open replaces it.
+     *
+     * @param label Name of the edit, e.g. "Delete".
+     * @param objects Objects the edit changes or removes; objects it adds are passed to commit().
+     * @param mergeKey Edits with the same non-empty key on the same objects merge into the previous one.
+     */
+    void begin(const std::string& label, const std::vector<ObjectId>& objects, const std::string& mergeKey = std::string());
+
+    /**
+     * @brief Finishes the open edit by saving the state of its objects after it.
+     *
+     * Edits that changed nothing are dropped. Committing clears the redo steps.
+     *
+     * @param added Objects the edit added to the scene.
+     */
+    void commit(const std::vector<ObjectId>& added = std::vector<ObjectId>());
+
+    /**
+     * @brief Keeps the next edit from merging into the last one, e.g. when a slider is released.
+     */
+    void seal() { mSealed = true; }
+
+    /// @brief Returns true if there is an edit to undo.
+    bool canUndo() const { return !mUndo.empty(); }
+
+    /// @brief Returns true if there is an edit to redo.
+    bool canRedo() const { return !mRedo.empty(); }
+
+    /// @brief Returns the label of the edit undo() would revert, or an empty string.
+    std::string undoLabel() const { return mUndo.empty() ? std::string() : mUndo.back().label; }
+
+    /// @brief Returns the label of the edit redo() would apply again, or an empty string.
+    std::string redoLabel() const { return mRedo.empty() ? std::string() : mRedo.back().label; }
+
+    /**
+     * @brief Reverts the last edit.
+     *
+     * @return std::vector<ObjectId> Objects the edit touched that are in the scene afterwards.
+     */
+    std::vector<ObjectId> undo();
+
+    /**
+     * @brief Applies the last undone edit again.
+     *
+     * @return std::vector<ObjectId> Objects the edit touched that are in the scene afterwards.
+     */
+    std::vector<ObjectId> redo();
+
+    /**
+     * @brief Forgets every edit.
+     */
+    void clear();
+
+    /**
+     * @brief Changes the memory cap, forgetting the oldest edits if the history is above it.
+     *
+     * @param bytes The new cap.
+     */
+    void setCapacity(std::size_t bytes);
+
+    /// @brief Returns the memory cap.
+    std::size_t capacity() const { return mCapacity; }
+
+    /// @brief Returns a snapshot of the counters.
+    Statistics statistics() const;
+
+private:
+    /// State of one object; mesh is null when the edit did not change it.
+    struct State
+    {
+        bool exists = false;
+        bool instanced = false;
+        std::array<double, 3> position;
+        std::array<double, 3> orientation;
+        double scale = 1.0;
+        std::array<double, 16> userMatrix;
+        std::array<double, 3> color;
+        double opacity = 1.0;
+        vtkSmartPointer<vtkPolyData> mesh;
+    };
+
+    struct Change
+    {
+        ObjectId id;
+        State before;
+        State after;
+    };
+
+    struct Edit
+    {
+        std::string label;
+        std::string mergeKey;
+        std::vector<Change> changes;
+    };
+
+    /// A mesh array referenced by the history, kept alive until its last reference goes.
+    struct Buffer
+    {
+        vtkSmartPointer<vtkObject> array;
+        std::size_t references = 0;
+        std::size_t bytes = 0;
+    };
+
+    State capture(ObjectId id) const;
+    void apply(ObjectId id, const State& state);
+    std::vector<ObjectId> applyEdit(const Edit& edit, bool forward);
+    void reference(const Edit& edit, int delta);
+    void reference(vtkPolyData* mesh, int delta);
+    void reference(vtkObject* array, std::size_t bytes, int delta);
+    void trim();
+
+    Scene& mScene;
+    std::size_t mCapacity;
+
+    std::deque<Edit> mUndo;
+    std::vector<Edit> mRedo;
+
+    bool mOpen = false;
+    bool mSealed = true;
+    Edit mPending;
+
+    std::unordered_map<vtkObject*, Buffer> mBuffers;
+    std::size_t mBufferBytes = 0;
+    std::size_t mChangeCount = 0;
+    std::size_t mForgotten = 0;
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vtkSmartPointer.h>
+#include <vtkActor.h>
+#include <vtkFloatArray.h>
+#include <vtkGlyph3DMapper.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class InstanceBatch
+ * @brief Draws many copies of one mesh with a single actor and glyph mapper.
+ *
+ * The source mesh is uploaded once; each instance only contributes a position,
+ * an orientation, a scale and an RGBA color stored in flat per-instance arrays.
+ * vtkGlyph3DMapper renders them with hardware instancing, so frame time and memory
+ * grow with the instance count only through these small arrays.
+ *
+ * Instances are addressed by a dense index. Removing an instance moves the last one
+ * into its place; the caller is told which owner moved so it can update its mapping.
+ */
+class InstanceBatch
+{
+public:
+    /**
+     * @brief Constructs an empty batch drawing the given mesh.
+     *
+     * @param mesh Source mesh shared by all instances. It is not modified.
+     */
+    explicit InstanceBatch(vtkSmartPointer<vtkPolyData> mesh);
+
+    /**
+     * @brief Appends an instance.
+     *
+     * @param owner Caller-defined id stored with the instance (for example a scene ObjectId).
+     * @return std::size_t Index of the new instance.
+     */
+    std::size_t add(std::uint32_t owner);
+
+    /**
+     * @brief Removes an instance by moving the last instance into its index.
+     *
+     * @param index The instance to remove.
+     * @return std::uint32_t Owner of the instance now stored at index, or the removed
+     *         owner if the last instance was removed.
+     */
+    std::uint32_t remove(std::size_t index);
+
+    /// @brief Returns the number of instances.
+    std::size_t size() const { return mOwners.size(); }
+
+    /**
+     * @brief Writes the transform and material of one instance.
+     *
+     * @param index The instance.
+     * @param position World position.
+     * @param orientation Rotation in degrees about X, Y and Z, as in vtkProp3D.
+     * @param scale Uniform scale factor.
+     * @param rgb Color in [0, 1].
+     * @param opacity Opacity in [0, 1].
+     */
+    void set(std::size_t index, const double position[3], const double orientation[3],
+             double scale, const double rgb[3], double opacity);
+
+    /**
+     * @brief Notifies the mapper that instance data changed. Call once after a batch of set().
+     */
+    void commit();
+
+    /// @brief Returns the actor drawing every instance.
+    vtkActor* actor() const { return mActor; }
+
+    /// @brief Returns the shared source mesh.
+    vtkPolyData* mesh() const { return mMesh; }
+
+    /// @brief Returns the memory used by the per-instance arrays, in bytes.
+    std::size_t instanceBytes() const;
+
+private:
+    vtkSmartPointer<vtkPolyData> mMesh;
+    vtkSmartPointer<vtkPoints> mPositions;
+    vtkSmartPointer<vtkFloatArray> mOrientations;
+    vtkSmartPointer<vtkFloatArray> mScales;
+    vtkSmartPointer<vtkUnsignedCharArray> mColors;
+    vtkSmartPointer<vtkPolyData> mInstances;
+    vtkSmartPointer<vtkGlyph3DMapper> mMapper;
+    vtkSmartPointer<vtkActor> mActor;
+
+    std::vector<std::uint32_t> mOwners;
+};
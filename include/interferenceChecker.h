@@ -0,0 +1,137 @@
+#pragma once
+
+#include "meshBvhCache.h"
+#include "scene.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @class InterferenceChecker
+ * @brief Finds the objects of a scene whose surfaces intersect, updating only what moved.
+ *
+ * The broad phase keeps the world bounds of every object in a uniform hash grid whose
+ * cell size is set from the objects' sizes when the first objects arrive; objects
+ * spanning too many cells are kept in a separate list tested against every mover. Pairs
+ * with overlapping bounds are remembered along with the outcome of their narrow phase,
+ * so only pairs involving an object that moved, got another mesh, was added or was
+ * removed are tested again.
+ *
+ * The narrow phase tests the objects' meshes triangle against triangle through their
+ * MeshBvh, one pair per task, in parallel. Touching surfaces count as interfering; an
+ * object entirely inside another does not, since only surfaces are tested.
+ *
+ * Changes are found through Scene::geometryRevision(), so the checker can be updated
+ * at any time, independently of the dirty flags synced to VTK.
+ */
+class InterferenceChecker
+{
+public:
+    /**
+     * @brief Snapshot of the checker's counters.
+     */
+    struct Statistics
+    {
+        std::size_t objects = 0;     ///< Objects in the broad phase.
+        std::size_t large = 0;       ///< Objects too large for the grid, tested against every mover.
+        std::size_t pairs = 0;       ///< Pairs whose bounds overlap.
+        std::size_t colliding = 0;   ///< Pairs whose surfaces intersect.
+        std::size_t moved = 0;       ///< Objects re-inserted by the last update.
+        std::size_t tests = 0;       ///< Pairs narrow-phase tested by the last update.
+    };
+
+    /**
+     * @brief Constructs a checker for a scene. Nothing is computed until the first update.
+     *
+     * @param scene The scene to check; must outlive the checker.
+     * @param cache Cache of the mesh hierarchies; must outlive the checker.
+     * @param threads Worker threads of the narrow phase; 0 uses every core.
+     */
+    InterferenceChecker(const Scene& scene, MeshBvhCache& cache, unsigned threads = 0);
+
+    /**
+     * @brief Brings the interference state up to date with the scene.
+     *
+     * Costs one comparison of revisions when nothing changed, and otherwise a pass over
+     * the scene's ids plus work proportional to the objects that changed and their
+     * neighbors.
+     *
+     * @return std::vector<ObjectId> Objects of the scene that started or stopped interfering with another.
+     */
+    std::vector<ObjectId> update();
+
+    /// @brief Returns true if the object's surface intersects another object's, as of the last update.
+    bool isColliding(ObjectId id) const;
+
+    /// @brief Returns every pair of interfering objects as of the last update, smaller id first.
+    std::vector<std::pair<ObjectId, ObjectId>> collidingPairs() const;
+
+    /**
+     * @brief Forgets every object and pair; the next update checks the whole scene.
+     */
+    void clear();
+
+    /// @brief Returns a snapshot of the counters.
+    Statistics statistics() const;
+
+private:
+    /// State of one object, indexed by ObjectId.
+    struct Entry
+    {
+        bool live = false;
+        bool large = false;                 ///< In mLarge instead of the grid.
+        std::uint64_t revision = 0;         ///< Scene::geometryRevision(id) when the object was last read.
+        std::uint64_t seen = 0;             ///< mStamp of the last update that found the object in the scene.
+        std::uint64_t touched = 0;          ///< mStamp of the last update that may have changed its state.
+        bool wasColliding = false;          ///< State before the update that touched it.
+        std::uint32_t colliding = 0;        ///< Number of interfering partners.
+        std::array<float, 6> bounds;        ///< World bounds: lower then upper corner; empty without geometry.
+        std::array<int, 6> cells;           ///< Grid cells covered: lower then upper cell index.
+        std::array<double, 16> world;       ///< Model to world matrix.
+        std::array<double, 16> inverse;     ///< World to model matrix.
+        std::vector<ObjectId> partners;     ///< Objects whose bounds overlap this one's.
+    };
+
+    /// Narrow-phase test of one pair.
+    struct Test
+    {
+        ObjectId first;
+        ObjectId second;
+        const MeshBvh* firstBvh;
+        const MeshBvh* secondBvh;
+        bool colliding;
+    };
+
+    void computeObject(ObjectId id);
+    void insert(ObjectId id);
+    void remove(ObjectId id);
+    void touch(ObjectId id);
+    void chooseCellSize(const std::vector<ObjectId>& ids);
+    bool hasGeometry(const Entry& entry) const { return entry.bounds[0] <= entry.bounds[3]; }
+
+    static std::uint64_t pairKey(ObjectId a, ObjectId b);
+    static std::uint64_t cellKey(int x, int y, int z);
+
+    const Scene& mScene;
+    MeshBvhCache& mCache;
+    unsigned mThreads;
+    std::uint64_t mRevision = 0;
+    std::uint64_t mStamp = 0;
+    bool mBuilt = false;
+    double mCellSize = 0.0;                 ///< 0 until chosen from the first objects.
+
+    std::vector<Entry> mEntries;
+    std::unordered_map<std::uint64_t, std::vector<ObjectId>> mGrid;
+    std::vector<ObjectId> mLarge;
+    std::unordered_map<std::uint64_t, bool> mPairs; ///< Pairs with overlapping bounds, keyed by pairKey(); true if interfering.
+    std::vector<ObjectId> mTouched;         ///< Objects whose state the current update may change.
+
+    std::size_t mObjects = 0;
+    std::size_t mColliding = 0;
+    std::size_t mMoved = 0;
+    std::size_t mTests = 0;
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "scene.h"
+
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+#include <vtkPolyData.h>
+#include <vtkRenderer.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class LodManager
+ * @brief Builds decimated levels of detail for scene meshes and picks one per object each frame.
+ *
+ * Every mesh with enough triangles gets a chain of progressively coarser levels, built
+ * on background threads by welding the mesh and running an error-bounded decimation
+ * with growing error bounds. Chains are keyed by mesh, so objects sharing a mesh also
+ * share its levels.
+ *
+ * update() picks for every object the coarsest level whose error bound, projected to
+ * the screen at the object's distance, stays below a pixel tolerance. The tolerance is
+ * larger while the user interacts, and no new chain is started meanwhile. The chosen
+ * level is drawn through Scene::setRenderMesh(), so the object's own mesh is untouched.
+ *
+ * Level memory is bounded by a capacity; the least recently drawn chains are evicted
+ * first and not rebuilt until the capacity changes. Instanced objects are not switched.
+ */
+class LodManager
+{
+public:
+    /**
+     * @brief Snapshot of the level of detail counters.
+     */
+    struct Statistics
+    {
+        std::size_t chains = 0;        ///< Meshes with a finished chain.
+        std::size_t levels = 0;        ///< Decimated levels across all chains.
+        std::size_t pending = 0;       ///< Chains waiting for or being built.
+        std::size_t bytes = 0;         ///< Memory held by the levels.
+        std::size_t capacityBytes = 0; ///< Configured memory cap.
+        std::size_t evictions = 0;     ///< Chains dropped to stay under the capacity.
+        std::size_t switches = 0;      ///< Level changes applied to objects.
+        std::size_t reducedObjects = 0; ///< Objects drawn with a decimated level in the last update.
+    };
+
+    /// Default memory cap of the levels (256 MiB).
+    static constexpr std::size_t DefaultCapacityBytes = 256u * 1024u * 1024u;
+
+    /// Meshes with fewer triangles are always drawn at full resolution.
+    static constexpr std::size_t MinimumTriangles = 10000;
+
+    /// Default tolerated screen-space error in pixels when the view is still.
+    static constexpr double DefaultIdlePixelError = 1.0;
+
+    /// Default tolerated screen-space error in pixels while the user interacts.
+    static constexpr double DefaultInteractivePixelError = 4.0;
+
+    /**
+     * @brief Constructs the manager and starts its builder threads.
+     *
+     * @param capacityBytes Maximum memory the levels may use.
+     * @param threads Number of builder threads; 0 uses half the hardware threads.
+     */
+    explicit LodManager(std::size_t capacityBytes = DefaultCapacityBytes, unsigned threads = 0);
+
+    /**
+     * @brief Stops the builder threads, abandoning chains not finished yet.
+     */
+    ~LodManager();
+
+    LodManager(const LodManager&) = delete;
+    LodManager& operator=(const LodManager&) = delete;
+
+    /// @brief Enables or disables level switching. Disabled, update() restores full meshes.
+    void setEnabled(bool enabled) { mEnabled = enabled; }
+    bool isEnabled() const { return mEnabled; }
+
+    /// @brief Tells whether the user is interacting, which selects the interactive tolerance.
+    void setInteracting(bool interacting) { mInteracting = interacting; }
+    bool isInteracting() const { return mInteracting; }
+
+    /**
+     * @brief Sets the tolerated screen-space error in pixels.
+     *
+     * @param idle Tolerance when the view is still.
+     * @param interactive Tolerance while the user interacts.
+     */
+    void setPixelErrors(double idle, double interactive);
+
+    /**
+     * @brief Sets the memory cap, evicting chains if the levels are over the new limit.
+     *
+     * Chains evicted earlier may be rebuilt afterwards.
+     *
+     * @param capacityBytes Maximum memory the levels may use.
+     */
+    void setCapacity(std::size_t capacityBytes);
+
+    /**
+     * @brief Sets a function called from a builder thread whenever a chain is finished.
+     *
+     * Typically used to request a render, so the new levels are picked up.
+     */
+    void setOnChainReady(std::function<void()> onChainReady);
+
+    /**
+     * @brief Picks a level for every object of the scene from the renderer's camera.
+     *
+     * Meshes without a chain are queued for building. Must be called from the thread
+     * that renders, before the scene is synced.
+     *
+     * @param scene The scene whose objects are switched.
+     * @param renderer The renderer whose camera and viewport define the screen.
+     * @return std::size_t Number of objects whose level changed.
+     */
+    std::size_t update(Scene& scene, vtkRenderer* renderer);
+
+    /**
+     * @brief Returns the current counters.
+     */
+    Statistics statistics() const;
+
+    /**
+     * @brief Drops every chain. Objects keep their levels until the next update().
+     */
+    void clear();
+
+private:
+    struct Level
+    {
+        vtkSmartPointer<vtkPolyData> mesh;
+        double error = 0.0;         ///< Bound of the geometric error, in model units.
+        std::size_t bytes = 0;
+    };
+
+    struct Chain
+    {
+        vtkSmartPointer<vtkPolyData> base;  ///< The mesh the levels approximate.
+        vtkSmartPointer<vtkPolyData> input; ///< Shallow copy of base read by the builder.
+        vtkMTimeType baseTime = 0;          ///< Modification time of base when the chain was queued.
+        double radius = 0.0;                ///< Half the bounding box diagonal of base.
+        std::vector<Level> levels;          ///< Coarser levels with growing error; empty until built.
+        std::size_t bytes = 0;
+        std::uint64_t lastUsed = 0;         ///< Frame of the last update() that drew a level.
+        bool ready = false;
+    };
+
+    Chain* chainFor(vtkPolyData* mesh);
+    void workerLoop();
+    static std::vector<Level> buildLevels(vtkPolyData* input, const std::atomic<bool>& stop);
+    void evictToCapacity();
+
+    mutable std::mutex mMutex;
+    std::condition_variable mWake;
+    std::unordered_map<vtkPolyData*, std::shared_ptr<Chain>> mChains;
+    std::deque<std::shared_ptr<Chain>> mQueue;
+    std::unordered_map<vtkPolyData*, vtkWeakPointer<vtkPolyData>> mEvicted; ///< Not rebuilt until the capacity changes.
+    std::vector<std::thread> mWorkers;
+    std::size_t mBuilding = 0;
+    std::atomic<bool> mStop{ false };
+    std::function<void()> mOnChainReady;
+
+    std::size_t mCapacityBytes;
+    std::size_t mBytes = 0;
+    std::size_t mEvictions = 0;
+    std::size_t mSwitches = 0;
+    std::size_t mReducedObjects = 0;
+    std::uint64_t mFrame = 0;
+
+    bool mEnabled = true;
+    bool mInteracting = false;
+    double mIdlePixelError = DefaultIdlePixelError;
+    double mInteractivePixelError = DefaultInteractivePixelError;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vtkPolyData.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @class MeshBvh
+ * @brief Bounding volume hierarchy over the triangles of one mesh, for ray and intersection queries in model space.
+ *
+ * Polygons are split into triangle fans and strips into their triangles; other cells are
+ * ignored. The tree is built top-down with binned surface area heuristic splits. Large
+ * nodes are binned in parallel, and once enough subtrees exist they are built in
+ * parallel too.
+ *
+ * Nodes are 32 bytes: a float bounding box, and either the first of two adjacent
+ * children or a range of triangles. Triangles are stored in leaf order as three point
+ * indices and their cell id, and points as floats, so the structure takes about
+ * 16 bytes per triangle plus 12 per point and 32 per node. A built tree is immutable
+ * and may be queried from any thread.
+ */
+class MeshBvh
+{
+public:
+    /**
+     * @brief Closest intersection found by a ray query.
+     */
+    struct Hit
+    {
+        vtkIdType cell = -1; ///< Id of the hit cell in the mesh, or -1 if nothing was hit.
+        double t = 0.0;      ///< Ray parameter of the hit: origin + t * direction.
+        double u = 0.0;      ///< Barycentric coordinate of the hit along the triangle's second vertex.
+        double v = 0.0;      ///< Barycentric coordinate of the hit along the triangle's third vertex.
+
+        /// @brief Returns true if the ray hit a triangle.
+        bool hit() const { return cell >= 0; }
+    };
+
+    /**
+     * @brief Builds the hierarchy of a mesh.
+     *
+     * @param mesh The mesh; only read.
+     * @param threads Worker threads; 0 uses every core.
+     * @return std::shared_ptr<const MeshBvh> The hierarchy, or null if the mesh has more than 2^32 - 1 points or triangles.
+     */
+    static std::shared_ptr<const MeshBvh> build(vtkPolyData* mesh, unsigned threads = 0);
+
+    /**
+     * @brief Finds the closest triangle the ray hits before tMax.
+     *
+     * Both sides of triangles are hit. The direction need not be normalized; t is
+     * measured in its units.
+     *
+     * @param origin Start of the ray.
+     * @param direction Direction of the ray.
+     * @param tMax Hits farther than this are ignored.
+     * @param hit Receives the closest hit; left untouched if there is none.
+     * @return true if a triangle was hit before tMax.
+     */
+    bool intersect(const double origin[3], const double direction[3], double tMax, Hit& hit) const;
+
+    /**
+     * @brief Returns true if any triangle of another hierarchy, moved into this one's model space, intersects one of this.
+     *
+     * Triangles that only touch count as intersecting. Only surfaces are tested, so a
+     * mesh lying entirely inside the other is not reported.
+     *
+     * @param other The other hierarchy; may be this one.
+     * @param otherToThis Row-major matrix from the other's model space to this one's.
+     * @return true if the surfaces intersect.
+     */
+    bool intersects(const MeshBvh& other, const double otherToThis[16]) const;
+
+    /// @brief Returns the number of triangles in the hierarchy.
+    std::size_t triangleCount() const { return mTriangles.size(); }
+
+    /// @brief Returns the number of nodes in the hierarchy.
+    std::size_t nodeCount() const { return mNodes.size(); }
+
+    /// @brief Returns the memory held by the hierarchy.
+    std::size_t memoryBytes() const;
+
+private:
+    /// Interior nodes have count 0 and children first and first + 1; leaves hold triangles [first, first + count).
+    struct Node
+    {
+        float lower[3];
+        std::uint32_t first;
+        float upper[3];
+        std::uint32_t count;
+    };
+
+    struct Triangle
+    {
+        std::uint32_t points[3];
+        std::uint32_t cell;
+    };
+
+    friend class MeshBvhBuilder;
+
+    std::vector<Node> mNodes;
+    std::vector<Triangle> mTriangles;
+    std::vector<float> mPoints;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "meshBvh.h"
+#include "scene.h"
+
+#include <vtkWeakPointer.h>
+#include <vtkPolyData.h>
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+
+/**
+ * @class MeshBvhCache
+ * @brief Builds the MeshBvh of a mesh once and shares it between everything querying the mesh.
+ *
+ * Hierarchies are keyed by mesh and rebuilt when the mesh is modified or destroyed and
+ * its address reused. They are only built when first asked for. Not thread-safe; the
+ * hierarchies it hands out are immutable and may be queried from any thread.
+ */
+class MeshBvhCache
+{
+public:
+    /**
+     * @brief Snapshot of the cache counters.
+     */
+    struct Statistics
+    {
+        std::size_t meshes = 0;    ///< Meshes with a built hierarchy.
+        std::size_t triangles = 0; ///< Triangles across the built hierarchies.
+        std::size_t bytes = 0;     ///< Memory held by the hierarchies.
+        std::size_t builds = 0;    ///< Hierarchies built so far.
+    };
+
+    /**
+     * @brief Returns the hierarchy of a mesh, building it if the mesh is new or was modified.
+     *
+     * @param mesh The mesh; may be null.
+     * @return std::shared_ptr<const MeshBvh> The hierarchy, or null if the mesh is null or too large to index.
+     */
+    std::shared_ptr<const MeshBvh> get(vtkPolyData* mesh);
+
+    /**
+     * @brief Drops the hierarchies of meshes that were destroyed or that no object of the scene uses.
+     */
+    void prune(const Scene& scene);
+
+    /**
+     * @brief Drops every hierarchy.
+     */
+    void clear() { mEntries.clear(); }
+
+    /// @brief Returns a snapshot of the counters.
+    Statistics statistics() const;
+
+private:
+    /// Hierarchy of one mesh and the state of the mesh it was built from.
+    struct Entry
+    {
+        vtkWeakPointer<vtkPolyData> mesh;
+        vtkMTimeType modified = 0;
+        std::shared_ptr<const MeshBvh> bvh;
+    };
+
+    std::unordered_map<vtkPolyData*, Entry> mEntries;
+    std::size_t mBuilds = 0;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <QString>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class MeshFile
+ * @brief Native binary mesh files that load by memory mapping, used as a cache of parsed STL files.
+ *
+ * A file is a fixed header followed by page-aligned sections: float32 or quantized
+ * positions, float32 point normals, and the offsets and connectivity of the polygons
+ * and of the triangle strips with 32- or 64-bit ids, all in the byte order of the
+ * machine that wrote them. The header holds the counts, the bounds and the key of the
+ * source file.
+ *
+ * Reading maps the file copy-on-write and hands VTK arrays that point straight into the
+ * mapping; there is no parsing and nothing is copied, so the cost does not grow with
+ * the size of the mesh until its pages are first touched. The mapping lives as long
+ * as any of the arrays. Quantized positions take 6 instead of 12 bytes per point, at
+ * 16 bits per axis of the bounds, and are decoded into a new array in parallel.
+ *
+ * sidecarPath() names the cache file of a source file; a cache is only used if the
+ * size, modification time and sampled content hash of its source still match.
+ */
+class MeshFile
+{
+public:
+    /**
+     * @brief Identity of the source file a cached mesh was made from.
+     */
+    struct SourceKey
+    {
+        std::uint64_t size = 0;     ///< Size of the source in bytes.
+        std::int64_t modified = 0;  ///< Modification time in milliseconds since the epoch.
+        std::uint64_t hash = 0;     ///< Hash of the size and of 64 KiB blocks spread over the content.
+        std::uint32_t variant = 0;  ///< Processing applied to the mesh; caches of another variant do not match.
+
+        /// @brief Returns true if both keys describe the same source and processing.
+        bool operator==(const SourceKey& other) const
+        {
+            return size == other.size && modified == other.modified && hash == other.hash && variant == other.variant;
+        }
+
+        /// @brief Returns true if both keys differ.
+        bool operator!=(const SourceKey& other) const { return !(*this == other); }
+    };
+
+    /**
+     * @brief Settings of a write.
+     */
+    struct WriteOptions
+    {
+        bool quantizePositions = false; ///< Store positions as 16 bits per axis of the bounds.
+        SourceKey source;               ///< Key stored in the header and checked by read().
+        unsigned threads = 0;           ///< Worker threads; 0 uses every core.
+    };
+
+    /**
+     * @brief Outcome of a read or write.
+     */
+    struct Result
+    {
+        vtkSmartPointer<vtkPolyData> mesh;       ///< The mesh read, null on failure and for writes.
+        QString error;                           ///< Reason for the failure, empty on success.
+        SourceKey source;                        ///< Key stored in the file.
+        double bounds[6] = { 0, 0, 0, 0, 0, 0 }; ///< Bounds of the points as xmin, xmax, ymin, ymax, zmin, zmax.
+        bool quantized = false;                  ///< True if the positions are quantized.
+        std::size_t bytes = 0;                   ///< Size of the file.
+        double seconds = 0.0;                    ///< Wall-clock time of the read or write.
+
+        /// @brief Returns true if the file was read or written completely.
+        bool ok() const { return error.isEmpty(); }
+    };
+
+    /**
+     * @brief Writes the polygons, triangle strips, points and point normals of a mesh.
+     *
+     * The file is written under a temporary name and atomically renamed over the old
+     * one, so readers never see a partial file and a failed write keeps the old one. Lines, vertices and other data are not stored.
+     *
+     * @param path Path of the file; an existing file is replaced.
+     * @param mesh The mesh; it is only read.
+     * @param options Quantization, source key and threading settings.
+     * @return Result Statistics of the write, or an error message.
+     */
+    static Result write(const QString& path, vtkPolyData* mesh, const WriteOptions& options);
+
+    /**
+     * @brief Maps a mesh file, rejecting it if any section or cell id is out of range.
+     *
+     * @param path Path of the file.
+     * @param expected Key the file must have been written with; null accepts any.
+     * @param threads Worker threads checking cells and decoding quantized positions; 0 uses every core.
+     * @return Result The mesh, or an error message if the file is missing, invalid or stale.
+     */
+    static Result read(const QString& path, const SourceKey* expected = nullptr, unsigned threads = 0);
+
+    /**
+     * @brief Returns the key of a source file, or a key of size 0 if it cannot be read.
+     *
+     * @param path Path of the source file.
+     * @param variant Processing the cached mesh gets, e.g. a repair.
+     */
+    static SourceKey keyOf(const QString& path, std::uint32_t variant = 0);
+
+    /**
+     * @brief Returns the path of the cache file kept next to a source file.
+     */
+    static QString sidecarPath(const QString& sourcePath) { return sourcePath + ".meshcache"; }
+};
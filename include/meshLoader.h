@@ -0,0 +1,137 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+#include "meshRepair.h"
+#include "stlReader.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+/**
+ * @class MeshLoader
+ * @brief Loads STL files on a worker thread, with a quick preview, progress and cancellation.
+ *
+ * load() first reads an evenly spread sample of the facets within a fixed time budget
+ * and emits previewReady(), then reads the whole file and emits loaded(). Progress is
+ * reported while the full read runs. All signals are emitted on the thread that owns
+ * the loader, so receivers may touch the scene and the renderer directly.
+ *
+ * The loaded mesh gets smooth point normals on the worker thread too, so the scene does
+ * not compute them on the GUI thread when it is first drawn; only the small preview is
+ * left to the scene. If repair is enabled, the mesh is run through MeshRepair first and
+ * repaired() reports what it changed just before loaded().
+ *
+ * With the cache enabled, the prepared mesh is also written to a MeshFile sidecar next
+ * to the STL file, and reopening the file maps that sidecar instead of parsing, as
+ * long as the size, modification time and sampled content of the STL file and the
+ * repair setting still match. Cache hits skip the preview and repaired().
+ *
+ * Only one file loads at a time: calling load() while another file is loading cancels
+ * the previous load, which emits canceled() for it and nothing else afterwards.
+ */
+class MeshLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Default maximum number of facets in the preview.
+    static constexpr std::size_t DefaultPreviewFacets = 200000;
+
+    /// Default time budget of the preview in milliseconds.
+    static constexpr int DefaultPreviewBudgetMs = 100;
+
+    /**
+     * @brief Constructs an idle loader.
+     *
+     * @param parent Parent QObject.
+     */
+    explicit MeshLoader(QObject* parent = nullptr);
+
+    /// @brief Cancels any running load and waits for its worker thread.
+    ~MeshLoader() override;
+
+    /// @brief Sets the maximum number of facets in the preview; 0 disables the preview.
+    void setPreviewFacets(std::size_t facets) { mPreviewFacets = facets; }
+
+    /// @brief Sets the time budget of the preview in milliseconds.
+    void setPreviewBudget(int milliseconds) { mPreviewBudgetMs = milliseconds; }
+
+    /// @brief Enables repairing meshes from the next load on.
+    void setRepairEnabled(bool enabled) { mRepair = enabled; }
+
+    /// @brief Returns true if loaded meshes are repaired.
+    bool isRepairEnabled() const { return mRepair; }
+
+    /// @brief Enables reading and writing MeshFile sidecar caches from the next load on.
+    void setCacheEnabled(bool enabled) { mCache = enabled; }
+
+    /// @brief Returns true if sidecar caches are used.
+    bool isCacheEnabled() const { return mCache; }
+
+    /// @brief Returns true while a file is loading.
+    bool isLoading() const { return mJob != nullptr; }
+
+    /// @brief Returns the path of the file being loaded, or an empty string.
+    QString currentPath() const { return mJob ? mJob->path : QString(); }
+
+public slots:
+    /**
+     * @brief Starts loading a file, canceling the load in progress if there is one.
+     *
+     * @param path Path of the STL file.
+     */
+    void load(const QString& path);
+
+    /**
+     * @brief Cancels the load in progress, if any, and emits canceled() for it.
+     */
+    void cancel();
+
+signals:
+    /// @brief A sampled preview of the file is available.
+    void previewReady(const QString& path, vtkSmartPointer<vtkPolyData> preview);
+
+    /// @brief The full read has progressed to the given fraction.
+    void progressChanged(double fraction);
+
+    /// @brief The loaded mesh was repaired; emitted right before loaded(). On failure the mesh is loaded unrepaired.
+    void repaired(const QString& path, const MeshRepair::Result& result);
+
+    /// @brief The file was read completely.
+    void loaded(const QString& path, const StlReader::Result& result);
+
+    /// @brief The file could not be read.
+    void failed(const QString& path, const QString& error);
+
+    /// @brief The load was canceled or superseded by another one.
+    void canceled(const QString& path);
+
+private:
+    /**
+     * @brief State shared between the loader and one worker thread.
+     */
+    struct Job
+    {
+        QString path;
+        std::atomic<bool> cancel{ false };
+    };
+
+    void run(std::shared_ptr<Job> job, quint64 generation, std::size_t previewFacets, double previewBudgetSeconds, bool repair, bool cache);
+    void finish(quint64 generation);
+
+    std::shared_ptr<Job> mJob;  ///< The load in progress, or null.
+    std::thread mWorker;        ///< Thread of the latest load; joined before the next one starts.
+    quint64 mGeneration = 0;    ///< Incremented per load and cancel; results of older generations are dropped.
+
+    std::size_t mPreviewFacets = DefaultPreviewFacets;
+    int mPreviewBudgetMs = DefaultPreviewBudgetMs;
+    bool mRepair = false;
+    bool mCache = true;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QString>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @class MeshMerger
+ * @brief Combines many meshes into one, so they are drawn with a single mapper.
+ *
+ * Sizes of every part are counted first and turned into point, cell and connectivity
+ * offsets by a prefix sum, so each part is transformed and copied in parallel straight
+ * into its range of the preallocated output arrays. Polygons are kept, triangle strips
+ * are unrolled into triangles, lines and vertices are dropped.
+ *
+ * Coincident points are then welded through a spatial hash of tolerance-sized cells:
+ * points closer than the tolerance become one, provided their normals agree, so sharp
+ * edges that duplicate points for their normals stay sharp.
+ */
+class MeshMerger
+{
+public:
+    /**
+     * @brief One mesh to merge and the transform placing it in the merged mesh.
+     */
+    struct Part
+    {
+        vtkSmartPointer<vtkPolyData> mesh;
+        std::array<double, 16> matrix = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 }; ///< Row-major 4x4 matrix.
+    };
+
+    /**
+     * @brief Merger settings.
+     */
+    struct Options
+    {
+        double weldTolerance = 0.0;    ///< Points closer than this are welded; 0 disables welding.
+        double normalTolerance = 0.99; ///< Minimum dot product of the normals of welded points.
+        unsigned threads = 0;          ///< Worker threads; 0 uses every core.
+    };
+
+    /**
+     * @brief Outcome of a merge.
+     */
+    struct Result
+    {
+        vtkSmartPointer<vtkPolyData> mesh; ///< The merged mesh, or null on failure.
+        QString error;                     ///< Reason for the failure, empty on success.
+        std::size_t inputPoints = 0;       ///< Points of all parts together.
+        std::size_t weldedPoints = 0;      ///< Points removed by welding.
+        std::size_t cells = 0;             ///< Cells of the merged mesh.
+        double seconds = 0.0;              ///< Wall-clock time of the merge.
+
+        /// @brief Returns true if the parts were merged.
+        bool ok() const { return error.isEmpty(); }
+    };
+
+    /**
+     * @brief Merges the parts into one mesh.
+     *
+     * Normals are carried over, rotated with their part, only if every part has them.
+     * Other point and cell data are dropped. The parts are only read.
+     *
+     * @param parts The meshes and their transforms.
+     * @param options Welding and threading settings.
+     * @return Result The merged mesh and statistics, or an error message.
+     */
+    static Result merge(const std::vector<Part>& parts, const Options& options);
+
+    /**
+     * @brief Returns a weld tolerance relative to the size of the parts: 1e-6 of their bounds' diagonal.
+     */
+    static double defaultWeldTolerance(const std::vector<Part>& parts);
+};
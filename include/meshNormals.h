@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+/**
+ * @class MeshNormals
+ * @brief Multithreaded point normals with feature-angle splitting, for meshes that come without normals.
+ *
+ * Normals are computed per corner of every polygon and strip: a corner averages the
+ * area-weighted normals of the faces around its position whose normal is within the
+ * feature angle of its own face. Faces are matched by point position rather than by
+ * point id, so triangle soups such as STL files, where every facet has its own three
+ * points, shade as smoothly as welded meshes.
+ *
+ * Where corners sharing a point get different normals, i.e. along feature edges of a
+ * welded mesh, the point is duplicated and the corners are redirected to the copy;
+ * offsets, cell order and cell data are unchanged. Soups never need copies.
+ *
+ * Face normals, position matching and corner normals run in parallel over cells and
+ * points; the work per point only touches the corners around its position.
+ */
+class MeshNormals
+{
+public:
+    /**
+     * @brief Normal settings.
+     */
+    struct Options
+    {
+        double featureAngle = 30.0; ///< Largest angle in degrees between faces shaded as one smooth surface.
+        unsigned threads = 0;       ///< Worker threads; 0 uses every core.
+    };
+
+    /**
+     * @brief Returns a copy of the mesh with float32 point normals.
+     *
+     * Existing normals are replaced. Points, cells and other data are shared with the
+     * input unless points had to be duplicated.
+     *
+     * @param mesh The mesh; it is not modified.
+     * @param options Feature angle and threading settings.
+     * @return vtkSmartPointer<vtkPolyData> The mesh with normals, or the input if it has no
+     *         polygons or strips or more than 2^31 - 1 points or corners.
+     */
+    static vtkSmartPointer<vtkPolyData> compute(vtkPolyData* mesh, const Options& options);
+
+    /**
+     * @brief Returns a copy of the mesh with normals split at 30 degrees, computed on every core.
+     */
+    static vtkSmartPointer<vtkPolyData> compute(vtkPolyData* mesh) { return compute(mesh, Options()); }
+
+    /**
+     * @brief Returns true if a transform keeps the angles between faces, i.e. it only rotates, translates and scales uniformly.
+     *
+     * Normals transformed by such a matrix stay valid, including where they were split,
+     * so they can be rotated along with the points instead of being computed again.
+     *
+     * @param matrix Row-major 4x4 affine matrix.
+     */
+    static bool preservesAngles(const double matrix[16]);
+};
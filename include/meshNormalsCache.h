@@ -0,0 +1,83 @@
+#pragma once
+
+#include "meshNormals.h"
+
+#include <vtkWeakPointer.h>
+#include <vtkPolyData.h>
+
+#include <cstddef>
+#include <unordered_map>
+
+/**
+ * @class MeshNormalsCache
+ * @brief Computes the normals of a mesh once per version of its geometry and shares them.
+ *
+ * Results are keyed by mesh and recomputed when the mesh is modified or destroyed and
+ * its address reused; moving an object does not touch its mesh and keeps the normals.
+ * Meshes that have point normals already are used as they are. Not thread-safe.
+ */
+class MeshNormalsCache
+{
+public:
+    /**
+     * @brief Snapshot of the cache counters.
+     */
+    struct Statistics
+    {
+        std::size_t meshes = 0;   ///< Meshes with computed normals.
+        std::size_t bytes = 0;    ///< Memory of the computed normal arrays.
+        std::size_t computes = 0; ///< Normals computed so far.
+    };
+
+    /**
+     * @brief Sets the feature angle of normals computed from now on; changing it drops every result.
+     *
+     * @param degrees Largest angle between faces shaded as one smooth surface.
+     */
+    void setFeatureAngle(double degrees);
+
+    /// @brief Returns the feature angle in degrees.
+    double featureAngle() const { return mFeatureAngle; }
+
+    /**
+     * @brief Returns the mesh with point normals, computing them if the mesh is new or was modified.
+     *
+     * @param mesh The mesh; may be null.
+     * @return vtkSmartPointer<vtkPolyData> The mesh itself if it has normals or nothing to shade, else the cached result.
+     */
+    vtkSmartPointer<vtkPolyData> get(vtkPolyData* mesh);
+
+    /**
+     * @brief Returns the cached result of a mesh without computing anything.
+     *
+     * @param mesh The mesh; may be null.
+     * @return vtkPolyData* The mesh with normals, or null if none is cached for the current version.
+     */
+    vtkPolyData* find(vtkPolyData* mesh) const;
+
+    /**
+     * @brief Drops the results of meshes that were destroyed.
+     */
+    void prune();
+
+    /**
+     * @brief Drops every result.
+     */
+    void clear() { mEntries.clear(); }
+
+    /// @brief Returns a snapshot of the counters.
+    Statistics statistics() const;
+
+private:
+    /// Normals of one mesh and the state of the mesh they were computed from.
+    struct Entry
+    {
+        vtkWeakPointer<vtkPolyData> mesh;
+        vtkMTimeType modified = 0;
+        vtkSmartPointer<vtkPolyData> normals;
+    };
+
+    std::unordered_map<vtkPolyData*, Entry> mEntries;
+    double mFeatureAngle = 30.0;
+    std::size_t mComputes = 0;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <QString>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @class MeshRepair
+ * @brief Multithreaded cleanup of triangle meshes read from STL files.
+ *
+ * The repair runs these steps in order, each timed and counted:
+ *  - weld: points closer than the tolerance become one. Points are bucketed by a hash
+ *    of their grid cell, sixteen tolerances wide, and every point joins the cluster of
+ *    the lowest-numbered point within the tolerance, looked up in its own cell and
+ *    the neighboring cells it is close to. The lookups run in parallel and the result
+ *    does not depend on the number of threads.
+ *  - degenerate: triangles with a repeated point, or with an area below 1e-6 of their
+ *    longest edge squared, are removed.
+ *  - duplicates: triangles using the same three points as an earlier one are removed,
+ *    whatever their winding.
+ *  - orient: windings are made consistent by flooding every connected surface from
+ *    its first triangle across edges shared by exactly two triangles. Open surfaces
+ *    then keep the winding most of their triangles had; closed surfaces are turned so
+ *    that they enclose a positive volume, i.e. face outwards.
+ *  - holes: boundary loops of at most maxHoleEdges edges are closed with a fan around
+ *    their centroid, wound like the triangles around them.
+ *
+ * Hashing, welding, the degenerate and duplicate tests and edge matching run in parallel;
+ * flooding and hole tracing are sequential walks in linear time.
+ */
+class MeshRepair
+{
+public:
+    /**
+     * @brief Repair settings.
+     */
+    struct Options
+    {
+        double weldTolerance = -1.0;               ///< Points closer than this are welded; 0 welds identical positions only, negative uses defaultWeldTolerance().
+        bool removeDegenerate = true;              ///< Remove triangles without area.
+        bool removeDuplicates = true;              ///< Remove triangles using the same points as an earlier one.
+        bool orient = true;                        ///< Make windings consistent and closed surfaces face outwards.
+        std::size_t maxHoleEdges = 16;             ///< Close boundary loops of at most this many edges; 0 leaves every hole open.
+        unsigned threads = 0;                      ///< Worker threads; 0 uses every core.
+        const std::atomic<bool>* cancel = nullptr; ///< The repair stops between steps once this becomes true.
+    };
+
+    /**
+     * @brief Time taken and change made by one step.
+     */
+    struct Step
+    {
+        QString description;  ///< What the step changed, e.g. "Welded 120 points".
+        double seconds = 0.0; ///< Wall-clock time of the step.
+    };
+
+    /**
+     * @brief Outcome of a repair.
+     */
+    struct Result
+    {
+        vtkSmartPointer<vtkPolyData> mesh;   ///< The repaired mesh, or null on failure.
+        QString error;                       ///< Reason for the failure, empty on success.
+        std::vector<Step> steps;             ///< The steps that ran, in order.
+        double tolerance = 0.0;              ///< Weld tolerance used.
+        std::size_t inputPoints = 0;         ///< Points of the input.
+        std::size_t inputTriangles = 0;      ///< Triangles of the input after splitting polygons and strips.
+        std::size_t weldedPoints = 0;        ///< Points removed by welding.
+        std::size_t degenerateTriangles = 0; ///< Triangles removed for lack of area.
+        std::size_t duplicateTriangles = 0;  ///< Triangles removed as duplicates.
+        std::size_t flippedTriangles = 0;    ///< Triangles whose winding was reversed.
+        std::size_t closedHoles = 0;         ///< Boundary loops closed.
+        std::size_t addedTriangles = 0;      ///< Triangles added to close them.
+        std::size_t openEdges = 0;           ///< Boundary edges left open.
+        std::size_t nonManifoldEdges = 0;    ///< Edges shared by more than two triangles.
+        double seconds = 0.0;                ///< Wall-clock time of the whole repair.
+
+        /// @brief Returns true if the mesh was repaired.
+        bool ok() const { return error.isEmpty(); }
+
+        /// @brief Returns true if any step changed the mesh.
+        bool changed() const
+        {
+            return weldedPoints + degenerateTriangles + duplicateTriangles + flippedTriangles + closedHoles > 0;
+        }
+    };
+
+    /**
+     * @brief Returns a repaired copy of the mesh.
+     *
+     * Polygons are split into fans and strips into triangles; lines, vertices, point and
+     * cell data are dropped, normals included, since welding and flipping invalidate them.
+     * The result has float32 points and 32-bit cell ids.
+     *
+     * @param mesh The mesh; it is not modified.
+     * @param options Repair and threading settings.
+     * @return Result The repaired mesh and what every step changed, or an error message.
+     */
+    static Result repair(vtkPolyData* mesh, const Options& options);
+
+    /**
+     * @brief Returns a repair with every step enabled, on every core.
+     */
+    static Result repair(vtkPolyData* mesh) { return repair(mesh, Options()); }
+
+    /**
+     * @brief Returns a weld tolerance relative to the size of the mesh: 1e-6 of its bounds' diagonal.
+     */
+    static double defaultWeldTolerance(vtkPolyData* mesh);
+};
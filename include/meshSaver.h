@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+#include "stlWriter.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <utility>
+
+/**
+ * @class MeshSaver
+ * @brief Saves meshes as binary STL files on a worker thread, with progress and cancellation.
+ *
+ * Saves run one at a time in the order they were requested; a save requested while
+ * another is running waits in a queue. The meshes are only read, so they may stay in
+ * the scene and be rendered meanwhile. All signals are emitted on the thread that owns
+ * the saver.
+ */
+class MeshSaver : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs an idle saver.
+     *
+     * @param parent Parent QObject.
+     */
+    explicit MeshSaver(QObject* parent = nullptr);
+
+    /// @brief Cancels the running save, drops the queued ones and waits for the worker thread.
+    ~MeshSaver() override;
+
+    /// @brief Returns true while a save is running or queued.
+    bool isSaving() const { return mJob != nullptr; }
+
+    /// @brief Returns the number of saves waiting behind the running one.
+    std::size_t queued() const { return mQueue.size(); }
+
+public slots:
+    /**
+     * @brief Saves a mesh, or queues the save if another one is running.
+     *
+     * @param path Path of the STL file.
+     * @param mesh The mesh to save.
+     */
+    void save(const QString& path, vtkSmartPointer<vtkPolyData> mesh);
+
+    /**
+     * @brief Cancels the running save, removing its incomplete file, and drops the queued ones.
+     */
+    void cancel();
+
+signals:
+    /// @brief The running save has progressed to the given fraction.
+    void progressChanged(double fraction);
+
+    /// @brief A file was written completely.
+    void saved(const QString& path, const StlWriter::Result& result);
+
+    /// @brief A file could not be written, or its save was canceled.
+    void failed(const QString& path, const QString& error);
+
+private:
+    /**
+     * @brief State shared between the saver and one worker thread.
+     */
+    struct Job
+    {
+        QString path;
+        vtkSmartPointer<vtkPolyData> mesh;
+        std::atomic<bool> cancel{ false };
+    };
+
+    void startNext();
+    void run(std::shared_ptr<Job> job);
+    void finish(const std::shared_ptr<Job>& job, const StlWriter::Result& result);
+
+    std::shared_ptr<Job> mJob; ///< The running save, or null.
+    std::thread mWorker;       ///< Thread of the running save.
+    std::deque<std::pair<QString, vtkSmartPointer<vtkPolyData>>> mQueue; ///< Saves waiting to run.
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+#include <cstddef>
+
+/**
+ * @class MeshStorage
+ * @brief Chooses how mesh arrays are stored, and converts and measures meshes accordingly.
+ *
+ * In the default mode meshes keep the storage VTK gives them: sources may produce double
+ * coordinates or normals, and cell arrays use 64-bit offsets and connectivity. In the
+ * compact mode points and normals are stored as float32 and cell arrays as 32-bit ids,
+ * which is what the renderer uploads anyway, roughly halving the memory per triangle.
+ *
+ * Generated shapes and baked transforms go through adapt(); the STL reader and
+ * MeshMerger already write float32 points and normals and 32-bit ids in both modes.
+ *
+ * The mode is process-wide and only affects meshes built after it is set.
+ */
+class MeshStorage
+{
+public:
+    /**
+     * @brief Storage of newly built meshes.
+     */
+    enum class Mode
+    {
+        Default, ///< Keep the arrays VTK produces.
+        Compact  ///< Float32 points and normals, 32-bit cell ids.
+    };
+
+    /**
+     * @brief Memory of a mesh's arrays, split by role.
+     */
+    struct Footprint
+    {
+        std::size_t triangles = 0;         ///< Triangles of the polygons and strips.
+        std::size_t pointBytes = 0;        ///< Point coordinates.
+        std::size_t normalBytes = 0;       ///< Point normals.
+        std::size_t cellBytes = 0;         ///< Offsets and connectivity of every cell array.
+        std::size_t otherBytes = 0;        ///< Other point and cell data.
+
+        /// @brief Returns the memory of every array together.
+        std::size_t bytes() const { return pointBytes + normalBytes + cellBytes + otherBytes; }
+
+        /// @brief Returns the memory per triangle, or 0 without triangles.
+        double bytesPerTriangle() const { return triangles > 0 ? static_cast<double>(bytes()) / triangles : 0.0; }
+    };
+
+    /// @brief Sets the storage of meshes built from now on.
+    static void setMode(Mode mode);
+
+    /// @brief Returns the storage of newly built meshes.
+    static Mode mode();
+
+    /**
+     * @brief Returns the mesh in the storage of the current mode.
+     *
+     * @param mesh The mesh; it is not modified.
+     * @return vtkSmartPointer<vtkPolyData> The mesh itself in the default mode or if it is compact already.
+     */
+    static vtkSmartPointer<vtkPolyData> adapt(vtkPolyData* mesh);
+
+    /**
+     * @brief Returns a mesh storing float32 points and normals and 32-bit cell ids.
+     *
+     * Arrays already stored that way, and other point and cell data, are shared with the
+     * input, not copied. Cell arrays too large for 32-bit ids keep their storage.
+     *
+     * @param mesh The mesh; it is not modified.
+     * @param threads Worker threads of the conversion; 0 uses every core.
+     * @return vtkSmartPointer<vtkPolyData> The compact mesh, or the input if it is compact already.
+     */
+    static vtkSmartPointer<vtkPolyData> compact(vtkPolyData* mesh, unsigned threads = 0);
+
+    /**
+     * @brief Returns true if the mesh stores float32 points and normals and 32-bit cell ids.
+     */
+    static bool isCompact(vtkPolyData* mesh);
+
+    /**
+     * @brief Measures the memory of a mesh's arrays.
+     *
+     * @param mesh The mesh.
+     * @return Footprint The bytes per role and the number of triangles.
+     */
+    static Footprint measure(vtkPolyData* mesh);
+};
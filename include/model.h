@@ -2,14 +2,104 @@
 
 #include <vtkSmartPointer.h>
 #include <vtkPolyDataMapper.h>
+#include <vtkPolyData.h>
+#include <vtkAlgorithm.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Identifies the geometry a shape generates: its type, constructor parameters and tessellation resolution.
+// Two shapes with equal keys produce identical meshes.
+struct ShapeKey {
+    std::string type;
+    std::vector<double> parameters;
+    int resolution = 0;
+
+    bool operator==(const ShapeKey& other) const;
+    bool operator!=(const ShapeKey& other) const { return !(*this == other); }
+};
+
+// Hash functor so ShapeKey can be used in unordered containers.
+struct ShapeKeyHash {
+    std::size_t operator()(const ShapeKey& key) const;
+};
+
+// Controls how finely shapes tessellate their curved surfaces.
+// A curve of radius r drawn with n segments deviates from the true curve by the chordal
+// error r * (1 - cos(pi / n)); shapes use the fewest segments that keep this error within
+// maxChordalError, clamped to [minSegments, maxSegments]. A non-positive maxChordalError
+// keeps every shape at its fixed default resolution.
+struct TessellationPolicy {
+    double maxChordalError = 0.0;
+    int minSegments = 8;
+    int maxSegments = 512;
+
+    // Policy bounding the chordal error in model units.
+    static TessellationPolicy fromChordalError(double maxChordalError);
+
+    // Policy bounding the error on screen, given how many pixels one model unit covers.
+    static TessellationPolicy fromPixelError(double pixels, double pixelsPerUnit);
+
+    // Returns the number of segments for a curve of the given radius.
+    int segmentsFor(double radius, int defaultSegments) const;
+};
+
+// A dimension of a shape that can be edited, with the range it may take.
+struct ShapeParameter {
+    std::string name;
+    double value = 0.0;
+    double minimum = 0.0;
+    double maximum = 0.0;
+};
+
+// The VTK sources, filters and functions generating a shape, kept alive between edits.
+// configurePipeline() only marks the stages whose settings change as modified, so
+// update() re-executes those stages and the ones downstream of them, and nothing else.
+struct ShapePipeline {
+    std::vector<vtkSmartPointer<vtkObject>> stages; // In the order the shape created them.
+    vtkSmartPointer<vtkAlgorithm> output;           // Stage producing the mesh.
+
+    // Executes the modified stages and returns a standalone copy of the output, stored as
+    // the MeshStorage mode asks. Earlier copies keep their arrays.
+    vtkSmartPointer<vtkPolyData> update() const;
+};
 
 // Base class for all geometric shapes.
 class Shape {
 public:
     virtual ~Shape() {}
 
-    // Pure virtual function to create the shape.
-    virtual vtkSmartPointer<vtkPolyDataMapper> createShape() const = 0;
+    // Creates the shape at its default resolution.
+    vtkSmartPointer<vtkPolyDataMapper> createShape() const { return createShape(TessellationPolicy()); }
+
+    // Creates the shape, tessellated according to the policy.
+    vtkSmartPointer<vtkPolyDataMapper> createShape(const TessellationPolicy& policy) const;
+
+    // Returns the key identifying the geometry generated at the default resolution.
+    ShapeKey key() const { return key(TessellationPolicy()); }
+
+    // Pure virtual function returning the key identifying the geometry generated under the policy.
+    virtual ShapeKey key(const TessellationPolicy& policy) const = 0;
+
+    // Runs a new pipeline of the shape and returns the generated mesh.
+    vtkSmartPointer<vtkPolyData> createMesh(const TessellationPolicy& policy = TessellationPolicy()) const;
+
+    // Pure virtual function returning a copy of the shape.
+    virtual std::unique_ptr<Shape> clone() const = 0;
+
+    // Pure virtual function returning the editable dimensions of the shape.
+    virtual std::vector<ShapeParameter> parameters() const = 0;
+
+    // Pure virtual function changing a dimension, clamped to its range; indices follow parameters().
+    virtual void setParameter(std::size_t index, double value) = 0;
+
+    // Pure virtual function creating the stages of the shape's pipeline, not configured yet.
+    virtual ShapePipeline createPipeline() const = 0;
+
+    // Pure virtual function pushing the shape's dimensions and the policy's resolution into its pipeline.
+    virtual void configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& policy) const = 0;
 };
 
 // Class to represent a 3D cube.
@@ -21,7 +111,14 @@ public:
     Cube(double xLength, double yLength, double zLength);
     virtual ~Cube();
 
-    vtkSmartPointer<vtkPolyDataMapper> createShape() const override;
+    using Shape::key;
+
+    ShapeKey key(const TessellationPolicy& policy) const override;
+    std::unique_ptr<Shape> clone() const override;
+    std::vector<ShapeParameter> parameters() const override;
+    void setParameter(std::size_t index, double value) override;
+    ShapePipeline createPipeline() const override;
+    void configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& policy) const override;
 };
 
 // Class to represent a 3D sphere.
@@ -33,7 +130,14 @@ public:
     Sphere(double radius);
     virtual ~Sphere();
 
-    vtkSmartPointer<vtkPolyDataMapper> createShape() const override;
+    using Shape::key;
+
+    ShapeKey key(const TessellationPolicy& policy) const override;
+    std::unique_ptr<Shape> clone() const override;
+    std::vector<ShapeParameter> parameters() const override;
+    void setParameter(std::size_t index, double value) override;
+    ShapePipeline createPipeline() const override;
+    void configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& policy) const override;
 };
 
 // Class to represent a 3D hemisphere.
@@ -45,7 +149,14 @@ public:
     Hemisphere(double radius);
     virtual ~Hemisphere();
 
-    vtkSmartPointer<vtkPolyDataMapper> createShape() const override;
+    using Shape::key;
+
+    ShapeKey key(const TessellationPolicy& policy) const override;
+    std::unique_ptr<Shape> clone() const override;
+    std::vector<ShapeParameter> parameters() const override;
+    void setParameter(std::size_t index, double value) override;
+    ShapePipeline createPipeline() const override;
+    void configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& policy) const override;
 };
 
 // Class to represent a 3D cone.
@@ -53,11 +164,20 @@ class Cone : public Shape {
 private:
     double angle;
 
+    double baseRadius() const;
+
 public:
     Cone(double angle);
     virtual ~Cone();
 
-    vtkSmartPointer<vtkPolyDataMapper> createShape() const override;
+    using Shape::key;
+
+    ShapeKey key(const TessellationPolicy& policy) const override;
+    std::unique_ptr<Shape> clone() const override;
+    std::vector<ShapeParameter> parameters() const override;
+    void setParameter(std::size_t index, double value) override;
+    ShapePipeline createPipeline() const override;
+    void configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& policy) const override;
 };
 
 // Class to represent a 3D pyramid.
@@ -69,7 +189,14 @@ public:
     Pyramid(double baseLength, double height);
     virtual ~Pyramid();
 
-    vtkSmartPointer<vtkPolyDataMapper> createShape() const override;
+    using Shape::key;
+
+    ShapeKey key(const TessellationPolicy& policy) const override;
+    std::unique_ptr<Shape> clone() const override;
+    std::vector<ShapeParameter> parameters() const override;
+    void setParameter(std::size_t index, double value) override;
+    ShapePipeline createPipeline() const override;
+    void configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& policy) const override;
 };
 
 // Class to represent a 3D cylinder.
@@ -81,7 +208,14 @@ public:
     Cylinder(double radius, double height);
     virtual ~Cylinder();
 
-    vtkSmartPointer<vtkPolyDataMapper> createShape() const override;
+    using Shape::key;
+
+    ShapeKey key(const TessellationPolicy& policy) const override;
+    std::unique_ptr<Shape> clone() const override;
+    std::vector<ShapeParameter> parameters() const override;
+    void setParameter(std::size_t index, double value) override;
+    ShapePipeline createPipeline() const override;
+    void configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& policy) const override;
 };
 
 // Class to represent a 3D tube.
@@ -93,7 +227,14 @@ public:
     Tube(double radius, double length);
     virtual ~Tube();
 
-    vtkSmartPointer<vtkPolyDataMapper> createShape() const override;
+    using Shape::key;
+
+    ShapeKey key(const TessellationPolicy& policy) const override;
+    std::unique_ptr<Shape> clone() const override;
+    std::vector<ShapeParameter> parameters() const override;
+    void setParameter(std::size_t index, double value) override;
+    ShapePipeline createPipeline() const override;
+    void configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& policy) const override;
 };
 
 // Class to represent a 3D doughnut (or torus).
@@ -105,7 +246,14 @@ public:
     Doughnut(double radius, double height);
     virtual ~Doughnut();
 
-    vtkSmartPointer<vtkPolyDataMapper> createShape() const override;
+    using Shape::key;
+
+    ShapeKey key(const TessellationPolicy& policy) const override;
+    std::unique_ptr<Shape> clone() const override;
+    std::vector<ShapeParameter> parameters() const override;
+    void setParameter(std::size_t index, double value) override;
+    ShapePipeline createPipeline() const override;
+    void configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& policy) const override;
 };
 
 // Class to represent a 3D curved cylinder.
@@ -117,5 +265,12 @@ public:
     CurvedCylinder(double radius);
     virtual ~CurvedCylinder();
 
-    vtkSmartPointer<vtkPolyDataMapper> createShape() const override;
+    using Shape::key;
+
+    ShapeKey key(const TessellationPolicy& policy) const override;
+    std::unique_ptr<Shape> clone() const override;
+    std::vector<ShapeParameter> parameters() const override;
+    void setParameter(std::size_t index, double value) override;
+    ShapePipeline createPipeline() const override;
+    void configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& policy) const override;
 };
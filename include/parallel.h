@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Returns the number of threads parallel algorithms use: one per hardware thread.
+ */
+inline unsigned parallelThreadCount()
+{
+    const unsigned count = std::thread::hardware_concurrency();
+    return count > 0 ? count : 1;
+}
+
+/**
+ * @class ParallelThreadLimit
+ * @brief Caps the threads of every parallelFor the current thread starts while it is alive.
+ *
+ * parallelFor starts fresh threads on each call, so work already running on the workers
+ * of an outer loop sets a limit of one: nested loops then run on the worker itself
+ * instead of each starting a thread per core.
+ */
+class ParallelThreadLimit
+{
+public:
+    /// @brief Sets the limit of the current thread until destruction; 0 lifts it.
+    explicit ParallelThreadLimit(unsigned threads) : mPrevious(current()) { current() = threads; }
+    ~ParallelThreadLimit() { current() = mPrevious; }
+
+    ParallelThreadLimit(const ParallelThreadLimit&) = delete;
+    ParallelThreadLimit& operator=(const ParallelThreadLimit&) = delete;
+
+    /// @brief Returns the limit of the current thread, 0 if there is none.
+    static unsigned& current()
+    {
+        thread_local unsigned limit = 0;
+        return limit;
+    }
+
+private:
+    const unsigned mPrevious;
+};
+
+/**
+ * @brief Runs fn(begin, end) over [0, count) split into blocks of at most grain items.
+ *
+ * Blocks are handed out dynamically to parallelThreadCount() threads, the calling thread
+ * included, so uneven blocks balance out. Returns when every block has been processed.
+ * fn must be safe to call concurrently for disjoint ranges and must not throw.
+ * A ParallelThreadLimit on the calling thread caps the thread count.
+ *
+ * @param count Number of items.
+ * @param grain Maximum items per block (at least 1).
+ * @param fn Callable taking (std::size_t begin, std::size_t end).
+ * @param threads Number of threads to use; 0 selects parallelThreadCount().
+ */
+template <typename Function>
+void parallelFor(std::size_t count, std::size_t grain, Function&& fn, unsigned threads = 0)
+{
+    if (count == 0)
+        return;
+
+    grain = std::max<std::size_t>(grain, 1);
+    const std::size_t blocks = (count + grain - 1) / grain;
+    const unsigned limit = ParallelThreadLimit::current();
+    const unsigned wanted = threads > 0 ? threads : parallelThreadCount();
+    const std::size_t workers = std::min<std::size_t>(limit > 0 ? std::min(wanted, limit) : wanted, blocks);
+
+    std::atomic<std::size_t> nextBlock{ 0 };
+    auto work = [&]() {
+        for (std::size_t block = nextBlock++; block < blocks; block = nextBlock++)
+        {
+            const std::size_t begin = block * grain;
+            fn(begin, std::min(begin + grain, count));
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (std::size_t i = 1; i < workers; ++i)
+        pool.emplace_back(work);
+
+    work();
+
+    for (std::thread& thread : pool)
+        thread.join();
+}
+
+/**
+ * @class ParallelProgress
+ * @brief Progress and cancellation shared by the workers of a parallelFor.
+ *
+ * Workers add the amount of work they finished; the progress callback is invoked by
+ * whichever worker gets the lock, the others skip the report instead of waiting.
+ */
+class ParallelProgress
+{
+public:
+    /**
+     * @brief Constructs a counter for the given amount of work.
+     *
+     * @param progress Called with the fraction done; may be empty.
+     * @param cancel Flag polled by canceled(); may be null.
+     * @param total Total amount of work.
+     */
+    ParallelProgress(const std::function<void(double)>& progress, const std::atomic<bool>* cancel, std::size_t total)
+        : mProgress(progress), mCancel(cancel), mTotal(total) {}
+
+    /// @brief Returns true once the cancel flag is set.
+    bool canceled() const { return mCancel && mCancel->load(); }
+
+    /// @brief Adds finished work and reports the new fraction if no other worker is reporting.
+    void advance(std::size_t amount)
+    {
+        const std::size_t done = mDone += amount;
+        if (!mProgress || mTotal == 0)
+            return;
+
+        std::unique_lock<std::mutex> lock(mMutex, std::try_to_lock);
+        if (lock)
+            mProgress(static_cast<double>(done) / mTotal);
+    }
+
+private:
+    const std::function<void(double)>& mProgress;
+    const std::atomic<bool>* mCancel;
+    const std::size_t mTotal;
+    std::atomic<std::size_t> mDone{ 0 };
+    std::mutex mMutex;
+};
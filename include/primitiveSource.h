@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+/**
+ * @brief Kind and dimensions of a built-in primitive generated by PrimitiveSource.
+ *
+ * The primitives are placed as the VTK sources they replace place them: the sphere and
+ * torus around the z-axis, the cylinder centered on the y-axis, the tube along the
+ * y-axis from the origin, and the cone along the x-axis with its apex towards +x.
+ */
+struct Primitive
+{
+    enum class Kind
+    {
+        Sphere,   ///< Sphere, or a wedge of it between startTheta and endTheta.
+        Cone,     ///< Capped cone.
+        Cylinder, ///< Capped cylinder.
+        Tube,     ///< Open cylinder starting at the origin.
+        Torus     ///< Torus; radius is the ring radius, minorRadius the tube radius.
+    };
+
+    Kind kind = Kind::Sphere;
+    double radius = 0.5;           ///< Radius of the sphere, the cone base, the cylinder or tube, or the torus ring.
+    double minorRadius = 0.1;      ///< Radius of the torus tube.
+    double height = 1.0;           ///< Height of the cone or cylinder, length of the tube.
+    int resolution = 8;            ///< Segments around the axis.
+    int secondaryResolution = 8;   ///< Segments from pole to pole of the sphere, or around the torus tube.
+    double startTheta = 0.0;       ///< First longitude of the sphere in degrees.
+    double endTheta = 360.0;       ///< Last longitude of the sphere in degrees.
+
+    bool operator==(const Primitive& other) const;
+    bool operator!=(const Primitive& other) const { return !(*this == other); }
+};
+
+/**
+ * @class PrimitiveSource
+ * @brief VTK source generating the built-in primitives natively.
+ *
+ * The VTK sources build points one by one through virtual insertion, in double
+ * precision, and evaluate sines and cosines for every point. generate() evaluates
+ * them once per row and column into tables, then fills preallocated float32 point
+ * and normal arrays in branch-free loops over the tables, which the compiler
+ * vectorizes, splitting large meshes across threads. Curved surfaces are emitted as
+ * triangle strips, one per band, with 32-bit ids written in the same pass; caps are
+ * single polygons, and the cone's side is a fan of triangles.
+ *
+ * Normals are exact surface normals, so curved surfaces shade smoothly without a
+ * normals filter.
+ */
+class PrimitiveSource : public vtkPolyDataAlgorithm
+{
+public:
+    /// Largest resolution; keeps every point and connectivity id within 32 bits.
+    static constexpr int MaxResolution = 16384;
+
+    static PrimitiveSource* New();
+    vtkTypeMacro(PrimitiveSource, vtkPolyDataAlgorithm);
+
+    PrimitiveSource(const PrimitiveSource&) = delete;
+    void operator=(const PrimitiveSource&) = delete;
+
+    /**
+     * @brief Sets the primitive to generate; the source is only marked modified if it differs.
+     */
+    void setPrimitive(const Primitive& primitive);
+
+    /// @brief Returns the primitive generated.
+    const Primitive& primitive() const { return mPrimitive; }
+
+    /**
+     * @brief Generates a primitive without a pipeline.
+     *
+     * @param primitive The primitive; resolutions are clamped to [3, MaxResolution].
+     * @param threads Worker threads for large meshes; 0 uses every core.
+     * @return vtkSmartPointer<vtkPolyData> Float32 points and normals and 32-bit cell ids.
+     */
+    static vtkSmartPointer<vtkPolyData> generate(const Primitive& primitive, unsigned threads = 0);
+
+protected:
+    PrimitiveSource();
+    ~PrimitiveSource() override = default;
+
+    int RequestData(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector) override;
+
+private:
+    Primitive mPrimitive;
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <QString>
+
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+#include <vtkPolyData.h>
+
+#include "scene.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class ProjectFile
+ * @brief Saves and opens sessions: every object's mesh reference, transform and material.
+ *
+ * A project file is a compact header followed by a table of contents: one fixed-size
+ * record per distinct mesh, holding its bounds, counts and the name of the MeshFile it
+ * is stored in, and one per object, holding the index of its mesh, its transform and
+ * its material. The meshes themselves live in the directory meshDirectory() next to
+ * the project file, so read() only reads the table, and a viewer can show every object
+ * as the box of its bounds at once while the meshes stream in, e.g. with ProjectLoader.
+ *
+ * An instance remembers which version of which mesh it last saved to which file, keyed
+ * by mesh like MeshBvhCache. Saving again only writes the meshes that are new or were
+ * modified since; the table, a few hundred bytes per object, is written whole. Changed
+ * meshes always go to new files and the files no longer used are only removed once the
+ * new table is in place, so a save that fails part way leaves the previous project
+ * intact.
+ */
+class ProjectFile
+{
+public:
+    /**
+     * @brief Table of contents entry of a mesh.
+     */
+    struct Mesh
+    {
+        QString file;                            ///< Name of its MeshFile in meshDirectory().
+        double bounds[6] = { 0, 0, 0, 0, 0, 0 }; ///< Bounds of its points in model space.
+        std::uint64_t points = 0;                ///< Number of points.
+        std::uint64_t polys = 0;                 ///< Number of polygons.
+    };
+
+    /**
+     * @brief Table of contents entry of an object.
+     */
+    struct Object
+    {
+        std::uint32_t mesh = 0;                 ///< Index of its mesh in Contents::meshes.
+        bool instanced = false;                 ///< Drawn through the instance batch of its mesh.
+        std::array<double, 3> position = {};    ///< As Scene::setPosition().
+        std::array<double, 3> orientation = {}; ///< As Scene::setOrientation().
+        double scale = 1.0;                     ///< As Scene::setScale().
+        std::array<double, 16> userMatrix = {}; ///< As Scene::setUserMatrix().
+        std::array<double, 3> color = {};       ///< As Scene::setColor().
+        double opacity = 1.0;                   ///< As Scene::setOpacity().
+    };
+
+    /**
+     * @brief The table of contents of a project, or why it could not be read.
+     */
+    struct Contents
+    {
+        std::vector<Mesh> meshes;    ///< Distinct meshes, in order of first use.
+        std::vector<Object> objects; ///< Objects in scene order.
+        QString error;               ///< Reason for the failure, empty on success.
+        std::size_t bytes = 0;       ///< Size of the project file.
+        double seconds = 0.0;        ///< Wall-clock time of the read.
+
+        /// @brief Returns true if the table was read completely.
+        bool ok() const { return error.isEmpty(); }
+    };
+
+    /**
+     * @brief Outcome of a save.
+     */
+    struct SaveResult
+    {
+        QString error;                 ///< Reason for the failure, empty on success.
+        std::size_t objects = 0;       ///< Objects saved.
+        std::size_t meshes = 0;        ///< Distinct meshes referenced.
+        std::size_t meshesWritten = 0; ///< Meshes written because they were new or modified, or copied from another project.
+        std::size_t bytesWritten = 0;  ///< Bytes written, table included.
+        std::size_t filesRemoved = 0;  ///< Mesh files removed because nothing uses them any more.
+        double seconds = 0.0;          ///< Wall-clock time of the save.
+
+        /// @brief Returns true if the project was saved completely.
+        bool ok() const { return error.isEmpty(); }
+    };
+
+    /**
+     * @brief Reads the table of contents of a project; the meshes are not read.
+     *
+     * @param path Path of the project file.
+     * @return Contents The table, or an error message.
+     */
+    static Contents read(const QString& path);
+
+    /**
+     * @brief Saves objects of a scene, writing only the meshes not saved to this path before.
+     *
+     * Meshes saved with another project, e.g. the one opened before saving under a new
+     * name, have their files copied rather than written again.
+     *
+     * @param path Path of the project file; an existing project is replaced.
+     * @param scene The scene; it is only read.
+     * @param objects The objects to save, in the order they are opened again.
+     * @return SaveResult Statistics of the save, or an error message.
+     */
+    SaveResult save(const QString& path, const Scene& scene, const std::vector<ObjectId>& objects);
+
+    /**
+     * @brief Forgets every saved mesh and makes path the project saved to, e.g. after opening it.
+     */
+    void reset(const QString& path);
+
+    /**
+     * @brief Records that a mesh, in its current version, is stored as an entry of a project.
+     *
+     * Called for meshes opened from a project, and for the boxes standing in for them
+     * until they are, so saving does not write them again.
+     *
+     * @param mesh The mesh.
+     * @param path Path of the project file the entry was read from.
+     * @param entry The entry.
+     */
+    void markSaved(vtkPolyData* mesh, const QString& path, const Mesh& entry);
+
+    /// @brief Returns the path of the last save or reset(), or an empty string.
+    QString path() const { return mPath; }
+
+    /**
+     * @brief Returns the directory holding the meshes of a project.
+     */
+    static QString meshDirectory(const QString& path) { return path + ".meshes"; }
+
+    /**
+     * @brief Returns a closed box of 12 triangles spanning bounds, to show a mesh that is not loaded yet.
+     */
+    static vtkSmartPointer<vtkPolyData> boundsMesh(const double bounds[6]);
+
+private:
+    /// A mesh as it was last saved.
+    struct Saved
+    {
+        vtkWeakPointer<vtkPolyData> mesh;
+        vtkMTimeType modified = 0;
+        QString directory;   ///< Mesh directory of the project the entry belongs to.
+        Mesh entry;
+    };
+
+    QString mPath;
+    std::unordered_map<vtkPolyData*, Saved> mSaved;
+    std::uint64_t mNextFile = 0; ///< Number tried first for the name of the next mesh file.
+};
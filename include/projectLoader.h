@@ -0,0 +1,100 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ProjectLoader
+ * @brief Streams the meshes of an opened project in on a worker thread, most wanted first.
+ *
+ * load() takes the mesh files of a project's table of contents and reads them one by
+ * one with MeshFile, emitting meshLoaded() for each. Meshes passed to prioritize() are
+ * read before the remaining ones, which follow in table order. Every page of a mapped
+ * mesh is touched on the worker, so the GUI thread does not stall on page faults when
+ * the mesh is first drawn. All signals are emitted on the thread that owns the loader.
+ *
+ * Only one project loads at a time: calling load() again or cancel() drops the meshes
+ * not delivered yet, and nothing of the earlier load is emitted afterwards.
+ */
+class ProjectLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs an idle loader.
+     *
+     * @param parent Parent QObject.
+     */
+    explicit ProjectLoader(QObject* parent = nullptr);
+
+    /// @brief Cancels any running load and waits for its worker thread.
+    ~ProjectLoader() override;
+
+    /// @brief Returns true while meshes are loading.
+    bool isLoading() const { return mJob != nullptr; }
+
+public slots:
+    /**
+     * @brief Starts reading the meshes of a project, canceling the load in progress if there is one.
+     *
+     * @param directory Directory holding the mesh files, see ProjectFile::meshDirectory().
+     * @param files Names of the mesh files; meshLoaded() reports meshes by their index here.
+     */
+    void load(const QString& directory, const QStringList& files);
+
+    /**
+     * @brief Reads a mesh next, before the ones not asked for; ignored if it was read already.
+     *
+     * @param mesh Index of the mesh in the list passed to load().
+     */
+    void prioritize(std::size_t mesh);
+
+    /**
+     * @brief Stops the load in progress, if any; meshes already delivered stay valid.
+     */
+    void cancel();
+
+signals:
+    /// @brief A mesh was read.
+    void meshLoaded(std::size_t mesh, vtkSmartPointer<vtkPolyData> polyData);
+
+    /// @brief A mesh could not be read.
+    void meshFailed(std::size_t mesh, const QString& error);
+
+    /// @brief Every mesh was read or failed.
+    void finished(std::size_t loaded, std::size_t failed, double seconds);
+
+private:
+    /**
+     * @brief State shared between the loader and one worker thread.
+     */
+    struct Job
+    {
+        QString directory;
+        QStringList files;
+        std::atomic<bool> cancel{ false };
+        std::mutex mutex;
+        std::deque<std::size_t> wanted;  ///< Meshes to read before the rest, most recent first.
+        std::vector<bool> started;       ///< Meshes read or being read; guarded by mutex.
+    };
+
+    void run(std::shared_ptr<Job> job, quint64 generation);
+    void finish(quint64 generation);
+
+    std::shared_ptr<Job> mJob;  ///< The load in progress, or null.
+    std::thread mWorker;        ///< Thread of the latest load; joined before the next one starts.
+    quint64 mGeneration = 0;    ///< Incremented per load and cancel; results of older generations are dropped.
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include <vtkSmartPointer.h>
+#include <vtkRenderWindow.h>
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * @class RenderScheduler
+ * @brief Coalesces render requests so a window renders at most once per frame interval.
+ *
+ * Slots that change the scene call requestRender(), which only marks the view dirty.
+ * The first request after a render arms a single-shot timer for the remainder of the
+ * frame interval; all requests arriving before it fires are served by one Render().
+ * renderNow() bypasses the cap when a frame must be on screen immediately.
+ */
+class RenderScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Counters of requested and executed renders.
+     */
+    struct Statistics
+    {
+        std::size_t requested = 0; ///< Calls to requestRender().
+        std::size_t executed = 0;  ///< Render() calls actually made.
+        std::size_t immediate = 0; ///< Renders forced through renderNow().
+    };
+
+    /// Default frame rate cap.
+    static constexpr double DefaultMaxFps = 60.0;
+
+    /**
+     * @brief Constructs a scheduler for the given window.
+     *
+     * @param window The window to render.
+     * @param parent Parent QObject.
+     */
+    explicit RenderScheduler(vtkRenderWindow* window, QObject* parent = nullptr);
+
+    /**
+     * @brief Sets the maximum number of renders per second. Values <= 0 remove the cap.
+     */
+    void setMaxFps(double fps);
+
+    /// @brief Returns the frame rate cap, or 0 if uncapped.
+    double maxFps() const { return mMaxFps; }
+
+    /**
+     * @brief Sets a function called right before every render, e.g. to sync the scene.
+     */
+    void setBeforeRender(std::function<void()> beforeRender) { mBeforeRender = std::move(beforeRender); }
+
+    /// @brief Returns true if a render has been requested but not executed yet.
+    bool isPending() const { return mPending; }
+
+    /// @brief Returns the request and execution counters.
+    Statistics statistics() const { return mStatistics; }
+
+public slots:
+    /**
+     * @brief Marks the view dirty; it is rendered within one frame interval.
+     */
+    void requestRender();
+
+    /**
+     * @brief Renders immediately, ignoring the frame rate cap.
+     */
+    void renderNow();
+
+private slots:
+    void onTimeout();
+
+private:
+    void render();
+
+    vtkSmartPointer<vtkRenderWindow> mRenderWindow;
+    std::function<void()> mBeforeRender;
+
+    QTimer mTimer;
+    QElapsedTimer mSinceLastRender;
+
+    double mMaxFps = DefaultMaxFps;
+    bool mPending = false;
+    Statistics mStatistics;
+};
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <vtkSmartPointer.h>
+#include <vtkActor.h>
+#include <vtkMatrix4x4.h>
+#include <vtkPolyData.h>
+#include <vtkRenderer.h>
+
+#include "instanceBatch.h"
+#include "meshNormalsCache.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/// Stable handle of an object in a Scene.
+using ObjectId = std::uint32_t;
+
+/// Handle value that never refers to an object.
+constexpr ObjectId InvalidObjectId = 0xFFFFFFFFu;
+
+/**
+ * @class Scene
+ * @brief Holds every object of the modeling session, its transform, material and selection state.
+ *
+ * Object state lives in flat structure-of-arrays columns indexed by a dense slot,
+ * so per-frame work touches contiguous memory regardless of how many objects exist.
+ * ObjectIds stay valid until the object is removed; removal swaps the last slot into
+ * the freed one so the columns never have holes.
+ *
+ * The columns are the source of truth. Each object is rendered either by its own vtkActor
+ * or, if it was added as an instance, as one entry of the InstanceBatch shared by all
+ * instances of the same mesh. Setters only mark the object dirty; syncToVtk() pushes the
+ * dirty entries to their actors or batches once per frame.
+ *
+ * Meshes without point normals, such as loaded STL files, are drawn with normals from
+ * the scene's MeshNormalsCache, computed once per version of the mesh. mesh() and
+ * exports keep returning the object's own mesh.
+ */
+class Scene
+{
+public:
+    /// Bits recording which parts of an object changed since the last sync.
+    enum DirtyFlag : std::uint8_t
+    {
+        DirtyTransform = 1 << 0,
+        DirtyMaterial = 1 << 1,
+        DirtyMesh = 1 << 2,
+        DirtyAll = DirtyTransform | DirtyMaterial | DirtyMesh
+    };
+
+    /**
+     * @brief Constructs an empty scene.
+     *
+     * @param renderer Renderer the objects' actors are added to. May be null for headless use.
+     */
+    explicit Scene(vtkRenderer* renderer = nullptr);
+
+    /**
+     * @brief Removes every object's actor from the renderer.
+     */
+    ~Scene();
+
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    /**
+     * @brief Adds an object with default transform and material.
+     *
+     * @param mesh The object's geometry. It may be shared with other objects.
+     * @return ObjectId Handle of the new object.
+     */
+    ObjectId addObject(vtkSmartPointer<vtkPolyData> mesh);
+
+    /**
+     * @brief Adds an object drawn through the instance batch of its mesh.
+     *
+     * All instances of the same vtkPolyData share one actor and one upload of the mesh.
+     * Instanced objects have no actor of their own.
+     *
+     * @param mesh The object's geometry, typically a shared mesh from the ShapeCache.
+     * @return ObjectId Handle of the new object.
+     */
+    ObjectId addInstance(vtkSmartPointer<vtkPolyData> mesh);
+
+    /**
+     * @brief Adds an object under a given free id, e.g. to bring a removed object back on undo.
+     *
+     * The object gets default transform and material like addObject() and addInstance().
+     *
+     * @param id The id the object gets; must not refer to an object in the scene.
+     * @param mesh The object's geometry.
+     * @param instanced Draw the object through the instance batch of its mesh.
+     * @return bool False if the id is in use or invalid; nothing is added then.
+     */
+    bool restoreObject(ObjectId id, vtkSmartPointer<vtkPolyData> mesh, bool instanced);
+
+    /**
+     * @brief Removes an object. Its id becomes invalid and may be reused.
+     *
+     * If the object was the current one, the scene has no current object afterwards.
+     *
+     * @param id The object to remove.
+     */
+    void removeObject(ObjectId id);
+
+    /**
+     * @brief Removes every object.
+     */
+    void clear();
+
+    /// @brief Returns true if the id refers to an object in the scene.
+    bool contains(ObjectId id) const;
+
+    /// @brief Returns the number of objects in the scene.
+    std::size_t size() const { return mIds.size(); }
+
+    /// @brief Returns the ids of all objects in slot order.
+    const std::vector<ObjectId>& objects() const { return mIds; }
+
+    /// @name Transform
+    /// @{
+    void setPosition(ObjectId id, const double position[3]);
+    void getPosition(ObjectId id, double position[3]) const;
+    /// Orientation in degrees about the X, Y and Z axes, applied like vtkProp3D::SetOrientation.
+    void setOrientation(ObjectId id, const double orientation[3]);
+    void getOrientation(ObjectId id, double orientation[3]) const;
+    void setScale(ObjectId id, double scale);
+    double scale(ObjectId id) const;
+    /// Extra world-space transform applied after position, orientation and scale (row-major 4x4).
+    /// An instance given a non-identity matrix becomes a plain object with its own actor, since its batch cannot draw it.
+    void setUserMatrix(ObjectId id, const double matrix[16]);
+    void getUserMatrix(ObjectId id, double matrix[16]) const;
+    /// Returns true if the object has a non-identity user matrix.
+    bool hasUserMatrix(ObjectId id) const;
+    /// Computes the matrix built from position, orientation and scale, excluding the user matrix.
+    void getModelMatrix(ObjectId id, vtkMatrix4x4* matrix) const;
+    /// Computes the matrix placing the mesh in the world: the user matrix times the model matrix (row-major 4x4).
+    void getWorldMatrix(ObjectId id, double matrix[16]) const;
+    /// @}
+
+    /// @name Material
+    /// @{
+    void setColor(ObjectId id, const double rgb[3]);
+    void getColor(ObjectId id, double rgb[3]) const;
+    void setOpacity(ObjectId id, double opacity);
+    double opacity(ObjectId id) const;
+    /// Draws the object in the highlight color instead of its own, e.g. to flag interference. Its color is kept.
+    void setHighlighted(ObjectId id, bool highlighted);
+    bool isHighlighted(ObjectId id) const;
+    /// @}
+
+    /// @name Geometry
+    /// @{
+    void setMesh(ObjectId id, vtkSmartPointer<vtkPolyData> mesh);
+    vtkPolyData* mesh(ObjectId id) const;
+    /**
+     * @brief Returns the mesh with the user matrix applied in model space.
+     *
+     * The result renders identically once the user matrix is reset to identity.
+     * Without a user matrix the object's own mesh is returned.
+     */
+    vtkSmartPointer<vtkPolyData> bakedMesh(ObjectId id) const;
+    /// Replaces the mesh with bakedMesh() and resets the user matrix.
+    void bakeUserMatrix(ObjectId id);
+    /**
+     * @brief Draws another mesh in place of the object's mesh, e.g. a level of detail.
+     *
+     * Only the actor's input changes; mesh(), bakedMesh() and exports keep using the
+     * object's own mesh. Null draws the object's mesh again. Ignored for instanced objects.
+     */
+    void setRenderMesh(ObjectId id, vtkSmartPointer<vtkPolyData> mesh);
+    /// Mesh drawn in place of the object's mesh, or null if the object's mesh is drawn.
+    vtkPolyData* renderMesh(ObjectId id) const;
+    /// Actor rendering the object, or null for instanced objects. Its transform and property are owned by the scene.
+    vtkActor* actor(ObjectId id) const;
+    /// Returns true if the object is drawn through an instance batch.
+    bool isInstanced(ObjectId id) const;
+    /// Returns the number of instance batches, i.e. distinct instanced meshes.
+    std::size_t batchCount() const { return mBatches.size(); }
+    /// Normals of the meshes drawn without their own. Only filled when the scene has a renderer.
+    MeshNormalsCache& normalsCache() { return mNormals; }
+    const MeshNormalsCache& normalsCache() const { return mNormals; }
+    /// @}
+
+    /// @name Selection
+    /// @{
+    /// Sets the object the UI controls act on. InvalidObjectId clears it.
+    void setCurrent(ObjectId id);
+    ObjectId current() const { return mCurrent; }
+    void setSelected(ObjectId id, bool selected);
+    bool isSelected(ObjectId id) const;
+    void clearSelection();
+    void selectAll();
+    /// Returns the selected objects in slot order.
+    std::vector<ObjectId> selection() const;
+    /// @}
+
+    /**
+     * @brief Marks parts of an object as changed so the next sync pushes them.
+     *
+     * @param id The object.
+     * @param flags Combination of DirtyFlag bits.
+     */
+    void markDirty(ObjectId id, std::uint8_t flags);
+
+    /// @brief Returns the number of objects waiting to be synced.
+    std::size_t dirtyCount() const { return mDirtyList.size(); }
+
+    /**
+     * @brief Returns a counter that grows whenever an object is added, removed, moved or gets another mesh.
+     *
+     * Unlike the dirty flags it is not reset by syncToVtk(), so consumers other than the
+     * actors, such as spatial indices, can find out what changed since they last looked.
+     */
+    std::uint64_t geometryRevision() const { return mGeometryRevision; }
+
+    /// @brief Returns the value geometryRevision() had after the object was last added, moved or given another mesh.
+    std::uint64_t geometryRevision(ObjectId id) const { return mRevision[slotOf(id)]; }
+
+    /**
+     * @brief Pushes the state of every dirty object to its actor.
+     *
+     * @return std::size_t Number of objects synced.
+     */
+    std::size_t syncToVtk();
+
+private:
+    std::uint32_t slotOf(ObjectId id) const { return mSlotOf[id]; }
+    ObjectId allocateSlot(vtkSmartPointer<vtkPolyData> mesh, ObjectId id = InvalidObjectId);
+    void attachActor(ObjectId id);
+    void moveSlot(std::uint32_t from, std::uint32_t to);
+    void popSlot();
+    InstanceBatch* batchFor(vtkPolyData* mesh);
+    vtkSmartPointer<vtkPolyData> shadedMesh(vtkPolyData* mesh);
+    void attachInstance(ObjectId id);
+    void detachInstance(ObjectId id);
+
+    vtkRenderer* mRenderer;
+
+    // id <-> slot mapping
+    std::vector<std::uint32_t> mSlotOf;   ///< Indexed by ObjectId; InvalidObjectId if free.
+    std::vector<ObjectId> mFreeIds;
+    std::vector<ObjectId> mIds;           ///< Indexed by slot.
+
+    // Columns, indexed by slot
+    std::vector<std::array<double, 3>> mPosition;
+    std::vector<std::array<double, 3>> mOrientation;
+    std::vector<double> mScale;
+    std::vector<std::array<double, 16>> mUserMatrix;
+    std::vector<std::array<double, 3>> mColor;
+    std::vector<double> mOpacity;
+    std::vector<std::uint8_t> mHighlighted;
+    std::vector<std::uint8_t> mSelected;
+    std::vector<std::uint8_t> mDirty;
+    std::vector<vtkSmartPointer<vtkPolyData>> mMesh;
+    std::vector<vtkSmartPointer<vtkPolyData>> mRenderMesh; ///< Null draws mMesh.
+    std::vector<vtkSmartPointer<vtkActor>> mActor;      ///< Null for instanced objects.
+    std::vector<InstanceBatch*> mBatch;                 ///< Null for objects with their own actor.
+    std::vector<std::uint32_t> mInstance;               ///< Index inside mBatch.
+    std::vector<std::uint64_t> mRevision;               ///< Geometry revision of the last transform or mesh change.
+
+    std::unordered_map<vtkPolyData*, std::unique_ptr<InstanceBatch>> mBatches;
+    MeshNormalsCache mNormals;
+    bool mPruneNormals = false;           ///< A mesh was replaced or removed since the last sync.
+
+    std::vector<ObjectId> mDirtyList;     ///< Objects with a non-zero dirty mask.
+    ObjectId mCurrent = InvalidObjectId;
+    std::uint64_t mGeometryRevision = 0;
+};
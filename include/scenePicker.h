@@ -0,0 +1,123 @@
+#pragma once
+
+#include "meshBvhCache.h"
+#include "scene.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class ScenePicker
+ * @brief Finds the object and triangle under a ray through a two-level bounding volume hierarchy.
+ *
+ * The top level is a hierarchy over the world bounds of the scene's objects; each
+ * object's leaf holds the inverse of its world matrix, so rays are transformed into
+ * model space and tested against the MeshBvh of the object's mesh. Mesh hierarchies come
+ * from a MeshBvhCache, are built on the first pick that reaches the mesh and are shared
+ * by every object using it; one built for an instance batch serves all its instances.
+ *
+ * The picker follows the scene through Scene::geometryRevision(). Objects that moved
+ * or got another mesh have their bounds recomputed and the top level is refit bottom-up,
+ * keeping its topology. It is rebuilt when objects were added or removed, or once
+ * refitting has grown the total area of its nodes past twice the area it had when built.
+ *
+ * Picks always test the object's own mesh, not the level of detail being drawn.
+ */
+class ScenePicker
+{
+public:
+    /**
+     * @brief The closest object a ray hits.
+     */
+    struct Hit
+    {
+        ObjectId object = InvalidObjectId; ///< The hit object, or InvalidObjectId if nothing was hit.
+        vtkIdType cell = -1;               ///< Id of the hit cell in the object's mesh.
+        double t = 0.0;                    ///< Ray parameter of the hit: origin + t * direction.
+        double point[3] = { 0.0, 0.0, 0.0 }; ///< Hit point in world coordinates.
+
+        /// @brief Returns true if the ray hit an object.
+        bool hit() const { return object != InvalidObjectId; }
+    };
+
+    /**
+     * @brief Snapshot of the picker's counters.
+     */
+    struct Statistics
+    {
+        std::size_t objects = 0;     ///< Objects in the top level.
+        std::size_t meshes = 0;      ///< Meshes with a built hierarchy in the cache.
+        std::size_t triangles = 0;   ///< Triangles across the cached mesh hierarchies.
+        std::size_t bytes = 0;       ///< Memory held by the cached mesh hierarchies.
+        std::size_t rebuilds = 0;    ///< Times the top level was rebuilt.
+        std::size_t refits = 0;      ///< Times the top level was refit.
+    };
+
+    /**
+     * @brief Constructs a picker for a scene. Nothing is built until the first pick.
+     *
+     * @param scene The scene to pick from; must outlive the picker.
+     * @param cache Cache of the mesh hierarchies; must outlive the picker.
+     */
+    ScenePicker(const Scene& scene, MeshBvhCache& cache);
+
+    /**
+     * @brief Finds the closest object along a ray.
+     *
+     * Brings the top level up to date with the scene first, and builds the hierarchies
+     * of meshes the ray reaches for the first time.
+     *
+     * @param origin Start of the ray in world coordinates.
+     * @param direction Direction of the ray; need not be normalized.
+     * @return Hit The closest hit, if any.
+     */
+    Hit pick(const double origin[3], const double direction[3]);
+
+    /**
+     * @brief Brings the top level up to date with the scene, refitting or rebuilding it.
+     */
+    void update();
+
+    /**
+     * @brief Drops the top level; it is rebuilt on demand. Mesh hierarchies stay in the cache.
+     */
+    void clear();
+
+    /// @brief Returns a snapshot of the counters.
+    Statistics statistics() const;
+
+private:
+    /// Interior nodes have count 0 and children first and first + 1; leaves hold objects [first, first + count).
+    struct Node
+    {
+        float lower[3];
+        std::uint32_t first;
+        float upper[3];
+        std::uint32_t count;
+    };
+
+    void rebuild();
+    void refit();
+    void computeObject(std::uint32_t index);
+    void buildNode(std::vector<std::uint32_t>& order, std::uint32_t index, std::uint32_t begin, std::uint32_t end);
+
+    const Scene& mScene;
+    MeshBvhCache& mCache;
+    std::uint64_t mRevision = 0;
+    bool mBuilt = false;
+    float mBuiltArea = 0.0f;
+
+    std::vector<Node> mNodes;
+
+    // Objects in leaf order
+    std::vector<ObjectId> mObjects;
+    std::vector<std::array<double, 16>> mInverse;   ///< World to model matrix of each object.
+    std::vector<std::array<float, 6>> mBounds;      ///< World bounds of each object: lower then upper corner.
+    std::vector<std::uint64_t> mObjectRevision;     ///< Scene::geometryRevision(id) when the object was last read.
+    std::vector<std::uint32_t> mIndexOf;            ///< Position in mObjects, indexed by ObjectId.
+
+    std::size_t mRebuilds = 0;
+    std::size_t mRefits = 0;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vtkActor.h>
+#include <vtkCamera.h>
+#include <vtkMath.h>
+#include <vtkRenderer.h>
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Returns how many pixels one world unit covers at an actor's distance from the camera.
+ *
+ * The distance is measured to the near side of the actor's bounding sphere, so the
+ * estimate holds for the whole actor. With a parallel projection the distance does
+ * not matter.
+ *
+ * @param renderer The renderer whose camera and viewport define the screen.
+ * @param actor The actor whose bounds are measured.
+ * @param worldRadius Receives half the diagonal of the actor's bounds, if not null.
+ * @return double Pixels per world unit, or 0 if the camera is inside the bounding sphere.
+ */
+inline double pixelsPerWorldUnit(vtkRenderer* renderer, vtkActor* actor, double* worldRadius = nullptr)
+{
+    vtkCamera* camera = renderer->GetActiveCamera();
+    const double viewportHeight = std::max(1, renderer->GetSize()[1]);
+
+    double bounds[6];
+    actor->GetBounds(bounds);
+    const double center[3] = { (bounds[0] + bounds[1]) / 2, (bounds[2] + bounds[3]) / 2, (bounds[4] + bounds[5]) / 2 };
+    const double extent[3] = { bounds[1] - bounds[0], bounds[3] - bounds[2], bounds[5] - bounds[4] };
+    const double radius = std::sqrt(vtkMath::Dot(extent, extent)) / 2.0;
+    if (worldRadius)
+        *worldRadius = radius;
+
+    if (camera->GetParallelProjection())
+        return viewportHeight / (2.0 * camera->GetParallelScale());
+
+    double cameraPosition[3];
+    camera->GetPosition(cameraPosition);
+    const double tanHalfAngle = std::tan(vtkMath::RadiansFromDegrees(camera->GetViewAngle()) / 2.0);
+    const double distance = std::sqrt(vtkMath::Distance2BetweenPoints(cameraPosition, center)) - radius;
+    return distance > 0.0 ? viewportHeight / (2.0 * distance * tanHalfAngle) : 0.0;
+}
+
+/**
+ * @brief Computes the world-space ray under a display position.
+ *
+ * The ray starts on the near clipping plane and its direction reaches the far plane,
+ * so the ray parameter runs from 0 to 1 through the view frustum.
+ *
+ * @param renderer The renderer whose camera and viewport define the screen.
+ * @param x Display x in pixels, from the left, as in vtkRenderWindowInteractor::GetEventPosition().
+ * @param y Display y in pixels, from the bottom.
+ * @param origin Receives the start of the ray.
+ * @param direction Receives the direction of the ray.
+ */
+inline void displayRay(vtkRenderer* renderer, double x, double y, double origin[3], double direction[3])
+{
+    double planes[2][4];
+    for (int plane = 0; plane < 2; ++plane)
+    {
+        renderer->SetDisplayPoint(x, y, plane);
+        renderer->DisplayToWorld();
+        renderer->GetWorldPoint(planes[plane]);
+        for (int axis = 0; axis < 3; ++axis)
+            planes[plane][axis] /= planes[plane][3];
+    }
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        origin[axis] = planes[0][axis];
+        direction[axis] = planes[1][axis] - planes[0][axis];
+    }
+}
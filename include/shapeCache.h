@@ -0,0 +1,131 @@
+#pragma once
+
+#include "model.h"
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class ShapeCache
+ * @brief Content-addressed cache of generated shape meshes.
+ *
+ * Meshes are keyed by ShapeKey (shape type, constructor parameters and resolution),
+ * so every request for the same primitive returns the same vtkPolyData instead of
+ * re-running the VTK source. Cached meshes are shared between actors and must be
+ * treated as immutable: edits have to produce a new vtkPolyData.
+ *
+ * The cache is bounded by a memory capacity and evicts the least recently used
+ * meshes first. All public methods are thread-safe.
+ */
+class ShapeCache
+{
+public:
+    /**
+     * @brief Snapshot of the cache counters.
+     */
+    struct Statistics
+    {
+        std::size_t hits = 0;          ///< Lookups served from the cache.
+        std::size_t misses = 0;        ///< Lookups that had to generate the mesh.
+        std::size_t evictions = 0;     ///< Meshes dropped to stay under the capacity.
+        std::size_t entries = 0;       ///< Meshes currently cached.
+        std::size_t bytes = 0;         ///< Memory held by the cached meshes.
+        std::size_t capacityBytes = 0; ///< Configured memory cap.
+    };
+
+    /// Default memory cap of the cache (256 MiB).
+    static constexpr std::size_t DefaultCapacityBytes = 256u * 1024u * 1024u;
+
+    /**
+     * @brief Constructs an empty cache.
+     *
+     * @param capacityBytes Maximum memory the cached meshes may use.
+     */
+    explicit ShapeCache(std::size_t capacityBytes = DefaultCapacityBytes);
+
+    /**
+     * @brief Waits for a running pre-warm to finish.
+     */
+    ~ShapeCache();
+
+    ShapeCache(const ShapeCache&) = delete;
+    ShapeCache& operator=(const ShapeCache&) = delete;
+
+    /**
+     * @brief Returns the mesh for the given shape, generating it on a miss.
+     *
+     * Meshes of the same shape generated under different tessellation policies are
+     * cached separately, as far as the policies lead to different resolutions.
+     *
+     * @param shape The shape whose geometry is requested.
+     * @param policy How finely curved surfaces are tessellated.
+     * @return vtkSmartPointer<vtkPolyData> The shared, immutable mesh.
+     */
+    vtkSmartPointer<vtkPolyData> getOrCreate(const Shape& shape, const TessellationPolicy& policy = TessellationPolicy());
+
+    /**
+     * @brief Sets the memory cap, evicting meshes if the cache is over the new limit.
+     *
+     * @param capacityBytes Maximum memory the cached meshes may use.
+     */
+    void setCapacity(std::size_t capacityBytes);
+
+    /**
+     * @brief Returns the current counters.
+     */
+    Statistics statistics() const;
+
+    /**
+     * @brief Drops every cached mesh. Counters are kept.
+     */
+    void clear();
+
+    /**
+     * @brief Generates the given shapes on a background thread so later lookups hit.
+     *
+     * A pre-warm already in progress is finished before the new one starts.
+     *
+     * @param shapes Shapes to generate.
+     */
+    void prewarm(std::vector<std::unique_ptr<Shape>> shapes);
+
+    /**
+     * @brief Blocks until the background pre-warm, if any, has finished.
+     */
+    void waitForPrewarm();
+
+private:
+    struct Entry
+    {
+        ShapeKey key;
+        vtkSmartPointer<vtkPolyData> mesh;
+        std::size_t bytes;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    void insert(const ShapeKey& key, vtkSmartPointer<vtkPolyData> mesh);
+    void evictToCapacity();
+
+    mutable std::mutex mMutex;
+    EntryList mEntries; ///< Most recently used first.
+    std::unordered_map<ShapeKey, EntryList::iterator, ShapeKeyHash> mIndex;
+
+    std::size_t mCapacityBytes;
+    std::size_t mBytes = 0;
+    std::size_t mHits = 0;
+    std::size_t mMisses = 0;
+    std::size_t mEvictions = 0;
+
+    std::thread mPrewarmThread;
+    std::atomic<bool> mStopPrewarm{ false };
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "model.h"
+#include "scene.h"
+
+#include <vtkPolyData.h>
+#include <vtkWeakPointer.h>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * @class ShapeEditor
+ * @brief Edits the dimensions of a generated shape live, re-executing only the pipeline stages an edit affects.
+ *
+ * open() builds the shape's pipeline once and keeps it alive while the object is edited.
+ * setParameter() only records the new value. update(), called right before rendering,
+ * pushes the values into the pipeline, executes the stages they modified and gives the
+ * object the new mesh: however many values arrive between two frames, the pipeline runs
+ * at most once per frame, and not at all when nothing changed.
+ *
+ * Edited meshes bypass the ShapeCache, so the intermediate values of a drag do not evict
+ * meshes in use. Editing stops being current once the object is removed or its mesh is
+ * replaced by anything else, such as an undo or a baked transform.
+ */
+class ShapeEditor
+{
+public:
+    /**
+     * @brief Snapshot of the editor's counters.
+     */
+    struct Statistics
+    {
+        std::size_t updates = 0;   ///< Meshes regenerated since the editor was constructed.
+        double lastUpdateMs = 0.0; ///< Time of the last regeneration.
+    };
+
+    ShapeEditor() = default;
+
+    ShapeEditor(const ShapeEditor&) = delete;
+    ShapeEditor& operator=(const ShapeEditor&) = delete;
+
+    /**
+     * @brief Starts editing an object, closing the previous edit.
+     *
+     * @param scene The scene the object belongs to.
+     * @param id The object; it must show the shape's mesh generated under the policy.
+     * @param shape The shape the object's mesh was generated from.
+     * @param policy How finely the edited shape is tessellated.
+     */
+    void open(const Scene& scene, ObjectId id, std::unique_ptr<Shape> shape, const TessellationPolicy& policy);
+
+    /**
+     * @brief Stops editing and releases the pipeline; edits not applied by update() are dropped.
+     */
+    void close();
+
+    /// @brief Returns true while an object is edited.
+    bool isOpen() const { return mObject != InvalidObjectId; }
+
+    /// @brief Returns the edited object, or InvalidObjectId.
+    ObjectId object() const { return mObject; }
+
+    /// @brief Returns the edited shape with the values set so far, or nullptr.
+    const Shape* shape() const { return mShape.get(); }
+
+    /// @brief Returns the tessellation of the edited shape.
+    const TessellationPolicy& policy() const { return mPolicy; }
+
+    /**
+     * @brief Returns the parameters of the edited shape, or none if closed.
+     */
+    std::vector<ShapeParameter> parameters() const;
+
+    /**
+     * @brief Records a new value of a parameter; the mesh follows at the next update().
+     *
+     * @param index Index of the parameter, as in parameters().
+     * @param value The new value, clamped to the parameter's range.
+     */
+    void setParameter(std::size_t index, double value);
+
+    /// @brief Returns true if a value changed since the last update().
+    bool hasPendingEdit() const { return mPending; }
+
+    /**
+     * @brief Returns true if the edited object still exists and shows the editor's last mesh.
+     */
+    bool isCurrent(const Scene& scene) const;
+
+    /**
+     * @brief Regenerates the edited object's mesh if a value changed.
+     *
+     * Must be called from the thread that renders, before the scene is synced.
+     *
+     * @param scene The scene the object belongs to.
+     * @return bool True if the object got a new mesh.
+     */
+    bool update(Scene& scene);
+
+    /**
+     * @brief Returns the current counters.
+     */
+    Statistics statistics() const { return mStatistics; }
+
+private:
+    ObjectId mObject = InvalidObjectId;
+    std::unique_ptr<Shape> mShape;
+    TessellationPolicy mPolicy;
+    ShapePipeline mPipeline;
+    vtkWeakPointer<vtkPolyData> mMesh; ///< The mesh last assigned to the object.
+    bool mPending = false;
+    Statistics mStatistics;
+};
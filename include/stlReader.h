@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QString>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+/**
+ * @class StlReader
+ * @brief Memory-mapped, multithreaded reader for binary and ASCII STL files.
+ *
+ * The file is mapped instead of read through stdio, its format is detected from the
+ * header and size, and facets are parsed in parallel chunks straight into preallocated
+ * float32 point and 32-bit connectivity arrays. There is no per-facet allocation and
+ * no point merging: every facet contributes three points, as written in the file.
+ */
+class StlReader
+{
+public:
+    /**
+     * @brief Reader settings.
+     */
+    struct Options
+    {
+        unsigned threads = 0;                     ///< Worker threads; 0 uses every core.
+        std::function<void(double)> progress;     ///< Called with the fraction done, from a worker thread.
+        const std::atomic<bool>* cancel = nullptr; ///< Reading stops early once this becomes true.
+    };
+
+    /**
+     * @brief Outcome of a read.
+     */
+    struct Result
+    {
+        vtkSmartPointer<vtkPolyData> mesh; ///< The triangles, or null on failure.
+        QString error;                     ///< Reason for the failure, empty on success.
+        bool binary = false;               ///< True if the file was binary STL.
+        std::size_t facets = 0;            ///< Number of facets read.
+        std::size_t bytes = 0;             ///< Size of the file.
+        double seconds = 0.0;              ///< Wall-clock time of the read.
+        bool sampled = false;              ///< True if the mesh is only a preview subset of the facets.
+        bool cached = false;               ///< True if the mesh was mapped from its MeshFile cache instead of parsed.
+
+        /// @brief Returns the read throughput in MB/s.
+        double throughputMBps() const { return seconds > 0.0 ? bytes / (seconds * 1.0e6) : 0.0; }
+    };
+
+    /**
+     * @brief Reads an STL file.
+     *
+     * @param path Path of the file.
+     * @param options Threading, progress and cancellation settings.
+     * @return Result The mesh and statistics, or an error message.
+     */
+    static Result read(const QString& path, const Options& options);
+
+    /**
+     * @brief Reads an STL file on every core, without progress reporting or cancellation.
+     *
+     * @param path Path of the file.
+     * @return Result The mesh and statistics, or an error message.
+     */
+    static Result read(const QString& path) { return read(path, Options()); }
+
+    /**
+     * @brief Reads an evenly spread subset of at most maxFacets facets, for a quick preview.
+     *
+     * Sampling stops once budgetSeconds have passed, keeping a coarser but still evenly
+     * spread subset. Small files are read completely; Result::sampled tells which happened.
+     *
+     * @param path Path of the file.
+     * @param maxFacets Maximum number of facets in the preview.
+     * @param budgetSeconds Time after which sampling stops with what it has.
+     * @param options Threading and cancellation settings; progress is not reported.
+     * @return Result The preview mesh and statistics, or an error message.
+     */
+    static Result readPreview(const QString& path, std::size_t maxFacets, double budgetSeconds, const Options& options);
+};
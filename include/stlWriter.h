@@ -0,0 +1,85 @@
+#pragma once
+
+#include <QString>
+
+#include <vtkPolyData.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/**
+ * @class StlWriter
+ * @brief Multithreaded writer of binary STL files.
+ *
+ * Polygons are fan-triangulated and triangle strips unrolled on the fly; lines and
+ * vertices are skipped. The output file is sized up front and mapped, and blocks of
+ * cells are serialized in parallel straight into it, facet normals included. Where
+ * the file cannot be mapped, the same blocks are serialized into large buffers that
+ * are written with one call each.
+ */
+class StlWriter
+{
+public:
+    /**
+     * @brief Writer settings.
+     */
+    struct Options
+    {
+        unsigned threads = 0;                     ///< Worker threads; 0 uses every core.
+        std::function<void(double)> progress;     ///< Called with the fraction done, from a worker thread.
+        const std::atomic<bool>* cancel = nullptr; ///< Writing stops early once this becomes true.
+        std::uint16_t attribute = 0;              ///< Attribute word of every facet, e.g. from colorAttribute().
+    };
+
+    /**
+     * @brief Outcome of a write.
+     */
+    struct Result
+    {
+        QString error;          ///< Reason for the failure, empty on success.
+        std::size_t facets = 0; ///< Number of facets written.
+        std::size_t bytes = 0;  ///< Size of the file written.
+        double seconds = 0.0;   ///< Wall-clock time of the write.
+
+        /// @brief Returns true if the file was written completely.
+        bool ok() const { return error.isEmpty(); }
+
+        /// @brief Returns the write throughput in MB/s.
+        double throughputMBps() const { return seconds > 0.0 ? bytes / (seconds * 1.0e6) : 0.0; }
+    };
+
+    /**
+     * @brief Writes the triangles of a mesh as binary STL.
+     *
+     * The mesh is only read, so it may be written from a worker thread while it is
+     * being rendered. A canceled or failed write removes the incomplete file.
+     *
+     * @param path Path of the file; an existing file is replaced.
+     * @param mesh The mesh to write.
+     * @param options Threading, progress and cancellation settings.
+     * @return Result Statistics of the write, or an error message.
+     */
+    static Result write(const QString& path, vtkPolyData* mesh, const Options& options);
+
+    /**
+     * @brief Writes the triangles of a mesh as binary STL on every core.
+     *
+     * @param path Path of the file; an existing file is replaced.
+     * @param mesh The mesh to write.
+     * @return Result Statistics of the write, or an error message.
+     */
+    static Result write(const QString& path, vtkPolyData* mesh) { return write(path, mesh, Options()); }
+
+    /**
+     * @brief Encodes a color as a facet attribute word, as read by VisCAM and SolidView.
+     *
+     * Five bits per channel, blue in the lowest bits and red in the highest, with the top bit set to
+     * mark the color valid.
+     *
+     * @param rgb The color, each channel in [0, 1].
+     * @return std::uint16_t The attribute word.
+     */
+    static std::uint16_t colorAttribute(const double rgb[3]);
+};
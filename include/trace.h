@@ -0,0 +1,107 @@
+#pragma once
+
+#include <QString>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class Trace
+ * @brief Process-wide recorder of timed spans, exported in Chrome's trace event format.
+ *
+ * Every thread records into a ring buffer of its own, so recording takes no lock: the
+ * owning thread is the only writer, and every slot carries a sequence number the
+ * exporter uses to skip events overwritten while it reads them. Buffers of threads that
+ * have exited are handed to new threads, so memory is bounded by the number of threads
+ * alive at once.
+ *
+ * Tracing is always compiled in and off by default. While off, a span costs one relaxed
+ * atomic load. Names and categories must be string literals or otherwise outlive the
+ * trace, since only their pointers are stored.
+ *
+ * The exported file opens in chrome://tracing or https://ui.perfetto.dev.
+ */
+class Trace
+{
+public:
+    /// Events kept per thread; once full, the oldest events are overwritten.
+    static constexpr std::size_t EventsPerThread = 1 << 14;
+
+    /// @brief Starts or stops recording. Events recorded so far are kept.
+    static void setEnabled(bool enabled) { sEnabled.store(enabled, std::memory_order_relaxed); }
+    static bool isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Returns the trace clock: nanoseconds since the process started tracing time.
+     */
+    static std::int64_t now();
+
+    /**
+     * @brief Records a span of the calling thread, e.g. one delimited by two VTK events.
+     *
+     * @param name Name of the span.
+     * @param category Category of the span, used to filter in the viewer.
+     * @param start Start on the trace clock.
+     * @param end End on the trace clock.
+     */
+    static void record(const char* name, const char* category, std::int64_t start, std::int64_t end);
+
+    /**
+     * @brief Names the calling thread in the exported trace.
+     */
+    static void setThreadName(const char* name);
+
+    /**
+     * @brief Drops every event recorded so far.
+     */
+    static void clear();
+
+    /**
+     * @brief Writes the recorded events as Chrome trace event JSON.
+     *
+     * Safe to call while other threads keep recording.
+     *
+     * @param path Path of the file; an existing file is replaced.
+     * @return QString The reason for the failure, empty on success.
+     */
+    static QString exportChromeJson(const QString& path);
+
+private:
+    static inline std::atomic<bool> sEnabled{ false };
+};
+
+/**
+ * @class TraceSpan
+ * @brief Records the lifetime of a scope as a span, if tracing was on when it began.
+ */
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char* name, const char* category = "app")
+        : mName(Trace::isEnabled() ? name : nullptr),
+        mCategory(category),
+        mStart(mName ? Trace::now() : 0)
+    {
+    }
+
+    ~TraceSpan()
+    {
+        if (mName)
+            Trace::record(mName, mCategory, mStart, Trace::now());
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* mName;
+    const char* mCategory;
+    std::int64_t mStart;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+/// Traces the rest of the enclosing scope under the given name and category.
+#define TRACE_SCOPE(name, category) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name, category)
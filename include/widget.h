@@ -4,8 +4,23 @@
 #include <QWidget>
 #include <QMenu>
 #include <QAction>
+#include <QActionGroup>
+#include <QDialog>
+#include <QProgressDialog>
 
 #include "controller.h"
+#include "scene.h"
+#include "renderScheduler.h"
+#include "meshLoader.h"
+#include "meshSaver.h"
+#include "projectFile.h"
+#include "projectLoader.h"
+#include "lodManager.h"
+#include "adaptiveTessellation.h"
+#include "scenePicker.h"
+#include "interferenceChecker.h"
+#include "history.h"
+#include "shapeEditor.h"
 
 #include <vtkGenericOpenGLRenderWindow.h>
 #include <vtkRenderer.h>
@@ -52,7 +67,44 @@ private slots:
     void on_yTranslateSlider_valueChanged(int value);
     void on_zTranslateSlider_valueChanged(int value);
     void onSaveSTL();
+    void onSaveProgress(double fraction);
+    void onSaveFinished(const QString& path, const StlWriter::Result& result);
+    void onSaveFailed(const QString& path, const QString& error);
     void onLoadSTL();
+    void onLoadPreview(const QString& path, vtkSmartPointer<vtkPolyData> preview);
+    void onLoadProgress(double fraction);
+    void onLoadRepaired(const QString& path, const MeshRepair::Result& result);
+    void onLoadFinished(const QString& path, const StlReader::Result& result);
+    void onLoadFailed(const QString& path, const QString& error);
+    void onLoadCanceled(const QString& path);
+    void onSaveProject();
+    void onOpenProject();
+    void onProjectMeshLoaded(std::size_t mesh, vtkSmartPointer<vtkPolyData> polyData);
+    void onProjectMeshFailed(std::size_t mesh, const QString& error);
+    void onProjectLoaded(std::size_t loaded, std::size_t failed, double seconds);
+    void onCreateArray();
+    void onEditShapeParameters();
+    void onBakeModeChanged(QAction* action);
+    void onSetFrameRateCap();
+    void onToggleLevelOfDetail(bool enabled);
+    void onSetLevelOfDetailMemory();
+    void onToggleAdaptiveTessellation(bool enabled);
+    void onSetTessellationPixelError();
+    void onToggleInterferenceCheck(bool enabled);
+    void onUndo();
+    void onRedo();
+    void onSetHistoryMemory();
+    void onToggleCompactStorage(bool enabled);
+    void onRepairMesh();
+    void onToggleRepairOnLoad(bool enabled);
+    void onToggleCacheOnLoad(bool enabled);
+    void onToggleTracing(bool enabled);
+    void onExportTrace();
+    void onSelectNext();
+    void onSelectPrevious();
+    void onToggleSelection();
+    void onSelectAll();
+    void onClearSelection();
 
 private:
     Ui::Widget* ui;
@@ -60,21 +112,173 @@ private:
     QMenu* mToolButtonMenu;
     QAction* mSaveSTLAction;
     QAction* mLoadSTLAction;
+    QAction* mSaveProjectAction;
+    QAction* mOpenProjectAction;
+    QAction* mRepairAction;
+    QAction* mRepairOnLoadAction;
+    QAction* mCacheOnLoadAction;
+    QAction* mInstancingAction;
+    QAction* mArrayAction;
+    QAction* mShapeParametersAction;
+    QActionGroup* mBakeModeGroup;
+    QAction* mFrameRateAction;
+    QAction* mLodAction;
+    QAction* mLodMemoryAction;
+    QAction* mTessellationAction;
+    QAction* mTessellationErrorAction;
+    QAction* mInterferenceAction;
+    QAction* mHistoryMemoryAction;
+    QAction* mCompactStorageAction;
+    QAction* mTraceAction;
+    QAction* mTraceExportAction;
 
     vtkSmartPointer<vtkGenericOpenGLRenderWindow> mRenderWindow;
     vtkSmartPointer<vtkRenderer> mRenderer;
     vtkSmartPointer<QVTKInteractor> mInteractor;
     vtkSmartPointer<vtkInteractorStyle> mInteractorStyle;
-    vtkSmartPointer<vtkActor> mCurrentShapeActor;
     vtkSmartPointer<vtkBoxWidget2> mBoxWidget2;
     vtkSmartPointer<BoxWidgetCallback> callback;
+    RenderScheduler* mRenderScheduler;
+    MeshLoader* mMeshLoader;
+    QProgressDialog* mLoadProgress;
+    MeshSaver* mMeshSaver;
+    QProgressDialog* mSaveProgress;
+    ProjectLoader* mProjectLoader;
 
     ShapeController shapeController;
+    Scene mScene;
+    MeshBvhCache mBvhCache;
+    ScenePicker mPicker{ mScene, mBvhCache };
+    InterferenceChecker mInterference{ mScene, mBvhCache };
+    bool mInterferenceEnabled = false;
+    History mHistory{ mScene };
+    ObjectId mPreviewObject = InvalidObjectId; ///< Object showing the preview of the file being loaded.
+    ProjectFile mProjectFile;
+    QString mOpenedProject;                                          ///< Path of the project whose meshes are streaming in.
+    ProjectFile::Contents mProjectContents;                          ///< Table of contents of mOpenedProject.
+    std::vector<vtkSmartPointer<vtkPolyData>> mProjectPlaceholders;  ///< Bounds box per mesh of mOpenedProject.
+    std::vector<vtkSmartPointer<vtkPolyData>> mProjectMeshes;        ///< Meshes of mOpenedProject read so far, null until each arrives.
+    LodManager mLod;
+    AdaptiveTessellation mTessellation{ shapeController.cache() };
+    ShapeEditor mShapeEditor;
+    QDialog* mShapeParameterDialog = nullptr; ///< Dialog editing the parameters of mShapeEditor's object.
+    unsigned long mRenderStartObserver = 0;
+    unsigned long mWindowStartObserver = 0;
+    unsigned long mWindowEndObserver = 0;
+    unsigned long mLeftPressObserver = 0;
+    unsigned long mLeftReleaseObserver = 0;
+    int mLeftPressPosition[2] = { 0, 0 };
+    std::int64_t mWindowRenderStart = -1; ///< Trace clock when the render window started rendering, -1 if not tracing.
 
 
     /**
      * @brief Resets all sliders to their default values.
      */
     void reset_sliders(void);
+
+    /**
+     * @brief Moves the sliders to the state of the current object without triggering their slots.
+     */
+    void update_sliders(void);
+
+    /**
+     * @brief Adds a mesh to the scene and makes it the current object.
+     * @param mesh The geometry of the new object.
+     * @param instanced Draw the object through the instance batch of its mesh.
+     */
+    void addSceneObject(vtkSmartPointer<vtkPolyData> mesh, bool instanced = false);
+
+    /**
+     * @brief Makes another object current, hiding the box widget of the previous one.
+     * @param id The new current object.
+     */
+    void setCurrentObject(ObjectId id);
+
+    /**
+     * @brief Makes an object touched by an undo or redo current, keeping the current object if it still exists.
+     * @param objects Objects of the undone or redone edit that are in the scene.
+     */
+    void showHistoryStep(const std::vector<ObjectId>& objects);
+
+    /**
+     * @brief Gives the edited shape the mesh of its latest parameters, as one undo step per drag.
+     */
+    void applyShapeEdit(void);
+
+    /**
+     * @brief Closes the shape parameter dialog and hands the edited object back to the adaptive tessellation.
+     */
+    void closeShapeEditor(void);
+
+    /**
+     * @brief Removes the preview object of the current load, if it is still in the scene.
+     */
+    void removePreviewObject(void);
+
+    /**
+     * @brief Returns true if an object still shows the bounds box of a project mesh that has not arrived; that mesh is read next.
+     * @param id The object.
+     */
+    bool isMeshPending(ObjectId id);
+
+    /**
+     * @brief Returns true, after telling the user, if an object's mesh is pending, so an edit of its mesh has to wait.
+     * @param id The object.
+     * @param title Title of the refused action, as shown in the message.
+     */
+    bool waitsForMesh(ObjectId id, const QString& title);
+
+    /**
+     * @brief Gives every object showing the bounds box of a project mesh that has arrived the mesh itself.
+     */
+    void showProjectMeshes(void);
+
+    /**
+     * @brief Logs the time taken and the change made by every step of a repair, or why it failed.
+     * @param subject The repaired file or object, as shown in the log.
+     * @param result The outcome of the repair.
+     */
+    void logRepair(const QString& subject, const MeshRepair::Result& result);
+
+    /**
+     * @brief Requests a render from the scheduler. Dirty scene objects are synced right before it runs.
+     */
+    void render(void);
+
+    /**
+     * @brief Applies shape parameter edits, adapts shape resolutions, picks the level of detail
+     *        of every object and highlights interfering objects right before the renderer draws.
+     */
+    void onRenderStart(void);
+
+    /**
+     * @brief Notes when the render window starts rendering, for the trace.
+     */
+    void onWindowRenderStart(void);
+
+    /**
+     * @brief Records the render window's Render() as a trace span.
+     */
+    void onWindowRenderEnd(void);
+
+    /**
+     * @brief Notes where the left mouse button went down, to tell clicks from drags.
+     */
+    void onLeftButtonPress(void);
+
+    /**
+     * @brief Picks the object under the cursor if the left button was clicked rather than dragged.
+     */
+    void onLeftButtonRelease(void);
+
+    /**
+     * @brief Switches levels of detail to the interactive tolerance and holds shape resolutions while the user drags.
+     */
+    void onInteractionStart(void);
+
+    /**
+     * @brief Switches levels of detail back to the idle tolerance and refines the view.
+     */
+    void onInteractionEnd(void);
 };
 #endif // WIDGET_H
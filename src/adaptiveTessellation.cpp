@@ -0,0 +1,202 @@
+/**
+ * @file adaptiveTessellation.cpp
+ * @brief Implementation of the AdaptiveTessellation class.
+ */
+
+#include "adaptiveTessellation.h"
+#include "screenSpace.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+
+
+namespace
+{
+
+/**
+ * @brief Returns the policy generating meshes for a chordal error; 0 keeps the default resolution.
+ */
+TessellationPolicy policyFor(double error)
+{
+    return error > 0.0 ? TessellationPolicy::fromChordalError(error) : TessellationPolicy();
+}
+
+} // namespace
+
+
+/**
+ * @brief Constructs a manager with no tracked objects.
+ *
+ * @param cache Cache the meshes are generated through.
+ */
+AdaptiveTessellation::AdaptiveTessellation(ShapeCache& cache) : mCache(cache)
+{
+}
+
+
+/**
+ * @brief Sets the tolerated deviation from the true surface, in pixels.
+ *
+ * @param pixels The tolerance; values that are not positive keep the default resolutions.
+ */
+void AdaptiveTessellation::setPixelError(double pixels)
+{
+    mPixelError = std::max(0.0, pixels);
+}
+
+
+/**
+ * @brief Sets how far the wanted error may drift before an object is regenerated.
+ *
+ * @param factor Ratio between the wanted and the current error.
+ */
+void AdaptiveTessellation::setHysteresis(double factor)
+{
+    mHysteresis = std::max(1.0, factor);
+}
+
+
+/**
+ * @brief Starts adapting the resolution of an object, replacing what was tracked for its id.
+ *
+ * @param id The object.
+ * @param shape The shape the object's mesh was generated from.
+ * @param mesh The object's current mesh.
+ * @param error Chordal error the mesh was generated for; 0 for the default resolution.
+ */
+void AdaptiveTessellation::track(ObjectId id, std::unique_ptr<Shape> shape, vtkPolyData* mesh, double error)
+{
+    Entry& entry = mEntries[id];
+    entry.key = shape->key(policyFor(error));
+    entry.shape = std::move(shape);
+    entry.mesh = mesh;
+    entry.error = error;
+}
+
+
+/**
+ * @brief Returns a copy of the shape an object shows.
+ *
+ * @param scene The scene the object belongs to.
+ * @param id The object.
+ * @param error Receives the chordal error its mesh was generated for; may be null.
+ * @return std::unique_ptr<Shape> The shape, or nullptr if the object is not tracked or got another mesh.
+ */
+std::unique_ptr<Shape> AdaptiveTessellation::trackedShape(const Scene& scene, ObjectId id, double* error) const
+{
+    auto found = mEntries.find(id);
+    if (found == mEntries.end() || !found->second.mesh || !scene.contains(id) || scene.mesh(id) != found->second.mesh)
+        return nullptr;
+
+    if (error)
+        *error = found->second.error;
+    return found->second.shape->clone();
+}
+
+
+/**
+ * @brief Stops adapting the resolution of an object.
+ */
+void AdaptiveTessellation::untrack(ObjectId id)
+{
+    mEntries.erase(id);
+}
+
+
+/**
+ * @brief Regenerates the tracked objects whose resolution no longer suits the view.
+ *
+ * The pixel tolerance is divided by the pixels one model unit covers, that is the
+ * pixels per world unit at the object's distance times the ratio of its world and
+ * model bounding radii, which gives the chordal error allowed in model units.
+ * Entries whose object was removed or got another mesh are dropped on the way.
+ *
+ * @param scene The scene the objects belong to.
+ * @param renderer The renderer whose camera and viewport define the screen.
+ * @return std::size_t Number of objects regenerated.
+ */
+std::size_t AdaptiveTessellation::update(Scene& scene, vtkRenderer* renderer)
+{
+    TRACE_SCOPE("AdaptiveTessellation::update", "shapes");
+
+    mPending = false;
+    if (mInteracting)
+        return 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t regenerated = 0;
+
+    for (auto it = mEntries.begin(); it != mEntries.end();)
+    {
+        const ObjectId id = it->first;
+        Entry& entry = it->second;
+
+        if (!entry.mesh || !scene.contains(id) || scene.isInstanced(id) || scene.mesh(id) != entry.mesh)
+        {
+            it = mEntries.erase(it);
+            continue;
+        }
+
+        double error = 0.0;
+        if (mEnabled && mPixelError > 0.0)
+        {
+            double worldRadius = 0.0;
+            const double pixelsPerUnit = pixelsPerWorldUnit(renderer, scene.actor(id), &worldRadius);
+            const double modelRadius = entry.mesh->GetLength() / 2.0;
+            if (pixelsPerUnit <= 0.0 || worldRadius <= 0.0 || modelRadius <= 0.0)
+            {
+                ++it;
+                continue;
+            }
+
+            error = mPixelError / (pixelsPerUnit * worldRadius / modelRadius);
+        }
+
+        // Keep the current mesh while the wanted error stays within the hysteresis band
+        const bool withinBand = error > 0.0 && entry.error > 0.0
+            && error < entry.error * mHysteresis && error > entry.error / mHysteresis;
+        if (withinBand || error == entry.error)
+        {
+            ++it;
+            continue;
+        }
+
+        const TessellationPolicy policy = policyFor(error);
+        const ShapeKey key = entry.shape->key(policy);
+        if (!(key == entry.key))
+        {
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed.count() > BudgetMs)
+            {
+                mPending = true;
+                ++it;
+                continue;
+            }
+
+            vtkSmartPointer<vtkPolyData> mesh = mCache.getOrCreate(*entry.shape, policy);
+            scene.setMesh(id, mesh);
+            entry.mesh = mesh;
+            entry.key = key;
+            ++regenerated;
+        }
+
+        entry.error = error;
+        ++it;
+    }
+
+    mRegenerations += regenerated;
+    return regenerated;
+}
+
+
+/**
+ * @brief Returns a snapshot of the counters.
+ */
+AdaptiveTessellation::Statistics AdaptiveTessellation::statistics() const
+{
+    Statistics statistics;
+    statistics.tracked = mEntries.size();
+    statistics.regenerations = mRegenerations;
+    return statistics;
+}
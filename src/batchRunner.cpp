@@ -0,0 +1,322 @@
+/**
+ * @file batchRunner.cpp
+ * @brief Implementation of the BatchRunner class.
+ */
+
+#include "batchRunner.h"
+#include "controller.h"
+#include "meshMerger.h"
+#include "parallel.h"
+#include "shapeCache.h"
+#include "stlReader.h"
+#include "stlWriter.h"
+#include "trace.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkTransform.h>
+
+#include <future>
+#include <map>
+#include <mutex>
+
+
+namespace
+{
+
+/**
+ * @brief STL files read by a batch, each read once by the first job that needs it.
+ */
+class FileCache
+{
+public:
+    StlReader::Result get(const QString& path)
+    {
+        std::shared_future<StlReader::Result> future;
+        std::promise<StlReader::Result> promise;
+        bool first = false;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mFiles.find(path);
+            if (it == mFiles.end())
+            {
+                it = mFiles.emplace(path, promise.get_future().share()).first;
+                first = true;
+            }
+            future = it->second;
+        }
+
+        // Other jobs needing the file wait for the first one to read it
+        if (first)
+        {
+            StlReader::Options options;
+            options.threads = 1;
+            promise.set_value(StlReader::read(path, options));
+        }
+        return future.get();
+    }
+
+private:
+    std::mutex mMutex;
+    std::map<QString, std::shared_future<StlReader::Result>> mFiles;
+};
+
+/**
+ * @brief Reads an array of three numbers into a value, keeping it if the key is absent.
+ *
+ * @return bool False if the key is present but not an array of three numbers.
+ */
+bool readVector(const QJsonObject& object, const QString& key, std::array<double, 3>& value)
+{
+    if (!object.contains(key))
+        return true;
+
+    const QJsonArray array = object.value(key).toArray();
+    if (array.size() != 3)
+        return false;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        if (!array[i].isDouble())
+            return false;
+        value[i] = array[i].toDouble();
+    }
+    return true;
+}
+
+/**
+ * @brief Computes the matrix placing a part, in the order Scene::getModelMatrix() uses.
+ */
+std::array<double, 16> partMatrix(const BatchRunner::Part& part)
+{
+    vtkNew<vtkTransform> transform;
+    transform->PostMultiply();
+    transform->Scale(part.scale, part.scale, part.scale);
+    transform->RotateY(part.orientation[1]);
+    transform->RotateX(part.orientation[0]);
+    transform->RotateZ(part.orientation[2]);
+    transform->Translate(part.position[0], part.position[1], part.position[2]);
+
+    std::array<double, 16> matrix;
+    vtkMatrix4x4::DeepCopy(matrix.data(), transform->GetMatrix());
+    return matrix;
+}
+
+/**
+ * @brief Builds, merges and writes the parts of one job on the calling thread.
+ */
+BatchRunner::JobResult runJob(const BatchRunner::Job& job, ShapeCache& shapes, FileCache& files)
+{
+    TRACE_SCOPE("BatchRunner::runJob", "batch");
+
+    BatchRunner::JobResult result;
+    result.name = job.name;
+    result.output = job.output;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    std::vector<MeshMerger::Part> parts(job.parts.size());
+    for (std::size_t i = 0; i < job.parts.size(); ++i)
+    {
+        const BatchRunner::Part& part = job.parts[i];
+        if (!part.shape.isEmpty())
+        {
+            const std::unique_ptr<Shape> shape = ShapeController::makeShape(part.shape);
+            parts[i].mesh = shapes.getOrCreate(*shape);
+        }
+        else
+        {
+            const StlReader::Result read = files.get(part.load);
+            if (!read.mesh)
+            {
+                result.error = QString("Could not load %1: %2").arg(part.load, read.error);
+                return result;
+            }
+            parts[i].mesh = read.mesh;
+        }
+        parts[i].matrix = partMatrix(part);
+    }
+
+    MeshMerger::Options mergeOptions;
+    mergeOptions.weldTolerance = job.weld ? MeshMerger::defaultWeldTolerance(parts) : 0.0;
+    mergeOptions.threads = 1;
+    const MeshMerger::Result merged = MeshMerger::merge(parts, mergeOptions);
+    if (!merged.ok())
+    {
+        result.error = merged.error;
+        return result;
+    }
+
+    QDir().mkpath(QFileInfo(job.output).absolutePath());
+
+    StlWriter::Options writeOptions;
+    writeOptions.threads = 1;
+    if (job.hasColor)
+        writeOptions.attribute = StlWriter::colorAttribute(job.color.data());
+    const StlWriter::Result written = StlWriter::write(job.output, merged.mesh, writeOptions);
+    if (!written.ok())
+    {
+        result.error = QString("Could not write %1: %2").arg(job.output, written.error);
+        return result;
+    }
+
+    result.facets = written.facets;
+    result.seconds = timer.nsecsElapsed() / 1.0e9;
+    return result;
+}
+
+} // namespace
+
+
+/**
+ * @brief Reads and validates a job file.
+ *
+ * @param path Path of the JSON job file.
+ * @return JobFile The jobs with absolute paths, or an error message.
+ */
+BatchRunner::JobFile BatchRunner::readJobFile(const QString& path)
+{
+    JobFile result;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        result.error = file.errorString();
+        return result;
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!document.isObject())
+    {
+        result.error = parseError.error != QJsonParseError::NoError ? parseError.errorString() : "The job file is not a JSON object.";
+        return result;
+    }
+
+    const QJsonObject root = document.object();
+    const QDir base = QFileInfo(path).absoluteDir();
+    const QDir outputs(base.absoluteFilePath(root.value("outputDirectory").toString(".")));
+    const QStringList shapes = ShapeController::supportedShapes();
+
+    QSet<QString> written;
+    const QJsonArray jobs = root.value("jobs").toArray();
+    result.jobs.reserve(static_cast<std::size_t>(jobs.size()));
+    for (int j = 0; j < jobs.size(); ++j)
+    {
+        const QJsonObject object = jobs[j].toObject();
+        const QString where = QString("Job %1: ").arg(j + 1);
+
+        Job job;
+        const QString output = object.value("output").toString();
+        if (output.isEmpty())
+        {
+            result.error = where + "there is no output.";
+            return result;
+        }
+        job.output = QDir::cleanPath(outputs.absoluteFilePath(output));
+        if (written.contains(job.output))
+        {
+            result.error = where + QString("%1 is written by another job too.").arg(job.output);
+            return result;
+        }
+        written.insert(job.output);
+
+        job.name = object.value("name").toString(QFileInfo(job.output).completeBaseName());
+        job.weld = object.value("weld").toBool(true);
+        job.hasColor = object.contains("color");
+        if (!readVector(object, "color", job.color))
+        {
+            result.error = where + "the color is not an array of three numbers.";
+            return result;
+        }
+
+        const QJsonArray parts = object.value("parts").toArray();
+        if (parts.isEmpty())
+        {
+            result.error = where + "there are no parts.";
+            return result;
+        }
+
+        for (const QJsonValue& value : parts)
+        {
+            const QJsonObject partObject = value.toObject();
+
+            Part part;
+            part.shape = partObject.value("shape").toString();
+            part.load = partObject.value("load").toString();
+            if (!part.shape.isEmpty() && !shapes.contains(part.shape))
+            {
+                result.error = where + QString("unknown shape \"%1\".").arg(part.shape);
+                return result;
+            }
+            if (part.shape.isEmpty() && part.load.isEmpty())
+            {
+                result.error = where + "a part has neither a shape nor a file to load.";
+                return result;
+            }
+            if (!part.load.isEmpty())
+                part.load = QDir::cleanPath(base.absoluteFilePath(part.load));
+
+            part.scale = partObject.value("scale").toDouble(1.0);
+            if (!readVector(partObject, "position", part.position) || !readVector(partObject, "orientation", part.orientation))
+            {
+                result.error = where + "a position or orientation is not an array of three numbers.";
+                return result;
+            }
+
+            job.parts.push_back(part);
+        }
+
+        result.jobs.push_back(std::move(job));
+    }
+
+    return result;
+}
+
+
+/**
+ * @brief Runs jobs concurrently and reports on each of them.
+ *
+ * Jobs are handed out one at a time to the workers, so long and short jobs balance out.
+ *
+ * @param jobs The jobs.
+ * @param threads Jobs run at the same time; 0 uses every core.
+ * @return Report The outcome of every job and the batch throughput.
+ */
+BatchRunner::Report BatchRunner::run(const std::vector<Job>& jobs, unsigned threads)
+{
+    TRACE_SCOPE("BatchRunner::run", "batch");
+
+    Report report;
+    report.threads = threads > 0 ? threads : parallelThreadCount();
+    report.jobs.resize(jobs.size());
+
+    QElapsedTimer timer;
+    timer.start();
+
+    ShapeCache shapes;
+    FileCache files;
+    parallelFor(jobs.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            report.jobs[i] = runJob(jobs[i], shapes, files);
+    }, report.threads);
+
+    for (const JobResult& job : report.jobs)
+    {
+        report.failed += job.ok() ? 0 : 1;
+        report.facets += job.facets;
+    }
+
+    report.seconds = timer.nsecsElapsed() / 1.0e9;
+    return report;
+}
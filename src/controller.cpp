@@ -1,53 +1,278 @@
 #include "controller.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <unordered_map>
 
 
 /**
  * @brief Implementation of the createShape method.
  *
  * This method generates shapes based on the provided shape type.
- * The shapes are initialized with default dimensions.
+ * The shapes are initialized with default dimensions and their meshes
+ * are served from the cache when available.
  *
  * @param shapeType The type of the shape to be generated.
+ * @param policy How finely curved surfaces are tessellated.
  * @return vtkSmartPointer<vtkPolyDataMapper> The generated shape, or nullptr if the shape type is not recognized.
  */
-vtkSmartPointer<vtkPolyDataMapper> ShapeController::createShape(const QString& shapeType)
+vtkSmartPointer<vtkPolyDataMapper> ShapeController::createShape(const QString& shapeType, const TessellationPolicy& policy)
+{
+    TRACE_SCOPE("ShapeController::createShape", "shapes");
+
+    std::unique_ptr<Shape> shape = makeShape(shapeType);
+    if (!shape) {
+        return nullptr;
+    }
+
+    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    mapper->SetInputData(mCache.getOrCreate(*shape, policy));
+    return mapper;
+}
+
+
+/**
+ * @brief Implementation of the makeShape method.
+ *
+ * @param shapeType The type of the shape to be built.
+ * @return std::unique_ptr<Shape> The shape, or nullptr if the shape type is not recognized.
+ */
+std::unique_ptr<Shape> ShapeController::makeShape(const QString& shapeType)
 {
     if (shapeType == "Cube") {
-        Cube cube(30, 40, 50);
-        return cube.createShape();
+        return std::make_unique<Cube>(30, 40, 50);
     }
     else if (shapeType == "Sphere") {
-        Sphere sphere(5);
-        return sphere.createShape();
+        return std::make_unique<Sphere>(5);
     }
     else if (shapeType == "Hemisphere") {
-        Hemisphere hemisphere(5);
-        return hemisphere.createShape();
+        return std::make_unique<Hemisphere>(5);
     }
     else if (shapeType == "Cone") {
-        Cone cone(30);
-        return cone.createShape();
+        return std::make_unique<Cone>(30);
     }
     else if (shapeType == "Pyramid") {
-        Pyramid pyramid(4, 15);
-        return pyramid.createShape();
+        return std::make_unique<Pyramid>(4, 15);
     }
     else if (shapeType == "Cylinder") {
-        Cylinder cylinder(5, 20);
-        return cylinder.createShape();
+        return std::make_unique<Cylinder>(5, 20);
     }
     else if (shapeType == "Tube") {
-        Tube tube(2, 5);
-        return tube.createShape();
+        return std::make_unique<Tube>(2, 5);
     }
     else if (shapeType == "Doughnut") {
-        Doughnut doughnut(6, 3);
-        return doughnut.createShape();
+        return std::make_unique<Doughnut>(6, 3);
     }
     else if (shapeType == "Curved Cylinder") {
-        CurvedCylinder curvedCylinder(5);
-        return curvedCylinder.createShape();
+        return std::make_unique<CurvedCylinder>(0.1);
     }
 
     return nullptr;
 }
+
+
+/**
+ * @brief Implementation of the supportedShapes method.
+ *
+ * @return QStringList The supported shape types, in the order shown in the UI.
+ */
+QStringList ShapeController::supportedShapes()
+{
+    return { "Cube", "Sphere", "Hemisphere", "Cone", "Pyramid",
+             "Cylinder", "Tube", "Doughnut", "Curved Cylinder" };
+}
+
+
+/**
+ * @brief Implementation of the prewarmCache method.
+ *
+ * Queues every supported shape for generation on the cache's background thread.
+ */
+void ShapeController::prewarmCache()
+{
+    std::vector<std::unique_ptr<Shape>> shapes;
+    for (const QString& shapeType : supportedShapes()) {
+        shapes.push_back(makeShape(shapeType));
+    }
+
+    mCache.prewarm(std::move(shapes));
+}
+
+
+/**
+ * @brief Implementation of the destructor.
+ *
+ * Cancels the running batches and joins their threads, so no worker outlives the cache.
+ */
+ShapeController::~ShapeController()
+{
+    cancelBatches();
+
+    std::lock_guard<std::mutex> lock(mBatchMutex);
+    for (Batch& batch : mBatches)
+        batch.thread.join();
+}
+
+
+/**
+ * @brief Implementation of the createShapes method returning futures.
+ *
+ * @param requests The shapes to generate.
+ * @param threads Worker threads of the batch; 0 uses every core.
+ * @return std::vector<MeshFuture> The mesh of every request, in the order of the requests.
+ */
+std::vector<ShapeController::MeshFuture> ShapeController::createShapes(std::vector<ShapeRequest> requests, unsigned threads)
+{
+    auto promises = std::make_shared<std::vector<std::promise<vtkSmartPointer<vtkPolyData>>>>(requests.size());
+    auto delivered = std::make_shared<std::vector<std::uint8_t>>(requests.size(), 0);
+
+    std::vector<MeshFuture> futures;
+    futures.reserve(requests.size());
+    for (std::promise<vtkSmartPointer<vtkPolyData>>& promise : *promises)
+        futures.push_back(promise.get_future().share());
+
+    // Each index is delivered at most once, so workers fulfil disjoint promises
+    auto deliver = [promises, delivered](Delivery&& meshes) {
+        for (auto& [index, mesh] : meshes)
+        {
+            (*delivered)[index] = 1;
+            (*promises)[index].set_value(std::move(mesh));
+        }
+    };
+
+    // Requests a canceled batch skipped get a null mesh, so no future waits forever
+    auto finished = [promises, delivered]() {
+        for (std::size_t i = 0; i < promises->size(); ++i)
+        {
+            if (!(*delivered)[i])
+                (*promises)[i].set_value(nullptr);
+        }
+    };
+
+    startBatch(std::move(requests), threads, deliver, finished);
+    return futures;
+}
+
+
+/**
+ * @brief Implementation of the createShapes method delivering through a callback.
+ *
+ * Each block of finished meshes is posted to the receiver as one queued call.
+ *
+ * @param requests The shapes to generate.
+ * @param receiver Object on whose thread the callbacks run.
+ * @param onShape Called once per request with its index and mesh.
+ * @param onFinished Called after the last mesh was delivered; may be empty.
+ * @param threads Worker threads of the batch; 0 uses every core.
+ */
+void ShapeController::createShapes(std::vector<ShapeRequest> requests, QObject* receiver, ShapeCallback onShape,
+                                   std::function<void()> onFinished, unsigned threads)
+{
+    auto deliver = [receiver, onShape](Delivery&& meshes) {
+        QMetaObject::invokeMethod(receiver, [onShape, meshes = std::move(meshes)]() {
+            for (const auto& [index, mesh] : meshes)
+                onShape(index, mesh);
+        }, Qt::QueuedConnection);
+    };
+
+    auto finished = [receiver, onFinished]() {
+        if (onFinished)
+            QMetaObject::invokeMethod(receiver, onFinished, Qt::QueuedConnection);
+    };
+
+    startBatch(std::move(requests), threads, deliver, finished);
+}
+
+
+/**
+ * @brief Implementation of the cancelBatches method.
+ */
+void ShapeController::cancelBatches()
+{
+    ++mBatchGeneration;
+}
+
+
+/**
+ * @brief Starts a batch on its own thread, which generates the distinct meshes of the requests with parallelFor.
+ *
+ * Requests are grouped by ShapeKey first, so every distinct geometry is generated once
+ * and delivered to all its requests. Meshes are delivered per block of distinct shapes.
+ * Each shape is generated on a single worker: the batch already uses the cores.
+ *
+ * @param requests The shapes to generate.
+ * @param threads Worker threads of the batch; 0 uses every core.
+ * @param deliver Called from a worker thread with each block of finished meshes.
+ * @param finished Called from the batch's thread after the last delivery.
+ */
+void ShapeController::startBatch(std::vector<ShapeRequest> requests, unsigned threads,
+                                 std::function<void(Delivery&&)> deliver, std::function<void()> finished)
+{
+    reapBatches();
+
+    const std::uint64_t generation = mBatchGeneration;
+    auto done = std::make_shared<std::atomic<bool>>(false);
+
+    std::thread thread([this, requests = std::move(requests), threads, deliver, finished, generation, done]() {
+        TRACE_SCOPE("ShapeController::createShapes", "shapes");
+
+        // Distinct keys, each with a linked list of the requests asking for it
+        std::vector<std::size_t> distinct;
+        std::vector<std::size_t> next(requests.size(), requests.size());
+        {
+            std::unordered_map<ShapeKey, std::size_t, ShapeKeyHash> last;
+            for (std::size_t i = 0; i < requests.size(); ++i)
+            {
+                auto [found, inserted] = last.emplace(requests[i].shape->key(requests[i].policy), i);
+                if (inserted)
+                    distinct.push_back(i);
+                else
+                    next[found->second] = i;
+                found->second = i;
+            }
+        }
+
+        constexpr std::size_t ShapesPerBlock = 8;
+        parallelFor(distinct.size(), ShapesPerBlock, [&](std::size_t begin, std::size_t end) {
+            // Generators such as PrimitiveSource split large meshes with parallelFor of their own
+            ParallelThreadLimit serial(1);
+            Delivery meshes;
+            for (std::size_t d = begin; d < end && mBatchGeneration == generation; ++d)
+            {
+                const ShapeRequest& request = requests[distinct[d]];
+                const vtkSmartPointer<vtkPolyData> mesh = mCache.getOrCreate(*request.shape, request.policy);
+                for (std::size_t i = distinct[d]; i < requests.size(); i = next[i])
+                    meshes.emplace_back(i, mesh);
+            }
+            if (!meshes.empty())
+                deliver(std::move(meshes));
+        }, threads);
+
+        finished();
+        *done = true;
+    });
+
+    std::lock_guard<std::mutex> lock(mBatchMutex);
+    mBatches.push_back(Batch{ std::move(thread), done });
+}
+
+
+/**
+ * @brief Joins the threads of the batches that finished.
+ */
+void ShapeController::reapBatches()
+{
+    std::lock_guard<std::mutex> lock(mBatchMutex);
+    for (auto it = mBatches.begin(); it != mBatches.end();)
+    {
+        if (*it->done)
+        {
+            it->thread.join();
+            it = mBatches.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
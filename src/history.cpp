@@ -0,0 +1,458 @@
+/**
+ * @file history.cpp
+ * @brief Implementation of the History class.
+ */
+
+#include "history.h"
+#include "trace.h"
+
+#include <vtkAbstractArray.h>
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+
+#include <algorithm>
+
+
+namespace
+{
+
+/// vtkObject::GetActualMemorySize() reports kibibytes.
+constexpr std::size_t KiB = 1024;
+
+} // namespace
+
+
+/**
+ * @brief Constructs an empty history of a scene.
+ *
+ * @param scene The scene edits are recorded on.
+ * @param capacityBytes Cap on the memory the history references.
+ */
+History::History(Scene& scene, std::size_t capacityBytes) : mScene(scene), mCapacity(capacityBytes)
+{
+}
+
+
+/**
+ * @brief Starts recording an edit by saving the state of the objects it touches.
+ *
+ * @param label Name of the edit.
+ * @param objects Objects the edit changes or removes; ids not in the scene are ignored.
+ * @param mergeKey Key under which consecutive edits merge.
+ */
+void History::begin(const std::string& label, const std::vector<ObjectId>& objects, const std::string& mergeKey)
+{
+    mPending = Edit();
+    mPending.label = label;
+    mPending.mergeKey = mergeKey;
+    for (ObjectId id : objects)
+    {
+        if (!mScene.contains(id))
+            continue;
+        const bool seen = std::any_of(mPending.changes.begin(), mPending.changes.end(),
+                                      [id](const Change& change) { return change.id == id; });
+        if (!seen)
+            mPending.changes.push_back({ id, capture(id), State() });
+    }
+    mOpen = true;
+}
+
+
+/**
+ * @brief Finishes the open edit by saving the state of its objects after it.
+ *
+ * An added object may take the id of an object the same edit removed; the id then
+ * simply goes from the removed object's state to the added one's. Meshes are dropped
+ * from states whose object kept its mesh, so the edit references only meshes it
+ * replaced, added or removed.
+ *
+ * An edit merging into the previous one keeps that edit's states before it and its
+ * own states after it, so the frames of a drag that replace the mesh each time hold
+ * only the first and the latest mesh.
+ *
+ * @param added Objects the edit added to the scene.
+ */
+void History::commit(const std::vector<ObjectId>& added)
+{
+    if (!mOpen)
+        return;
+    mOpen = false;
+
+    TRACE_SCOPE("History::commit", "history");
+
+    for (ObjectId id : added)
+    {
+        const bool seen = std::any_of(mPending.changes.begin(), mPending.changes.end(),
+                                      [id](const Change& change) { return change.id == id; });
+        if (!seen)
+            mPending.changes.push_back({ id, State(), State() });
+    }
+
+    auto same = [](const State& a, const State& b) {
+        if (!a.exists || !b.exists)
+            return a.exists == b.exists;
+        return a.instanced == b.instanced && a.position == b.position && a.orientation == b.orientation &&
+               a.scale == b.scale && a.userMatrix == b.userMatrix && a.color == b.color && a.opacity == b.opacity &&
+               a.mesh == b.mesh;
+    };
+
+    std::vector<Change> changes;
+    changes.reserve(mPending.changes.size());
+    for (Change& change : mPending.changes)
+    {
+        change.after = capture(change.id);
+        if (same(change.before, change.after))
+            continue;
+        if (change.before.exists && change.after.exists && change.before.mesh == change.after.mesh &&
+            change.before.instanced == change.after.instanced)
+        {
+            change.before.mesh = nullptr;
+            change.after.mesh = nullptr;
+        }
+        changes.push_back(std::move(change));
+    }
+    mPending.changes.swap(changes);
+    if (mPending.changes.empty())
+        return;
+
+    // Steps of one drag only modify objects, neither adding nor removing any
+    auto modifies = [](const Edit& edit) {
+        return std::all_of(edit.changes.begin(), edit.changes.end(),
+                           [](const Change& change) { return change.before.exists && change.after.exists; });
+    };
+    auto sameObjects = [](const Edit& a, const Edit& b) {
+        return a.changes.size() == b.changes.size() &&
+               std::equal(a.changes.begin(), a.changes.end(), b.changes.begin(),
+                          [](const Change& x, const Change& y) { return x.id == y.id; });
+    };
+
+    if (!mSealed && mRedo.empty() && !mUndo.empty() && !mPending.mergeKey.empty() &&
+        mUndo.back().mergeKey == mPending.mergeKey && sameObjects(mUndo.back(), mPending) &&
+        modifies(mUndo.back()) && modifies(mPending))
+    {
+        // The merged step goes from the first step's before to the newest after; meshes
+        // only seen in between are released
+        Edit& last = mUndo.back();
+        reference(last, -1);
+        for (std::size_t i = 0; i < last.changes.size(); ++i)
+        {
+            Change& change = last.changes[i];
+            const Change& next = mPending.changes[i];
+
+            // A step that kept its mesh recorded none; the other step's side holds it then
+            vtkSmartPointer<vtkPolyData> before = change.before.mesh ? change.before.mesh : next.before.mesh;
+            vtkSmartPointer<vtkPolyData> after = next.after.mesh ? next.after.mesh : change.after.mesh;
+            change.after = next.after;
+            if (before == after && change.before.instanced == change.after.instanced)
+                before = after = nullptr;
+            change.before.mesh = before;
+            change.after.mesh = after;
+        }
+        reference(last, +1);
+        mPending = Edit();
+        trim();
+        return;
+    }
+
+    for (const Edit& edit : mRedo)
+        reference(edit, -1);
+    mRedo.clear();
+
+    reference(mPending, +1);
+    mUndo.push_back(std::move(mPending));
+    mPending = Edit();
+    mSealed = false;
+    trim();
+}
+
+
+/**
+ * @brief Reverts the last edit by restoring the states its objects had before it.
+ *
+ * @return std::vector<ObjectId> Objects the edit touched that are in the scene afterwards.
+ */
+std::vector<ObjectId> History::undo()
+{
+    mOpen = false;
+    if (mUndo.empty())
+        return {};
+
+    TRACE_SCOPE("History::undo", "history");
+
+    Edit edit = std::move(mUndo.back());
+    mUndo.pop_back();
+    const std::vector<ObjectId> objects = applyEdit(edit, false);
+    mRedo.push_back(std::move(edit));
+    mSealed = true;
+    return objects;
+}
+
+
+/**
+ * @brief Applies the last undone edit again by restoring the states its objects had after it.
+ *
+ * @return std::vector<ObjectId> Objects the edit touched that are in the scene afterwards.
+ */
+std::vector<ObjectId> History::redo()
+{
+    mOpen = false;
+    if (mRedo.empty())
+        return {};
+
+    TRACE_SCOPE("History::redo", "history");
+
+    Edit edit = std::move(mRedo.back());
+    mRedo.pop_back();
+    const std::vector<ObjectId> objects = applyEdit(edit, true);
+    mUndo.push_back(std::move(edit));
+    mSealed = true;
+    return objects;
+}
+
+
+/**
+ * @brief Forgets every edit and releases the arrays they referenced.
+ */
+void History::clear()
+{
+    mUndo.clear();
+    mRedo.clear();
+    mBuffers.clear();
+    mBufferBytes = 0;
+    mChangeCount = 0;
+    mOpen = false;
+    mSealed = true;
+}
+
+
+/**
+ * @brief Changes the memory cap, forgetting the oldest edits if the history is above it.
+ *
+ * @param bytes The new cap.
+ */
+void History::setCapacity(std::size_t bytes)
+{
+    mCapacity = bytes;
+    trim();
+}
+
+
+/**
+ * @brief Returns a snapshot of the counters.
+ */
+History::Statistics History::statistics() const
+{
+    Statistics statistics;
+    statistics.undoSteps = mUndo.size();
+    statistics.redoSteps = mRedo.size();
+    statistics.buffers = mBuffers.size();
+    statistics.bytes = mBufferBytes + mChangeCount * sizeof(Change);
+    statistics.capacityBytes = mCapacity;
+    statistics.forgotten = mForgotten;
+    return statistics;
+}
+
+
+/**
+ * @brief Reads the state of an object, or a non-existing state if the id is not in the scene.
+ *
+ * @param id The object.
+ */
+History::State History::capture(ObjectId id) const
+{
+    State state;
+    if (!mScene.contains(id))
+        return state;
+
+    state.exists = true;
+    state.instanced = mScene.isInstanced(id);
+    mScene.getPosition(id, state.position.data());
+    mScene.getOrientation(id, state.orientation.data());
+    state.scale = mScene.scale(id);
+    mScene.getUserMatrix(id, state.userMatrix.data());
+    mScene.getColor(id, state.color.data());
+    state.opacity = mScene.opacity(id);
+    state.mesh = mScene.mesh(id);
+    return state;
+}
+
+
+/**
+ * @brief Brings an object to a recorded state, adding or removing it as needed.
+ *
+ * An object whose rendering path differs from the state's is added again with the
+ * state's; otherwise only its mesh pointer is swapped, if the state has one.
+ *
+ * @param id The object.
+ * @param state The state to restore.
+ */
+void History::apply(ObjectId id, const State& state)
+{
+    if (!state.exists)
+    {
+        mScene.removeObject(id);
+        return;
+    }
+
+    if (mScene.contains(id) && mScene.isInstanced(id) != state.instanced)
+    {
+        vtkSmartPointer<vtkPolyData> mesh = state.mesh ? state.mesh : vtkSmartPointer<vtkPolyData>(mScene.mesh(id));
+        mScene.removeObject(id);
+        mScene.restoreObject(id, mesh, state.instanced);
+    }
+    else if (!mScene.contains(id))
+    {
+        // An object removed outside the history has no mesh to come back with
+        if (!state.mesh)
+            return;
+        mScene.restoreObject(id, state.mesh, state.instanced);
+    }
+    else if (state.mesh && state.mesh != mScene.mesh(id))
+    {
+        mScene.setMesh(id, state.mesh);
+    }
+
+    mScene.setPosition(id, state.position.data());
+    mScene.setOrientation(id, state.orientation.data());
+    mScene.setScale(id, state.scale);
+    mScene.setUserMatrix(id, state.userMatrix.data());
+    mScene.setColor(id, state.color.data());
+    mScene.setOpacity(id, state.opacity);
+}
+
+
+/**
+ * @brief Restores the states an edit recorded, in reverse order when undoing.
+ *
+ * Reverse order matters when the edit removed an object and added another that took its id.
+ *
+ * @param edit The edit.
+ * @param forward True to restore the states after the edit, false for those before it.
+ * @return std::vector<ObjectId> Objects of the edit that are in the scene afterwards.
+ */
+std::vector<ObjectId> History::applyEdit(const Edit& edit, bool forward)
+{
+    const std::size_t count = edit.changes.size();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const Change& change = edit.changes[forward ? i : count - 1 - i];
+        apply(change.id, forward ? change.after : change.before);
+    }
+
+    std::vector<ObjectId> objects;
+    for (const Change& change : edit.changes)
+    {
+        if (mScene.contains(change.id))
+            objects.push_back(change.id);
+    }
+    return objects;
+}
+
+
+/**
+ * @brief Adds or releases the references of an edit to the arrays of its meshes.
+ *
+ * @param edit The edit.
+ * @param delta +1 when the edit enters the history, -1 when it leaves it.
+ */
+void History::reference(const Edit& edit, int delta)
+{
+    for (const Change& change : edit.changes)
+    {
+        if (change.before.mesh)
+            reference(change.before.mesh, delta);
+        if (change.after.mesh)
+            reference(change.after.mesh, delta);
+    }
+    mChangeCount = delta > 0 ? mChangeCount + edit.changes.size() : mChangeCount - edit.changes.size();
+}
+
+
+/**
+ * @brief Adds or releases references to the point coordinates, attribute arrays and cell arrays of a mesh.
+ *
+ * Costs one lookup per array, independent of the number of points and cells.
+ *
+ * @param mesh The mesh.
+ * @param delta +1 or -1.
+ */
+void History::reference(vtkPolyData* mesh, int delta)
+{
+    if (vtkPoints* points = mesh->GetPoints())
+        reference(points->GetData(), points->GetData()->GetActualMemorySize() * KiB, delta);
+
+    for (vtkFieldData* attributes : { static_cast<vtkFieldData*>(mesh->GetPointData()), static_cast<vtkFieldData*>(mesh->GetCellData()) })
+    {
+        for (int i = 0; i < attributes->GetNumberOfArrays(); ++i)
+        {
+            vtkAbstractArray* array = attributes->GetAbstractArray(i);
+            reference(array, array->GetActualMemorySize() * KiB, delta);
+        }
+    }
+
+    for (vtkCellArray* cells : { mesh->GetVerts(), mesh->GetLines(), mesh->GetPolys(), mesh->GetStrips() })
+    {
+        if (cells)
+            reference(cells, cells->GetActualMemorySize() * KiB, delta);
+    }
+}
+
+
+/**
+ * @brief Adds or releases one reference to an array, counting its memory while it is referenced.
+ *
+ * @param array The array.
+ * @param bytes Its memory; only read when it is first referenced.
+ * @param delta +1 or -1.
+ */
+void History::reference(vtkObject* array, std::size_t bytes, int delta)
+{
+    if (!array)
+        return;
+
+    if (delta > 0)
+    {
+        Buffer& buffer = mBuffers[array];
+        if (buffer.references++ == 0)
+        {
+            buffer.array = array;
+            buffer.bytes = bytes;
+            mBufferBytes += bytes;
+        }
+        return;
+    }
+
+    auto it = mBuffers.find(array);
+    if (it == mBuffers.end())
+        return;
+    if (--it->second.references == 0)
+    {
+        mBufferBytes -= it->second.bytes;
+        mBuffers.erase(it);
+    }
+}
+
+
+/**
+ * @brief Forgets the oldest undo steps, then the farthest redo steps, until the history fits its cap.
+ */
+void History::trim()
+{
+    auto bytes = [this]() { return mBufferBytes + mChangeCount * sizeof(Change); };
+
+    while (bytes() > mCapacity && !mUndo.empty())
+    {
+        reference(mUndo.front(), -1);
+        mUndo.pop_front();
+        ++mForgotten;
+    }
+    while (bytes() > mCapacity && !mRedo.empty())
+    {
+        reference(mRedo.front(), -1);
+        mRedo.erase(mRedo.begin());
+        ++mForgotten;
+    }
+}
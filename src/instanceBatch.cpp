@@ -0,0 +1,166 @@
+/**
+ * @file instanceBatch.cpp
+ * @brief Implementation of the InstanceBatch class.
+ */
+
+#include "instanceBatch.h"
+
+#include <vtkPointData.h>
+
+#include <algorithm>
+
+
+/**
+ * @brief Sets up the per-instance arrays and the glyph mapper for the given mesh.
+ *
+ * Orientation is interpreted as X/Y/Z rotation angles in degrees, scale as a uniform
+ * factor, and the RGBA colors are used directly without a lookup table.
+ *
+ * @param mesh Source mesh shared by all instances.
+ */
+InstanceBatch::InstanceBatch(vtkSmartPointer<vtkPolyData> mesh)
+    : mMesh(mesh),
+    mPositions(vtkSmartPointer<vtkPoints>::New()),
+    mOrientations(vtkSmartPointer<vtkFloatArray>::New()),
+    mScales(vtkSmartPointer<vtkFloatArray>::New()),
+    mColors(vtkSmartPointer<vtkUnsignedCharArray>::New()),
+    mInstances(vtkSmartPointer<vtkPolyData>::New()),
+    mMapper(vtkSmartPointer<vtkGlyph3DMapper>::New()),
+    mActor(vtkSmartPointer<vtkActor>::New())
+{
+    mPositions->SetDataTypeToFloat();
+
+    mOrientations->SetName("Orientation");
+    mOrientations->SetNumberOfComponents(3);
+
+    mScales->SetName("Scale");
+    mScales->SetNumberOfComponents(1);
+
+    mColors->SetName("Colors");
+    mColors->SetNumberOfComponents(4);
+
+    mInstances->SetPoints(mPositions);
+    mInstances->GetPointData()->AddArray(mOrientations);
+    mInstances->GetPointData()->AddArray(mScales);
+    mInstances->GetPointData()->SetScalars(mColors);
+
+    mMapper->SetInputData(mInstances);
+    mMapper->SetSourceData(mMesh);
+    mMapper->SetOrientationArray("Orientation");
+    mMapper->SetOrientationModeToRotation();
+    mMapper->SetScaleArray("Scale");
+    mMapper->SetScaleModeToScaleByMagnitude();
+    mMapper->ScalingOn();
+    mMapper->ScalarVisibilityOn();
+    mMapper->SetScalarModeToUsePointData();
+    mMapper->SetColorModeToDirectScalars();
+
+    mActor->SetMapper(mMapper);
+}
+
+
+/**
+ * @brief Appends an instance at the origin with identity transform, black and opaque.
+ *
+ * @param owner Caller-defined id stored with the instance.
+ * @return std::size_t Index of the new instance.
+ */
+std::size_t InstanceBatch::add(std::uint32_t owner)
+{
+    const unsigned char black[4] = { 0, 0, 0, 255 };
+
+    mPositions->InsertNextPoint(0.0, 0.0, 0.0);
+    mOrientations->InsertNextTuple3(0.0, 0.0, 0.0);
+    mScales->InsertNextValue(1.0f);
+    mColors->InsertNextTypedTuple(black);
+
+    mOwners.push_back(owner);
+    return mOwners.size() - 1;
+}
+
+
+/**
+ * @brief Removes an instance by moving the last instance into its index.
+ *
+ * @param index The instance to remove.
+ * @return std::uint32_t Owner of the instance now at index.
+ */
+std::uint32_t InstanceBatch::remove(std::size_t index)
+{
+    const std::uint32_t removed = mOwners[index];
+    const vtkIdType last = static_cast<vtkIdType>(mOwners.size() - 1);
+    const vtkIdType target = static_cast<vtkIdType>(index);
+
+    if (target != last)
+    {
+        mPositions->SetPoint(target, mPositions->GetPoint(last));
+        mOrientations->SetTuple(target, last, mOrientations);
+        mScales->SetTuple(target, last, mScales);
+        mColors->SetTuple(target, last, mColors);
+        mOwners[index] = mOwners[last];
+    }
+
+    mPositions->SetNumberOfPoints(last);
+    mOrientations->SetNumberOfTuples(last);
+    mScales->SetNumberOfTuples(last);
+    mColors->SetNumberOfTuples(last);
+    mOwners.pop_back();
+
+    commit();
+
+    return target != last ? mOwners[index] : removed;
+}
+
+
+/**
+ * @brief Writes the transform and material of one instance.
+ *
+ * @param index The instance.
+ * @param position World position.
+ * @param orientation Rotation in degrees about X, Y and Z.
+ * @param scale Uniform scale factor.
+ * @param rgb Color in [0, 1].
+ * @param opacity Opacity in [0, 1].
+ */
+void InstanceBatch::set(std::size_t index, const double position[3], const double orientation[3],
+                        double scale, const double rgb[3], double opacity)
+{
+    const vtkIdType id = static_cast<vtkIdType>(index);
+
+    auto toByte = [](double value) {
+        return static_cast<unsigned char>(std::clamp(value, 0.0, 1.0) * 255.0 + 0.5);
+    };
+    const unsigned char rgba[4] = { toByte(rgb[0]), toByte(rgb[1]), toByte(rgb[2]), toByte(opacity) };
+
+    mPositions->SetPoint(id, position);
+    mOrientations->SetTuple3(id, orientation[0], orientation[1], orientation[2]);
+    mScales->SetValue(id, static_cast<float>(scale));
+    mColors->SetTypedTuple(id, rgba);
+}
+
+
+/**
+ * @brief Marks the instance arrays as modified so the mapper re-uploads them.
+ */
+void InstanceBatch::commit()
+{
+    mPositions->Modified();
+    mOrientations->Modified();
+    mScales->Modified();
+    mColors->Modified();
+    mInstances->Modified();
+}
+
+
+/**
+ * @brief Returns the memory used by the per-instance arrays.
+ *
+ * @return std::size_t Size in bytes.
+ */
+std::size_t InstanceBatch::instanceBytes() const
+{
+    // GetActualMemorySize() reports kibibytes.
+    const unsigned long kib = mPositions->GetData()->GetActualMemorySize() + mOrientations->GetActualMemorySize() +
+        mScales->GetActualMemorySize() + mColors->GetActualMemorySize();
+    return static_cast<std::size_t>(kib) * 1024u;
+}
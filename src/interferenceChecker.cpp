@@ -0,0 +1,468 @@
+/**
+ * @file interferenceChecker.cpp
+ * @brief Implementation of the InterferenceChecker class.
+ */
+
+#include "interferenceChecker.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <vtkMatrix4x4.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace
+{
+
+/// Objects covering more grid cells than this are kept out of the grid.
+constexpr long long MaxCells = 512;
+
+/// Grid cells are this many times the median object size.
+constexpr double CellSizeFactor = 2.0;
+
+/// Cell indices are clamped to [-CellLimit, CellLimit), which keeps keys unique and lookups conservative.
+constexpr int CellLimit = 1 << 20;
+
+/// Returns true if two boxes, lower then upper corner, overlap or touch.
+bool overlaps(const std::array<float, 6>& a, const std::array<float, 6>& b)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (a[3 + axis] < b[axis] || b[3 + axis] < a[axis])
+            return false;
+    }
+    return true;
+}
+
+/// Removes one occurrence of a value from an unordered vector.
+void eraseUnordered(std::vector<ObjectId>& values, ObjectId value)
+{
+    auto it = std::find(values.begin(), values.end(), value);
+    if (it == values.end())
+        return;
+    *it = values.back();
+    values.pop_back();
+}
+
+} // namespace
+
+
+/**
+ * @brief Constructs a checker for a scene.
+ *
+ * @param scene The scene to check.
+ * @param cache Cache of the mesh hierarchies.
+ * @param threads Worker threads of the narrow phase; 0 uses every core.
+ */
+InterferenceChecker::InterferenceChecker(const Scene& scene, MeshBvhCache& cache, unsigned threads)
+    : mScene(scene), mCache(cache), mThreads(threads)
+{
+}
+
+
+/**
+ * @brief Brings the interference state up to date with the scene.
+ *
+ * Objects whose revision changed, and objects new to the checker, are taken out of
+ * the grid with their pairs, moved to their new bounds and queried against their
+ * neighbors; the new pairs are tested in parallel. Objects that left the scene only
+ * have their pairs dropped. Pairs between objects that did not change are kept as is.
+ *
+ * @return std::vector<ObjectId> Objects of the scene whose interference state changed.
+ */
+std::vector<ObjectId> InterferenceChecker::update()
+{
+    if (mBuilt && mScene.geometryRevision() == mRevision)
+        return {};
+
+    TRACE_SCOPE("InterferenceChecker::update", "interference");
+
+    ++mStamp;
+    mTouched.clear();
+
+    std::vector<ObjectId> moved;
+    for (ObjectId id : mScene.objects())
+    {
+        if (id >= mEntries.size())
+            mEntries.resize(static_cast<std::size_t>(id) + 1);
+
+        Entry& entry = mEntries[id];
+        if (!entry.live || entry.revision != mScene.geometryRevision(id))
+            moved.push_back(id);
+        entry.seen = mStamp;
+    }
+
+    for (ObjectId id = 0; id < mEntries.size(); ++id)
+    {
+        if (mEntries[id].live && mEntries[id].seen != mStamp)
+            remove(id);
+    }
+
+    for (ObjectId id : moved)
+    {
+        if (mEntries[id].live)
+            remove(id);
+        computeObject(id);
+    }
+
+    if (mCellSize == 0.0)
+        chooseCellSize(moved);
+
+    for (ObjectId id : moved)
+        insert(id);
+
+    // Broad phase: pairs of a moved object and any object whose bounds overlap it
+    std::vector<Test> tests;
+    for (ObjectId id : moved)
+    {
+        Entry& entry = mEntries[id];
+        if (!hasGeometry(entry))
+            continue;
+
+        auto consider = [&](ObjectId other) {
+            if (other == id || !overlaps(entry.bounds, mEntries[other].bounds))
+                return;
+            if (!mPairs.emplace(pairKey(id, other), false).second)
+                return;
+            entry.partners.push_back(other);
+            mEntries[other].partners.push_back(id);
+            tests.push_back({ std::min(id, other), std::max(id, other), nullptr, nullptr, false });
+        };
+
+        if (entry.large)
+        {
+            for (ObjectId other : mScene.objects())
+                consider(other);
+            continue;
+        }
+
+        for (int x = entry.cells[0]; x <= entry.cells[3]; ++x)
+        {
+            for (int y = entry.cells[1]; y <= entry.cells[4]; ++y)
+            {
+                for (int z = entry.cells[2]; z <= entry.cells[5]; ++z)
+                {
+                    auto bucket = mGrid.find(cellKey(x, y, z));
+                    for (ObjectId other : bucket->second)
+                        consider(other);
+                }
+            }
+        }
+        for (ObjectId other : mLarge)
+            consider(other);
+    }
+
+    // Narrow phase: mesh hierarchies are built up front, then pairs are tested concurrently
+    for (Test& test : tests)
+    {
+        test.firstBvh = mCache.get(mScene.mesh(test.first)).get();
+        test.secondBvh = mCache.get(mScene.mesh(test.second)).get();
+    }
+
+    parallelFor(tests.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            Test& test = tests[i];
+            if (!test.firstBvh || !test.secondBvh)
+                continue;
+
+            double secondToFirst[16];
+            vtkMatrix4x4::Multiply4x4(mEntries[test.first].inverse.data(), mEntries[test.second].world.data(), secondToFirst);
+            test.colliding = test.firstBvh->intersects(*test.secondBvh, secondToFirst);
+        }
+    }, mThreads);
+
+    for (const Test& test : tests)
+    {
+        if (!test.colliding)
+            continue;
+
+        mPairs[pairKey(test.first, test.second)] = true;
+        touch(test.first);
+        touch(test.second);
+        ++mEntries[test.first].colliding;
+        ++mEntries[test.second].colliding;
+        ++mColliding;
+    }
+
+    std::vector<ObjectId> changed;
+    for (ObjectId id : mTouched)
+    {
+        const Entry& entry = mEntries[id];
+        if (entry.live && (entry.colliding > 0) != entry.wasColliding)
+            changed.push_back(id);
+    }
+
+    mMoved = moved.size();
+    mTests = tests.size();
+    mRevision = mScene.geometryRevision();
+    mBuilt = true;
+    return changed;
+}
+
+
+/**
+ * @brief Returns true if the object interferes with another, as of the last update.
+ *
+ * @param id The object; ids unknown to the checker are not colliding.
+ */
+bool InterferenceChecker::isColliding(ObjectId id) const
+{
+    return id < mEntries.size() && mEntries[id].live && mEntries[id].colliding > 0;
+}
+
+
+/**
+ * @brief Returns every pair of interfering objects, sorted, smaller id first.
+ */
+std::vector<std::pair<ObjectId, ObjectId>> InterferenceChecker::collidingPairs() const
+{
+    std::vector<std::pair<ObjectId, ObjectId>> pairs;
+    pairs.reserve(mColliding);
+    for (const auto& pair : mPairs)
+    {
+        if (pair.second)
+            pairs.emplace_back(static_cast<ObjectId>(pair.first >> 32), static_cast<ObjectId>(pair.first & 0xFFFFFFFFu));
+    }
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+
+/**
+ * @brief Forgets every object and pair, and the grid's cell size.
+ */
+void InterferenceChecker::clear()
+{
+    mEntries.clear();
+    mGrid.clear();
+    mLarge.clear();
+    mPairs.clear();
+    mTouched.clear();
+    mObjects = 0;
+    mColliding = 0;
+    mMoved = 0;
+    mTests = 0;
+    mCellSize = 0.0;
+    mBuilt = false;
+}
+
+
+/**
+ * @brief Returns a snapshot of the counters.
+ */
+InterferenceChecker::Statistics InterferenceChecker::statistics() const
+{
+    Statistics statistics;
+    statistics.objects = mObjects;
+    statistics.large = mLarge.size();
+    statistics.pairs = mPairs.size();
+    statistics.colliding = mColliding;
+    statistics.moved = mMoved;
+    statistics.tests = mTests;
+    return statistics;
+}
+
+
+/**
+ * @brief Reads the world matrix and mesh bounds of an object and computes its world bounds.
+ *
+ * The bounds are those of the mesh's bounding box corners moved into the world, and
+ * empty for objects without geometry or with a singular matrix.
+ *
+ * @param id The object.
+ */
+void InterferenceChecker::computeObject(ObjectId id)
+{
+    Entry& entry = mEntries[id];
+    entry.revision = mScene.geometryRevision(id);
+    std::fill(entry.bounds.begin(), entry.bounds.begin() + 3, std::numeric_limits<float>::max());
+    std::fill(entry.bounds.begin() + 3, entry.bounds.end(), std::numeric_limits<float>::lowest());
+
+    mScene.getWorldMatrix(id, entry.world.data());
+    vtkPolyData* mesh = mScene.mesh(id);
+    if (!mesh || mesh->GetNumberOfPoints() == 0 || vtkMatrix4x4::Determinant(entry.world.data()) == 0.0)
+        return;
+    vtkMatrix4x4::Invert(entry.world.data(), entry.inverse.data());
+
+    double meshBounds[6];
+    mesh->GetBounds(meshBounds);
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        const double p[3] = { meshBounds[corner & 1], meshBounds[2 + ((corner >> 1) & 1)], meshBounds[4 + ((corner >> 2) & 1)] };
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const double* row = entry.world.data() + 4 * axis;
+            const double value = row[0] * p[0] + row[1] * p[1] + row[2] * p[2] + row[3];
+            // Round outwards so touching objects still overlap
+            entry.bounds[axis] = std::min(entry.bounds[axis], std::nextafter(static_cast<float>(value), std::numeric_limits<float>::lowest()));
+            entry.bounds[3 + axis] = std::max(entry.bounds[3 + axis], std::nextafter(static_cast<float>(value), std::numeric_limits<float>::max()));
+        }
+    }
+}
+
+
+/**
+ * @brief Adds an object with freshly computed bounds to the grid, or to the large list.
+ *
+ * Objects without geometry are tracked but never paired.
+ *
+ * @param id The object.
+ */
+void InterferenceChecker::insert(ObjectId id)
+{
+    Entry& entry = mEntries[id];
+    entry.live = true;
+    entry.large = false;
+    ++mObjects;
+    touch(id);
+    if (!hasGeometry(entry))
+        return;
+
+    long long cells = 1;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        auto cell = [this](float value) {
+            const double index = std::floor(value / mCellSize);
+            return static_cast<int>(std::min<double>(std::max<double>(index, -CellLimit), CellLimit - 1));
+        };
+        entry.cells[axis] = cell(entry.bounds[axis]);
+        entry.cells[3 + axis] = cell(entry.bounds[3 + axis]);
+        cells *= entry.cells[3 + axis] - entry.cells[axis] + 1;
+    }
+
+    if (cells > MaxCells)
+    {
+        entry.large = true;
+        mLarge.push_back(id);
+        return;
+    }
+
+    for (int x = entry.cells[0]; x <= entry.cells[3]; ++x)
+    {
+        for (int y = entry.cells[1]; y <= entry.cells[4]; ++y)
+        {
+            for (int z = entry.cells[2]; z <= entry.cells[5]; ++z)
+                mGrid[cellKey(x, y, z)].push_back(id);
+        }
+    }
+}
+
+
+/**
+ * @brief Takes an object out of the grid and drops its pairs, updating its partners' counts.
+ *
+ * @param id The object.
+ */
+void InterferenceChecker::remove(ObjectId id)
+{
+    Entry& entry = mEntries[id];
+    touch(id);
+
+    for (ObjectId partner : entry.partners)
+    {
+        auto pair = mPairs.find(pairKey(id, partner));
+        if (pair->second)
+        {
+            touch(partner);
+            --mEntries[partner].colliding;
+            --mColliding;
+        }
+        mPairs.erase(pair);
+        eraseUnordered(mEntries[partner].partners, id);
+    }
+    entry.partners.clear();
+    entry.colliding = 0;
+
+    if (entry.large)
+    {
+        eraseUnordered(mLarge, id);
+    }
+    else if (hasGeometry(entry))
+    {
+        for (int x = entry.cells[0]; x <= entry.cells[3]; ++x)
+        {
+            for (int y = entry.cells[1]; y <= entry.cells[4]; ++y)
+            {
+                for (int z = entry.cells[2]; z <= entry.cells[5]; ++z)
+                {
+                    auto bucket = mGrid.find(cellKey(x, y, z));
+                    eraseUnordered(bucket->second, id);
+                    if (bucket->second.empty())
+                        mGrid.erase(bucket);
+                }
+            }
+        }
+    }
+
+    entry.live = false;
+    entry.large = false;
+    --mObjects;
+}
+
+
+/**
+ * @brief Records an object's state before the current update changes it, once per update.
+ *
+ * @param id The object.
+ */
+void InterferenceChecker::touch(ObjectId id)
+{
+    Entry& entry = mEntries[id];
+    if (entry.touched == mStamp)
+        return;
+    entry.touched = mStamp;
+    entry.wasColliding = entry.live && entry.colliding > 0;
+    mTouched.push_back(id);
+}
+
+
+/**
+ * @brief Sets the grid's cell size from the median size of the given objects.
+ *
+ * Only the first objects decide it; objects that later turn out much larger than the
+ * cells end up in the large list instead of degrading the grid.
+ *
+ * @param ids Objects with computed bounds.
+ */
+void InterferenceChecker::chooseCellSize(const std::vector<ObjectId>& ids)
+{
+    std::vector<float> sizes;
+    sizes.reserve(ids.size());
+    for (ObjectId id : ids)
+    {
+        const Entry& entry = mEntries[id];
+        if (!hasGeometry(entry))
+            continue;
+        sizes.push_back(std::max({ entry.bounds[3] - entry.bounds[0], entry.bounds[4] - entry.bounds[1],
+                                   entry.bounds[5] - entry.bounds[2] }));
+    }
+    if (sizes.empty())
+        return;
+
+    std::nth_element(sizes.begin(), sizes.begin() + sizes.size() / 2, sizes.end());
+    const double median = sizes[sizes.size() / 2];
+    mCellSize = median > 0.0 ? CellSizeFactor * median : 1.0;
+}
+
+
+/**
+ * @brief Returns the key of an unordered pair of objects: the smaller id in the high half.
+ */
+std::uint64_t InterferenceChecker::pairKey(ObjectId a, ObjectId b)
+{
+    return (static_cast<std::uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+}
+
+
+/**
+ * @brief Packs the 21-bit offset indices of a grid cell into one key.
+ */
+std::uint64_t InterferenceChecker::cellKey(int x, int y, int z)
+{
+    const auto offset = [](int index) { return static_cast<std::uint64_t>(index + CellLimit) & 0x1FFFFFu; };
+    return (offset(x) << 42) | (offset(y) << 21) | offset(z);
+}
@@ -0,0 +1,440 @@
+/**
+ * @file lodManager.cpp
+ * @brief Implementation of the LodManager class.
+ */
+
+#include "lodManager.h"
+#include "meshStorage.h"
+#include "parallel.h"
+#include "screenSpace.h"
+#include "trace.h"
+
+#include <vtkActor.h>
+#include <vtkCleanPolyData.h>
+#include <vtkDecimatePro.h>
+#include <vtkNew.h>
+#include <vtkPolyDataNormals.h>
+#include <vtkTriangleFilter.h>
+
+#include <algorithm>
+
+
+namespace
+{
+
+/**
+ * @brief One step of a chain: the fraction of triangles to remove and the error bound,
+ * as a fraction of the mesh's bounding box diagonal, the decimation may not exceed.
+ */
+struct LevelStep
+{
+    double reduction;
+    double error;
+};
+
+constexpr LevelStep LevelSteps[] = {
+    { 0.50, 0.002 },
+    { 0.75, 0.005 },
+    { 0.90, 0.010 },
+    { 0.97, 0.025 },
+};
+
+/// A level must have at most this fraction of the triangles of the previous one to be kept.
+constexpr double MinimumGain = 0.7;
+
+} // namespace
+
+
+/**
+ * @brief Constructs the manager and starts its builder threads.
+ *
+ * @param capacityBytes Maximum memory the levels may use.
+ * @param threads Number of builder threads; 0 uses half the hardware threads.
+ */
+LodManager::LodManager(std::size_t capacityBytes, unsigned threads) : mCapacityBytes(capacityBytes)
+{
+    if (threads == 0)
+        threads = std::max(1u, parallelThreadCount() / 2);
+
+    for (unsigned i = 0; i < threads; ++i)
+        mWorkers.emplace_back(&LodManager::workerLoop, this);
+}
+
+
+/**
+ * @brief Stops and joins the builder threads.
+ */
+LodManager::~LodManager()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+        mQueue.clear();
+    }
+    mWake.notify_all();
+
+    for (std::thread& worker : mWorkers)
+        worker.join();
+}
+
+
+/**
+ * @brief Sets the tolerated screen-space error in pixels.
+ *
+ * @param idle Tolerance when the view is still.
+ * @param interactive Tolerance while the user interacts.
+ */
+void LodManager::setPixelErrors(double idle, double interactive)
+{
+    mIdlePixelError = std::max(0.0, idle);
+    mInteractivePixelError = std::max(0.0, interactive);
+}
+
+
+/**
+ * @brief Sets the memory cap and evicts chains until the levels fit.
+ *
+ * @param capacityBytes Maximum memory the levels may use.
+ */
+void LodManager::setCapacity(std::size_t capacityBytes)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCapacityBytes = capacityBytes;
+    mEvicted.clear();
+    evictToCapacity();
+}
+
+
+/**
+ * @brief Sets a function called from a builder thread whenever a chain is finished.
+ */
+void LodManager::setOnChainReady(std::function<void()> onChainReady)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mOnChainReady = std::move(onChainReady);
+}
+
+
+/**
+ * @brief Picks a level for every object from the camera.
+ *
+ * The error bound of each level is scaled from model to world units by the ratio of
+ * the object's world and model bounding radii, then to pixels at the distance of the
+ * object's bounding sphere from the camera. The coarsest level within the tolerance
+ * wins; objects the camera is inside of are drawn at full resolution.
+ *
+ * @param scene The scene whose objects are switched.
+ * @param renderer The renderer whose camera and viewport define the screen.
+ * @return std::size_t Number of objects whose level changed.
+ */
+std::size_t LodManager::update(Scene& scene, vtkRenderer* renderer)
+{
+    TRACE_SCOPE("LodManager::update", "lod");
+
+    const double tolerance = mInteracting ? mInteractivePixelError : mIdlePixelError;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    ++mFrame;
+
+    std::size_t switched = 0;
+    mReducedObjects = 0;
+
+    for (ObjectId id : scene.objects())
+    {
+        if (scene.isInstanced(id))
+            continue;
+
+        vtkPolyData* level = nullptr;
+        Chain* chain = mEnabled ? chainFor(scene.mesh(id)) : nullptr;
+        vtkActor* actor = scene.actor(id);
+
+        if (chain && chain->ready && !chain->levels.empty() && chain->radius > 0.0)
+        {
+            chain->lastUsed = mFrame;
+
+            double worldRadius = 0.0;
+            const double pixelsPerUnit = pixelsPerWorldUnit(renderer, actor, &worldRadius);
+            const double worldScale = worldRadius / chain->radius;
+
+            if (pixelsPerUnit > 0.0)
+            {
+                for (auto it = chain->levels.rbegin(); it != chain->levels.rend(); ++it)
+                {
+                    if (it->error * worldScale * pixelsPerUnit <= tolerance)
+                    {
+                        level = it->mesh;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (scene.renderMesh(id) != level)
+        {
+            scene.setRenderMesh(id, level);
+            ++switched;
+        }
+        if (level)
+            ++mReducedObjects;
+    }
+
+    mSwitches += switched;
+
+    // Drop chains whose mesh is no longer referenced by anything but the chain
+    for (auto it = mChains.begin(); it != mChains.end();)
+    {
+        const std::shared_ptr<Chain>& chain = it->second;
+        if (chain->ready && chain->base->GetReferenceCount() == 1)
+        {
+            mBytes -= chain->bytes;
+            it = mChains.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    return switched;
+}
+
+
+/**
+ * @brief Returns a snapshot of the counters.
+ */
+LodManager::Statistics LodManager::statistics() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    Statistics statistics;
+    for (const auto& entry : mChains)
+    {
+        if (entry.second->ready)
+        {
+            ++statistics.chains;
+            statistics.levels += entry.second->levels.size();
+        }
+    }
+    statistics.pending = mQueue.size() + mBuilding;
+    statistics.bytes = mBytes;
+    statistics.capacityBytes = mCapacityBytes;
+    statistics.evictions = mEvictions;
+    statistics.switches = mSwitches;
+    statistics.reducedObjects = mReducedObjects;
+    return statistics;
+}
+
+
+/**
+ * @brief Drops every chain and every queued build.
+ */
+void LodManager::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mChains.clear();
+    mQueue.clear();
+    mEvicted.clear();
+    mBytes = 0;
+}
+
+
+/**
+ * @brief Returns the chain of a mesh, queueing a build if there is none and the user is not interacting. Requires the lock.
+ *
+ * @param mesh The mesh.
+ * @return Chain* The chain, possibly not built yet, or null if the mesh gets no levels.
+ */
+LodManager::Chain* LodManager::chainFor(vtkPolyData* mesh)
+{
+    if (!mesh)
+        return nullptr;
+
+    auto found = mChains.find(mesh);
+    if (found != mChains.end())
+    {
+        // A mesh edited in place gets a new chain
+        if (found->second->baseTime == mesh->GetMTime())
+            return found->second.get();
+
+        mBytes -= found->second->bytes;
+        mChains.erase(found);
+    }
+
+    auto evicted = mEvicted.find(mesh);
+    if (evicted != mEvicted.end())
+    {
+        if (evicted->second)
+            return nullptr;
+        mEvicted.erase(evicted);
+    }
+
+    if (static_cast<std::size_t>(mesh->GetNumberOfPolys() + mesh->GetNumberOfStrips()) < MinimumTriangles)
+        return nullptr;
+
+    // A shape parameter drag replaces the mesh on every frame; build a chain once it settles
+    if (mInteracting)
+        return nullptr;
+
+    std::shared_ptr<Chain> chain = std::make_shared<Chain>();
+    chain->base = mesh;
+    chain->baseTime = mesh->GetMTime();
+    chain->radius = mesh->GetLength() / 2.0;
+
+    // The builder reads a shallow copy, so it never touches the rendered data object
+    chain->input = vtkSmartPointer<vtkPolyData>::New();
+    chain->input->ShallowCopy(mesh);
+
+    mChains.emplace(mesh, chain);
+    mQueue.push_back(chain);
+    mWake.notify_one();
+
+    return chain.get();
+}
+
+
+/**
+ * @brief Builder thread: takes queued chains, builds their levels and publishes them.
+ */
+void LodManager::workerLoop()
+{
+    Trace::setThreadName("LodManager builder");
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        mWake.wait(lock, [this]() { return mStop || !mQueue.empty(); });
+        if (mStop)
+            return;
+
+        std::shared_ptr<Chain> chain = mQueue.front();
+        mQueue.pop_front();
+        ++mBuilding;
+
+        lock.unlock();
+        std::vector<Level> levels = buildLevels(chain->input, mStop);
+        lock.lock();
+
+        --mBuilding;
+        if (mStop)
+            return;
+
+        // The chain may have been dropped or replaced while it was built
+        auto found = mChains.find(chain->base);
+        if (found == mChains.end() || found->second != chain)
+            continue;
+
+        chain->levels = std::move(levels);
+        chain->input = nullptr;
+        chain->ready = true;
+        chain->lastUsed = mFrame;
+        for (const Level& level : chain->levels)
+            chain->bytes += level.bytes;
+        mBytes += chain->bytes;
+
+        evictToCapacity();
+
+        if (mOnChainReady)
+        {
+            std::function<void()> onChainReady = mOnChainReady;
+            lock.unlock();
+            onChainReady();
+            lock.lock();
+        }
+    }
+}
+
+
+/**
+ * @brief Builds the decimated levels of a mesh.
+ *
+ * The mesh is triangulated and its coincident points merged first, since meshes read
+ * from STL have three points per facet and cannot be decimated otherwise. Each level is
+ * then decimated from the welded mesh with topology preserved and an absolute error
+ * bound, and gets feature-angle normals. The chain stops early once a step no longer
+ * removes enough triangles within its error bound.
+ *
+ * @param input The mesh to approximate; only read.
+ * @param stop Building stops as soon as this becomes true.
+ * @return std::vector<Level> The levels, finest first.
+ */
+std::vector<LodManager::Level> LodManager::buildLevels(vtkPolyData* input, const std::atomic<bool>& stop)
+{
+    TRACE_SCOPE("LodManager::buildLevels", "lod");
+
+    std::vector<Level> levels;
+
+    vtkNew<vtkTriangleFilter> triangles;
+    triangles->SetInputData(input);
+    triangles->PassVertsOff();
+    triangles->PassLinesOff();
+
+    vtkNew<vtkCleanPolyData> weld;
+    weld->SetInputConnection(triangles->GetOutputPort());
+    weld->PointMergingOn();
+    weld->SetTolerance(0.0);
+    weld->Update();
+
+    vtkPolyData* welded = weld->GetOutput();
+    const double diagonal = welded->GetLength();
+    double previousTriangles = static_cast<double>(welded->GetNumberOfPolys());
+
+    for (const LevelStep& step : LevelSteps)
+    {
+        if (stop)
+            break;
+
+        vtkNew<vtkDecimatePro> decimate;
+        decimate->SetInputData(welded);
+        decimate->SetTargetReduction(step.reduction);
+        decimate->PreserveTopologyOn();
+        decimate->SplittingOff();
+        decimate->BoundaryVertexDeletionOff();
+        decimate->ErrorIsAbsoluteOn();
+        decimate->SetAbsoluteError(step.error * diagonal);
+
+        vtkNew<vtkPolyDataNormals> normals;
+        normals->SetInputConnection(decimate->GetOutputPort());
+        normals->SetFeatureAngle(30.0);
+        normals->Update();
+
+        const double levelTriangles = static_cast<double>(normals->GetOutput()->GetNumberOfPolys());
+        if (levelTriangles > previousTriangles * MinimumGain)
+            break;
+
+        Level level;
+        level.mesh = vtkSmartPointer<vtkPolyData>::New();
+        level.mesh->ShallowCopy(normals->GetOutput());
+        level.mesh = MeshStorage::adapt(level.mesh);
+        level.error = step.error * diagonal;
+        level.bytes = static_cast<std::size_t>(level.mesh->GetActualMemorySize()) * 1024;
+        levels.push_back(level);
+
+        previousTriangles = levelTriangles;
+    }
+
+    return levels;
+}
+
+
+/**
+ * @brief Evicts the least recently drawn chains until the levels fit. Requires the lock.
+ */
+void LodManager::evictToCapacity()
+{
+    while (mBytes > mCapacityBytes)
+    {
+        auto oldest = mChains.end();
+        for (auto it = mChains.begin(); it != mChains.end(); ++it)
+        {
+            if (it->second->ready && it->second->bytes > 0 && (oldest == mChains.end() || it->second->lastUsed < oldest->second->lastUsed))
+                oldest = it;
+        }
+        if (oldest == mChains.end())
+            break;
+
+        mBytes -= oldest->second->bytes;
+        mEvicted[oldest->first] = oldest->second->base;
+        mChains.erase(oldest);
+        ++mEvictions;
+    }
+}
@@ -1,16 +1,93 @@
 #include <QtWidgets/QApplication>
+#include <QCommandLineParser>
+#include "batchRunner.h"
+#include "meshStorage.h"
 #include "widget.h"
+#include "trace.h"
 
+#include <cstdio>
+#include <memory>
 
-int main(int argc, char** argv)
+
+// --batch runs headless, so it must be known before any application object exists
+static std::unique_ptr<QCoreApplication> createApplication(int& argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!qstrcmp(argv[i], "--batch") || !qstrncmp(argv[i], "--batch=", 8))
+			return std::make_unique<QCoreApplication>(argc, argv);
+	}
+	return std::make_unique<QApplication>(argc, argv);
+}
+
+
+// Runs the jobs of a job file without any window and prints failures and throughput
+static int runBatch(const QString& path, unsigned threads)
 {
-	QApplication app(argc, argv);
+	const BatchRunner::JobFile jobFile = BatchRunner::readJobFile(path);
+	if (!jobFile.ok())
+	{
+		std::fprintf(stderr, "Could not read job file %s: %s\n", qPrintable(path), qPrintable(jobFile.error));
+		return 2;
+	}
 
-	Widget w;
-	w.show();
+	const BatchRunner::Report report = BatchRunner::run(jobFile.jobs, threads);
+	for (const BatchRunner::JobResult& job : report.jobs)
+	{
+		if (!job.ok())
+			std::fprintf(stderr, "%s: %s\n", qPrintable(job.name), qPrintable(job.error));
+	}
 
-	return app.exec();
+	std::printf("%zu jobs, %zu failed, %zu facets in %.3f s on %u threads: %.1f jobs/s\n",
+				report.jobs.size(), report.failed, report.facets, report.seconds, report.threads, report.jobsPerSecond());
+
+	return report.failed == 0 ? 0 : 1;
 }
 
 
+int main(int argc, char** argv)
+{
+	const std::unique_ptr<QCoreApplication> app = createApplication(argc, argv);
+
+	// --trace <file> records trace spans from startup and writes them to the file on exit
+	QCommandLineParser parser;
+	parser.addHelpOption();
+	const QCommandLineOption traceOption("trace", "Record a Chrome trace and write it to <file> on exit.", "file");
+	parser.addOption(traceOption);
+	const QCommandLineOption batchOption("batch", "Run the jobs of <file> without a window, then exit.", "file");
+	parser.addOption(batchOption);
+	const QCommandLineOption threadsOption("threads", "Jobs run at the same time in batch mode; 0 uses every core.", "count", "0");
+	parser.addOption(threadsOption);
+	const QCommandLineOption compactOption("compact-meshes", "Store meshes as float32 points and normals with 32-bit cell ids.");
+	parser.addOption(compactOption);
+	parser.process(*app);
+
+	if (parser.isSet(compactOption))
+		MeshStorage::setMode(MeshStorage::Mode::Compact);
+
+	const QString tracePath = parser.value(traceOption);
+	if (!tracePath.isEmpty())
+		Trace::setEnabled(true);
 
+	int status = 0;
+	if (parser.isSet(batchOption))
+	{
+		status = runBatch(parser.value(batchOption), parser.value(threadsOption).toUInt());
+	}
+	else
+	{
+		Widget w;
+		w.show();
+
+		status = app->exec();
+	}
+
+	if (!tracePath.isEmpty())
+	{
+		const QString error = Trace::exportChromeJson(tracePath);
+		if (!error.isEmpty())
+			qWarning("Could not write trace %s: %s", qPrintable(tracePath), qPrintable(error));
+	}
+
+	return status;
+}
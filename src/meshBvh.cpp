@@ -0,0 +1,941 @@
+/**
+ * @file meshBvh.cpp
+ * @brief Implementation of the MeshBvh class.
+ */
+
+#include "meshBvh.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkIdList.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+
+
+namespace
+{
+
+/// Nodes below this depth are leaves whatever their size, which bounds the traversal stack.
+constexpr std::uint32_t MaxDepth = 64;
+
+/// Nodes with at most this many triangles always become leaves.
+constexpr std::uint32_t MinLeafSize = 4;
+
+/// Nodes with at most this many triangles become leaves when splitting them would not pay off.
+constexpr std::uint32_t MaxLeafSize = 8;
+
+/// Number of bins the surface area heuristic evaluates along the split axis.
+constexpr int BinCount = 16;
+
+/// Ranges with more triangles than this are measured and binned in parallel.
+constexpr std::uint32_t ParallelThreshold = 1u << 16;
+
+/// Block size of the parallel loops.
+constexpr std::size_t Grain = 1u << 14;
+
+/**
+ * @brief Axis-aligned bounding box in single precision.
+ */
+struct Box
+{
+    float lower[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    float upper[3] = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+
+    void grow(const float p[3])
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            lower[axis] = std::min(lower[axis], p[axis]);
+            upper[axis] = std::max(upper[axis], p[axis]);
+        }
+    }
+
+    void grow(const Box& box)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            lower[axis] = std::min(lower[axis], box.lower[axis]);
+            upper[axis] = std::max(upper[axis], box.upper[axis]);
+        }
+    }
+
+    /// Twice the center, which orders triangles the same as the center does.
+    void centroid(float c[3]) const
+    {
+        for (int axis = 0; axis < 3; ++axis)
+            c[axis] = lower[axis] + upper[axis];
+    }
+
+    /// Half the surface area; only ratios of areas matter to the heuristic.
+    float area() const
+    {
+        const float x = upper[0] - lower[0];
+        const float y = upper[1] - lower[1];
+        const float z = upper[2] - lower[2];
+        return x < 0.0f ? 0.0f : x * y + y * z + z * x;
+    }
+};
+
+/**
+ * @brief Bounding box of a triangle and its index, partitioned in place during the build.
+ */
+struct Reference
+{
+    Box box;
+    std::uint32_t triangle;
+};
+
+/**
+ * @brief Enters the ray into a node's box.
+ *
+ * @return float The ray parameter where it enters the box, or a negative value if it misses it before tMax.
+ */
+template <typename Node>
+float enterBox(const Node& node, const float origin[3], const float inverse[3], float tMax)
+{
+    float tNear = 0.0f;
+    float tFar = tMax;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float t0 = (node.lower[axis] - origin[axis]) * inverse[axis];
+        float t1 = (node.upper[axis] - origin[axis]) * inverse[axis];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        tNear = t0 > tNear ? t0 : tNear;
+        tFar = t1 < tFar ? t1 : tFar;
+    }
+    return tNear <= tFar ? tNear : -1.0f;
+}
+
+/// Tolerance of the triangle-triangle test, relative to the size of the triangles.
+constexpr double Epsilon = 1e-9;
+
+double dot(const double a[3], const double b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+void cross(const double a[3], const double b[3], double out[3])
+{
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+void subtract(const double a[3], const double b[3], double out[3])
+{
+    out[0] = a[0] - b[0];
+    out[1] = a[1] - b[1];
+    out[2] = a[2] - b[2];
+}
+
+/// Returns true if the 2D segments p0-p1 and q0-q1 intersect, endpoints included.
+bool segmentsIntersect(const double p0[2], const double p1[2], const double q0[2], const double q1[2])
+{
+    auto orient = [](const double a[2], const double b[2], const double c[2]) {
+        return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+    };
+    auto within = [](const double a[2], const double b[2], const double c[2]) {
+        return std::min(a[0], b[0]) <= c[0] && c[0] <= std::max(a[0], b[0]) &&
+               std::min(a[1], b[1]) <= c[1] && c[1] <= std::max(a[1], b[1]);
+    };
+
+    const double d1 = orient(q0, q1, p0);
+    const double d2 = orient(q0, q1, p1);
+    const double d3 = orient(p0, p1, q0);
+    const double d4 = orient(p0, p1, q1);
+    if (((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)))
+        return true;
+    return (d1 == 0 && within(q0, q1, p0)) || (d2 == 0 && within(q0, q1, p1)) ||
+           (d3 == 0 && within(p0, p1, q0)) || (d4 == 0 && within(p0, p1, q1));
+}
+
+/// Returns true if the 2D point p lies in the triangle a, b, c of either winding, boundary included.
+bool pointInTriangle(const double p[2], const double a[2], const double b[2], const double c[2])
+{
+    const double d0 = (b[0] - a[0]) * (p[1] - a[1]) - (b[1] - a[1]) * (p[0] - a[0]);
+    const double d1 = (c[0] - b[0]) * (p[1] - b[1]) - (c[1] - b[1]) * (p[0] - b[0]);
+    const double d2 = (a[0] - c[0]) * (p[1] - c[1]) - (a[1] - c[1]) * (p[0] - c[0]);
+    return (d0 >= 0 && d1 >= 0 && d2 >= 0) || (d0 <= 0 && d1 <= 0 && d2 <= 0);
+}
+
+/**
+ * @brief Tests two coplanar triangles by projecting them onto the axis plane their normal is most aligned with.
+ */
+bool coplanarTrianglesIntersect(const double normal[3], const double* v[3], const double* u[3])
+{
+    int drop = 0;
+    for (int axis = 1; axis < 3; ++axis)
+    {
+        if (std::abs(normal[axis]) > std::abs(normal[drop]))
+            drop = axis;
+    }
+    const int i0 = drop == 0 ? 1 : 0;
+    const int i1 = drop == 2 ? 1 : 2;
+
+    double v2[3][2], u2[3][2];
+    for (int i = 0; i < 3; ++i)
+    {
+        v2[i][0] = v[i][i0];
+        v2[i][1] = v[i][i1];
+        u2[i][0] = u[i][i0];
+        u2[i][1] = u[i][i1];
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            if (segmentsIntersect(v2[i], v2[(i + 1) % 3], u2[j], u2[(j + 1) % 3]))
+                return true;
+        }
+    }
+    return pointInTriangle(v2[0], u2[0], u2[1], u2[2]) || pointInTriangle(u2[0], v2[0], v2[1], v2[2]);
+}
+
+/**
+ * @brief Computes the interval a triangle covers on the line where its plane meets the other's.
+ *
+ * @param p Projections of the vertices onto the line.
+ * @param d Signed distances of the vertices to the other triangle's plane; not all zero.
+ */
+void lineInterval(const double p[3], const double d[3], double interval[2])
+{
+    // The lone vertex is the one on its own side of the plane
+    int lone = 0;
+    if (d[0] * d[1] > 0.0)
+        lone = 2;
+    else if (d[0] * d[2] > 0.0)
+        lone = 1;
+    else if (d[1] * d[2] > 0.0 || d[0] != 0.0)
+        lone = 0;
+    else if (d[1] != 0.0)
+        lone = 1;
+    else
+        lone = 2;
+
+    const int a = (lone + 1) % 3;
+    const int b = (lone + 2) % 3;
+    interval[0] = p[lone] + (p[a] - p[lone]) * d[lone] / (d[lone] - d[a]);
+    interval[1] = p[lone] + (p[b] - p[lone]) * d[lone] / (d[lone] - d[b]);
+    if (interval[0] > interval[1])
+        std::swap(interval[0], interval[1]);
+}
+
+/**
+ * @brief Returns true if two triangles intersect or touch (Moller's interval overlap test).
+ *
+ * Distances to a plane below a tolerance relative to the triangles' size count as zero,
+ * so triangles resting on each other are reported. Degenerate triangles never intersect.
+ */
+bool trianglesIntersect(const double* v[3], const double* u[3])
+{
+    double e1[3], e2[3], n1[3], n2[3];
+    subtract(v[1], v[0], e1);
+    subtract(v[2], v[0], e2);
+    cross(e1, e2, n1);
+    subtract(u[1], u[0], e1);
+    subtract(u[2], u[0], e2);
+    cross(e1, e2, n2);
+
+    const double length1 = std::sqrt(dot(n1, n1));
+    const double length2 = std::sqrt(dot(n2, n2));
+    if (length1 == 0.0 || length2 == 0.0)
+        return false;
+
+    double scale = 0.0;
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+            scale = std::max({ scale, std::abs(v[i][axis] - v[0][axis]), std::abs(u[i][axis] - u[0][axis]) });
+    }
+
+    // Distances of u to the plane of v
+    double du[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        double offset[3];
+        subtract(u[i], v[0], offset);
+        du[i] = dot(n1, offset);
+        if (std::abs(du[i]) <= Epsilon * length1 * scale)
+            du[i] = 0.0;
+    }
+    if ((du[0] > 0.0 && du[1] > 0.0 && du[2] > 0.0) || (du[0] < 0.0 && du[1] < 0.0 && du[2] < 0.0))
+        return false;
+
+    // Distances of v to the plane of u
+    double dv[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        double offset[3];
+        subtract(v[i], u[0], offset);
+        dv[i] = dot(n2, offset);
+        if (std::abs(dv[i]) <= Epsilon * length2 * scale)
+            dv[i] = 0.0;
+    }
+    if ((dv[0] > 0.0 && dv[1] > 0.0 && dv[2] > 0.0) || (dv[0] < 0.0 && dv[1] < 0.0 && dv[2] < 0.0))
+        return false;
+
+    if ((du[0] == 0.0 && du[1] == 0.0 && du[2] == 0.0) || (dv[0] == 0.0 && dv[1] == 0.0 && dv[2] == 0.0))
+        return coplanarTrianglesIntersect(n1, v, u);
+
+    // Both triangles cross the line where the planes meet; compare the intervals they cover on it
+    double direction[3];
+    cross(n1, n2, direction);
+    int axis = 0;
+    for (int candidate = 1; candidate < 3; ++candidate)
+    {
+        if (std::abs(direction[candidate]) > std::abs(direction[axis]))
+            axis = candidate;
+    }
+
+    const double pv[3] = { v[0][axis], v[1][axis], v[2][axis] };
+    const double pu[3] = { u[0][axis], u[1][axis], u[2][axis] };
+    double intervalV[2], intervalU[2];
+    lineInterval(pv, dv, intervalV);
+    lineInterval(pu, du, intervalU);
+    return intervalV[0] <= intervalU[1] && intervalU[0] <= intervalV[1];
+}
+
+} // namespace
+
+
+/**
+ * @class MeshBvhBuilder
+ * @brief Builds the nodes of a MeshBvh over the bounding boxes of its triangles.
+ *
+ * Works on the triangles' boxes, which are partitioned in place so every pass reads
+ * memory sequentially and subtrees over disjoint ranges can be built concurrently.
+ */
+class MeshBvhBuilder
+{
+public:
+    using Node = MeshBvh::Node;
+
+    MeshBvhBuilder(std::vector<Reference>& references, unsigned threads)
+        : mReferences(references), mThreads(threads > 0 ? threads : parallelThreadCount())
+    {
+    }
+
+    /**
+     * @brief Builds the whole tree into nodes.
+     *
+     * The top of the tree is built by the calling thread with parallel binning until
+     * the ranges left are small enough to spread over the threads; these subtrees are
+     * then built in parallel into their own vectors and appended.
+     */
+    void build(std::vector<Node>& nodes)
+    {
+        const std::uint32_t count = static_cast<std::uint32_t>(mReferences.size());
+        mDeferBelow = mThreads > 1 ? std::max<std::uint32_t>(count / (8 * mThreads), 4096) : 0;
+
+        nodes.clear();
+        nodes.emplace_back();
+
+        std::vector<Task> tasks;
+        buildNode(nodes, 0, 0, count, measure(0, count, true), 0, true, mDeferBelow > 0 ? &tasks : nullptr);
+
+        std::vector<std::vector<Node>> subtrees(tasks.size());
+        parallelFor(tasks.size(), 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                subtrees[i].emplace_back();
+                buildNode(subtrees[i], 0, tasks[i].begin, tasks[i].end, tasks[i].extent, tasks[i].depth, false, nullptr);
+            }
+        }, mThreads);
+
+        // A subtree's root replaces its placeholder; the rest is appended, keeping children adjacent
+        for (std::size_t i = 0; i < tasks.size(); ++i)
+        {
+            const std::uint32_t base = static_cast<std::uint32_t>(nodes.size());
+            auto relocate = [base](Node node) {
+                if (node.count == 0)
+                    node.first = base + node.first - 1;
+                return node;
+            };
+
+            nodes[tasks[i].node] = relocate(subtrees[i][0]);
+            for (std::size_t j = 1; j < subtrees[i].size(); ++j)
+                nodes.push_back(relocate(subtrees[i][j]));
+            std::vector<Node>().swap(subtrees[i]);
+        }
+    }
+
+private:
+    /// A range left for the parallel phase, and the node it belongs to.
+    /// Bounds of the triangles of a range and of their centroids.
+    struct Extent
+    {
+        Box bounds;
+        Box centroids;
+
+        void grow(const Extent& extent)
+        {
+            bounds.grow(extent.bounds);
+            centroids.grow(extent.centroids);
+        }
+    };
+
+    struct Task
+    {
+        std::uint32_t node;
+        std::uint32_t begin;
+        std::uint32_t end;
+        std::uint32_t depth;
+        Extent extent;
+    };
+
+    struct Bin
+    {
+        Extent extent;
+        std::uint32_t count = 0;
+    };
+
+    Extent measure(std::uint32_t begin, std::uint32_t end, bool parallel) const
+    {
+        auto measureBlock = [this](std::size_t first, std::size_t last) {
+            Extent extent;
+            for (std::size_t i = first; i < last; ++i)
+            {
+                const Box& box = mReferences[i].box;
+                float c[3];
+                box.centroid(c);
+                extent.bounds.grow(box);
+                extent.centroids.grow(c);
+            }
+            return extent;
+        };
+
+        if (!parallel || end - begin <= ParallelThreshold)
+            return measureBlock(begin, end);
+
+        Extent extent;
+        std::mutex mutex;
+        parallelFor(end - begin, Grain, [&](std::size_t first, std::size_t last) {
+            const Extent block = measureBlock(begin + first, begin + last);
+            std::lock_guard<std::mutex> lock(mutex);
+            extent.grow(block);
+        }, mThreads);
+        return extent;
+    }
+
+    /**
+     * @brief Partitions a range at the cheapest of the binned split planes along its widest centroid axis.
+     *
+     * The bins also collect the extents of their triangles, so the extents of both
+     * halves come out of the sweep without another pass.
+     *
+     * @return false if the range should become a leaf.
+     */
+    bool split(std::uint32_t begin, std::uint32_t end, const Extent& extent, bool parallel,
+               std::uint32_t& middle, Extent& leftExtent, Extent& rightExtent) const
+    {
+        const Box& centroids = extent.centroids;
+        int axis = 0;
+        for (int candidate = 1; candidate < 3; ++candidate)
+        {
+            if (centroids.upper[candidate] - centroids.lower[candidate] > centroids.upper[axis] - centroids.lower[axis])
+                axis = candidate;
+        }
+
+        const float lower = centroids.lower[axis];
+        const float width = centroids.upper[axis] - lower;
+        if (!(width > 0.0f))
+            return false; // every centroid coincides
+
+        const float scale = BinCount / width;
+        auto binOf = [&](const Reference& reference) {
+            float c[3];
+            reference.box.centroid(c);
+            return std::min(BinCount - 1, static_cast<int>((c[axis] - lower) * scale));
+        };
+
+        Bin bins[BinCount];
+        auto binBlock = [&](std::size_t first, std::size_t last, Bin* out) {
+            for (std::size_t i = first; i < last; ++i)
+            {
+                const Box& box = mReferences[i].box;
+                float c[3];
+                box.centroid(c);
+
+                Bin& bin = out[binOf(mReferences[i])];
+                bin.extent.bounds.grow(box);
+                bin.extent.centroids.grow(c);
+                ++bin.count;
+            }
+        };
+
+        if (!parallel || end - begin <= ParallelThreshold)
+        {
+            binBlock(begin, end, bins);
+        }
+        else
+        {
+            std::mutex mutex;
+            parallelFor(end - begin, Grain, [&](std::size_t first, std::size_t last) {
+                Bin local[BinCount];
+                binBlock(begin + first, begin + last, local);
+                std::lock_guard<std::mutex> lock(mutex);
+                for (int i = 0; i < BinCount; ++i)
+                {
+                    bins[i].extent.grow(local[i].extent);
+                    bins[i].count += local[i].count;
+                }
+            }, mThreads);
+        }
+
+        // Sweep from the right to know the cost of everything past each plane
+        float rightCost[BinCount];
+        Box right;
+        std::uint32_t rightCount = 0;
+        for (int i = BinCount - 1; i > 0; --i)
+        {
+            right.grow(bins[i].extent.bounds);
+            rightCount += bins[i].count;
+            rightCost[i] = right.area() * static_cast<float>(rightCount);
+        }
+
+        Extent left;
+        std::uint32_t leftCount = 0;
+        float bestCost = std::numeric_limits<float>::max();
+        int bestPlane = 0;
+        for (int i = 1; i < BinCount; ++i)
+        {
+            left.grow(bins[i - 1].extent);
+            leftCount += bins[i - 1].count;
+            const float cost = left.bounds.area() * static_cast<float>(leftCount) + rightCost[i];
+            if (leftCount > 0 && leftCount < end - begin && cost < bestCost)
+            {
+                bestCost = cost;
+                bestPlane = i;
+                leftExtent = left;
+            }
+        }
+        if (bestPlane == 0)
+            return false;
+
+        // One traversal step against intersecting every triangle of the leaf
+        const std::uint32_t count = end - begin;
+        const float area = extent.bounds.area();
+        if (count <= MaxLeafSize && (area <= 0.0f || 1.0f + bestCost / area >= static_cast<float>(count)))
+            return false;
+
+        auto it = std::partition(mReferences.begin() + begin, mReferences.begin() + end,
+                                 [&](const Reference& reference) { return binOf(reference) < bestPlane; });
+        middle = static_cast<std::uint32_t>(it - mReferences.begin());
+        for (int i = bestPlane; i < BinCount; ++i)
+            rightExtent.grow(bins[i].extent);
+        return middle > begin && middle < end;
+    }
+
+    void buildNode(std::vector<Node>& nodes, std::uint32_t index, std::uint32_t begin, std::uint32_t end,
+                   const Extent& extent, std::uint32_t depth, bool parallel, std::vector<Task>* deferred) const
+    {
+        std::copy(extent.bounds.lower, extent.bounds.lower + 3, nodes[index].lower);
+        std::copy(extent.bounds.upper, extent.bounds.upper + 3, nodes[index].upper);
+
+        if (deferred && end - begin <= mDeferBelow)
+        {
+            deferred->push_back({ index, begin, end, depth, extent });
+            return;
+        }
+
+        std::uint32_t middle = begin;
+        Extent leftExtent;
+        Extent rightExtent;
+        if (end - begin <= MinLeafSize || depth >= MaxDepth || !split(begin, end, extent, parallel, middle, leftExtent, rightExtent))
+        {
+            nodes[index].first = begin;
+            nodes[index].count = end - begin;
+            return;
+        }
+
+        const std::uint32_t children = static_cast<std::uint32_t>(nodes.size());
+        nodes.emplace_back();
+        nodes.emplace_back();
+        nodes[index].first = children;
+        nodes[index].count = 0;
+
+        buildNode(nodes, children, begin, middle, leftExtent, depth + 1, parallel, deferred);
+        buildNode(nodes, children + 1, middle, end, rightExtent, depth + 1, parallel, deferred);
+    }
+
+    std::vector<Reference>& mReferences;
+    const unsigned mThreads;
+    std::uint32_t mDeferBelow = 0;
+};
+
+
+/**
+ * @brief Builds the hierarchy of a mesh.
+ *
+ * Triangles are counted per cell, turned into offsets by a prefix sum and gathered in
+ * parallel. Cell ids follow vtkPolyData's numbering, which puts vertices and lines
+ * before polygons and strips.
+ *
+ * @param mesh The mesh; only read.
+ * @param threads Worker threads; 0 uses every core.
+ * @return std::shared_ptr<const MeshBvh> The hierarchy, or null if the mesh is too large to index.
+ */
+std::shared_ptr<const MeshBvh> MeshBvh::build(vtkPolyData* mesh, unsigned threads)
+{
+    TRACE_SCOPE("MeshBvh::build", "picking");
+
+    auto bvh = std::make_shared<MeshBvh>();
+    if (!mesh || !mesh->GetPoints())
+        return bvh;
+
+    const std::size_t pointCount = static_cast<std::size_t>(mesh->GetNumberOfPoints());
+    vtkCellArray* polys = mesh->GetPolys();
+    vtkCellArray* strips = mesh->GetStrips();
+    const std::size_t polyCount = polys ? static_cast<std::size_t>(polys->GetNumberOfCells()) : 0;
+    const std::size_t stripCount = strips ? static_cast<std::size_t>(strips->GetNumberOfCells()) : 0;
+    const vtkIdType firstPolyId = mesh->GetNumberOfVerts() + mesh->GetNumberOfLines();
+    const vtkIdType firstStripId = firstPolyId + static_cast<vtkIdType>(polyCount);
+
+    constexpr std::size_t IndexLimit = std::numeric_limits<std::uint32_t>::max();
+    if (pointCount > IndexLimit || static_cast<std::size_t>(firstStripId) + stripCount > IndexLimit)
+        return nullptr;
+
+    // Triangles of every polygon and strip, then where each cell's triangles start
+    const std::size_t cellCount = polyCount + stripCount;
+    std::vector<std::size_t> firstTriangle(cellCount + 1, 0);
+    parallelFor(cellCount, Grain, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t cell = begin; cell < end; ++cell)
+        {
+            const vtkIdType size = cell < polyCount ? polys->GetCellSize(static_cast<vtkIdType>(cell))
+                                                    : strips->GetCellSize(static_cast<vtkIdType>(cell - polyCount));
+            firstTriangle[cell + 1] = size >= 3 ? static_cast<std::size_t>(size - 2) : 0;
+        }
+    }, threads);
+    for (std::size_t cell = 0; cell < cellCount; ++cell)
+        firstTriangle[cell + 1] += firstTriangle[cell];
+
+    const std::size_t triangleCount = firstTriangle[cellCount];
+    if (triangleCount > IndexLimit)
+        return nullptr;
+
+    bvh->mPoints.resize(3 * pointCount);
+    vtkDataArray* points = mesh->GetPoints()->GetData();
+    parallelFor(pointCount, Grain, [&](std::size_t begin, std::size_t end) {
+        double p[3];
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            points->GetTuple(static_cast<vtkIdType>(i), p);
+            bvh->mPoints[3 * i] = static_cast<float>(p[0]);
+            bvh->mPoints[3 * i + 1] = static_cast<float>(p[1]);
+            bvh->mPoints[3 * i + 2] = static_cast<float>(p[2]);
+        }
+    }, threads);
+
+    // Polygons become fans, strips keep their alternating orientation
+    std::vector<Triangle> triangles(triangleCount);
+    std::vector<Reference> references(triangleCount);
+    parallelFor(cellCount, Grain, [&](std::size_t begin, std::size_t end) {
+        vtkNew<vtkIdList> ids;
+        for (std::size_t cell = begin; cell < end; ++cell)
+        {
+            const bool strip = cell >= polyCount;
+            if (strip)
+                strips->GetCellAtId(static_cast<vtkIdType>(cell - polyCount), ids);
+            else
+                polys->GetCellAtId(static_cast<vtkIdType>(cell), ids);
+
+            const vtkIdType* pts = ids->GetPointer(0);
+            const std::uint32_t cellId = static_cast<std::uint32_t>(
+                strip ? firstStripId + static_cast<vtkIdType>(cell - polyCount) : firstPolyId + static_cast<vtkIdType>(cell));
+
+            std::size_t out = firstTriangle[cell];
+            for (vtkIdType t = 0; t + 2 < ids->GetNumberOfIds(); ++t, ++out)
+            {
+                Triangle& triangle = triangles[out];
+                if (strip)
+                {
+                    const bool odd = t % 2 == 1;
+                    triangle.points[0] = static_cast<std::uint32_t>(pts[odd ? t + 1 : t]);
+                    triangle.points[1] = static_cast<std::uint32_t>(pts[odd ? t : t + 1]);
+                    triangle.points[2] = static_cast<std::uint32_t>(pts[t + 2]);
+                }
+                else
+                {
+                    triangle.points[0] = static_cast<std::uint32_t>(pts[0]);
+                    triangle.points[1] = static_cast<std::uint32_t>(pts[t + 1]);
+                    triangle.points[2] = static_cast<std::uint32_t>(pts[t + 2]);
+                }
+                triangle.cell = cellId;
+
+                references[out].triangle = static_cast<std::uint32_t>(out);
+                for (std::uint32_t point : triangle.points)
+                    references[out].box.grow(&bvh->mPoints[3 * static_cast<std::size_t>(point)]);
+            }
+        }
+    }, threads);
+
+    if (triangleCount == 0)
+        return bvh;
+
+    MeshBvhBuilder(references, threads).build(bvh->mNodes);
+
+    // Store triangles in leaf order so leaves read contiguous memory
+    bvh->mTriangles.resize(triangleCount);
+    parallelFor(triangleCount, Grain, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            bvh->mTriangles[i] = triangles[references[i].triangle];
+    }, threads);
+
+    return bvh;
+}
+
+
+/**
+ * @brief Finds the closest triangle the ray hits before tMax.
+ *
+ * Boxes are tested in single precision, the nearer child first; triangles are
+ * intersected in double precision with the Moller-Trumbore test.
+ */
+bool MeshBvh::intersect(const double origin[3], const double direction[3], double tMax, Hit& hit) const
+{
+    if (mNodes.empty())
+        return false;
+
+    const float originF[3] = { static_cast<float>(origin[0]), static_cast<float>(origin[1]), static_cast<float>(origin[2]) };
+    const float inverse[3] = { 1.0f / static_cast<float>(direction[0]), 1.0f / static_cast<float>(direction[1]),
+                               1.0f / static_cast<float>(direction[2]) };
+
+    double best = tMax;
+    bool found = false;
+    auto limit = [&]() { return std::min(static_cast<float>(best), std::numeric_limits<float>::max()); };
+
+    if (enterBox(mNodes[0], originF, inverse, limit()) < 0.0f)
+        return false;
+
+    struct Entry
+    {
+        std::uint32_t node;
+        float t;
+    };
+    Entry stack[2 * MaxDepth + 2];
+    int top = 0;
+    stack[top++] = { 0, 0.0f };
+
+    while (top > 0)
+    {
+        const Entry entry = stack[--top];
+        if (entry.t > best)
+            continue;
+
+        const Node& node = mNodes[entry.node];
+        if (node.count > 0)
+        {
+            for (std::uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                const Triangle& triangle = mTriangles[i];
+                const float* a = &mPoints[3 * static_cast<std::size_t>(triangle.points[0])];
+                const float* b = &mPoints[3 * static_cast<std::size_t>(triangle.points[1])];
+                const float* c = &mPoints[3 * static_cast<std::size_t>(triangle.points[2])];
+
+                const double e1[3] = { double(b[0]) - a[0], double(b[1]) - a[1], double(b[2]) - a[2] };
+                const double e2[3] = { double(c[0]) - a[0], double(c[1]) - a[1], double(c[2]) - a[2] };
+                const double p[3] = { direction[1] * e2[2] - direction[2] * e2[1],
+                                      direction[2] * e2[0] - direction[0] * e2[2],
+                                      direction[0] * e2[1] - direction[1] * e2[0] };
+                const double det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+                if (det == 0.0)
+                    continue;
+
+                const double inverseDet = 1.0 / det;
+                const double s[3] = { origin[0] - a[0], origin[1] - a[1], origin[2] - a[2] };
+                const double u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverseDet;
+                if (u < 0.0 || u > 1.0)
+                    continue;
+
+                const double q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+                const double v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * inverseDet;
+                if (v < 0.0 || u + v > 1.0)
+                    continue;
+
+                const double t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inverseDet;
+                if (t < 0.0 || t >= best)
+                    continue;
+
+                best = t;
+                found = true;
+                hit.cell = triangle.cell;
+                hit.t = t;
+                hit.u = u;
+                hit.v = v;
+            }
+            continue;
+        }
+
+        const float tLeft = enterBox(mNodes[node.first], originF, inverse, limit());
+        const float tRight = enterBox(mNodes[node.first + 1], originF, inverse, limit());
+        const bool leftFirst = tLeft <= tRight;
+        const Entry nearer = { leftFirst ? node.first : node.first + 1, leftFirst ? tLeft : tRight };
+        const Entry farther = { leftFirst ? node.first + 1 : node.first, leftFirst ? tRight : tLeft };
+
+        if (farther.t >= 0.0f)
+            stack[top++] = farther;
+        if (nearer.t >= 0.0f)
+            stack[top++] = nearer;
+    }
+
+    return found;
+}
+
+
+/**
+ * @brief Returns true if a triangle of another hierarchy, moved by a matrix, intersects or touches one of this.
+ *
+ * Node pairs are traversed depth first, splitting the larger node of each pair. The
+ * other hierarchy's boxes are moved into this model space as the box around the moved
+ * box, so only its triangles' points are transformed exactly, in double precision.
+ */
+bool MeshBvh::intersects(const MeshBvh& other, const double otherToThis[16]) const
+{
+    if (mNodes.empty() || other.mNodes.empty())
+        return false;
+
+    const double* m = otherToThis;
+    auto transform = [m](const float p[3], double out[3]) {
+        for (int axis = 0; axis < 3; ++axis)
+            out[axis] = m[4 * axis] * p[0] + m[4 * axis + 1] * p[1] + m[4 * axis + 2] * p[2] + m[4 * axis + 3];
+    };
+
+    // Box of a moved node from its moved center and the absolute matrix applied to its half extent
+    struct Bounds
+    {
+        double lower[3];
+        double upper[3];
+    };
+    auto moveNode = [m](const Node& node, Bounds& bounds) {
+        double center[3], half[3];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            center[axis] = 0.5 * (double(node.lower[axis]) + node.upper[axis]);
+            half[axis] = 0.5 * (double(node.upper[axis]) - node.lower[axis]);
+        }
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const double* row = m + 4 * axis;
+            const double c = row[0] * center[0] + row[1] * center[1] + row[2] * center[2] + row[3];
+            const double h = std::abs(row[0]) * half[0] + std::abs(row[1]) * half[1] + std::abs(row[2]) * half[2];
+            const double pad = Epsilon * (std::abs(c) + h);
+            bounds.lower[axis] = c - h - pad;
+            bounds.upper[axis] = c + h + pad;
+        }
+    };
+    auto overlaps = [](const Node& node, const Bounds& bounds) {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (bounds.upper[axis] < node.lower[axis] || node.upper[axis] < bounds.lower[axis])
+                return false;
+        }
+        return true;
+    };
+    auto area = [](const double lower[3], const double upper[3]) {
+        const double x = upper[0] - lower[0];
+        const double y = upper[1] - lower[1];
+        const double z = upper[2] - lower[2];
+        return x * y + y * z + z * x;
+    };
+
+    struct Pair
+    {
+        std::uint32_t node;
+        std::uint32_t otherNode;
+    };
+    std::vector<Pair> stack;
+    stack.reserve(4 * MaxDepth);
+
+    Bounds bounds;
+    moveNode(other.mNodes[0], bounds);
+    if (overlaps(mNodes[0], bounds))
+        stack.push_back({ 0, 0 });
+
+    std::vector<double> moved;
+    while (!stack.empty())
+    {
+        const Pair pair = stack.back();
+        stack.pop_back();
+        const Node& node = mNodes[pair.node];
+        const Node& otherNode = other.mNodes[pair.otherNode];
+
+        if (node.count > 0 && otherNode.count > 0)
+        {
+            // Move the other leaf's triangles once and test them against every triangle of this leaf
+            moved.resize(9 * static_cast<std::size_t>(otherNode.count));
+            for (std::uint32_t j = 0; j < otherNode.count; ++j)
+            {
+                const Triangle& triangle = other.mTriangles[otherNode.first + j];
+                for (int k = 0; k < 3; ++k)
+                    transform(&other.mPoints[3 * static_cast<std::size_t>(triangle.points[k])], &moved[9 * j + 3 * k]);
+            }
+
+            for (std::uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                const Triangle& triangle = mTriangles[i];
+                double points[9];
+                for (int k = 0; k < 3; ++k)
+                {
+                    const float* p = &mPoints[3 * static_cast<std::size_t>(triangle.points[k])];
+                    points[3 * k] = p[0];
+                    points[3 * k + 1] = p[1];
+                    points[3 * k + 2] = p[2];
+                }
+                const double* v[3] = { points, points + 3, points + 6 };
+
+                for (std::uint32_t j = 0; j < otherNode.count; ++j)
+                {
+                    const double* u[3] = { &moved[9 * j], &moved[9 * j + 3], &moved[9 * j + 6] };
+                    if (trianglesIntersect(v, u))
+                        return true;
+                }
+            }
+            continue;
+        }
+
+        // Split the other node when this one is a leaf or the other is the larger
+        moveNode(otherNode, bounds);
+        const double lower[3] = { node.lower[0], node.lower[1], node.lower[2] };
+        const double upper[3] = { node.upper[0], node.upper[1], node.upper[2] };
+        const bool splitOther = otherNode.count == 0 &&
+                                (node.count > 0 || area(bounds.lower, bounds.upper) > area(lower, upper));
+
+        if (splitOther)
+        {
+            for (std::uint32_t child = otherNode.first; child < otherNode.first + 2; ++child)
+            {
+                moveNode(other.mNodes[child], bounds);
+                if (overlaps(node, bounds))
+                    stack.push_back({ pair.node, child });
+            }
+        }
+        else
+        {
+            for (std::uint32_t child = node.first; child < node.first + 2; ++child)
+            {
+                if (overlaps(mNodes[child], bounds))
+                    stack.push_back({ child, pair.otherNode });
+            }
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief Returns the memory held by the nodes, triangles and points.
+ */
+std::size_t MeshBvh::memoryBytes() const
+{
+    return mNodes.capacity() * sizeof(Node) + mTriangles.capacity() * sizeof(Triangle) + mPoints.capacity() * sizeof(float);
+}
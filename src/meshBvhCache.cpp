@@ -0,0 +1,73 @@
+/**
+ * @file meshBvhCache.cpp
+ * @brief Implementation of the MeshBvhCache class.
+ */
+
+#include "meshBvhCache.h"
+
+#include <unordered_set>
+
+
+/**
+ * @brief Returns the hierarchy of a mesh, building it if the mesh is new or was modified.
+ *
+ * The weak pointer tells a live mesh from a destroyed one whose address was reused.
+ *
+ * @param mesh The mesh; may be null.
+ * @return std::shared_ptr<const MeshBvh> The hierarchy, or null.
+ */
+std::shared_ptr<const MeshBvh> MeshBvhCache::get(vtkPolyData* mesh)
+{
+    if (!mesh)
+        return nullptr;
+
+    Entry& entry = mEntries[mesh];
+    if (entry.mesh != mesh || entry.modified != mesh->GetMTime())
+    {
+        entry.mesh = mesh;
+        entry.modified = mesh->GetMTime();
+        entry.bvh = MeshBvh::build(mesh);
+        ++mBuilds;
+    }
+    return entry.bvh;
+}
+
+
+/**
+ * @brief Drops the hierarchies of meshes that were destroyed or that no object of the scene uses.
+ *
+ * @param scene The scene whose meshes are kept.
+ */
+void MeshBvhCache::prune(const Scene& scene)
+{
+    std::unordered_set<vtkPolyData*> used;
+    for (ObjectId id : scene.objects())
+        used.insert(scene.mesh(id));
+
+    for (auto it = mEntries.begin(); it != mEntries.end();)
+    {
+        if (!it->second.mesh || !used.count(it->first))
+            it = mEntries.erase(it);
+        else
+            ++it;
+    }
+}
+
+
+/**
+ * @brief Returns a snapshot of the counters.
+ */
+MeshBvhCache::Statistics MeshBvhCache::statistics() const
+{
+    Statistics statistics;
+    for (const auto& entry : mEntries)
+    {
+        if (!entry.second.bvh)
+            continue;
+        ++statistics.meshes;
+        statistics.triangles += entry.second.bvh->triangleCount();
+        statistics.bytes += entry.second.bvh->memoryBytes();
+    }
+    statistics.builds = mBuilds;
+    return statistics;
+}
@@ -0,0 +1,696 @@
+/**
+ * @file meshFile.cpp
+ * @brief Implementation of the MeshFile class.
+ */
+
+#include "meshFile.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+
+namespace
+{
+
+constexpr std::size_t ItemsPerBlock = 1 << 16;
+
+/// Alignment of every section, so each can be mapped and used in place.
+constexpr std::size_t PageSize = 4096;
+
+constexpr char Magic[8] = { 'Q', 'V', 'T', 'K', 'M', 'E', 'S', 'H' };
+constexpr std::uint32_t Version = 2;
+
+/// Written as is; reads as something else on a machine of the other byte order.
+constexpr std::uint32_t ByteOrderMark = 0x01020304u;
+
+/// Number and size of the content blocks hashed into a source key, besides the last block.
+constexpr int SampleBlocks = 16;
+constexpr std::size_t SampleBytes = 1 << 16;
+
+/// Largest quantized coordinate.
+constexpr double QuantizedMax = 65535.0;
+
+/// Bits of Header::flags.
+constexpr std::uint32_t QuantizedPositions = 1;
+constexpr std::uint32_t HasNormals = 2;
+constexpr std::uint32_t PolyIds64 = 4;
+constexpr std::uint32_t StripIds64 = 8;
+
+/// Cell arrays stored, each as an offsets and a connectivity section.
+enum CellKind
+{
+    Polys,
+    Strips,
+    CellKindCount
+};
+
+enum SectionKind
+{
+    Positions,
+    Normals,
+    PolyOffsets,
+    PolyConnectivity,
+    StripOffsets,
+    StripConnectivity,
+    SectionCount
+};
+
+/**
+ * @brief Place of one section in the file.
+ */
+struct Section
+{
+    std::uint64_t offset;
+    std::uint64_t bytes;
+};
+
+/**
+ * @brief Start of every mesh file; the sections follow at multiples of PageSize.
+ */
+struct Header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint32_t flags;
+    std::uint32_t sourceVariant;
+    std::uint64_t points;
+    std::uint64_t cells[CellKindCount];
+    std::uint64_t connectivity[CellKindCount];
+    double bounds[6];
+    std::uint64_t sourceSize;
+    std::int64_t sourceModified;
+    std::uint64_t sourceHash;
+    Section sections[SectionCount];
+};
+
+static_assert(std::is_trivially_copyable<Header>::value, "The header is written and read as raw bytes");
+
+/**
+ * @brief Rounds a file offset up to the next page.
+ */
+std::uint64_t alignToPage(std::uint64_t offset)
+{
+    return (offset + PageSize - 1) / PageSize * PageSize;
+}
+
+/**
+ * @brief A file mapped copy-on-write, unmapped when destroyed.
+ *
+ * Writes through the mapping stay private to the process, so VTK filters that modify
+ * arrays in place do not touch the file.
+ */
+class Mapping
+{
+public:
+    explicit Mapping(const QString& path) : mFile(path) {}
+
+    ~Mapping()
+    {
+        if (mData)
+            mFile.unmap(mData);
+    }
+
+    /**
+     * @brief Opens and maps the file; returns false and sets error on failure.
+     */
+    bool open(QString& error)
+    {
+        if (!mFile.open(QIODevice::ReadOnly))
+        {
+            error = mFile.errorString();
+            return false;
+        }
+
+        mSize = static_cast<std::size_t>(mFile.size());
+        if (mSize < sizeof(Header))
+        {
+            error = "The file is not a mesh file.";
+            return false;
+        }
+
+        mData = mFile.map(0, mFile.size(), QFileDevice::MapPrivateOption);
+        if (!mData)
+        {
+            error = mFile.errorString();
+            return false;
+        }
+        return true;
+    }
+
+    uchar* data() const { return mData; }
+    std::size_t size() const { return mSize; }
+
+private:
+    QFile mFile;
+    uchar* mData = nullptr;
+    std::size_t mSize = 0;
+};
+
+/**
+ * @brief The mappings in use, by the address of each array pointing into one.
+ */
+struct Mappings
+{
+    std::mutex mutex;
+    std::unordered_map<void*, std::shared_ptr<Mapping>> users;
+};
+
+Mappings& mappings()
+{
+    static Mappings instance;
+    return instance;
+}
+
+/**
+ * @brief Free function of arrays pointing into a mapping: drops their reference, unmapping it after the last one.
+ */
+void releaseMapping(void* data)
+{
+    std::shared_ptr<Mapping> released;
+    Mappings& all = mappings();
+    {
+        std::lock_guard<std::mutex> lock(all.mutex);
+        const auto it = all.users.find(data);
+        if (it == all.users.end())
+            return;
+        released = std::move(it->second);
+        all.users.erase(it);
+    }
+}
+
+/**
+ * @brief Returns an array using a section of the mapping in place, keeping the mapping alive while it exists.
+ */
+template <typename Array>
+vtkSmartPointer<Array> mappedArray(const std::shared_ptr<Mapping>& mapping, const Section& section, int components)
+{
+    vtkSmartPointer<Array> array = vtkSmartPointer<Array>::New();
+    array->SetNumberOfComponents(components);
+    if (section.bytes == 0)
+        return array;
+
+    // Empty sections may start where the next one does, so only non-empty ones are registered
+    using Value = typename Array::ValueType;
+    Value* data = reinterpret_cast<Value*>(mapping->data() + section.offset);
+    {
+        Mappings& all = mappings();
+        std::lock_guard<std::mutex> lock(all.mutex);
+        all.users[data] = mapping;
+    }
+
+    array->SetArray(data, static_cast<vtkIdType>(section.bytes / sizeof(Value)), 0, Array::VTK_DATA_ARRAY_USER_DEFINED);
+    array->SetArrayFreeFunction(releaseMapping);
+    return array;
+}
+
+/**
+ * @brief Returns three floats per point, pointing into the array if it already stores float32.
+ */
+const float* floatTuples(vtkDataArray* array, std::size_t tuples, std::vector<float>& converted, unsigned threads)
+{
+    if (vtkFloatArray* floats = vtkFloatArray::SafeDownCast(array))
+    {
+        if (floats->GetNumberOfComponents() == 3)
+            return floats->GetPointer(0);
+    }
+
+    converted.resize(3 * tuples);
+    parallelFor(3 * tuples, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            converted[i] = static_cast<float>(array->GetComponent(static_cast<vtkIdType>(i / 3), static_cast<int>(i % 3)));
+    }, threads);
+    return converted.data();
+}
+
+/**
+ * @brief Returns the first offset of a cell array's storage.
+ */
+const void* offsetsData(vtkCellArray* cells)
+{
+    if (cells->IsStorage64Bit())
+        return cells->GetOffsetsArray64()->GetPointer(0);
+    return cells->GetOffsetsArray32()->GetPointer(0);
+}
+
+
+/**
+ * @brief Returns the first id of a cell array's connectivity.
+ */
+const void* connectivityData(vtkCellArray* cells)
+{
+    if (cells->IsStorage64Bit())
+        return cells->GetConnectivityArray64()->GetPointer(0);
+    return cells->GetConnectivityArray32()->GetPointer(0);
+}
+
+
+/**
+ * @brief Multiplies two sizes read from a file; returns false if the product overflows.
+ */
+bool multiply(std::uint64_t a, std::uint64_t b, std::uint64_t& product)
+{
+    if (a != 0 && b > std::numeric_limits<std::uint64_t>::max() / a)
+        return false;
+    product = a * b;
+    return true;
+}
+
+
+/**
+ * @brief Checks that offsets rise from 0 to the id count and that every id refers to a point.
+ *
+ * Both checks run in blocks on all cores; the ids are checked by a maximum over their
+ * unsigned values, so negative ids count as too large.
+ */
+template <typename Index>
+bool validCells(const Index* offsets, const Index* ids, std::uint64_t cells, std::uint64_t idCount, std::uint64_t points, unsigned threads)
+{
+    if (offsets[0] != 0 || static_cast<std::uint64_t>(offsets[cells]) != idCount)
+        return false;
+
+    std::atomic<bool> ordered{ true };
+    parallelFor(static_cast<std::size_t>(cells), ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            if (offsets[i] > offsets[i + 1])
+            {
+                ordered = false;
+                return;
+            }
+        }
+    }, threads);
+
+    using Unsigned = typename std::make_unsigned<Index>::type;
+    std::atomic<std::uint64_t> largest{ 0 };
+    parallelFor(static_cast<std::size_t>(idCount), ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        Unsigned blockLargest = 0;
+        for (std::size_t i = begin; i < end; ++i)
+            blockLargest = std::max(blockLargest, static_cast<Unsigned>(ids[i]));
+
+        std::uint64_t current = largest.load();
+        while (blockLargest > current && !largest.compare_exchange_weak(current, blockLargest))
+        {
+        }
+    }, threads);
+
+    return ordered && (idCount == 0 || largest.load() < points);
+}
+
+
+/**
+ * @brief Returns a cell array using the offsets and connectivity sections of the mapping in place.
+ *
+ * The offsets must rise from 0 to the id count and every id must refer to one of the
+ * points, so VTK never reads outside the mapped arrays.
+ *
+ * @return vtkSmartPointer<vtkCellArray> The cells, or null if the sections are damaged.
+ */
+vtkSmartPointer<vtkCellArray> mappedCells(const std::shared_ptr<Mapping>& mapping, const Section& offsets, const Section& connectivity,
+                                          std::uint64_t cells, std::uint64_t ids, bool ids64, std::uint64_t points, unsigned threads)
+{
+    const uchar* offsetData = mapping->data() + offsets.offset;
+    const uchar* idData = mapping->data() + connectivity.offset;
+    const bool valid = ids64
+        ? validCells(reinterpret_cast<const std::int64_t*>(offsetData), reinterpret_cast<const std::int64_t*>(idData), cells, ids, points, threads)
+        : validCells(reinterpret_cast<const std::int32_t*>(offsetData), reinterpret_cast<const std::int32_t*>(idData), cells, ids, points, threads);
+    if (!valid)
+        return nullptr;
+
+    vtkSmartPointer<vtkCellArray> result = vtkSmartPointer<vtkCellArray>::New();
+    if (ids64)
+        result->SetData(mappedArray<vtkTypeInt64Array>(mapping, offsets, 1), mappedArray<vtkTypeInt64Array>(mapping, connectivity, 1));
+    else
+        result->SetData(mappedArray<vtkTypeInt32Array>(mapping, offsets, 1), mappedArray<vtkTypeInt32Array>(mapping, connectivity, 1));
+    return result;
+}
+
+
+/**
+ * @brief Returns a 64-bit FNV-1a hash of some bytes, continuing from hash.
+ */
+std::uint64_t hashBytes(const char* data, std::size_t size, std::uint64_t hash)
+{
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+} // namespace
+
+
+/**
+ * @brief Writes the polygons, triangle strips, points and point normals of a mesh.
+ *
+ * The header and each section are written with one call each at their page-aligned
+ * offsets; only quantized positions and arrays stored otherwise than as float32 are
+ * converted first, in parallel.
+ *
+ * @param path Path of the file; an existing file is replaced.
+ * @param mesh The mesh; it is only read.
+ * @param options Quantization, source key and threading settings.
+ * @return Result Statistics of the write, or an error message.
+ */
+MeshFile::Result MeshFile::write(const QString& path, vtkPolyData* mesh, const WriteOptions& options)
+{
+    TRACE_SCOPE("MeshFile::write", "io");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    Result result;
+    if (!mesh || !mesh->GetPoints() || mesh->GetNumberOfPolys() + mesh->GetNumberOfStrips() == 0)
+    {
+        result.error = "The mesh has no surface to write.";
+        return result;
+    }
+    if (mesh->GetNumberOfLines() + mesh->GetNumberOfVerts() > 0)
+    {
+        result.error = "Only meshes of polygons and triangle strips can be written.";
+        return result;
+    }
+
+    const unsigned threads = options.threads;
+    const std::size_t points = static_cast<std::size_t>(mesh->GetNumberOfPoints());
+    vtkCellArray* const cells[CellKindCount] = { mesh->GetPolys(), mesh->GetStrips() };
+    std::uint64_t idBytes[CellKindCount];
+    for (int kind = 0; kind < CellKindCount; ++kind)
+        idBytes[kind] = cells[kind]->IsStorage64Bit() ? sizeof(std::int64_t) : sizeof(std::int32_t);
+    vtkDataArray* normals = mesh->GetPointData()->GetNormals();
+    if (normals && (normals->GetNumberOfTuples() != mesh->GetNumberOfPoints() || normals->GetNumberOfComponents() != 3))
+        normals = nullptr;
+
+    Header header = {};
+    std::memcpy(header.magic, Magic, sizeof Magic);
+    header.version = Version;
+    header.byteOrder = ByteOrderMark;
+    header.flags = (options.quantizePositions ? QuantizedPositions : 0u) | (normals ? HasNormals : 0u)
+        | (cells[Polys]->IsStorage64Bit() ? PolyIds64 : 0u) | (cells[Strips]->IsStorage64Bit() ? StripIds64 : 0u);
+    header.sourceVariant = options.source.variant;
+    header.points = points;
+    for (int kind = 0; kind < CellKindCount; ++kind)
+    {
+        header.cells[kind] = static_cast<std::uint64_t>(cells[kind]->GetNumberOfCells());
+        header.connectivity[kind] = static_cast<std::uint64_t>(cells[kind]->GetNumberOfConnectivityIds());
+    }
+    mesh->GetBounds(header.bounds);
+    header.sourceSize = options.source.size;
+    header.sourceModified = options.source.modified;
+    header.sourceHash = options.source.hash;
+
+    const std::uint64_t sectionBytes[SectionCount] = {
+        (options.quantizePositions ? 3 * sizeof(std::uint16_t) : 3 * sizeof(float)) * points,
+        normals ? 3 * sizeof(float) * points : 0,
+        idBytes[Polys] * (header.cells[Polys] + 1),
+        idBytes[Polys] * header.connectivity[Polys],
+        idBytes[Strips] * (header.cells[Strips] + 1),
+        idBytes[Strips] * header.connectivity[Strips] };
+    std::uint64_t offset = alignToPage(sizeof(Header));
+    for (int section = 0; section < SectionCount; ++section)
+    {
+        header.sections[section] = { offset, sectionBytes[section] };
+        offset = alignToPage(offset + sectionBytes[section]);
+    }
+
+    // Positions as stored, or quantized to 16 bits per axis of the bounds
+    std::vector<float> convertedPoints;
+    const float* xyz = floatTuples(mesh->GetPoints()->GetData(), points, convertedPoints, threads);
+    std::vector<std::uint16_t> quantized;
+    const void* positionData = xyz;
+    if (options.quantizePositions)
+    {
+        double scale[3];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const double extent = header.bounds[2 * axis + 1] - header.bounds[2 * axis];
+            scale[axis] = extent > 0.0 ? QuantizedMax / extent : 0.0;
+        }
+
+        quantized.resize(3 * points);
+        parallelFor(3 * points, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const int axis = static_cast<int>(i % 3);
+                const double q = std::round((xyz[i] - header.bounds[2 * axis]) * scale[axis]);
+                quantized[i] = static_cast<std::uint16_t>(std::clamp(q, 0.0, QuantizedMax));
+            }
+        }, threads);
+        positionData = quantized.data();
+    }
+
+    std::vector<float> convertedNormals;
+    const float* normalData = normals ? floatTuples(normals, points, convertedNormals, threads) : nullptr;
+
+    const void* sectionData[SectionCount] = {
+        positionData,
+        normalData,
+        offsetsData(cells[Polys]),
+        connectivityData(cells[Polys]),
+        offsetsData(cells[Strips]),
+        connectivityData(cells[Strips]) };
+
+    // Written aside and renamed over the old file on commit, so a reader never maps a partial file
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        result.error = file.errorString();
+        return result;
+    }
+
+    bool written = file.write(reinterpret_cast<const char*>(&header), sizeof header) == static_cast<qint64>(sizeof header);
+    for (int section = 0; section < SectionCount && written; ++section)
+    {
+        const Section& place = header.sections[section];
+        if (place.bytes == 0)
+            continue;
+        written = file.seek(static_cast<qint64>(place.offset))
+            && file.write(static_cast<const char*>(sectionData[section]), static_cast<qint64>(place.bytes)) == static_cast<qint64>(place.bytes);
+    }
+    if (!written)
+    {
+        result.error = file.errorString();
+        file.cancelWriting();
+        return result;
+    }
+
+    result.bytes = static_cast<std::size_t>(file.size());
+    if (!file.commit())
+    {
+        result.error = QString("Could not replace %1: %2").arg(path, file.errorString());
+        return result;
+    }
+
+    result.source = options.source;
+    std::copy(header.bounds, header.bounds + 6, result.bounds);
+    result.quantized = options.quantizePositions;
+    result.seconds = timer.nsecsElapsed() / 1.0e9;
+    return result;
+}
+
+
+/**
+ * @brief Maps a mesh file.
+ *
+ * The header and the extent of every section are checked against the file size
+ * before any array is made, and the cell offsets and point ids are checked on all
+ * cores, so a truncated, damaged or foreign file is rejected rather than read out of
+ * bounds when it is drawn.
+ *
+ * @param path Path of the file.
+ * @param expected Key the file must have been written with; null accepts any.
+ * @param threads Worker threads checking cells and decoding quantized positions; 0 uses every core.
+ * @return Result The mesh, or an error message if the file is missing, invalid or stale.
+ */
+MeshFile::Result MeshFile::read(const QString& path, const SourceKey* expected, unsigned threads)
+{
+    TRACE_SCOPE("MeshFile::read", "io");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    Result result;
+    std::shared_ptr<Mapping> mapping = std::make_shared<Mapping>(path);
+    if (!mapping->open(result.error))
+        return result;
+
+    Header header;
+    std::memcpy(&header, mapping->data(), sizeof header);
+    if (std::memcmp(header.magic, Magic, sizeof Magic) != 0 || header.version != Version || header.byteOrder != ByteOrderMark)
+    {
+        result.error = "The file is not a mesh file of this version.";
+        return result;
+    }
+
+    result.source.size = header.sourceSize;
+    result.source.modified = header.sourceModified;
+    result.source.hash = header.sourceHash;
+    result.source.variant = header.sourceVariant;
+    if (expected && *expected != result.source)
+    {
+        result.error = "The mesh file is out of date.";
+        return result;
+    }
+
+    const bool quantized = (header.flags & QuantizedPositions) != 0;
+    const bool hasNormals = (header.flags & HasNormals) != 0;
+    const bool ids64[CellKindCount] = { (header.flags & PolyIds64) != 0, (header.flags & StripIds64) != 0 };
+    std::uint64_t idBytes[CellKindCount];
+    for (int kind = 0; kind < CellKindCount; ++kind)
+        idBytes[kind] = ids64[kind] ? sizeof(std::int64_t) : sizeof(std::int32_t);
+
+    // Counts come from the file, so the section sizes are computed with overflow checks
+    constexpr std::uint64_t MaxCount = std::numeric_limits<std::uint64_t>::max();
+    if (header.cells[Polys] == MaxCount || header.cells[Strips] == MaxCount)
+    {
+        result.error = "The mesh file is damaged.";
+        return result;
+    }
+    const std::uint64_t counts[SectionCount][2] = {
+        { quantized ? 3 * sizeof(std::uint16_t) : 3 * sizeof(float), header.points },
+        { hasNormals ? 3 * sizeof(float) : 0, header.points },
+        { idBytes[Polys], header.cells[Polys] + 1 },
+        { idBytes[Polys], header.connectivity[Polys] },
+        { idBytes[Strips], header.cells[Strips] + 1 },
+        { idBytes[Strips], header.connectivity[Strips] } };
+    for (int section = 0; section < SectionCount; ++section)
+    {
+        const Section& place = header.sections[section];
+        std::uint64_t expectedBytes = 0;
+        if (!multiply(counts[section][0], counts[section][1], expectedBytes)
+            || place.bytes != expectedBytes || place.offset % PageSize != 0
+            || (place.bytes > 0 && (place.offset > mapping->size() || place.bytes > mapping->size() - place.offset)))
+        {
+            result.error = "The mesh file is damaged.";
+            return result;
+        }
+    }
+    if (header.points == 0 || header.cells[Polys] + header.cells[Strips] == 0)
+    {
+        result.error = "The mesh file is empty.";
+        return result;
+    }
+
+    const vtkSmartPointer<vtkCellArray> polys = mappedCells(mapping, header.sections[PolyOffsets], header.sections[PolyConnectivity],
+                                                            header.cells[Polys], header.connectivity[Polys], ids64[Polys], header.points, threads);
+    const vtkSmartPointer<vtkCellArray> strips = mappedCells(mapping, header.sections[StripOffsets], header.sections[StripConnectivity],
+                                                             header.cells[Strips], header.connectivity[Strips], ids64[Strips], header.points, threads);
+    if (!polys || !strips)
+    {
+        result.error = "The mesh file is damaged.";
+        return result;
+    }
+
+    vtkSmartPointer<vtkFloatArray> coordinates;
+    if (!quantized)
+    {
+        coordinates = mappedArray<vtkFloatArray>(mapping, header.sections[Positions], 3);
+    }
+    else
+    {
+        double step[3];
+        for (int axis = 0; axis < 3; ++axis)
+            step[axis] = (header.bounds[2 * axis + 1] - header.bounds[2 * axis]) / QuantizedMax;
+
+        coordinates = vtkSmartPointer<vtkFloatArray>::New();
+        coordinates->SetNumberOfComponents(3);
+        coordinates->SetNumberOfTuples(static_cast<vtkIdType>(header.points));
+        float* xyz = coordinates->GetPointer(0);
+        const std::uint16_t* q = reinterpret_cast<const std::uint16_t*>(mapping->data() + header.sections[Positions].offset);
+        parallelFor(3 * header.points, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const int axis = static_cast<int>(i % 3);
+                xyz[i] = static_cast<float>(header.bounds[2 * axis] + q[i] * step[axis]);
+            }
+        }, threads);
+    }
+
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetData(coordinates);
+
+    result.mesh = vtkSmartPointer<vtkPolyData>::New();
+    result.mesh->SetPoints(points);
+    result.mesh->SetPolys(polys);
+    result.mesh->SetStrips(strips);
+    if (hasNormals)
+    {
+        vtkSmartPointer<vtkFloatArray> normals = mappedArray<vtkFloatArray>(mapping, header.sections[Normals], 3);
+        normals->SetName("Normals");
+        result.mesh->GetPointData()->SetNormals(normals);
+    }
+
+    std::copy(header.bounds, header.bounds + 6, result.bounds);
+    result.quantized = quantized;
+    result.bytes = mapping->size();
+    result.seconds = timer.nsecsElapsed() / 1.0e9;
+    return result;
+}
+
+
+/**
+ * @brief Returns the key of a source file, or a key of size 0 if it cannot be read.
+ *
+ * Only the size and 17 blocks of 64 KiB spread evenly over the file, the last one
+ * included, are hashed, so checking a cache costs about a megabyte of reading
+ * whatever the size of the source; together with the modification time this catches
+ * files that were replaced or edited.
+ *
+ * @param path Path of the source file.
+ * @param variant Processing the cached mesh gets, e.g. a repair.
+ * @return SourceKey The key.
+ */
+MeshFile::SourceKey MeshFile::keyOf(const QString& path, std::uint32_t variant)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return SourceKey();
+
+    SourceKey key;
+    key.size = static_cast<std::uint64_t>(file.size());
+    key.modified = QFileInfo(path).lastModified().toMSecsSinceEpoch();
+    key.variant = variant;
+
+    std::uint64_t hash = hashBytes(reinterpret_cast<const char*>(&key.size), sizeof key.size, 0xCBF29CE484222325ull);
+    std::vector<char> block(SampleBytes);
+    const std::uint64_t lastStart = key.size > SampleBytes ? key.size - SampleBytes : 0;
+    for (int sample = 0; sample <= SampleBlocks; ++sample)
+    {
+        if (!file.seek(static_cast<qint64>(lastStart * sample / SampleBlocks)))
+            return SourceKey();
+        const qint64 read = file.read(block.data(), static_cast<qint64>(block.size()));
+        if (read < 0)
+            return SourceKey();
+        hash = hashBytes(block.data(), static_cast<std::size_t>(read), hash);
+        if (lastStart == 0)
+            break;
+    }
+
+    key.hash = hash;
+    return key;
+}
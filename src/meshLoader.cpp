@@ -0,0 +1,291 @@
+/**
+ * @file meshLoader.cpp
+ * @brief Implementation of the MeshLoader class.
+ */
+
+#include "meshLoader.h"
+#include "meshFile.h"
+#include "meshNormals.h"
+#include "trace.h"
+
+#include <QElapsedTimer>
+#include <QMetaObject>
+
+
+namespace
+{
+
+/**
+ * @brief Repairs a loaded mesh if asked to, then gives it normals; a mesh that fails to repair is kept as read.
+ *
+ * @return bool False if the load was canceled meanwhile.
+ */
+bool prepareMesh(vtkSmartPointer<vtkPolyData>& mesh, bool repair, const std::atomic<bool>& cancel, MeshRepair::Result& report)
+{
+    if (repair)
+    {
+        MeshRepair::Options options;
+        options.cancel = &cancel;
+        report = MeshRepair::repair(mesh, options);
+        if (cancel)
+            return false;
+        if (report.ok())
+            mesh = report.mesh;
+    }
+
+    mesh = MeshNormals::compute(mesh);
+    return !cancel;
+}
+
+
+/**
+ * @brief Returns the key of the sidecar cache of a file loaded with or without repair.
+ */
+MeshFile::SourceKey cacheKey(const QString& path, bool repair)
+{
+    return MeshFile::keyOf(path, repair ? 1 : 0);
+}
+
+
+/**
+ * @brief Maps the sidecar cache of a file if it is current; returns a result without a mesh otherwise.
+ */
+StlReader::Result readCache(const QString& path, const MeshFile::SourceKey& key)
+{
+    StlReader::Result result;
+    if (key.size == 0)
+        return result;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    MeshFile::Result cached = MeshFile::read(MeshFile::sidecarPath(path), &key);
+    if (!cached.ok())
+        return result;
+
+    result.mesh = cached.mesh;
+    result.binary = true;
+    result.cached = true;
+    result.facets = static_cast<std::size_t>(cached.mesh->GetNumberOfPolys());
+    result.bytes = static_cast<std::size_t>(key.size);
+    result.seconds = timer.nsecsElapsed() / 1.0e9;
+    return result;
+}
+
+
+/**
+ * @brief Writes the sidecar cache of a prepared mesh; a cache that cannot be written is simply not kept.
+ *
+ * Meshes whose repair failed are not passed here, so a repaired key never names an unrepaired mesh.
+ */
+void writeCache(const QString& path, vtkPolyData* mesh, const MeshFile::SourceKey& key)
+{
+    if (key.size == 0)
+        return;
+
+    MeshFile::WriteOptions options;
+    options.source = key;
+    MeshFile::write(MeshFile::sidecarPath(path), mesh, options);
+}
+
+} // namespace
+
+
+/**
+ * @brief Constructs an idle loader.
+ *
+ * @param parent Parent QObject.
+ */
+MeshLoader::MeshLoader(QObject* parent)
+    : QObject(parent)
+{
+}
+
+
+/**
+ * @brief Cancels any running load and waits for its worker thread.
+ *
+ * Results still queued for this loader are discarded by Qt together with it.
+ */
+MeshLoader::~MeshLoader()
+{
+    if (mJob)
+        mJob->cancel = true;
+
+    if (mWorker.joinable())
+        mWorker.join();
+}
+
+
+/**
+ * @brief Starts loading a file, canceling the load in progress if there is one.
+ *
+ * The previous worker is canceled and joined first; the readers check the cancel
+ * flag per block of facets, so this only blocks for a few milliseconds.
+ *
+ * @param path Path of the STL file.
+ */
+void MeshLoader::load(const QString& path)
+{
+    cancel();
+
+    if (mWorker.joinable())
+        mWorker.join();
+
+    mJob = std::make_shared<Job>();
+    mJob->path = path;
+
+    const quint64 generation = ++mGeneration;
+    mWorker = std::thread(&MeshLoader::run, this, mJob, generation, mPreviewFacets, mPreviewBudgetMs / 1000.0, mRepair, mCache);
+}
+
+
+/**
+ * @brief Cancels the load in progress, if any, and emits canceled() for it.
+ *
+ * The worker stops at its next check of the cancel flag; anything it still
+ * delivers belongs to an old generation and is dropped.
+ */
+void MeshLoader::cancel()
+{
+    if (!mJob)
+        return;
+
+    mJob->cancel = true;
+    ++mGeneration;
+
+    const QString path = mJob->path;
+    mJob.reset();
+    emit canceled(path);
+}
+
+
+/**
+ * @brief Body of the worker thread: maps a current cache, or reads the preview, then the whole file, and repairs it if asked to.
+ *
+ * Results are posted to the loader's thread and emitted there, provided the
+ * generation is still current when they arrive. The cache is written before
+ * the result is posted, since posting it is the last thing the worker does.
+ */
+void MeshLoader::run(std::shared_ptr<Job> job, quint64 generation, std::size_t previewFacets, double previewBudgetSeconds, bool repair, bool cache)
+{
+    Trace::setThreadName("MeshLoader");
+
+    const QString path = job->path;
+
+    MeshFile::SourceKey key;
+    if (cache)
+    {
+        key = cacheKey(path, repair);
+        StlReader::Result cached = readCache(path, key);
+        if (job->cancel)
+            return;
+
+        if (cached.mesh)
+        {
+            QMetaObject::invokeMethod(this, [this, generation, path, cached]() {
+                if (generation != mGeneration)
+                    return;
+
+                finish(generation);
+                emit loaded(path, cached);
+            }, Qt::QueuedConnection);
+            return;
+        }
+    }
+
+    // Report whole percents only, so the event queue is not flooded
+    std::atomic<int> lastPercent{ -1 };
+
+    StlReader::Options options;
+    options.cancel = &job->cancel;
+    options.progress = [this, generation, &lastPercent](double fraction) {
+        const int percent = static_cast<int>(fraction * 100.0);
+        if (lastPercent.exchange(percent) == percent)
+            return;
+
+        QMetaObject::invokeMethod(this, [this, generation, fraction]() {
+            if (generation == mGeneration)
+                emit progressChanged(fraction);
+        }, Qt::QueuedConnection);
+    };
+
+    if (previewFacets > 0)
+    {
+        StlReader::Options previewOptions = options;
+        previewOptions.progress = nullptr;
+
+        StlReader::Result preview = StlReader::readPreview(path, previewFacets, previewBudgetSeconds, previewOptions);
+        if (job->cancel)
+            return;
+
+        // Small files are read completely by the preview already
+        if (!preview.mesh || !preview.sampled)
+        {
+            MeshRepair::Result report;
+            if (preview.mesh && !prepareMesh(preview.mesh, repair, job->cancel, report))
+                return;
+            if (preview.mesh && cache && report.ok())
+                writeCache(path, preview.mesh, key);
+
+            QMetaObject::invokeMethod(this, [this, generation, path, preview, repair, report]() {
+                if (generation != mGeneration)
+                    return;
+
+                finish(generation);
+                if (preview.mesh && repair)
+                    emit repaired(path, report);
+                if (preview.mesh)
+                    emit loaded(path, preview);
+                else
+                    emit failed(path, preview.error);
+            }, Qt::QueuedConnection);
+            return;
+        }
+
+        QMetaObject::invokeMethod(this, [this, generation, path, mesh = preview.mesh]() {
+            if (generation == mGeneration)
+                emit previewReady(path, mesh);
+        }, Qt::QueuedConnection);
+    }
+
+    StlReader::Result result = StlReader::read(path, options);
+    if (job->cancel)
+        return;
+
+    MeshRepair::Result report;
+    if (result.mesh && !prepareMesh(result.mesh, repair, job->cancel, report))
+        return;
+    if (result.mesh && cache && report.ok())
+        writeCache(path, result.mesh, key);
+
+    QMetaObject::invokeMethod(this, [this, generation, path, result, repair, report]() {
+        if (generation != mGeneration)
+            return;
+
+        finish(generation);
+        if (result.mesh && repair)
+            emit repaired(path, report);
+        if (result.mesh)
+            emit loaded(path, result);
+        else
+            emit failed(path, result.error);
+    }, Qt::QueuedConnection);
+}
+
+
+/**
+ * @brief Marks the load of the given generation as done and joins its worker.
+ *
+ * Called from a result posted by the worker as its last action, so the join
+ * only waits for the thread to return.
+ */
+void MeshLoader::finish(quint64 generation)
+{
+    if (generation != mGeneration)
+        return;
+
+    mJob.reset();
+    if (mWorker.joinable())
+        mWorker.join();
+}
@@ -0,0 +1,481 @@
+/**
+ * @file meshMerger.cpp
+ * @brief Implementation of the MeshMerger class.
+ */
+
+#include "meshMerger.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <QElapsedTimer>
+
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdList.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+
+
+namespace
+{
+
+/**
+ * @brief Sizes of a part in the merged mesh and where its ranges start.
+ */
+struct PartLayout
+{
+    std::size_t points = 0;
+    std::size_t cells = 0;        ///< Polygons plus the triangles of the strips.
+    std::size_t connectivity = 0;
+    std::size_t firstPoint = 0;
+    std::size_t firstCell = 0;
+    std::size_t firstConnectivity = 0;
+};
+
+PartLayout measure(vtkPolyData* mesh)
+{
+    PartLayout layout;
+    layout.points = static_cast<std::size_t>(mesh->GetNumberOfPoints());
+
+    if (vtkCellArray* polys = mesh->GetPolys())
+    {
+        layout.cells += static_cast<std::size_t>(polys->GetNumberOfCells());
+        layout.connectivity += static_cast<std::size_t>(polys->GetNumberOfConnectivityIds());
+    }
+    if (vtkCellArray* strips = mesh->GetStrips())
+    {
+        for (vtkIdType strip = 0; strip < strips->GetNumberOfCells(); ++strip)
+        {
+            const vtkIdType size = strips->GetCellSize(strip);
+            if (size >= 3)
+            {
+                layout.cells += static_cast<std::size_t>(size - 2);
+                layout.connectivity += static_cast<std::size_t>(3 * (size - 2));
+            }
+        }
+    }
+    return layout;
+}
+
+/**
+ * @brief Computes the bounds of a mesh's points by reading them only.
+ *
+ * vtkPolyData::GetBounds() caches its result in the data object, which races when
+ * meshes shared through the ShapeCache are measured by concurrent jobs.
+ */
+void pointBounds(vtkPolyData* mesh, double bounds[6])
+{
+    vtkPoints* points = mesh->GetPoints();
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        bounds[2 * axis] = std::numeric_limits<double>::max();
+        bounds[2 * axis + 1] = std::numeric_limits<double>::lowest();
+    }
+    for (vtkIdType i = 0; i < points->GetNumberOfPoints(); ++i)
+    {
+        double p[3];
+        points->GetPoint(i, p);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            bounds[2 * axis] = std::min(bounds[2 * axis], p[axis]);
+            bounds[2 * axis + 1] = std::max(bounds[2 * axis + 1], p[axis]);
+        }
+    }
+}
+
+/**
+ * @brief Transforms the points and normals of a part into the merged arrays.
+ */
+void copyPoints(const MeshMerger::Part& part, const PartLayout& layout, float* points, float* normals)
+{
+    const double* m = part.matrix.data();
+
+    // Normals transform with the inverse transpose of the upper 3x3 block
+    double linear[3][3] = { { m[0], m[1], m[2] }, { m[4], m[5], m[6] }, { m[8], m[9], m[10] } };
+    double inverse[3][3];
+    vtkMath::Invert3x3(linear, inverse);
+
+    vtkPoints* source = part.mesh->GetPoints();
+    vtkDataArray* sourceNormals = normals ? part.mesh->GetPointData()->GetNormals() : nullptr;
+
+    for (std::size_t i = 0; i < layout.points; ++i)
+    {
+        double p[3];
+        source->GetPoint(static_cast<vtkIdType>(i), p);
+
+        float* out = points + 3 * (layout.firstPoint + i);
+        out[0] = static_cast<float>(m[0] * p[0] + m[1] * p[1] + m[2] * p[2] + m[3]);
+        out[1] = static_cast<float>(m[4] * p[0] + m[5] * p[1] + m[6] * p[2] + m[7]);
+        out[2] = static_cast<float>(m[8] * p[0] + m[9] * p[1] + m[10] * p[2] + m[11]);
+
+        if (sourceNormals)
+        {
+            double n[3];
+            sourceNormals->GetTuple(static_cast<vtkIdType>(i), n);
+
+            double t[3] = {
+                inverse[0][0] * n[0] + inverse[1][0] * n[1] + inverse[2][0] * n[2],
+                inverse[0][1] * n[0] + inverse[1][1] * n[1] + inverse[2][1] * n[2],
+                inverse[0][2] * n[0] + inverse[1][2] * n[1] + inverse[2][2] * n[2],
+            };
+            vtkMath::Normalize(t);
+
+            float* outNormal = normals + 3 * (layout.firstPoint + i);
+            outNormal[0] = static_cast<float>(t[0]);
+            outNormal[1] = static_cast<float>(t[1]);
+            outNormal[2] = static_cast<float>(t[2]);
+        }
+    }
+}
+
+/**
+ * @brief Copies the polygons of a part and unrolls its strips into the merged cell arrays.
+ *
+ * Every other triangle of a strip is flipped so that all of them keep the strip's orientation.
+ */
+template <typename Index>
+void copyCells(vtkPolyData* mesh, const PartLayout& layout, Index* offsets, Index* connectivity)
+{
+    vtkNew<vtkIdList> ids;
+    const Index pointOffset = static_cast<Index>(layout.firstPoint);
+    std::size_t cell = layout.firstCell;
+    std::size_t position = layout.firstConnectivity;
+
+    if (vtkCellArray* polys = mesh->GetPolys())
+    {
+        for (vtkIdType poly = 0; poly < polys->GetNumberOfCells(); ++poly)
+        {
+            polys->GetCellAtId(poly, ids);
+            offsets[cell++] = static_cast<Index>(position);
+            for (vtkIdType i = 0; i < ids->GetNumberOfIds(); ++i)
+                connectivity[position++] = pointOffset + static_cast<Index>(ids->GetId(i));
+        }
+    }
+
+    if (vtkCellArray* strips = mesh->GetStrips())
+    {
+        for (vtkIdType strip = 0; strip < strips->GetNumberOfCells(); ++strip)
+        {
+            strips->GetCellAtId(strip, ids);
+            const vtkIdType* pts = ids->GetPointer(0);
+            for (vtkIdType t = 0; t + 2 < ids->GetNumberOfIds(); ++t)
+            {
+                vtkIdType a = pts[t];
+                vtkIdType b = pts[t + 1];
+                if (t % 2 == 1)
+                    std::swap(a, b);
+
+                offsets[cell++] = static_cast<Index>(position);
+                connectivity[position++] = pointOffset + static_cast<Index>(a);
+                connectivity[position++] = pointOffset + static_cast<Index>(b);
+                connectivity[position++] = pointOffset + static_cast<Index>(pts[t + 2]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Maps every point to the index of its welded point.
+ *
+ * Points are hashed into cells four tolerances wide. A point is compared with the
+ * points kept so far in its own cell, and in a neighbouring cell only if it lies
+ * within the tolerance of that side, so most points need a single lookup. The first
+ * point of a group is kept, which makes the result independent of thread timing.
+ *
+ * @return std::size_t Number of points kept.
+ */
+std::size_t weld(const float* points, const float* normals, std::size_t count, double tolerance, double normalTolerance,
+                 std::vector<std::size_t>& remap, std::vector<char>& kept)
+{
+    const double cellSize = 4.0 * tolerance;
+    const double tolerance2 = tolerance * tolerance;
+
+    auto cellKey = [](std::int64_t x, std::int64_t y, std::int64_t z) {
+        return static_cast<std::uint64_t>(x) * 73856093u ^ static_cast<std::uint64_t>(y) * 19349663u ^ static_cast<std::uint64_t>(z) * 83492791u;
+    };
+
+    std::unordered_map<std::uint64_t, std::vector<std::size_t>> grid;
+    grid.reserve(count / 4 + 1);
+
+    std::size_t next = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const float* p = points + 3 * i;
+
+        std::int64_t cell[3];
+        int low[3];
+        int high[3];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const double scaled = p[axis] / cellSize;
+            cell[axis] = static_cast<std::int64_t>(std::floor(scaled));
+            const double inside = (scaled - cell[axis]) * cellSize;
+            low[axis] = inside < tolerance ? -1 : 0;
+            high[axis] = inside > cellSize - tolerance ? 1 : 0;
+        }
+
+        std::size_t match = count;
+        for (int dx = low[0]; dx <= high[0] && match == count; ++dx)
+        {
+            for (int dy = low[1]; dy <= high[1] && match == count; ++dy)
+            {
+                for (int dz = low[2]; dz <= high[2] && match == count; ++dz)
+                {
+                    const auto found = grid.find(cellKey(cell[0] + dx, cell[1] + dy, cell[2] + dz));
+                    if (found == grid.end())
+                        continue;
+
+                    for (std::size_t candidate : found->second)
+                    {
+                        const float* q = points + 3 * candidate;
+                        const double d[3] = { p[0] - q[0], p[1] - q[1], p[2] - q[2] };
+                        if (vtkMath::Dot(d, d) > tolerance2)
+                            continue;
+
+                        if (normals)
+                        {
+                            const float* n = normals + 3 * i;
+                            const float* m = normals + 3 * candidate;
+                            if (n[0] * m[0] + n[1] * m[1] + n[2] * m[2] < normalTolerance)
+                                continue;
+                        }
+
+                        match = candidate;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (match == count)
+        {
+            remap[i] = next++;
+            kept[i] = 1;
+            grid[cellKey(cell[0], cell[1], cell[2])].push_back(i);
+        }
+        else
+        {
+            remap[i] = remap[match];
+        }
+    }
+
+    return next;
+}
+
+/**
+ * @brief Builds the cell array of the merged mesh with Index-sized offsets and connectivity.
+ */
+template <typename Index, typename IndexArray>
+vtkSmartPointer<vtkCellArray> buildCells(const std::vector<MeshMerger::Part>& parts, const std::vector<PartLayout>& layouts,
+                                         std::size_t cells, std::size_t connectivitySize, const std::vector<std::size_t>* remap,
+                                         unsigned threads)
+{
+    vtkSmartPointer<IndexArray> offsets = vtkSmartPointer<IndexArray>::New();
+    offsets->SetNumberOfValues(static_cast<vtkIdType>(cells + 1));
+    vtkSmartPointer<IndexArray> connectivity = vtkSmartPointer<IndexArray>::New();
+    connectivity->SetNumberOfValues(static_cast<vtkIdType>(connectivitySize));
+
+    Index* offsetData = offsets->GetPointer(0);
+    Index* connectivityData = connectivity->GetPointer(0);
+
+    parallelFor(parts.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t part = begin; part < end; ++part)
+            copyCells(parts[part].mesh, layouts[part], offsetData, connectivityData);
+    }, threads);
+    offsetData[cells] = static_cast<Index>(connectivitySize);
+
+    if (remap)
+    {
+        parallelFor(connectivitySize, 1 << 16, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+                connectivityData[i] = static_cast<Index>((*remap)[static_cast<std::size_t>(connectivityData[i])]);
+        }, threads);
+    }
+
+    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+    polys->SetData(offsets, connectivity);
+    return polys;
+}
+
+} // namespace
+
+
+/**
+ * @brief Merges the parts into one mesh.
+ *
+ * @param parts The meshes and their transforms.
+ * @param options Welding and threading settings.
+ * @return Result The merged mesh and statistics, or an error message.
+ */
+MeshMerger::Result MeshMerger::merge(const std::vector<Part>& parts, const Options& options)
+{
+    TRACE_SCOPE("MeshMerger::merge", "geometry");
+
+    Result result;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Lay the parts out one after the other in the merged arrays
+    std::vector<PartLayout> layouts(parts.size());
+    bool withNormals = !parts.empty();
+    for (std::size_t part = 0; part < parts.size(); ++part)
+    {
+        if (!parts[part].mesh || !parts[part].mesh->GetPoints())
+        {
+            result.error = "A part has no mesh.";
+            return result;
+        }
+        layouts[part] = measure(parts[part].mesh);
+        withNormals = withNormals && parts[part].mesh->GetPointData()->GetNormals();
+    }
+
+    PartLayout total;
+    for (PartLayout& layout : layouts)
+    {
+        layout.firstPoint = total.points;
+        layout.firstCell = total.cells;
+        layout.firstConnectivity = total.connectivity;
+        total.points += layout.points;
+        total.cells += layout.cells;
+        total.connectivity += layout.connectivity;
+    }
+
+    if (total.cells == 0)
+    {
+        result.error = "There are no polygons to merge.";
+        return result;
+    }
+
+    vtkSmartPointer<vtkFloatArray> coordinates = vtkSmartPointer<vtkFloatArray>::New();
+    coordinates->SetNumberOfComponents(3);
+    coordinates->SetNumberOfTuples(static_cast<vtkIdType>(total.points));
+    vtkSmartPointer<vtkFloatArray> normals;
+    if (withNormals)
+    {
+        normals = vtkSmartPointer<vtkFloatArray>::New();
+        normals->SetName("Normals");
+        normals->SetNumberOfComponents(3);
+        normals->SetNumberOfTuples(static_cast<vtkIdType>(total.points));
+    }
+
+    float* pointData = coordinates->GetPointer(0);
+    float* normalData = normals ? normals->GetPointer(0) : nullptr;
+    parallelFor(parts.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t part = begin; part < end; ++part)
+            copyPoints(parts[part], layouts[part], pointData, normalData);
+    }, options.threads);
+
+    // Weld, then compact the kept points in parallel
+    std::vector<std::size_t> remap;
+    std::size_t keptPoints = total.points;
+    if (options.weldTolerance > 0.0)
+    {
+        remap.resize(total.points);
+        std::vector<char> kept(total.points, 0);
+        keptPoints = weld(pointData, normalData, total.points, options.weldTolerance, options.normalTolerance, remap, kept);
+
+        vtkSmartPointer<vtkFloatArray> weldedCoordinates = vtkSmartPointer<vtkFloatArray>::New();
+        weldedCoordinates->SetNumberOfComponents(3);
+        weldedCoordinates->SetNumberOfTuples(static_cast<vtkIdType>(keptPoints));
+        vtkSmartPointer<vtkFloatArray> weldedNormals;
+        if (normals)
+        {
+            weldedNormals = vtkSmartPointer<vtkFloatArray>::New();
+            weldedNormals->SetName("Normals");
+            weldedNormals->SetNumberOfComponents(3);
+            weldedNormals->SetNumberOfTuples(static_cast<vtkIdType>(keptPoints));
+        }
+
+        float* weldedPointData = weldedCoordinates->GetPointer(0);
+        float* weldedNormalData = weldedNormals ? weldedNormals->GetPointer(0) : nullptr;
+        parallelFor(total.points, 1 << 16, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                if (!kept[i])
+                    continue;
+                std::copy(pointData + 3 * i, pointData + 3 * i + 3, weldedPointData + 3 * remap[i]);
+                if (weldedNormalData)
+                    std::copy(normalData + 3 * i, normalData + 3 * i + 3, weldedNormalData + 3 * remap[i]);
+            }
+        }, options.threads);
+
+        coordinates = weldedCoordinates;
+        normals = weldedNormals;
+    }
+
+    const std::vector<std::size_t>* cellRemap = remap.empty() ? nullptr : &remap;
+    const bool fitsInt32 = total.points <= static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max())
+        && total.connectivity <= static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max());
+    vtkSmartPointer<vtkCellArray> polys = fitsInt32
+        ? buildCells<std::int32_t, vtkTypeInt32Array>(parts, layouts, total.cells, total.connectivity, cellRemap, options.threads)
+        : buildCells<std::int64_t, vtkTypeInt64Array>(parts, layouts, total.cells, total.connectivity, cellRemap, options.threads);
+
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetData(coordinates);
+
+    result.mesh = vtkSmartPointer<vtkPolyData>::New();
+    result.mesh->SetPoints(points);
+    result.mesh->SetPolys(polys);
+    if (normals)
+        result.mesh->GetPointData()->SetNormals(normals);
+
+    result.inputPoints = total.points;
+    result.weldedPoints = total.points - keptPoints;
+    result.cells = total.cells;
+    result.seconds = timer.nsecsElapsed() / 1.0e9;
+    return result;
+}
+
+
+/**
+ * @brief Returns 1e-6 of the diagonal of the parts' transformed bounds, the points' bounding box.
+ *
+ * The meshes are only read, so jobs sharing them may call this concurrently.
+ *
+ * @param parts The meshes and their transforms.
+ * @return double The tolerance, or 0 if there are no points.
+ */
+double MeshMerger::defaultWeldTolerance(const std::vector<Part>& parts)
+{
+    double lower[3] = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), std::numeric_limits<double>::max() };
+    double upper[3] = { std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest() };
+
+    for (const Part& part : parts)
+    {
+        if (!part.mesh || part.mesh->GetNumberOfPoints() == 0)
+            continue;
+
+        double bounds[6];
+        pointBounds(part.mesh, bounds);
+
+        // Transform the corners of the part's bounds
+        const double* m = part.matrix.data();
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            const double p[3] = { bounds[corner & 1], bounds[2 + ((corner >> 1) & 1)], bounds[4 + ((corner >> 2) & 1)] };
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                const double value = m[4 * axis] * p[0] + m[4 * axis + 1] * p[1] + m[4 * axis + 2] * p[2] + m[4 * axis + 3];
+                lower[axis] = std::min(lower[axis], value);
+                upper[axis] = std::max(upper[axis], value);
+            }
+        }
+    }
+
+    if (lower[0] > upper[0])
+        return 0.0;
+
+    const double extent[3] = { upper[0] - lower[0], upper[1] - lower[1], upper[2] - lower[2] };
+    return 1.0e-6 * std::sqrt(vtkMath::Dot(extent, extent));
+}
@@ -0,0 +1,648 @@
+/**
+ * @file meshNormals.cpp
+ * @brief Implementation of the MeshNormals class.
+ */
+
+#include "meshNormals.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdList.h>
+#include <vtkMath.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+
+namespace
+{
+
+constexpr std::size_t ItemsPerBlock = 1 << 14;
+
+/// Corner keeping its own point.
+constexpr std::uint32_t NoCopy = 0xFFFFFFFFu;
+
+/// Faces with an area below this fraction of their longest edge squared count as degenerate.
+constexpr double DegenerateArea = 1e-6;
+
+/// Largest point or corner count; keeps every id valid in 32-bit cell arrays.
+constexpr std::size_t Largest = static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max());
+
+/**
+ * @brief Corners of the polygons and strips of a mesh: one per connectivity entry, polygons first.
+ */
+struct Corners
+{
+    std::vector<std::uint32_t> point;        ///< Point of every corner.
+    std::vector<std::uint32_t> polyOffsets;  ///< First corner of every polygon, then the end.
+    std::vector<std::uint32_t> stripOffsets; ///< First corner of every strip, then the end.
+};
+
+/**
+ * @brief Appends the cells of one cell array to the corners, whatever the width of its ids.
+ */
+template <typename Id>
+void appendCells(const Id* offsets, const Id* connectivity, std::size_t cells, std::size_t ids,
+                 std::vector<std::uint32_t>& cellOffsets, Corners& corners, unsigned threads)
+{
+    const std::uint32_t base = static_cast<std::uint32_t>(corners.point.size());
+    cellOffsets.resize(cells + 1);
+    corners.point.resize(base + ids);
+
+    std::uint32_t* outOffsets = cellOffsets.data();
+    std::uint32_t* outPoints = corners.point.data() + base;
+    parallelFor(cells + 1, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            outOffsets[i] = base + static_cast<std::uint32_t>(offsets[i]);
+    }, threads);
+    parallelFor(ids, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            outPoints[i] = static_cast<std::uint32_t>(connectivity[i]);
+    }, threads);
+}
+
+/**
+ * @brief Appends the cells of a cell array, which may be null, to the corners.
+ */
+void appendCells(vtkCellArray* cells, std::vector<std::uint32_t>& cellOffsets, Corners& corners, unsigned threads)
+{
+    const std::size_t count = cells ? static_cast<std::size_t>(cells->GetNumberOfCells()) : 0;
+    if (count == 0)
+    {
+        cellOffsets.assign(1, static_cast<std::uint32_t>(corners.point.size()));
+        return;
+    }
+
+    const std::size_t ids = static_cast<std::size_t>(cells->GetNumberOfConnectivityIds());
+    if (cells->IsStorage64Bit())
+        appendCells(cells->GetOffsetsArray64()->GetPointer(0), cells->GetConnectivityArray64()->GetPointer(0), count, ids, cellOffsets, corners, threads);
+    else
+        appendCells(cells->GetOffsetsArray32()->GetPointer(0), cells->GetConnectivityArray32()->GetPointer(0), count, ids, cellOffsets, corners, threads);
+}
+
+/**
+ * @brief Returns the bits of a coordinate, with -0 and +0 alike.
+ */
+std::uint32_t coordinateBits(float value)
+{
+    if (value == 0.0f)
+        value = 0.0f;
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof bits);
+    return bits;
+}
+
+/**
+ * @brief Returns a well-mixed hash of a position.
+ */
+std::uint64_t positionHash(const float* p)
+{
+    std::uint64_t h = coordinateBits(p[0]);
+    h = h * 0x9E3779B97F4A7C15ull + coordinateBits(p[1]);
+    h = h * 0x9E3779B97F4A7C15ull + coordinateBits(p[2]);
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 29;
+    return h;
+}
+
+/**
+ * @brief Adds the area-weighted normal of every face around each corner into faceNormals.
+ *
+ * A polygon's corners all get its Newell normal; a strip corner gets the sum of the
+ * normals of the strip triangles it belongs to. Degenerate faces add nothing, so that
+ * rounding does not give them a normal in an arbitrary direction.
+ */
+void computeFaceNormals(const float* xyz, const Corners& corners, float* faceNormals, unsigned threads)
+{
+    const std::uint32_t* point = corners.point.data();
+
+    const std::size_t polys = corners.polyOffsets.size() - 1;
+    parallelFor(polys, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t cell = begin; cell < end; ++cell)
+        {
+            const std::uint32_t first = corners.polyOffsets[cell];
+            const std::uint32_t last = corners.polyOffsets[cell + 1];
+
+            double n[3] = { 0.0, 0.0, 0.0 };
+            double longestEdge = 0.0;
+            for (std::uint32_t c = first; c < last; ++c)
+            {
+                const float* a = xyz + 3 * static_cast<std::size_t>(point[c]);
+                const float* b = xyz + 3 * static_cast<std::size_t>(point[c + 1 < last ? c + 1 : first]);
+                n[0] += (static_cast<double>(a[1]) - b[1]) * (static_cast<double>(a[2]) + b[2]);
+                n[1] += (static_cast<double>(a[2]) - b[2]) * (static_cast<double>(a[0]) + b[0]);
+                n[2] += (static_cast<double>(a[0]) - b[0]) * (static_cast<double>(a[1]) + b[1]);
+                const double e[3] = { static_cast<double>(b[0]) - a[0], static_cast<double>(b[1]) - a[1], static_cast<double>(b[2]) - a[2] };
+                longestEdge = std::max(longestEdge, e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+            }
+            if (0.5 * std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) <= DegenerateArea * longestEdge)
+                n[0] = n[1] = n[2] = 0.0;
+            for (std::uint32_t c = first; c < last; ++c)
+            {
+                faceNormals[3 * static_cast<std::size_t>(c) + 0] = static_cast<float>(0.5 * n[0]);
+                faceNormals[3 * static_cast<std::size_t>(c) + 1] = static_cast<float>(0.5 * n[1]);
+                faceNormals[3 * static_cast<std::size_t>(c) + 2] = static_cast<float>(0.5 * n[2]);
+            }
+        }
+    }, threads);
+
+    const std::size_t strips = corners.stripOffsets.size() - 1;
+    parallelFor(strips, ItemsPerBlock / 16, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t cell = begin; cell < end; ++cell)
+        {
+            const std::uint32_t first = corners.stripOffsets[cell];
+            const std::uint32_t last = corners.stripOffsets[cell + 1];
+            std::fill(faceNormals + 3 * static_cast<std::size_t>(first), faceNormals + 3 * static_cast<std::size_t>(last), 0.0f);
+
+            // Every other triangle of a strip is wound the other way round
+            for (std::uint32_t c = first; c + 2 < last; ++c)
+            {
+                const bool odd = ((c - first) & 1) != 0;
+                const float* a = xyz + 3 * static_cast<std::size_t>(point[odd ? c + 1 : c]);
+                const float* b = xyz + 3 * static_cast<std::size_t>(point[odd ? c : c + 1]);
+                const float* p = xyz + 3 * static_cast<std::size_t>(point[c + 2]);
+
+                const double u[3] = { static_cast<double>(b[0]) - a[0], static_cast<double>(b[1]) - a[1], static_cast<double>(b[2]) - a[2] };
+                const double v[3] = { static_cast<double>(p[0]) - a[0], static_cast<double>(p[1]) - a[1], static_cast<double>(p[2]) - a[2] };
+                const double w[3] = { v[0] - u[0], v[1] - u[1], v[2] - u[2] };
+                const float n[3] = {
+                    static_cast<float>(0.5 * (u[1] * v[2] - u[2] * v[1])),
+                    static_cast<float>(0.5 * (u[2] * v[0] - u[0] * v[2])),
+                    static_cast<float>(0.5 * (u[0] * v[1] - u[1] * v[0])) };
+
+                const double longestEdge = std::max({ u[0] * u[0] + u[1] * u[1] + u[2] * u[2],
+                                                      v[0] * v[0] + v[1] * v[1] + v[2] * v[2],
+                                                      w[0] * w[0] + w[1] * w[1] + w[2] * w[2] });
+                if (std::sqrt(static_cast<double>(n[0]) * n[0] + static_cast<double>(n[1]) * n[1] + static_cast<double>(n[2]) * n[2]) <= DegenerateArea * longestEdge)
+                    continue;
+
+                for (std::uint32_t corner = c; corner < c + 3; ++corner)
+                {
+                    float* out = faceNormals + 3 * static_cast<std::size_t>(corner);
+                    out[0] += n[0];
+                    out[1] += n[1];
+                    out[2] += n[2];
+                }
+            }
+        }
+    }, threads);
+}
+
+/**
+ * @brief Finds for every point the lowest-numbered point at exactly the same position.
+ *
+ * Points are bucketed by a hash of their position, about four per bucket, then compared
+ * within their bucket; coordinates are only read for points whose full hashes match.
+ */
+std::vector<std::uint32_t> matchPositions(const float* xyz, std::size_t points, unsigned threads)
+{
+    int bits = 1;
+    while ((std::size_t(4) << bits) < points)
+        ++bits;
+    const std::size_t buckets = std::size_t(1) << bits;
+
+    std::vector<std::uint64_t> hash(points);
+    std::vector<std::atomic<std::uint32_t>> fill(buckets);
+    parallelFor(points, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            hash[i] = positionHash(xyz + 3 * i);
+            fill[hash[i] >> (64 - bits)].fetch_add(1, std::memory_order_relaxed);
+        }
+    }, threads);
+
+    std::vector<std::uint32_t> bucketStart(buckets + 1);
+    std::uint32_t sum = 0;
+    for (std::size_t b = 0; b < buckets; ++b)
+    {
+        bucketStart[b] = sum;
+        sum += fill[b].load(std::memory_order_relaxed);
+        fill[b].store(bucketStart[b], std::memory_order_relaxed);
+    }
+    bucketStart[buckets] = sum;
+
+    // The low bits of the hash, which do not choose the bucket, are kept next to the point
+    struct Entry { std::uint32_t point; std::uint32_t hash; };
+    std::vector<Entry> order(points);
+    parallelFor(points, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const std::uint32_t slot = fill[hash[i] >> (64 - bits)].fetch_add(1, std::memory_order_relaxed);
+            order[slot] = { static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(hash[i]) };
+        }
+    }, threads);
+
+    std::vector<std::uint32_t> representative(points);
+    parallelFor(buckets, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t b = begin; b < end; ++b)
+        {
+            for (std::uint32_t i = bucketStart[b]; i < bucketStart[b + 1]; ++i)
+            {
+                const float* p = xyz + 3 * static_cast<std::size_t>(order[i].point);
+                std::uint32_t lowest = order[i].point;
+                for (std::uint32_t j = bucketStart[b]; j < bucketStart[b + 1]; ++j)
+                {
+                    if (order[j].hash != order[i].hash || order[j].point >= lowest)
+                        continue;
+                    const float* q = xyz + 3 * static_cast<std::size_t>(order[j].point);
+                    if (p[0] == q[0] && p[1] == q[1] && p[2] == q[2])
+                        lowest = order[j].point;
+                }
+                representative[order[i].point] = lowest;
+            }
+        }
+    }, threads);
+
+    return representative;
+}
+
+/**
+ * @brief Lists the corners around every position: those of representative r are groupCorner[groupStart[r], groupStart[r + 1]).
+ */
+void groupCorners(const Corners& corners, const std::vector<std::uint32_t>& representative,
+                  std::vector<std::uint32_t>& groupStart, std::vector<std::uint32_t>& groupCorner, unsigned threads)
+{
+    const std::size_t points = representative.size();
+    const std::size_t count = corners.point.size();
+
+    std::vector<std::atomic<std::uint32_t>> fill(points);
+    parallelFor(count, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; ++c)
+            fill[representative[corners.point[c]]].fetch_add(1, std::memory_order_relaxed);
+    }, threads);
+
+    groupStart.resize(points + 1);
+    std::uint32_t sum = 0;
+    for (std::size_t r = 0; r < points; ++r)
+    {
+        groupStart[r] = sum;
+        sum += fill[r].load(std::memory_order_relaxed);
+        fill[r].store(groupStart[r], std::memory_order_relaxed);
+    }
+    groupStart[points] = sum;
+
+    groupCorner.resize(count);
+    parallelFor(count, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; ++c)
+            groupCorner[fill[representative[corners.point[c]]].fetch_add(1, std::memory_order_relaxed)] = static_cast<std::uint32_t>(c);
+    }, threads);
+}
+
+/**
+ * @brief Returns a new connectivity array of the same width as the cell array's, with corners redirected to their copies.
+ */
+template <typename Array>
+vtkSmartPointer<Array> remapConnectivity(const std::vector<std::uint32_t>& cornerPoint, std::uint32_t first, std::uint32_t last, unsigned threads)
+{
+    vtkSmartPointer<Array> connectivity = vtkSmartPointer<Array>::New();
+    connectivity->SetNumberOfValues(static_cast<vtkIdType>(last - first));
+    auto* out = connectivity->GetPointer(0);
+    parallelFor(last - first, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            out[i] = cornerPoint[first + i];
+    }, threads);
+    return connectivity;
+}
+
+/**
+ * @brief Returns the cells with the connectivity of corners [first, last) taken from cornerPoint; the offsets are shared.
+ */
+vtkSmartPointer<vtkCellArray> remapCells(vtkCellArray* cells, const std::vector<std::uint32_t>& cornerPoint, std::uint32_t first, std::uint32_t last, unsigned threads)
+{
+    vtkSmartPointer<vtkCellArray> remapped = vtkSmartPointer<vtkCellArray>::New();
+    if (cells->IsStorage64Bit())
+        remapped->SetData(cells->GetOffsetsArray64(), remapConnectivity<vtkTypeInt64Array>(cornerPoint, first, last, threads));
+    else
+        remapped->SetData(cells->GetOffsetsArray32(), remapConnectivity<vtkTypeInt32Array>(cornerPoint, first, last, threads));
+    return remapped;
+}
+
+} // namespace
+
+
+/**
+ * @brief Returns a copy of the mesh with float32 point normals.
+ *
+ * The corners around a position are split into smooth groups, joining any two whose
+ * faces are within the feature angle; each group gets the normalized sum of its
+ * area-weighted face normals. The first group using a point keeps it, later groups
+ * using the same point get a copy of it.
+ *
+ * @param mesh The mesh; it is not modified.
+ * @param options Feature angle and threading settings.
+ * @return vtkSmartPointer<vtkPolyData> The mesh with normals, or the input if there is nothing to shade.
+ */
+vtkSmartPointer<vtkPolyData> MeshNormals::compute(vtkPolyData* mesh, const Options& options)
+{
+    if (!mesh || !mesh->GetPoints() || mesh->GetNumberOfPolys() + mesh->GetNumberOfStrips() == 0)
+        return mesh;
+
+    const std::size_t points = static_cast<std::size_t>(mesh->GetNumberOfPoints());
+    const std::size_t cornerCount = static_cast<std::size_t>(mesh->GetPolys()->GetNumberOfConnectivityIds() +
+                                                             mesh->GetStrips()->GetNumberOfConnectivityIds());
+    if (points > Largest || cornerCount > Largest)
+        return mesh;
+
+    TRACE_SCOPE("MeshNormals::compute", "geometry");
+
+    const unsigned threads = options.threads;
+    const float cosFeature = static_cast<float>(std::cos(vtkMath::RadiansFromDegrees(std::clamp(options.featureAngle, 0.0, 180.0))));
+
+    // Points as float32, converted only if stored otherwise
+    std::vector<float> convertedPoints;
+    const float* xyz = nullptr;
+    vtkDataArray* pointData = mesh->GetPoints()->GetData();
+    if (vtkFloatArray* floats = vtkFloatArray::SafeDownCast(pointData))
+    {
+        xyz = floats->GetPointer(0);
+    }
+    else
+    {
+        convertedPoints.resize(3 * points);
+        parallelFor(3 * points, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+                convertedPoints[i] = static_cast<float>(pointData->GetComponent(static_cast<vtkIdType>(i / 3), static_cast<int>(i % 3)));
+        }, threads);
+        xyz = convertedPoints.data();
+    }
+
+    Corners corners;
+    corners.point.reserve(cornerCount);
+    appendCells(mesh->GetPolys(), corners.polyOffsets, corners, threads);
+    appendCells(mesh->GetStrips(), corners.stripOffsets, corners, threads);
+
+    // Area-weighted face normal per corner; replaced by the corner's normal further down
+    std::vector<float> cornerNormal(3 * cornerCount);
+    computeFaceNormals(xyz, corners, cornerNormal.data(), threads);
+
+    const std::vector<std::uint32_t> representative = matchPositions(xyz, points, threads);
+    std::vector<std::uint32_t> groupStart;
+    std::vector<std::uint32_t> groupCorner;
+    groupCorners(corners, representative, groupStart, groupCorner, threads);
+
+    vtkSmartPointer<vtkFloatArray> normals = vtkSmartPointer<vtkFloatArray>::New();
+    normals->SetName("Normals");
+    normals->SetNumberOfComponents(3);
+    normals->SetNumberOfTuples(static_cast<vtkIdType>(points));
+    float* pointNormal = normals->GetPointer(0);
+    parallelFor(3 * points, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        std::fill(pointNormal + begin, pointNormal + end, 0.0f);
+    }, threads);
+
+    // Copy of its point a corner moves to, numbered per group; NoCopy keeps the point
+    std::vector<std::uint32_t> cornerCopy(cornerCount, NoCopy);
+    std::vector<std::uint32_t> groupCopies(points, 0);
+
+    parallelFor(points, ItemsPerBlock / 4, [&](std::size_t begin, std::size_t end) {
+        std::vector<float> unit;
+        std::vector<std::uint32_t> root;
+        std::vector<double> sum;
+        struct Use { std::uint32_t point; std::uint32_t root; std::uint32_t copy; };
+        std::vector<Use> uses;
+
+        for (std::size_t group = begin; group < end; ++group)
+        {
+            std::uint32_t* first = groupCorner.data() + groupStart[group];
+            const std::size_t count = groupStart[group + 1] - groupStart[group];
+            if (count == 0)
+                continue;
+            std::sort(first, first + count);
+
+            unit.assign(3 * count, 0.0f);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const float* n = cornerNormal.data() + 3 * static_cast<std::size_t>(first[i]);
+                const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                if (length > 0.0f)
+                {
+                    unit[3 * i + 0] = n[0] / length;
+                    unit[3 * i + 1] = n[1] / length;
+                    unit[3 * i + 2] = n[2] / length;
+                }
+            }
+
+            // Smooth groups: corners joined directly or through others whose faces are within the feature angle
+            root.resize(count);
+            for (std::size_t i = 0; i < count; ++i)
+                root[i] = static_cast<std::uint32_t>(i);
+            auto find = [&root](std::uint32_t i) {
+                while (root[i] != i)
+                    i = root[i] = root[root[i]];
+                return i;
+            };
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const float* u = unit.data() + 3 * i;
+                if (u[0] == 0.0f && u[1] == 0.0f && u[2] == 0.0f)
+                    continue;
+                for (std::size_t j = i + 1; j < count; ++j)
+                {
+                    const float* v = unit.data() + 3 * j;
+                    if (u[0] * v[0] + u[1] * v[1] + u[2] * v[2] >= cosFeature)
+                    {
+                        const std::uint32_t a = find(static_cast<std::uint32_t>(i));
+                        const std::uint32_t b = find(static_cast<std::uint32_t>(j));
+                        root[std::max(a, b)] = std::min(a, b);
+                    }
+                }
+            }
+
+            sum.assign(3 * count, 0.0);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                root[i] = find(static_cast<std::uint32_t>(i));
+                const float* n = cornerNormal.data() + 3 * static_cast<std::size_t>(first[i]);
+                sum[3 * root[i] + 0] += n[0];
+                sum[3 * root[i] + 1] += n[1];
+                sum[3 * root[i] + 2] += n[2];
+            }
+
+            // Corners of degenerate faces join the first smooth group around the position
+            std::uint32_t fallback = NoCopy;
+            for (std::size_t i = 0; i < count && fallback == NoCopy; ++i)
+            {
+                const double* s = sum.data() + 3 * root[i];
+                if (s[0] != 0.0 || s[1] != 0.0 || s[2] != 0.0)
+                    fallback = root[i];
+            }
+
+            uses.clear();
+            std::uint32_t copies = 0;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const std::uint32_t corner = first[i];
+                const std::uint32_t point = corners.point[corner];
+                const double* s = sum.data() + 3 * root[i];
+                if (s[0] == 0.0 && s[1] == 0.0 && s[2] == 0.0 && fallback != NoCopy)
+                {
+                    root[i] = fallback;
+                    s = sum.data() + 3 * fallback;
+                }
+                const double length = std::sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+
+                float* normal = cornerNormal.data() + 3 * static_cast<std::size_t>(corner);
+                if (length == 0.0)
+                {
+                    normal[0] = normal[1] = normal[2] = 0.0f;
+                    continue;
+                }
+                normal[0] = static_cast<float>(s[0] / length);
+                normal[1] = static_cast<float>(s[1] / length);
+                normal[2] = static_cast<float>(s[2] / length);
+
+                auto use = std::find_if(uses.begin(), uses.end(), [&](const Use& u) { return u.point == point && u.root == root[i]; });
+                if (use != uses.end())
+                {
+                    cornerCopy[corner] = use->copy;
+                    continue;
+                }
+
+                const bool used = std::any_of(uses.begin(), uses.end(), [&](const Use& u) { return u.point == point; });
+                const std::uint32_t copy = used ? copies++ : NoCopy;
+                uses.push_back({ point, root[i], copy });
+                cornerCopy[corner] = copy;
+                if (!used)
+                    std::copy(normal, normal + 3, pointNormal + 3 * static_cast<std::size_t>(point));
+            }
+            groupCopies[group] = copies;
+        }
+    }, threads);
+
+    vtkSmartPointer<vtkPolyData> result = vtkSmartPointer<vtkPolyData>::New();
+    result->ShallowCopy(mesh);
+
+    std::size_t copyCount = 0;
+    for (std::uint32_t& copies : groupCopies)
+    {
+        const std::uint32_t count = copies;
+        copies = static_cast<std::uint32_t>(copyCount);
+        copyCount += count;
+    }
+
+    if (copyCount == 0)
+    {
+        result->GetPointData()->SetNormals(normals);
+        return result;
+    }
+
+    const std::size_t total = points + copyCount;
+    if (total > Largest)
+        return mesh;
+
+    // Feature edges of a welded mesh: append the copies and redirect their corners
+    vtkSmartPointer<vtkFloatArray> splitNormals = vtkSmartPointer<vtkFloatArray>::New();
+    splitNormals->SetName("Normals");
+    splitNormals->SetNumberOfComponents(3);
+    splitNormals->SetNumberOfTuples(static_cast<vtkIdType>(total));
+    float* outNormal = splitNormals->GetPointer(0);
+
+    vtkSmartPointer<vtkFloatArray> splitCoordinates = vtkSmartPointer<vtkFloatArray>::New();
+    splitCoordinates->SetNumberOfComponents(3);
+    splitCoordinates->SetNumberOfTuples(static_cast<vtkIdType>(total));
+    float* outPoint = splitCoordinates->GetPointer(0);
+
+    parallelFor(3 * points, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        std::copy(pointNormal + begin, pointNormal + end, outNormal + begin);
+        std::copy(xyz + begin, xyz + end, outPoint + begin);
+    }, threads);
+
+    std::vector<std::uint32_t> copySource(copyCount);
+    std::vector<std::uint32_t> cornerPoint(corners.point);
+    parallelFor(points, ItemsPerBlock / 4, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t group = begin; group < end; ++group)
+        {
+            for (std::uint32_t i = groupStart[group]; i < groupStart[group + 1]; ++i)
+            {
+                const std::uint32_t corner = groupCorner[i];
+                if (cornerCopy[corner] == NoCopy)
+                    continue;
+
+                const std::uint32_t index = groupCopies[group] + cornerCopy[corner];
+                const std::size_t target = points + index;
+                const std::uint32_t source = corners.point[corner];
+                copySource[index] = source;
+                cornerPoint[corner] = static_cast<std::uint32_t>(target);
+                std::copy(cornerNormal.data() + 3 * static_cast<std::size_t>(corner), cornerNormal.data() + 3 * static_cast<std::size_t>(corner) + 3, outNormal + 3 * target);
+                std::copy(xyz + 3 * static_cast<std::size_t>(source), xyz + 3 * static_cast<std::size_t>(source) + 3, outPoint + 3 * target);
+            }
+        }
+    }, threads);
+
+    vtkSmartPointer<vtkPoints> splitPoints = vtkSmartPointer<vtkPoints>::New();
+    splitPoints->SetData(splitCoordinates);
+    result->SetPoints(splitPoints);
+
+    // Other point data follows the points it was copied from
+    vtkPointData* sourceData = mesh->GetPointData();
+    vtkSmartPointer<vtkPointData> splitData = vtkSmartPointer<vtkPointData>::New();
+    splitData->CopyNormalsOff();
+    splitData->CopyAllocate(sourceData, static_cast<vtkIdType>(total));
+    splitData->CopyData(sourceData, 0, static_cast<vtkIdType>(points), 0);
+
+    vtkSmartPointer<vtkIdList> sourceIds = vtkSmartPointer<vtkIdList>::New();
+    vtkSmartPointer<vtkIdList> targetIds = vtkSmartPointer<vtkIdList>::New();
+    sourceIds->SetNumberOfIds(static_cast<vtkIdType>(copyCount));
+    targetIds->SetNumberOfIds(static_cast<vtkIdType>(copyCount));
+    for (std::size_t i = 0; i < copyCount; ++i)
+    {
+        sourceIds->SetId(static_cast<vtkIdType>(i), copySource[i]);
+        targetIds->SetId(static_cast<vtkIdType>(i), static_cast<vtkIdType>(points + i));
+    }
+    splitData->CopyData(sourceData, sourceIds, targetIds);
+    splitData->SetNormals(splitNormals);
+    result->GetPointData()->ShallowCopy(splitData);
+
+    const std::uint32_t stripStart = corners.stripOffsets.front();
+    if (mesh->GetNumberOfPolys() > 0)
+        result->SetPolys(remapCells(mesh->GetPolys(), cornerPoint, 0, stripStart, threads));
+    if (mesh->GetNumberOfStrips() > 0)
+        result->SetStrips(remapCells(mesh->GetStrips(), cornerPoint, stripStart, static_cast<std::uint32_t>(cornerCount), threads));
+
+    return result;
+}
+
+
+/**
+ * @brief Returns true if a transform keeps the angles between faces.
+ *
+ * That is the case if the columns of its linear part are orthogonal and equally long.
+ *
+ * @param matrix Row-major 4x4 affine matrix.
+ * @return bool True for rotations, translations, uniform scales and their combinations.
+ */
+bool MeshNormals::preservesAngles(const double matrix[16])
+{
+    double gram[3][3];
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+            gram[i][j] = matrix[i] * matrix[j] + matrix[4 + i] * matrix[4 + j] + matrix[8 + i] * matrix[8 + j];
+    }
+
+    const double scale = (gram[0][0] + gram[1][1] + gram[2][2]) / 3.0;
+    if (!(scale > 0.0))
+        return false;
+
+    constexpr double Tolerance = 1e-6;
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            if (std::abs(gram[i][j] - (i == j ? scale : 0.0)) > Tolerance * scale)
+                return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file meshNormalsCache.cpp
+ * @brief Implementation of the MeshNormalsCache class.
+ */
+
+#include "meshNormalsCache.h"
+
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+
+
+/**
+ * @brief Sets the feature angle of normals computed from now on; changing it drops every result.
+ *
+ * @param degrees Largest angle between faces shaded as one smooth surface.
+ */
+void MeshNormalsCache::setFeatureAngle(double degrees)
+{
+    if (degrees == mFeatureAngle)
+        return;
+
+    mFeatureAngle = degrees;
+    mEntries.clear();
+}
+
+
+/**
+ * @brief Returns the mesh with point normals, computing them if the mesh is new or was modified.
+ *
+ * The weak pointer tells a live mesh from a destroyed one whose address was reused.
+ *
+ * @param mesh The mesh; may be null.
+ * @return vtkSmartPointer<vtkPolyData> The mesh with normals.
+ */
+vtkSmartPointer<vtkPolyData> MeshNormalsCache::get(vtkPolyData* mesh)
+{
+    if (!mesh || mesh->GetPointData()->GetNormals() || mesh->GetNumberOfPolys() + mesh->GetNumberOfStrips() == 0)
+        return mesh;
+
+    Entry& entry = mEntries[mesh];
+    if (entry.mesh != mesh || entry.modified != mesh->GetMTime())
+    {
+        MeshNormals::Options options;
+        options.featureAngle = mFeatureAngle;
+
+        entry.mesh = mesh;
+        entry.modified = mesh->GetMTime();
+        entry.normals = MeshNormals::compute(mesh, options);
+        ++mComputes;
+    }
+    return entry.normals;
+}
+
+
+/**
+ * @brief Returns the cached result of a mesh without computing anything.
+ *
+ * @param mesh The mesh; may be null.
+ * @return vtkPolyData* The mesh with normals, or null if none is cached for the current version.
+ */
+vtkPolyData* MeshNormalsCache::find(vtkPolyData* mesh) const
+{
+    const auto it = mEntries.find(mesh);
+    if (!mesh || it == mEntries.end() || it->second.mesh != mesh || it->second.modified != mesh->GetMTime())
+        return nullptr;
+    return it->second.normals;
+}
+
+
+/**
+ * @brief Drops the results of meshes that were destroyed.
+ *
+ * Results of meshes that are alive but no longer in the scene, e.g. held by the undo
+ * history, are kept so that bringing the mesh back does not compute them again.
+ */
+void MeshNormalsCache::prune()
+{
+    for (auto it = mEntries.begin(); it != mEntries.end();)
+    {
+        if (!it->second.mesh)
+            it = mEntries.erase(it);
+        else
+            ++it;
+    }
+}
+
+
+/**
+ * @brief Returns a snapshot of the counters.
+ */
+MeshNormalsCache::Statistics MeshNormalsCache::statistics() const
+{
+    Statistics statistics;
+    for (const auto& entry : mEntries)
+    {
+        vtkDataArray* normals = entry.second.normals ? entry.second.normals->GetPointData()->GetNormals() : nullptr;
+        if (!normals)
+            continue;
+        ++statistics.meshes;
+        statistics.bytes += static_cast<std::size_t>(normals->GetNumberOfValues()) * static_cast<std::size_t>(normals->GetDataTypeSize());
+    }
+    statistics.computes = mComputes;
+    return statistics;
+}
@@ -0,0 +1,942 @@
+/**
+ * @file meshRepair.cpp
+ * @brief Implementation of the MeshRepair class.
+ */
+
+#include "meshRepair.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <QElapsedTimer>
+
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkPoints.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+
+namespace
+{
+
+constexpr std::size_t ItemsPerBlock = 1 << 14;
+
+/// Triangles with an area below this fraction of their longest edge squared count as degenerate.
+constexpr double DegenerateArea = 1e-6;
+
+/// Largest point or corner count; keeps every id valid in 32-bit cell arrays.
+constexpr std::size_t Largest = static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max());
+
+/// Neighbor of an edge that belongs to one triangle only.
+constexpr std::uint32_t Boundary = 0xFFFFFFFFu;
+
+/// Neighbor of an edge that belongs to three or more triangles.
+constexpr std::uint32_t NonManifold = 0xFFFFFFFEu;
+
+/**
+ * @brief Point ids of a triangle; edge e runs from v[e] to v[(e + 1) % 3].
+ */
+struct Triangle
+{
+    std::uint32_t v[3];
+};
+
+/**
+ * @brief Returns a well-mixed hash of three values.
+ */
+std::uint64_t hashOf(std::uint64_t a, std::uint64_t b, std::uint64_t c)
+{
+    std::uint64_t h = a;
+    h = h * 0x9E3779B97F4A7C15ull + b;
+    h = h * 0x9E3779B97F4A7C15ull + c;
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 29;
+    return h;
+}
+
+/**
+ * @brief Returns the bits of a coordinate, with -0 and +0 alike.
+ */
+std::uint32_t coordinateBits(float value)
+{
+    if (value == 0.0f)
+        value = 0.0f;
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof bits);
+    return bits;
+}
+
+/**
+ * @brief Returns twice the area of a triangle and its longest edge squared.
+ */
+void measureTriangle(const float* a, const float* b, const float* c, double& doubleArea, double& longestEdge)
+{
+    const double u[3] = { static_cast<double>(b[0]) - a[0], static_cast<double>(b[1]) - a[1], static_cast<double>(b[2]) - a[2] };
+    const double v[3] = { static_cast<double>(c[0]) - a[0], static_cast<double>(c[1]) - a[1], static_cast<double>(c[2]) - a[2] };
+    const double w[3] = { v[0] - u[0], v[1] - u[1], v[2] - u[2] };
+    const double n[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+    doubleArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    longestEdge = std::max({ u[0] * u[0] + u[1] * u[1] + u[2] * u[2],
+                             v[0] * v[0] + v[1] * v[1] + v[2] * v[2],
+                             w[0] * w[0] + w[1] * w[1] + w[2] * w[2] });
+}
+
+/**
+ * @brief Items bucketed by the high bits of their hash, about four per bucket.
+ *
+ * The low 32 bits of the hash are kept next to the item, so most non-matching items
+ * in a bucket are skipped without reading them.
+ */
+struct Buckets
+{
+    struct Entry { std::uint32_t item; std::uint32_t hash; };
+
+    int bits = 1;
+    std::vector<std::uint32_t> start; ///< First entry of every bucket, then the end.
+    std::vector<Entry> entries;
+
+    /// @brief Returns the bucket of a hash.
+    std::size_t bucket(std::uint64_t hash) const { return static_cast<std::size_t>(hash >> (64 - bits)); }
+};
+
+/**
+ * @brief Sorts items into buckets by hash, counting and placing them in parallel.
+ */
+Buckets bucketByHash(const std::vector<std::uint64_t>& hash, unsigned threads)
+{
+    const std::size_t count = hash.size();
+
+    Buckets buckets;
+    while ((std::size_t(4) << buckets.bits) < count)
+        ++buckets.bits;
+    const std::size_t bucketCount = std::size_t(1) << buckets.bits;
+
+    std::vector<std::atomic<std::uint32_t>> fill(bucketCount);
+    parallelFor(count, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            fill[buckets.bucket(hash[i])].fetch_add(1, std::memory_order_relaxed);
+    }, threads);
+
+    buckets.start.resize(bucketCount + 1);
+    std::uint32_t sum = 0;
+    for (std::size_t b = 0; b < bucketCount; ++b)
+    {
+        buckets.start[b] = sum;
+        sum += fill[b].load(std::memory_order_relaxed);
+        fill[b].store(buckets.start[b], std::memory_order_relaxed);
+    }
+    buckets.start[bucketCount] = sum;
+
+    buckets.entries.resize(count);
+    parallelFor(count, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const std::uint32_t slot = fill[buckets.bucket(hash[i])].fetch_add(1, std::memory_order_relaxed);
+            buckets.entries[slot] = { static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(hash[i]) };
+        }
+    }, threads);
+
+    return buckets;
+}
+
+/**
+ * @brief Numbers the kept items consecutively: index[i] becomes the new position of kept item i.
+ *
+ * Items are counted per block in parallel, the blocks are offset by a prefix sum and
+ * then numbered in parallel.
+ *
+ * @return std::size_t The number of kept items.
+ */
+std::size_t numberKept(const std::vector<char>& keep, std::vector<std::uint32_t>& index, unsigned threads)
+{
+    const std::size_t count = keep.size();
+    const std::size_t blocks = (count + ItemsPerBlock - 1) / ItemsPerBlock;
+
+    std::vector<std::uint32_t> blockStart(blocks + 1, 0);
+    parallelFor(blocks, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t block = begin; block < end; ++block)
+        {
+            const std::size_t last = std::min(count, (block + 1) * ItemsPerBlock);
+            blockStart[block + 1] = static_cast<std::uint32_t>(std::count(keep.begin() + block * ItemsPerBlock, keep.begin() + last, 1));
+        }
+    }, threads);
+    for (std::size_t block = 0; block < blocks; ++block)
+        blockStart[block + 1] += blockStart[block];
+
+    index.resize(count);
+    parallelFor(blocks, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t block = begin; block < end; ++block)
+        {
+            std::uint32_t next = blockStart[block];
+            const std::size_t last = std::min(count, (block + 1) * ItemsPerBlock);
+            for (std::size_t i = block * ItemsPerBlock; i < last; ++i)
+            {
+                index[i] = next;
+                next += keep[i] ? 1 : 0;
+            }
+        }
+    }, threads);
+
+    return blockStart[blocks];
+}
+
+/**
+ * @brief Drops the triangles that are not kept, preserving the order of the others.
+ *
+ * @return std::size_t The number of triangles dropped.
+ */
+std::size_t keepTriangles(std::vector<Triangle>& triangles, const std::vector<char>& keep, unsigned threads)
+{
+    std::vector<std::uint32_t> index;
+    const std::size_t kept = numberKept(keep, index, threads);
+    if (kept == triangles.size())
+        return 0;
+
+    std::vector<Triangle> compacted(kept);
+    parallelFor(triangles.size(), ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t t = begin; t < end; ++t)
+        {
+            if (keep[t])
+                compacted[index[t]] = triangles[t];
+        }
+    }, threads);
+
+    const std::size_t dropped = triangles.size() - kept;
+    triangles.swap(compacted);
+    return dropped;
+}
+
+/**
+ * @brief Appends the triangles of one cell array, whatever the width of its ids.
+ *
+ * A polygon of n points becomes a fan of n - 2 triangles around its first point; a
+ * strip of n points has n - 2 triangles, every other one wound the other way round.
+ */
+template <typename Id>
+void appendTriangles(const Id* offsets, const Id* connectivity, std::size_t cells, bool strips,
+                     std::vector<Triangle>& triangles, unsigned threads)
+{
+    std::vector<std::size_t> first(cells + 1);
+    std::size_t sum = triangles.size();
+    for (std::size_t cell = 0; cell < cells; ++cell)
+    {
+        first[cell] = sum;
+        const std::size_t size = static_cast<std::size_t>(offsets[cell + 1] - offsets[cell]);
+        sum += size >= 3 ? size - 2 : 0;
+    }
+    first[cells] = sum;
+    triangles.resize(sum);
+
+    parallelFor(cells, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t cell = begin; cell < end; ++cell)
+        {
+            const Id* p = connectivity + offsets[cell];
+            Triangle* out = triangles.data() + first[cell];
+            const std::size_t count = first[cell + 1] - first[cell];
+            for (std::size_t k = 0; k < count; ++k)
+            {
+                if (!strips)
+                    out[k] = { { static_cast<std::uint32_t>(p[0]), static_cast<std::uint32_t>(p[k + 1]), static_cast<std::uint32_t>(p[k + 2]) } };
+                else if (k & 1)
+                    out[k] = { { static_cast<std::uint32_t>(p[k + 1]), static_cast<std::uint32_t>(p[k]), static_cast<std::uint32_t>(p[k + 2]) } };
+                else
+                    out[k] = { { static_cast<std::uint32_t>(p[k]), static_cast<std::uint32_t>(p[k + 1]), static_cast<std::uint32_t>(p[k + 2]) } };
+            }
+        }
+    }, threads);
+}
+
+/**
+ * @brief Appends the triangles of a cell array, which may be null.
+ */
+void appendTriangles(vtkCellArray* cells, bool strips, std::vector<Triangle>& triangles, unsigned threads)
+{
+    const std::size_t count = cells ? static_cast<std::size_t>(cells->GetNumberOfCells()) : 0;
+    if (count == 0)
+        return;
+
+    if (cells->IsStorage64Bit())
+        appendTriangles(cells->GetOffsetsArray64()->GetPointer(0), cells->GetConnectivityArray64()->GetPointer(0), count, strips, triangles, threads);
+    else
+        appendTriangles(cells->GetOffsetsArray32()->GetPointer(0), cells->GetConnectivityArray32()->GetPointer(0), count, strips, triangles, threads);
+}
+
+/**
+ * @brief Finds for every point the point whose cluster it joins when welding.
+ *
+ * A point joins the cluster of the lowest-numbered point within the tolerance, itself
+ * if there is none. Points are bucketed by the grid cell they lie in, cells being sixteen
+ * tolerances wide, so a point only looks at its own cell and at the neighbors whose
+ * faces it is within the tolerance of, which few points are. A tolerance of 0 buckets by exact position.
+ *
+ * @return std::vector<std::uint32_t> The first point of every point's cluster.
+ */
+std::vector<std::uint32_t> weldPoints(const float* xyz, std::size_t points, double tolerance, unsigned threads)
+{
+    const double cellSize = 16.0 * tolerance;
+    const double squaredTolerance = tolerance * tolerance;
+    auto cellOf = [cellSize](float coordinate) { return static_cast<std::int64_t>(std::floor(coordinate / cellSize)); };
+    auto cellHash = [](std::int64_t x, std::int64_t y, std::int64_t z) {
+        return hashOf(static_cast<std::uint64_t>(x), static_cast<std::uint64_t>(y), static_cast<std::uint64_t>(z));
+    };
+
+    std::vector<std::uint64_t> hash(points);
+    parallelFor(points, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const float* p = xyz + 3 * i;
+            hash[i] = tolerance > 0.0
+                ? cellHash(cellOf(p[0]), cellOf(p[1]), cellOf(p[2]))
+                : hashOf(coordinateBits(p[0]), coordinateBits(p[1]), coordinateBits(p[2]));
+        }
+    }, threads);
+
+    const Buckets buckets = bucketByHash(hash, threads);
+
+    std::vector<std::uint32_t> cluster(points);
+    parallelFor(points, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const float* p = xyz + 3 * i;
+            std::uint32_t lowest = static_cast<std::uint32_t>(i);
+
+            auto scan = [&](std::uint64_t cell) {
+                const std::size_t b = buckets.bucket(cell);
+                for (std::uint32_t j = buckets.start[b]; j < buckets.start[b + 1]; ++j)
+                {
+                    const Buckets::Entry& entry = buckets.entries[j];
+                    if (entry.hash != static_cast<std::uint32_t>(cell) || entry.item >= lowest)
+                        continue;
+
+                    const float* q = xyz + 3 * static_cast<std::size_t>(entry.item);
+                    const double d[3] = { static_cast<double>(q[0]) - p[0], static_cast<double>(q[1]) - p[1], static_cast<double>(q[2]) - p[2] };
+                    if (d[0] * d[0] + d[1] * d[1] + d[2] * d[2] <= squaredTolerance)
+                        lowest = entry.item;
+                }
+            };
+
+            if (tolerance <= 0.0)
+            {
+                scan(hash[i]);
+                cluster[i] = lowest;
+                continue;
+            }
+
+            // Neighboring cells only matter on the sides the point is within the tolerance of
+            std::int64_t cell[3];
+            int low[3];
+            int high[3];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                cell[axis] = cellOf(p[axis]);
+                const double offset = p[axis] - static_cast<double>(cell[axis]) * cellSize;
+                low[axis] = offset < tolerance ? -1 : 0;
+                high[axis] = offset > cellSize - tolerance ? 1 : 0;
+            }
+            for (int dx = low[0]; dx <= high[0]; ++dx)
+            {
+                for (int dy = low[1]; dy <= high[1]; ++dy)
+                {
+                    for (int dz = low[2]; dz <= high[2]; ++dz)
+                        scan(cellHash(cell[0] + dx, cell[1] + dy, cell[2] + dz));
+                }
+            }
+            cluster[i] = lowest;
+        }
+    }, threads);
+
+    // A point's cluster has a lower number, so it is resolved before the point itself
+    for (std::size_t i = 0; i < points; ++i)
+        cluster[i] = cluster[cluster[i]];
+
+    return cluster;
+}
+
+/**
+ * @brief Marks the triangles that have a repeated point or no area.
+ */
+std::vector<char> findAreas(const std::vector<Triangle>& triangles, const float* xyz, unsigned threads)
+{
+    std::vector<char> keep(triangles.size());
+    parallelFor(triangles.size(), ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t t = begin; t < end; ++t)
+        {
+            const std::uint32_t* v = triangles[t].v;
+            if (v[0] == v[1] || v[1] == v[2] || v[2] == v[0])
+            {
+                keep[t] = 0;
+                continue;
+            }
+
+            double doubleArea;
+            double longestEdge;
+            measureTriangle(xyz + 3 * static_cast<std::size_t>(v[0]), xyz + 3 * static_cast<std::size_t>(v[1]),
+                            xyz + 3 * static_cast<std::size_t>(v[2]), doubleArea, longestEdge);
+            keep[t] = 0.5 * doubleArea > DegenerateArea * longestEdge ? 1 : 0;
+        }
+    }, threads);
+    return keep;
+}
+
+/**
+ * @brief Marks the triangles that use the same three points as a lower-numbered triangle.
+ */
+std::vector<char> findUnique(const std::vector<Triangle>& triangles, unsigned threads)
+{
+    const std::size_t count = triangles.size();
+
+    std::vector<Triangle> sorted(count);
+    std::vector<std::uint64_t> hash(count);
+    parallelFor(count, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t t = begin; t < end; ++t)
+        {
+            Triangle key = triangles[t];
+            std::sort(key.v, key.v + 3);
+            sorted[t] = key;
+            hash[t] = hashOf(key.v[0], key.v[1], key.v[2]);
+        }
+    }, threads);
+
+    const Buckets buckets = bucketByHash(hash, threads);
+
+    std::vector<char> keep(count, 1);
+    parallelFor(count, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t t = begin; t < end; ++t)
+        {
+            const std::size_t b = buckets.bucket(hash[t]);
+            for (std::uint32_t j = buckets.start[b]; j < buckets.start[b + 1]; ++j)
+            {
+                const Buckets::Entry& entry = buckets.entries[j];
+                if (entry.item >= t || entry.hash != static_cast<std::uint32_t>(hash[t]))
+                    continue;
+
+                const Triangle& other = sorted[entry.item];
+                if (other.v[0] == sorted[t].v[0] && other.v[1] == sorted[t].v[1] && other.v[2] == sorted[t].v[2])
+                {
+                    keep[t] = 0;
+                    break;
+                }
+            }
+        }
+    }, threads);
+    return keep;
+}
+
+/**
+ * @brief Finds the neighbor of every edge: edge 3 * t + e is matched with the other triangle's edge between the same two points.
+ *
+ * @return std::vector<std::uint32_t> The matching edge, Boundary or NonManifold.
+ */
+std::vector<std::uint32_t> matchEdges(const std::vector<Triangle>& triangles, unsigned threads)
+{
+    const std::size_t edges = 3 * triangles.size();
+    auto endsOf = [&triangles](std::size_t edge, std::uint32_t& low, std::uint32_t& high) {
+        const std::uint32_t* v = triangles[edge / 3].v;
+        const std::uint32_t a = v[edge % 3];
+        const std::uint32_t b = v[(edge % 3 + 1) % 3];
+        low = std::min(a, b);
+        high = std::max(a, b);
+    };
+
+    std::vector<std::uint64_t> hash(edges);
+    parallelFor(edges, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t edge = begin; edge < end; ++edge)
+        {
+            std::uint32_t low;
+            std::uint32_t high;
+            endsOf(edge, low, high);
+            hash[edge] = hashOf(low, high, 0);
+        }
+    }, threads);
+
+    const Buckets buckets = bucketByHash(hash, threads);
+
+    std::vector<std::uint32_t> neighbor(edges);
+    parallelFor(edges, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t edge = begin; edge < end; ++edge)
+        {
+            std::uint32_t low;
+            std::uint32_t high;
+            endsOf(edge, low, high);
+
+            std::uint32_t match = Boundary;
+            const std::size_t b = buckets.bucket(hash[edge]);
+            for (std::uint32_t j = buckets.start[b]; j < buckets.start[b + 1]; ++j)
+            {
+                const Buckets::Entry& entry = buckets.entries[j];
+                if (entry.item == edge || entry.hash != static_cast<std::uint32_t>(hash[edge]))
+                    continue;
+
+                std::uint32_t otherLow;
+                std::uint32_t otherHigh;
+                endsOf(entry.item, otherLow, otherHigh);
+                if (otherLow != low || otherHigh != high)
+                    continue;
+
+                if (match != Boundary)
+                {
+                    match = NonManifold;
+                    break;
+                }
+                match = entry.item;
+            }
+            neighbor[edge] = match;
+        }
+    }, threads);
+    return neighbor;
+}
+
+/**
+ * @brief What orient() changed.
+ */
+struct Orientation
+{
+    std::size_t flipped = 0;   ///< Triangles to reverse.
+    std::size_t surfaces = 0;  ///< Connected surfaces.
+    std::size_t conflicts = 0; ///< Edges that cannot be made consistent, as on a Moebius strip.
+};
+
+/**
+ * @brief Decides which triangles to reverse so that neighbors run along their shared edge in opposite directions.
+ *
+ * Every connected surface is flooded breadth-first from its lowest-numbered triangle,
+ * and then reversed as a whole where that suits it better: an open surface keeps the
+ * winding most of its triangles had, a closed surface is turned to enclose a positive
+ * volume, which also turns the inner walls of hollow parts outwards.
+ */
+Orientation orient(const std::vector<Triangle>& triangles, const std::vector<std::uint32_t>& neighbor, const float* xyz,
+                   std::vector<char>& flipped)
+{
+    const std::size_t count = triangles.size();
+    std::vector<char> visited(count, 0);
+    std::vector<std::uint32_t> surface;
+    Orientation orientation;
+
+    for (std::size_t seed = 0; seed < count; ++seed)
+    {
+        if (visited[seed])
+            continue;
+
+        ++orientation.surfaces;
+        visited[seed] = 1;
+        surface.assign(1, static_cast<std::uint32_t>(seed));
+        bool closed = true;
+        for (std::size_t next = 0; next < surface.size(); ++next)
+        {
+            const std::uint32_t t = surface[next];
+            for (std::uint32_t e = 0; e < 3; ++e)
+            {
+                const std::uint32_t edge = 3 * t + e;
+                const std::uint32_t other = neighbor[edge];
+                if (other == Boundary || other == NonManifold)
+                {
+                    closed = false;
+                    continue;
+                }
+
+                // Running the same way round, the neighbor needs the opposite winding
+                const std::uint32_t u = other / 3;
+                const bool sameDirection = triangles[t].v[e] == triangles[u].v[other % 3];
+                const char wanted = static_cast<char>(flipped[t] ^ (sameDirection ? 1 : 0));
+                if (!visited[u])
+                {
+                    visited[u] = 1;
+                    flipped[u] = wanted;
+                    surface.push_back(u);
+                }
+                else if (flipped[u] != wanted && edge < other)
+                {
+                    ++orientation.conflicts;
+                }
+            }
+        }
+
+        // An open surface keeps the winding of most of its triangles
+        if (!closed)
+        {
+            const std::size_t reversed = static_cast<std::size_t>(std::count_if(surface.begin(), surface.end(), [&flipped](std::uint32_t t) { return flipped[t] != 0; }));
+            if (2 * reversed > surface.size())
+            {
+                for (std::uint32_t t : surface)
+                    flipped[t] ^= 1;
+            }
+            continue;
+        }
+
+        // Six times the enclosed volume, relative to a point of the surface to limit rounding
+        const float* origin = xyz + 3 * static_cast<std::size_t>(triangles[seed].v[0]);
+        double volume = 0.0;
+        for (std::uint32_t t : surface)
+        {
+            const std::uint32_t* v = triangles[t].v;
+            const float* a = xyz + 3 * static_cast<std::size_t>(v[0]);
+            const float* b = xyz + 3 * static_cast<std::size_t>(v[flipped[t] ? 2 : 1]);
+            const float* c = xyz + 3 * static_cast<std::size_t>(v[flipped[t] ? 1 : 2]);
+            const double p[3] = { static_cast<double>(a[0]) - origin[0], static_cast<double>(a[1]) - origin[1], static_cast<double>(a[2]) - origin[2] };
+            const double q[3] = { static_cast<double>(b[0]) - origin[0], static_cast<double>(b[1]) - origin[1], static_cast<double>(b[2]) - origin[2] };
+            const double r[3] = { static_cast<double>(c[0]) - origin[0], static_cast<double>(c[1]) - origin[1], static_cast<double>(c[2]) - origin[2] };
+            volume += p[0] * (q[1] * r[2] - q[2] * r[1]) + p[1] * (q[2] * r[0] - q[0] * r[2]) + p[2] * (q[0] * r[1] - q[1] * r[0]);
+        }
+        if (volume < 0.0)
+        {
+            for (std::uint32_t t : surface)
+                flipped[t] ^= 1;
+        }
+    }
+
+    orientation.flipped = static_cast<std::size_t>(std::count(flipped.begin(), flipped.end(), 1));
+    return orientation;
+}
+
+/**
+ * @brief What fillHoles() changed.
+ */
+struct HoleFill
+{
+    std::size_t closed = 0;    ///< Boundary loops closed.
+    std::size_t openEdges = 0; ///< Boundary edges left open.
+};
+
+/**
+ * @brief Closes the boundary loops of at most maxEdges edges, appending triangles and centroids.
+ *
+ * A hole's edges run against the boundary edges of the triangles around it, so a fan
+ * along them is wound like its neighbors. Loops through a point where several boundary
+ * edges start, and loops without area, are left open.
+ */
+HoleFill fillHoles(const std::vector<Triangle>& triangles, const std::vector<char>& flipped, const std::vector<std::uint32_t>& neighbor,
+                   const float* xyz, std::size_t points, std::size_t maxEdges,
+                   std::vector<Triangle>& added, std::vector<float>& addedPoints)
+{
+    struct Edge { std::uint32_t from; std::uint32_t to; };
+    std::vector<Edge> edges;
+    for (std::size_t edge = 0; edge < neighbor.size(); ++edge)
+    {
+        if (neighbor[edge] != Boundary)
+            continue;
+
+        const std::size_t t = edge / 3;
+        const std::uint32_t* v = triangles[t].v;
+        std::uint32_t a = v[edge % 3];
+        std::uint32_t b = v[(edge % 3 + 1) % 3];
+        if (!flipped.empty() && flipped[t])
+            std::swap(a, b);
+        edges.push_back({ b, a });
+    }
+    std::sort(edges.begin(), edges.end(), [](const Edge& x, const Edge& y) { return x.from != y.from ? x.from < y.from : x.to < y.to; });
+
+    // The only edge leaving a point, or none if zero or several do
+    const std::size_t none = edges.size();
+    auto leaving = [&edges, none](std::uint32_t from) {
+        const auto it = std::lower_bound(edges.begin(), edges.end(), from, [](const Edge& edge, std::uint32_t point) { return edge.from < point; });
+        if (it == edges.end() || it->from != from || (it + 1 != edges.end() && (it + 1)->from == from))
+            return none;
+        return static_cast<std::size_t>(it - edges.begin());
+    };
+
+    HoleFill fill;
+    std::size_t filledEdges = 0;
+    std::vector<char> used(edges.size(), 0);
+    std::vector<std::uint32_t> loop;
+    for (std::size_t start = 0; start < edges.size(); ++start)
+    {
+        if (used[start])
+            continue;
+
+        loop.clear();
+        bool closed = false;
+        for (std::size_t edge = start; edge != none && !used[edge]; edge = leaving(edges[edge].to))
+        {
+            used[edge] = 1;
+            loop.push_back(edges[edge].from);
+            if (edges[edge].to == edges[start].from)
+            {
+                closed = true;
+                break;
+            }
+        }
+        if (!closed || loop.size() < 3 || loop.size() > maxEdges)
+            continue;
+
+        // Newell normal and centroid of the loop
+        double normal[3] = { 0.0, 0.0, 0.0 };
+        double center[3] = { 0.0, 0.0, 0.0 };
+        double longestEdge = 0.0;
+        for (std::size_t k = 0; k < loop.size(); ++k)
+        {
+            const float* a = xyz + 3 * static_cast<std::size_t>(loop[k]);
+            const float* b = xyz + 3 * static_cast<std::size_t>(loop[(k + 1) % loop.size()]);
+            normal[0] += (static_cast<double>(a[1]) - b[1]) * (static_cast<double>(a[2]) + b[2]);
+            normal[1] += (static_cast<double>(a[2]) - b[2]) * (static_cast<double>(a[0]) + b[0]);
+            normal[2] += (static_cast<double>(a[0]) - b[0]) * (static_cast<double>(a[1]) + b[1]);
+            const double e[3] = { static_cast<double>(b[0]) - a[0], static_cast<double>(b[1]) - a[1], static_cast<double>(b[2]) - a[2] };
+            longestEdge = std::max(longestEdge, e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+            for (int axis = 0; axis < 3; ++axis)
+                center[axis] += a[axis];
+        }
+        if (0.5 * std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]) <= DegenerateArea * longestEdge)
+            continue;
+
+        ++fill.closed;
+        filledEdges += loop.size();
+        if (loop.size() == 3)
+        {
+            added.push_back({ { loop[0], loop[1], loop[2] } });
+            continue;
+        }
+
+        const std::uint32_t centroid = static_cast<std::uint32_t>(points + addedPoints.size() / 3);
+        for (int axis = 0; axis < 3; ++axis)
+            addedPoints.push_back(static_cast<float>(center[axis] / static_cast<double>(loop.size())));
+        for (std::size_t k = 0; k < loop.size(); ++k)
+            added.push_back({ { loop[k], loop[(k + 1) % loop.size()], centroid } });
+    }
+
+    fill.openEdges = edges.size() - filledEdges;
+    return fill;
+}
+
+} // namespace
+
+
+/**
+ * @brief Returns a repaired copy of the mesh.
+ *
+ * Triangles are gathered into one list, welded and filtered in place, then written to
+ * new 32-bit cell arrays with their final winding; the steps that are disabled in the
+ * options are skipped, except welding, which identical positions always go through.
+ *
+ * @param mesh The mesh; it is not modified.
+ * @param options Repair and threading settings.
+ * @return Result The repaired mesh and what every step changed, or an error message.
+ */
+MeshRepair::Result MeshRepair::repair(vtkPolyData* mesh, const Options& options)
+{
+    Result result;
+    if (!mesh || !mesh->GetPoints() || mesh->GetNumberOfPolys() + mesh->GetNumberOfStrips() == 0)
+    {
+        result.error = "There are no triangles to repair.";
+        return result;
+    }
+
+    const std::size_t points = static_cast<std::size_t>(mesh->GetNumberOfPoints());
+    if (points > Largest)
+    {
+        result.error = "The mesh has too many points to repair.";
+        return result;
+    }
+
+    TRACE_SCOPE("MeshRepair::repair", "geometry");
+
+    const unsigned threads = options.threads;
+    QElapsedTimer total;
+    total.start();
+    QElapsedTimer timer;
+    timer.start();
+    auto finishStep = [&result, &timer](const QString& description) {
+        result.steps.push_back({ description, timer.nsecsElapsed() / 1.0e9 });
+        timer.restart();
+    };
+    auto canceled = [&result, &options]() {
+        if (!options.cancel || !options.cancel->load())
+            return false;
+        result.error = "Repair was canceled.";
+        return true;
+    };
+
+    // Points as float32, converted only if stored otherwise
+    std::vector<float> convertedPoints;
+    const float* xyz = nullptr;
+    vtkDataArray* pointData = mesh->GetPoints()->GetData();
+    if (vtkFloatArray* floats = vtkFloatArray::SafeDownCast(pointData))
+    {
+        xyz = floats->GetPointer(0);
+    }
+    else
+    {
+        convertedPoints.resize(3 * points);
+        parallelFor(3 * points, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+                convertedPoints[i] = static_cast<float>(pointData->GetComponent(static_cast<vtkIdType>(i / 3), static_cast<int>(i % 3)));
+        }, threads);
+        xyz = convertedPoints.data();
+    }
+
+    std::vector<Triangle> triangles;
+    appendTriangles(mesh->GetPolys(), false, triangles, threads);
+    appendTriangles(mesh->GetStrips(), true, triangles, threads);
+    result.inputPoints = points;
+    result.inputTriangles = triangles.size();
+    if (3 * triangles.size() > Largest)
+    {
+        result.error = "The mesh has too many triangles to repair.";
+        return result;
+    }
+
+    // Weld, keeping the first point of every cluster
+    result.tolerance = options.weldTolerance < 0.0 ? defaultWeldTolerance(mesh) : options.weldTolerance;
+    const std::vector<std::uint32_t> cluster = weldPoints(xyz, points, result.tolerance, threads);
+
+    std::vector<char> keepPoint(points);
+    parallelFor(points, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            keepPoint[i] = cluster[i] == i ? 1 : 0;
+    }, threads);
+    std::vector<std::uint32_t> index;
+    const std::size_t keptPoints = numberKept(keepPoint, index, threads);
+
+    std::vector<float> welded(3 * keptPoints);
+    parallelFor(points, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            if (keepPoint[i])
+                std::copy(xyz + 3 * i, xyz + 3 * i + 3, welded.data() + 3 * static_cast<std::size_t>(index[i]));
+        }
+    }, threads);
+    parallelFor(triangles.size(), ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t t = begin; t < end; ++t)
+        {
+            for (std::uint32_t& v : triangles[t].v)
+                v = index[cluster[v]];
+        }
+    }, threads);
+    xyz = welded.data();
+
+    result.weldedPoints = points - keptPoints;
+    finishStep(QString("Welded %1 of %2 points closer than %3").arg(result.weldedPoints).arg(points).arg(result.tolerance, 0, 'g', 3));
+    if (canceled())
+        return result;
+
+    if (options.removeDegenerate)
+    {
+        result.degenerateTriangles = keepTriangles(triangles, findAreas(triangles, xyz, threads), threads);
+        finishStep(QString("Removed %1 degenerate triangles").arg(result.degenerateTriangles));
+        if (canceled())
+            return result;
+    }
+
+    if (options.removeDuplicates)
+    {
+        result.duplicateTriangles = keepTriangles(triangles, findUnique(triangles, threads), threads);
+        finishStep(QString("Removed %1 duplicate triangles").arg(result.duplicateTriangles));
+        if (canceled())
+            return result;
+    }
+
+    std::vector<char> flipped;
+    std::vector<Triangle> added;
+    std::vector<float> addedPoints;
+    if (options.orient || options.maxHoleEdges > 0)
+    {
+        const std::vector<std::uint32_t> neighbor = matchEdges(triangles, threads);
+        const std::size_t boundary = static_cast<std::size_t>(std::count(neighbor.begin(), neighbor.end(), Boundary));
+        result.nonManifoldEdges = static_cast<std::size_t>(std::count(neighbor.begin(), neighbor.end(), NonManifold));
+        result.openEdges = boundary;
+        finishStep(QString("Matched %1 edges: %2 open, %3 shared by more than two triangles")
+                       .arg(neighbor.size()).arg(boundary).arg(result.nonManifoldEdges));
+        if (canceled())
+            return result;
+
+        flipped.assign(triangles.size(), 0);
+        if (options.orient)
+        {
+            const Orientation orientation = orient(triangles, neighbor, xyz, flipped);
+            result.flippedTriangles = orientation.flipped;
+            QString description = QString("Flipped %1 triangles of %2 surfaces").arg(orientation.flipped).arg(orientation.surfaces);
+            if (orientation.conflicts > 0)
+                description += QString(", %1 edges cannot be oriented").arg(orientation.conflicts);
+            finishStep(description);
+            if (canceled())
+                return result;
+        }
+
+        if (options.maxHoleEdges > 0 && boundary > 0)
+        {
+            const HoleFill fill = fillHoles(triangles, flipped, neighbor, xyz, keptPoints, options.maxHoleEdges, added, addedPoints);
+            result.closedHoles = fill.closed;
+            result.addedTriangles = added.size();
+            result.openEdges = fill.openEdges;
+            finishStep(QString("Closed %1 holes with %2 triangles, %3 open edges left")
+                           .arg(fill.closed).arg(added.size()).arg(fill.openEdges));
+        }
+    }
+
+    const std::size_t outPoints = keptPoints + addedPoints.size() / 3;
+    const std::size_t outTriangles = triangles.size() + added.size();
+    if (outTriangles == 0)
+    {
+        result.error = "No triangles are left after the repair.";
+        return result;
+    }
+    if (outPoints > Largest || 3 * outTriangles > Largest)
+    {
+        result.error = "The repaired mesh has too many triangles.";
+        return result;
+    }
+
+    vtkSmartPointer<vtkFloatArray> coordinates = vtkSmartPointer<vtkFloatArray>::New();
+    coordinates->SetNumberOfComponents(3);
+    coordinates->SetNumberOfTuples(static_cast<vtkIdType>(outPoints));
+    float* outXyz = coordinates->GetPointer(0);
+    parallelFor(welded.size(), ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        std::copy(welded.data() + begin, welded.data() + end, outXyz + begin);
+    }, threads);
+    std::copy(addedPoints.begin(), addedPoints.end(), outXyz + welded.size());
+
+    vtkSmartPointer<vtkTypeInt32Array> offsets = vtkSmartPointer<vtkTypeInt32Array>::New();
+    offsets->SetNumberOfValues(static_cast<vtkIdType>(outTriangles + 1));
+    vtkSmartPointer<vtkTypeInt32Array> connectivity = vtkSmartPointer<vtkTypeInt32Array>::New();
+    connectivity->SetNumberOfValues(static_cast<vtkIdType>(3 * outTriangles));
+    std::int32_t* outOffsets = offsets->GetPointer(0);
+    std::int32_t* outIds = connectivity->GetPointer(0);
+    parallelFor(outTriangles + 1, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t t = begin; t < end; ++t)
+            outOffsets[t] = static_cast<std::int32_t>(3 * t);
+    }, threads);
+    parallelFor(outTriangles, ItemsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t t = begin; t < end; ++t)
+        {
+            const bool fromMesh = t < triangles.size();
+            const Triangle& triangle = fromMesh ? triangles[t] : added[t - triangles.size()];
+            const bool reverse = fromMesh && !flipped.empty() && flipped[t];
+            outIds[3 * t + 0] = static_cast<std::int32_t>(triangle.v[0]);
+            outIds[3 * t + 1] = static_cast<std::int32_t>(triangle.v[reverse ? 2 : 1]);
+            outIds[3 * t + 2] = static_cast<std::int32_t>(triangle.v[reverse ? 1 : 2]);
+        }
+    }, threads);
+
+    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+    polys->SetData(offsets, connectivity);
+
+    vtkSmartPointer<vtkPoints> outPointSet = vtkSmartPointer<vtkPoints>::New();
+    outPointSet->SetData(coordinates);
+
+    result.mesh = vtkSmartPointer<vtkPolyData>::New();
+    result.mesh->SetPoints(outPointSet);
+    result.mesh->SetPolys(polys);
+    result.seconds = total.nsecsElapsed() / 1.0e9;
+    return result;
+}
+
+
+/**
+ * @brief Returns 1e-6 of the diagonal of the mesh's bounds.
+ *
+ * @param mesh The mesh; may be null.
+ * @return double The tolerance, or 0 if there are no points.
+ */
+double MeshRepair::defaultWeldTolerance(vtkPolyData* mesh)
+{
+    if (!mesh || mesh->GetNumberOfPoints() == 0)
+        return 0.0;
+    return 1e-6 * mesh->GetLength();
+}
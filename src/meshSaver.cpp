@@ -0,0 +1,123 @@
+/**
+ * @file meshSaver.cpp
+ * @brief Implementation of the MeshSaver class.
+ */
+
+#include "meshSaver.h"
+#include "trace.h"
+
+#include <QMetaObject>
+
+
+/**
+ * @brief Constructs an idle saver.
+ *
+ * @param parent Parent QObject.
+ */
+MeshSaver::MeshSaver(QObject* parent)
+    : QObject(parent)
+{
+}
+
+
+/**
+ * @brief Cancels the running save, drops the queued ones and waits for the worker thread.
+ */
+MeshSaver::~MeshSaver()
+{
+    mQueue.clear();
+    if (mJob)
+        mJob->cancel = true;
+
+    if (mWorker.joinable())
+        mWorker.join();
+}
+
+
+/**
+ * @brief Saves a mesh, or queues the save if another one is running.
+ *
+ * @param path Path of the STL file.
+ * @param mesh The mesh to save.
+ */
+void MeshSaver::save(const QString& path, vtkSmartPointer<vtkPolyData> mesh)
+{
+    mQueue.emplace_back(path, mesh);
+    if (!mJob)
+        startNext();
+}
+
+
+/**
+ * @brief Cancels the running save and drops the queued ones.
+ *
+ * The worker stops at its next block of cells and removes the incomplete file;
+ * failed() is emitted for it once it has.
+ */
+void MeshSaver::cancel()
+{
+    mQueue.clear();
+    if (mJob)
+        mJob->cancel = true;
+}
+
+
+/**
+ * @brief Starts the worker for the first queued save, if any.
+ */
+void MeshSaver::startNext()
+{
+    if (mQueue.empty())
+        return;
+
+    mJob = std::make_shared<Job>();
+    mJob->path = mQueue.front().first;
+    mJob->mesh = mQueue.front().second;
+    mQueue.pop_front();
+
+    mWorker = std::thread(&MeshSaver::run, this, mJob);
+}
+
+
+/**
+ * @brief Body of the worker thread: writes the file and posts the result back.
+ */
+void MeshSaver::run(std::shared_ptr<Job> job)
+{
+    Trace::setThreadName("MeshSaver");
+
+    // Report whole percents only, so the event queue is not flooded
+    std::atomic<int> lastPercent{ -1 };
+
+    StlWriter::Options options;
+    options.cancel = &job->cancel;
+    options.progress = [this, &lastPercent](double fraction) {
+        const int percent = static_cast<int>(fraction * 100.0);
+        if (lastPercent.exchange(percent) == percent)
+            return;
+
+        QMetaObject::invokeMethod(this, [this, fraction]() { emit progressChanged(fraction); }, Qt::QueuedConnection);
+    };
+
+    const StlWriter::Result result = StlWriter::write(job->path, job->mesh, options);
+
+    QMetaObject::invokeMethod(this, [this, job, result]() { finish(job, result); }, Qt::QueuedConnection);
+}
+
+
+/**
+ * @brief Joins the finished worker, reports its result and starts the next queued save.
+ */
+void MeshSaver::finish(const std::shared_ptr<Job>& job, const StlWriter::Result& result)
+{
+    if (mWorker.joinable())
+        mWorker.join();
+    mJob.reset();
+
+    if (result.ok())
+        emit saved(job->path, result);
+    else
+        emit failed(job->path, result.error);
+
+    startNext();
+}
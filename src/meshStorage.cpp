@@ -0,0 +1,285 @@
+/**
+ * @file meshStorage.cpp
+ * @brief Implementation of the MeshStorage class.
+ */
+
+#include "meshStorage.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+
+namespace
+{
+
+constexpr std::size_t ValuesPerBlock = 1 << 16;
+
+std::atomic<MeshStorage::Mode> gMode{ MeshStorage::Mode::Default };
+
+/**
+ * @brief Returns the bytes of an array's values.
+ */
+std::size_t arrayBytes(vtkAbstractArray* array)
+{
+    return array ? static_cast<std::size_t>(array->GetNumberOfValues()) * static_cast<std::size_t>(array->GetDataTypeSize()) : 0;
+}
+
+/**
+ * @brief Returns the bytes of the offsets and connectivity of a cell array.
+ */
+std::size_t cellBytes(vtkCellArray* cells)
+{
+    return cells ? arrayBytes(cells->GetOffsetsArray()) + arrayBytes(cells->GetConnectivityArray()) : 0;
+}
+
+/**
+ * @brief Returns true if the cell array is absent or stores 32-bit ids.
+ */
+bool is32Bit(vtkCellArray* cells)
+{
+    return !cells || !cells->IsStorage64Bit();
+}
+
+/**
+ * @brief Returns true if the array is absent or stores floats.
+ */
+bool isFloat(vtkDataArray* array)
+{
+    return !array || array->GetDataType() == VTK_FLOAT;
+}
+
+/**
+ * @brief Copies an array of any numeric type into a new float32 array with the same name and shape.
+ */
+vtkSmartPointer<vtkFloatArray> toFloat(vtkDataArray* source, unsigned threads)
+{
+    const int components = source->GetNumberOfComponents();
+    const vtkIdType tuples = source->GetNumberOfTuples();
+
+    vtkSmartPointer<vtkFloatArray> target = vtkSmartPointer<vtkFloatArray>::New();
+    target->SetName(source->GetName());
+    target->SetNumberOfComponents(components);
+    target->SetNumberOfTuples(tuples);
+    float* out = target->GetPointer(0);
+
+    const std::size_t values = static_cast<std::size_t>(tuples) * static_cast<std::size_t>(components);
+    if (vtkDoubleArray* doubles = vtkDoubleArray::SafeDownCast(source))
+    {
+        const double* in = doubles->GetPointer(0);
+        parallelFor(values, ValuesPerBlock, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+                out[i] = static_cast<float>(in[i]);
+        }, threads);
+    }
+    else
+    {
+        parallelFor(values, ValuesPerBlock, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const vtkIdType tuple = static_cast<vtkIdType>(i / components);
+                out[i] = static_cast<float>(source->GetComponent(tuple, static_cast<int>(i % components)));
+            }
+        }, threads);
+    }
+    return target;
+}
+
+/**
+ * @brief Copies a cell array with 64-bit ids into one with 32-bit ids; returns the input if the ids do not fit.
+ *
+ * @param source The cell array.
+ * @param points Number of points of the mesh, which bounds the point ids.
+ * @param threads Worker threads of the copy.
+ */
+vtkSmartPointer<vtkCellArray> to32Bit(vtkCellArray* source, vtkIdType points, unsigned threads)
+{
+    vtkTypeInt64Array* sourceOffsets = source->GetOffsetsArray64();
+    vtkTypeInt64Array* sourceConnectivity = source->GetConnectivityArray64();
+    const std::size_t offsetCount = static_cast<std::size_t>(sourceOffsets->GetNumberOfValues());
+    const std::size_t connectivityCount = static_cast<std::size_t>(sourceConnectivity->GetNumberOfValues());
+
+    constexpr std::size_t Largest = static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max());
+    if (connectivityCount > Largest || static_cast<std::size_t>(points) > Largest)
+        return source;
+
+    const std::int64_t* inOffsets = sourceOffsets->GetPointer(0);
+    const std::int64_t* inConnectivity = sourceConnectivity->GetPointer(0);
+
+    vtkSmartPointer<vtkTypeInt32Array> offsets = vtkSmartPointer<vtkTypeInt32Array>::New();
+    offsets->SetNumberOfValues(static_cast<vtkIdType>(offsetCount));
+    vtkSmartPointer<vtkTypeInt32Array> connectivity = vtkSmartPointer<vtkTypeInt32Array>::New();
+    connectivity->SetNumberOfValues(static_cast<vtkIdType>(connectivityCount));
+
+    std::int32_t* outOffsets = offsets->GetPointer(0);
+    std::int32_t* outConnectivity = connectivity->GetPointer(0);
+    parallelFor(offsetCount, ValuesPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            outOffsets[i] = static_cast<std::int32_t>(inOffsets[i]);
+    }, threads);
+    parallelFor(connectivityCount, ValuesPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            outConnectivity[i] = static_cast<std::int32_t>(inConnectivity[i]);
+    }, threads);
+
+    vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+    cells->SetData(offsets, connectivity);
+    return cells;
+}
+
+} // namespace
+
+
+/**
+ * @brief Sets the storage of meshes built from now on.
+ *
+ * @param mode The new mode.
+ */
+void MeshStorage::setMode(Mode mode)
+{
+    gMode = mode;
+}
+
+
+/**
+ * @brief Returns the storage of newly built meshes.
+ *
+ * @return Mode The current mode.
+ */
+MeshStorage::Mode MeshStorage::mode()
+{
+    return gMode;
+}
+
+
+/**
+ * @brief Returns the mesh in the storage of the current mode.
+ *
+ * @param mesh The mesh; it is not modified.
+ * @return vtkSmartPointer<vtkPolyData> The mesh in the current mode's storage.
+ */
+vtkSmartPointer<vtkPolyData> MeshStorage::adapt(vtkPolyData* mesh)
+{
+    if (mode() == Mode::Compact)
+        return compact(mesh);
+    return mesh;
+}
+
+
+/**
+ * @brief Returns a mesh storing float32 points and normals and 32-bit cell ids.
+ *
+ * The output is a shallow copy of the input whose converted arrays are replaced.
+ *
+ * @param mesh The mesh; it is not modified.
+ * @param threads Worker threads of the conversion; 0 uses every core.
+ * @return vtkSmartPointer<vtkPolyData> The compact mesh, or the input if it is compact already.
+ */
+vtkSmartPointer<vtkPolyData> MeshStorage::compact(vtkPolyData* mesh, unsigned threads)
+{
+    if (!mesh || isCompact(mesh))
+        return mesh;
+
+    TRACE_SCOPE("MeshStorage::compact", "geometry");
+
+    vtkSmartPointer<vtkPolyData> result = vtkSmartPointer<vtkPolyData>::New();
+    result->ShallowCopy(mesh);
+
+    vtkPoints* points = mesh->GetPoints();
+    if (points && !isFloat(points->GetData()))
+    {
+        vtkSmartPointer<vtkPoints> floatPoints = vtkSmartPointer<vtkPoints>::New();
+        floatPoints->SetData(toFloat(points->GetData(), threads));
+        result->SetPoints(floatPoints);
+    }
+
+    vtkDataArray* normals = mesh->GetPointData()->GetNormals();
+    if (!isFloat(normals))
+        result->GetPointData()->SetNormals(toFloat(normals, threads));
+
+    if (!is32Bit(mesh->GetVerts()))
+        result->SetVerts(to32Bit(mesh->GetVerts(), mesh->GetNumberOfPoints(), threads));
+    if (!is32Bit(mesh->GetLines()))
+        result->SetLines(to32Bit(mesh->GetLines(), mesh->GetNumberOfPoints(), threads));
+    if (!is32Bit(mesh->GetPolys()))
+        result->SetPolys(to32Bit(mesh->GetPolys(), mesh->GetNumberOfPoints(), threads));
+    if (!is32Bit(mesh->GetStrips()))
+        result->SetStrips(to32Bit(mesh->GetStrips(), mesh->GetNumberOfPoints(), threads));
+
+    return result;
+}
+
+
+/**
+ * @brief Returns true if the mesh stores float32 points and normals and 32-bit cell ids.
+ *
+ * @param mesh The mesh.
+ * @return bool True if compact() would return the mesh itself.
+ */
+bool MeshStorage::isCompact(vtkPolyData* mesh)
+{
+    vtkPoints* points = mesh->GetPoints();
+    return (!points || isFloat(points->GetData())) &&
+           isFloat(mesh->GetPointData()->GetNormals()) &&
+           is32Bit(mesh->GetVerts()) && is32Bit(mesh->GetLines()) &&
+           is32Bit(mesh->GetPolys()) && is32Bit(mesh->GetStrips());
+}
+
+
+/**
+ * @brief Measures the memory of a mesh's arrays.
+ *
+ * Counts the bytes of the values, not the capacity allocated for them.
+ *
+ * @param mesh The mesh.
+ * @return Footprint The bytes per role and the number of triangles.
+ */
+MeshStorage::Footprint MeshStorage::measure(vtkPolyData* mesh)
+{
+    Footprint footprint;
+    if (!mesh)
+        return footprint;
+
+    if (vtkPoints* points = mesh->GetPoints())
+        footprint.pointBytes = arrayBytes(points->GetData());
+
+    vtkDataArray* normals = mesh->GetPointData()->GetNormals();
+    footprint.normalBytes = arrayBytes(normals);
+
+    for (vtkFieldData* attributes : { static_cast<vtkFieldData*>(mesh->GetPointData()), static_cast<vtkFieldData*>(mesh->GetCellData()) })
+    {
+        for (int i = 0; i < attributes->GetNumberOfArrays(); ++i)
+        {
+            vtkAbstractArray* array = attributes->GetAbstractArray(i);
+            if (array != normals)
+                footprint.otherBytes += arrayBytes(array);
+        }
+    }
+
+    for (vtkCellArray* cells : { mesh->GetVerts(), mesh->GetLines(), mesh->GetPolys(), mesh->GetStrips() })
+        footprint.cellBytes += cellBytes(cells);
+
+    // A polygon of n points is n - 2 triangles, as is a strip
+    for (vtkCellArray* cells : { mesh->GetPolys(), mesh->GetStrips() })
+    {
+        if (!cells)
+            continue;
+        const vtkIdType cellCount = cells->GetNumberOfCells();
+        const vtkIdType ids = cells->GetNumberOfConnectivityIds();
+        if (ids > 2 * cellCount)
+            footprint.triangles += static_cast<std::size_t>(ids - 2 * cellCount);
+    }
+
+    return footprint;
+}
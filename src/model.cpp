@@ -1,18 +1,182 @@
 #include "model.h"
+#include "meshStorage.h"
+#include "primitiveSource.h"
 
-#include <vtkNew.h>
-#include <vtkActor.h>
+#include <vtkCellArray.h>
+#include <vtkPoints.h>
+#include <vtkTrivialProducer.h>
 
 #include <vtkCubeSource.h>
-#include <vtkSphereSource.h>
-#include <vtkConeSource.h>
-#include <vtkCylinderSource.h>
-#include <vtkLineSource.h>
 #include <vtkTubeFilter.h>
 #include <vtkParametricFunctionSource.h>
-#include <vtkParametricTorus.h>
 #include <vtkParametricSpline.h>
-#include <vtkParametricFunctionSource.h>
+
+#include <vtkMath.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <initializer_list>
+
+
+
+/**
+ * @brief Compares two shape keys for equality.
+ *
+ * @param other The key to compare with.
+ * @return true if type, parameters and resolution all match.
+ */
+bool ShapeKey::operator==(const ShapeKey& other) const
+{
+    return type == other.type && parameters == other.parameters && resolution == other.resolution;
+}
+
+/**
+ * @brief Combines the hashes of all key fields.
+ *
+ * @param key The key to hash.
+ * @return std::size_t The hash value.
+ */
+std::size_t ShapeKeyHash::operator()(const ShapeKey& key) const
+{
+    std::size_t seed = std::hash<std::string>()(key.type);
+    auto combine = [&seed](std::size_t value) {
+        seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+    };
+
+    for (double parameter : key.parameters)
+        combine(std::hash<double>()(parameter));
+    combine(std::hash<int>()(key.resolution));
+
+    return seed;
+}
+
+
+
+/**
+ * @brief Creates a policy bounding the chordal error in model units.
+ *
+ * @param maxChordalError Maximum distance between the tessellation and the true surface.
+ * @return TessellationPolicy The policy.
+ */
+TessellationPolicy TessellationPolicy::fromChordalError(double maxChordalError)
+{
+    TessellationPolicy policy;
+    policy.maxChordalError = maxChordalError;
+    return policy;
+}
+
+/**
+ * @brief Creates a policy bounding the error on screen.
+ *
+ * @param pixels Maximum deviation from the true surface in pixels.
+ * @param pixelsPerUnit Pixels covered by one model unit at the shape's distance.
+ * @return TessellationPolicy The policy; the default resolution if pixelsPerUnit is not positive.
+ */
+TessellationPolicy TessellationPolicy::fromPixelError(double pixels, double pixelsPerUnit)
+{
+    return fromChordalError(pixelsPerUnit > 0.0 ? pixels / pixelsPerUnit : 0.0);
+}
+
+/**
+ * @brief Returns the number of segments for a curve of the given radius.
+ *
+ * The count is rounded up to a multiple of 4, so nearby errors map to the same
+ * mesh and share one cache entry.
+ *
+ * @param radius Radius of the curve in model units.
+ * @param defaultSegments Segments used when the policy has no error bound.
+ * @return int The number of segments.
+ */
+int TessellationPolicy::segmentsFor(double radius, int defaultSegments) const
+{
+    if (maxChordalError <= 0.0 || radius <= 0.0)
+        return defaultSegments;
+    if (maxChordalError >= radius)
+        return minSegments;
+
+    const double segments = vtkMath::Pi() / std::acos(1.0 - maxChordalError / radius);
+    const int rounded = (static_cast<int>(std::ceil(segments)) + 3) / 4 * 4;
+    return std::clamp(rounded, minSegments, maxSegments);
+}
+
+
+
+namespace
+{
+
+/**
+ * @brief Sets one of a shape's fields to a value clamped to the range of its parameter.
+ *
+ * @param parameters The shape's parameters.
+ * @param index Index of the parameter to set.
+ * @param value The new value.
+ * @param fields The shape's fields, in the order of its parameters.
+ */
+void setClamped(const std::vector<ShapeParameter>& parameters, std::size_t index, double value, std::initializer_list<double*> fields)
+{
+    if (index < parameters.size() && index < fields.size())
+        *fields.begin()[index] = std::clamp(value, parameters[index].minimum, parameters[index].maximum);
+}
+
+/**
+ * @brief Returns a stage of a pipeline as the type the shape created it with.
+ */
+template <typename Stage>
+Stage* stage(const ShapePipeline& pipeline, std::size_t index)
+{
+    return static_cast<Stage*>(pipeline.stages[index].Get());
+}
+
+} // namespace
+
+
+
+/**
+ * @brief Executes the modified stages of the pipeline and returns a standalone copy of the output.
+ *
+ * VTK sources allocate new arrays whenever they execute, so the copy keeps its arrays
+ * when the pipeline runs again; the copy is stored as the MeshStorage mode asks.
+ *
+ * @return vtkSmartPointer<vtkPolyData> The generated mesh.
+ */
+vtkSmartPointer<vtkPolyData> ShapePipeline::update() const
+{
+    output->Update();
+
+    vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
+    mesh->ShallowCopy(output->GetOutputDataObject(0));
+    return MeshStorage::adapt(mesh);
+}
+
+
+
+/**
+ * @brief Generates the shape and returns a mapper showing it.
+ *
+ * @param policy How finely curved surfaces are tessellated.
+ * @return vtkSmartPointer<vtkPolyDataMapper> A mapper whose input is the generated mesh.
+ */
+vtkSmartPointer<vtkPolyDataMapper> Shape::createShape(const TessellationPolicy& policy) const
+{
+    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    mapper->SetInputData(createMesh(policy));
+    return mapper;
+}
+
+
+/**
+ * @brief Builds a new pipeline of the shape, runs it and returns its output.
+ *
+ * @param policy How finely curved surfaces are tessellated.
+ * @return vtkSmartPointer<vtkPolyData> The generated mesh.
+ */
+vtkSmartPointer<vtkPolyData> Shape::createMesh(const TessellationPolicy& policy) const
+{
+    ShapePipeline pipeline = createPipeline();
+    configurePipeline(pipeline, policy);
+    return pipeline.update();
+}
 
 
 
@@ -35,23 +199,68 @@ Cube::~Cube()
 }
 
 /**
- * @brief Generates and returns a Cube-shaped vtkPolyDataMapper object.
+ * @brief Returns the key identifying the geometry generated by this Cube.
+ *
+ * @param policy How finely curved surfaces are tessellated.
+ * @return ShapeKey The type, dimensions and resolution of the Cube.
+ */
+ShapeKey Cube::key(const TessellationPolicy& /*policy*/) const
+{
+    return ShapeKey{ "Cube", { xLength, yLength, zLength }, 0 };
+}
+
+/**
+ * @brief Returns a copy of this Cube.
+ */
+std::unique_ptr<Shape> Cube::clone() const
+{
+    return std::make_unique<Cube>(*this);
+}
+
+/**
+ * @brief Returns the lengths of the Cube along each axis.
+ */
+std::vector<ShapeParameter> Cube::parameters() const
+{
+    return { { "X length", xLength, 1.0, 200.0 },
+             { "Y length", yLength, 1.0, 200.0 },
+             { "Z length", zLength, 1.0, 200.0 } };
+}
+
+/**
+ * @brief Changes a length of the Cube.
  *
- * @return vtkSmartPointer<vtkPolyDataMapper> The mapper representing the Cube shape.
+ * @param index 0, 1 or 2 for the x, y or z length.
+ * @param value The new length.
  */
-vtkSmartPointer<vtkPolyDataMapper> Cube::createShape() const
+void Cube::setParameter(std::size_t index, double value)
+{
+    setClamped(parameters(), index, value, { &xLength, &yLength, &zLength });
+}
+
+/**
+ * @brief Creates the pipeline of the Cube: a single vtkCubeSource.
+ *
+ * @return ShapePipeline The pipeline.
+ */
+ShapePipeline Cube::createPipeline() const
 {
     vtkSmartPointer<vtkCubeSource> cubeSource = vtkSmartPointer<vtkCubeSource>::New();
+    return ShapePipeline{ { cubeSource }, cubeSource };
+}
 
+/**
+ * @brief Pushes the lengths of the Cube into its pipeline.
+ *
+ * @param pipeline A pipeline created by createPipeline().
+ * @param policy How finely curved surfaces are tessellated.
+ */
+void Cube::configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& /*policy*/) const
+{
+    vtkCubeSource* cubeSource = stage<vtkCubeSource>(pipeline, 0);
     cubeSource->SetXLength(xLength);
     cubeSource->SetYLength(yLength);
     cubeSource->SetZLength(zLength);
-
-    cubeSource->Update();
-
-    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-    mapper->SetInputData(cubeSource->GetOutput());
-    return mapper;
 }
 
 
@@ -74,21 +283,68 @@ Sphere::~Sphere()
 }
 
 /**
- * @brief Generates and returns a Sphere-shaped vtkPolyDataMapper object.
+ * @brief Returns the key identifying the geometry generated by this Sphere.
  *
- * @return vtkSmartPointer<vtkPolyDataMapper> The mapper representing the Sphere shape.
+ * @param policy How finely curved surfaces are tessellated.
+ * @return ShapeKey The type, dimensions and resolution of the Sphere.
  */
-vtkSmartPointer<vtkPolyDataMapper>  Sphere::createShape() const
+ShapeKey Sphere::key(const TessellationPolicy& policy) const
 {
-    vtkSmartPointer<vtkSphereSource> sphereSource = vtkSmartPointer<vtkSphereSource>::New();
-    sphereSource->SetRadius(radius);
-    sphereSource->SetPhiResolution(100);
-    sphereSource->SetThetaResolution(100);
-    sphereSource->Update();
+    return ShapeKey{ "Sphere", { radius }, policy.segmentsFor(radius, 100) };
+}
 
-    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-    mapper->SetInputData(sphereSource->GetOutput());
-    return mapper;
+/**
+ * @brief Returns a copy of this Sphere.
+ */
+std::unique_ptr<Shape> Sphere::clone() const
+{
+    return std::make_unique<Sphere>(*this);
+}
+
+/**
+ * @brief Returns the radius of the Sphere.
+ */
+std::vector<ShapeParameter> Sphere::parameters() const
+{
+    return { { "Radius", radius, 0.5, 50.0 } };
+}
+
+/**
+ * @brief Changes the radius of the Sphere.
+ *
+ * @param index 0 for the radius.
+ * @param value The new radius.
+ */
+void Sphere::setParameter(std::size_t index, double value)
+{
+    setClamped(parameters(), index, value, { &radius });
+}
+
+/**
+ * @brief Creates the pipeline of the Sphere: a single PrimitiveSource.
+ *
+ * @return ShapePipeline The pipeline.
+ */
+ShapePipeline Sphere::createPipeline() const
+{
+    vtkSmartPointer<PrimitiveSource> source = vtkSmartPointer<PrimitiveSource>::New();
+    return ShapePipeline{ { source }, source };
+}
+
+/**
+ * @brief Pushes the radius and resolution of the Sphere into its pipeline.
+ *
+ * @param pipeline A pipeline created by createPipeline().
+ * @param policy How finely curved surfaces are tessellated.
+ */
+void Sphere::configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& policy) const
+{
+    Primitive sphere;
+    sphere.kind = Primitive::Kind::Sphere;
+    sphere.radius = radius;
+    sphere.resolution = policy.segmentsFor(radius, 100);
+    sphere.secondaryResolution = policy.segmentsFor(radius, 100);
+    stage<PrimitiveSource>(pipeline, 0)->setPrimitive(sphere);
 }
 
 
@@ -111,23 +367,71 @@ Hemisphere::~Hemisphere()
 }
 
 /**
- * @brief Generates and returns a Hemisphere-shaped vtkPolyDataMapper object.
+ * @brief Returns the key identifying the geometry generated by this Hemisphere.
  *
- * @return vtkSmartPointer<vtkPolyDataMapper> The mapper representing the Hemisphere shape.
+ * @param policy How finely curved surfaces are tessellated.
+ * @return ShapeKey The type, dimensions and resolution of the Hemisphere.
  */
-vtkSmartPointer<vtkPolyDataMapper> Hemisphere::createShape() const
+ShapeKey Hemisphere::key(const TessellationPolicy& policy) const
 {
-    vtkSmartPointer<vtkSphereSource> sphereSource = vtkSmartPointer<vtkSphereSource>::New();
-    sphereSource->SetRadius(radius);
-    sphereSource->SetStartTheta(0);
-    sphereSource->SetEndTheta(180);
-    sphereSource->SetPhiResolution(100);
-    sphereSource->SetThetaResolution(100);
-    sphereSource->Update();
+    return ShapeKey{ "Hemisphere", { radius }, policy.segmentsFor(radius, 100) };
+}
 
-    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-    mapper->SetInputData(sphereSource->GetOutput());
-    return mapper;
+/**
+ * @brief Returns a copy of this Hemisphere.
+ */
+std::unique_ptr<Shape> Hemisphere::clone() const
+{
+    return std::make_unique<Hemisphere>(*this);
+}
+
+/**
+ * @brief Returns the radius of the Hemisphere.
+ */
+std::vector<ShapeParameter> Hemisphere::parameters() const
+{
+    return { { "Radius", radius, 0.5, 50.0 } };
+}
+
+/**
+ * @brief Changes the radius of the Hemisphere.
+ *
+ * @param index 0 for the radius.
+ * @param value The new radius.
+ */
+void Hemisphere::setParameter(std::size_t index, double value)
+{
+    setClamped(parameters(), index, value, { &radius });
+}
+
+/**
+ * @brief Creates the pipeline of the Hemisphere: a single PrimitiveSource.
+ *
+ * @return ShapePipeline The pipeline.
+ */
+ShapePipeline Hemisphere::createPipeline() const
+{
+    vtkSmartPointer<PrimitiveSource> source = vtkSmartPointer<PrimitiveSource>::New();
+    return ShapePipeline{ { source }, source };
+}
+
+/**
+ * @brief Pushes the radius and resolution of the Hemisphere into its pipeline.
+ *
+ * @param pipeline A pipeline created by createPipeline().
+ * @param policy How finely curved surfaces are tessellated.
+ */
+void Hemisphere::configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& policy) const
+{
+    // Half a turn of longitudes
+    Primitive hemisphere;
+    hemisphere.kind = Primitive::Kind::Sphere;
+    hemisphere.radius = radius;
+    hemisphere.resolution = policy.segmentsFor(radius, 100);
+    hemisphere.secondaryResolution = policy.segmentsFor(radius, 100);
+    hemisphere.startTheta = 0.0;
+    hemisphere.endTheta = 180.0;
+    stage<PrimitiveSource>(pipeline, 0)->setPrimitive(hemisphere);
 }
 
 
@@ -149,20 +453,78 @@ Cone::~Cone()
 }
 
 /**
- * @brief Generates and returns a cone-shaped vtkPolyDataMapper object.
+ * @brief Returns the radius of the Cone's base: the cone keeps a unit height and derives the radius from the angle.
  *
- * @return vtkSmartPointer<vtkPolyDataMapper> The mapper representing the Cone shape.
+ * @return double The base radius.
  */
-vtkSmartPointer<vtkPolyDataMapper> Cone::createShape() const
+double Cone::baseRadius() const
 {
-    vtkSmartPointer<vtkConeSource> coneSource = vtkSmartPointer<vtkConeSource>::New();
-    coneSource->SetAngle(angle);
-    coneSource->SetResolution(100);
-    coneSource->Update();
+    return std::tan(vtkMath::RadiansFromDegrees(angle));
+}
 
-    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-    mapper->SetInputData(coneSource->GetOutput());
-    return mapper;
+/**
+ * @brief Returns the key identifying the geometry generated by this Cone.
+ *
+ * @param policy How finely curved surfaces are tessellated.
+ * @return ShapeKey The type, dimensions and resolution of the Cone.
+ */
+ShapeKey Cone::key(const TessellationPolicy& policy) const
+{
+    return ShapeKey{ "Cone", { angle }, policy.segmentsFor(baseRadius(), 100) };
+}
+
+/**
+ * @brief Returns a copy of this Cone.
+ */
+std::unique_ptr<Shape> Cone::clone() const
+{
+    return std::make_unique<Cone>(*this);
+}
+
+/**
+ * @brief Returns the half-angle of the Cone in degrees.
+ */
+std::vector<ShapeParameter> Cone::parameters() const
+{
+    return { { "Angle", angle, 5.0, 80.0 } };
+}
+
+/**
+ * @brief Changes the half-angle of the Cone.
+ *
+ * @param index 0 for the angle.
+ * @param value The new angle in degrees.
+ */
+void Cone::setParameter(std::size_t index, double value)
+{
+    setClamped(parameters(), index, value, { &angle });
+}
+
+/**
+ * @brief Creates the pipeline of the Cone: a single PrimitiveSource.
+ *
+ * @return ShapePipeline The pipeline.
+ */
+ShapePipeline Cone::createPipeline() const
+{
+    vtkSmartPointer<PrimitiveSource> source = vtkSmartPointer<PrimitiveSource>::New();
+    return ShapePipeline{ { source }, source };
+}
+
+/**
+ * @brief Pushes the shape and resolution of the Cone into its pipeline.
+ *
+ * @param pipeline A pipeline created by createPipeline().
+ * @param policy How finely curved surfaces are tessellated.
+ */
+void Cone::configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& policy) const
+{
+    Primitive cone;
+    cone.kind = Primitive::Kind::Cone;
+    cone.radius = baseRadius();
+    cone.height = 1.0;
+    cone.resolution = policy.segmentsFor(baseRadius(), 100);
+    stage<PrimitiveSource>(pipeline, 0)->setPrimitive(cone);
 }
 
 
@@ -185,20 +547,53 @@ Pyramid::~Pyramid()
 }
 
 /**
- * @brief Generates and returns a Pyramid-shaped vtkPolyDataMapper object.
+ * @brief Returns the key identifying the geometry generated by this Pyramid.
  *
- * @return vtkSmartPointer<vtkPolyDataMapper> The mapper representing the Pyramid shape.
+ * @param policy How finely curved surfaces are tessellated.
+ * @return ShapeKey The type, dimensions and resolution of the Pyramid.
  */
-vtkSmartPointer<vtkPolyDataMapper> Pyramid::createShape() const
+ShapeKey Pyramid::key(const TessellationPolicy& /*policy*/) const
 {
-    // Create pyramid vertices
-    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
-    points->InsertNextPoint(0.0, 0.0, 0.0); // Point 0 - Base corner
-    points->InsertNextPoint(baseLength, 0.0, 0.0); // Point 1 - Base corner
-    points->InsertNextPoint(baseLength, baseLength, 0.0); // Point 2 - Base corner
-    points->InsertNextPoint(0.0, baseLength, 0.0); // Point 3 - Base corner
-    points->InsertNextPoint(baseLength/2, baseLength/2, height); // Point 4 - Apex
+    return ShapeKey{ "Pyramid", { baseLength, height }, 0 };
+}
+
+/**
+ * @brief Returns a copy of this Pyramid.
+ */
+std::unique_ptr<Shape> Pyramid::clone() const
+{
+    return std::make_unique<Pyramid>(*this);
+}
+
+/**
+ * @brief Returns the base length and height of the Pyramid.
+ */
+std::vector<ShapeParameter> Pyramid::parameters() const
+{
+    return { { "Base length", baseLength, 0.5, 50.0 },
+             { "Height", height, 0.5, 100.0 } };
+}
+
+/**
+ * @brief Changes the base length or the height of the Pyramid.
+ *
+ * @param index 0 for the base length, 1 for the height.
+ * @param value The new length.
+ */
+void Pyramid::setParameter(std::size_t index, double value)
+{
+    setClamped(parameters(), index, value, { &baseLength, &height });
+}
 
+/**
+ * @brief Creates the pipeline of the Pyramid: a producer of a mesh of four triangles and a square base.
+ *
+ * The connectivity is fixed; configurePipeline() supplies the points.
+ *
+ * @return ShapePipeline The pipeline.
+ */
+ShapePipeline Pyramid::createPipeline() const
+{
     // Connect the vertices to create the pyramid
     vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
     cells->InsertNextCell(3); // Triangle
@@ -229,14 +624,44 @@ vtkSmartPointer<vtkPolyDataMapper> Pyramid::createShape() const
 
     // Create a polydata object
     vtkSmartPointer<vtkPolyData> pyramid = vtkSmartPointer<vtkPolyData>::New();
-    pyramid->SetPoints(points);
     pyramid->SetPolys(cells);
 
-    // Mapper
-    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-    mapper->SetInputData(pyramid);
+    vtkSmartPointer<vtkTrivialProducer> producer = vtkSmartPointer<vtkTrivialProducer>::New();
+    producer->SetOutput(pyramid);
+    return ShapePipeline{ { producer }, producer };
+}
 
-    return mapper;
+/**
+ * @brief Gives the Pyramid's mesh the points of its dimensions.
+ *
+ * The points are replaced, not edited, so meshes copied from earlier updates keep theirs.
+ *
+ * @param pipeline A pipeline created by createPipeline().
+ * @param policy How finely curved surfaces are tessellated.
+ */
+void Pyramid::configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& /*policy*/) const
+{
+    vtkPolyData* pyramid = vtkPolyData::SafeDownCast(stage<vtkTrivialProducer>(pipeline, 0)->GetOutputDataObject(0));
+
+    vtkPoints* current = pyramid->GetPoints();
+    if (current && current->GetPoint(1)[0] == baseLength && current->GetPoint(4)[2] == height)
+        return;
+
+    // Create pyramid vertices
+    const double corners[5][3] = {
+        { 0.0, 0.0, 0.0 },                        // Point 0 - Base corner
+        { baseLength, 0.0, 0.0 },                 // Point 1 - Base corner
+        { baseLength, baseLength, 0.0 },          // Point 2 - Base corner
+        { 0.0, baseLength, 0.0 },                 // Point 3 - Base corner
+        { baseLength / 2, baseLength / 2, height } // Point 4 - Apex
+    };
+
+    // Doubles, so the dimensions read back exactly for the comparison above
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetDataTypeToDouble();
+    for (const double* corner : corners)
+        points->InsertNextPoint(corner);
+    pyramid->SetPoints(points);
 }
 
 
@@ -259,21 +684,69 @@ Cylinder::~Cylinder()
 }
 
 /**
- * @brief Generates and returns a Cylinder-shaped vtkPolyDataMapper object.
+ * @brief Returns the key identifying the geometry generated by this Cylinder.
  *
- * @return vtkSmartPointer<vtkPolyDataMapper> The mapper representing the Cylinder shape.
+ * @param policy How finely curved surfaces are tessellated.
+ * @return ShapeKey The type, dimensions and resolution of the Cylinder.
  */
-vtkSmartPointer<vtkPolyDataMapper> Cylinder::createShape() const
+ShapeKey Cylinder::key(const TessellationPolicy& policy) const
 {
-    vtkSmartPointer<vtkCylinderSource> cylinderSource = vtkSmartPointer<vtkCylinderSource>::New();
-    cylinderSource->SetRadius(radius);
-    cylinderSource->SetHeight(height);
-    cylinderSource->SetResolution(50);
-    cylinderSource->Update();
+    return ShapeKey{ "Cylinder", { radius, height }, policy.segmentsFor(radius, 50) };
+}
 
-    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-    mapper->SetInputData(cylinderSource->GetOutput());
-    return mapper;
+/**
+ * @brief Returns a copy of this Cylinder.
+ */
+std::unique_ptr<Shape> Cylinder::clone() const
+{
+    return std::make_unique<Cylinder>(*this);
+}
+
+/**
+ * @brief Returns the radius and height of the Cylinder.
+ */
+std::vector<ShapeParameter> Cylinder::parameters() const
+{
+    return { { "Radius", radius, 0.5, 50.0 },
+             { "Height", height, 0.5, 100.0 } };
+}
+
+/**
+ * @brief Changes the radius or the height of the Cylinder.
+ *
+ * @param index 0 for the radius, 1 for the height.
+ * @param value The new length.
+ */
+void Cylinder::setParameter(std::size_t index, double value)
+{
+    setClamped(parameters(), index, value, { &radius, &height });
+}
+
+/**
+ * @brief Creates the pipeline of the Cylinder: a single PrimitiveSource.
+ *
+ * @return ShapePipeline The pipeline.
+ */
+ShapePipeline Cylinder::createPipeline() const
+{
+    vtkSmartPointer<PrimitiveSource> source = vtkSmartPointer<PrimitiveSource>::New();
+    return ShapePipeline{ { source }, source };
+}
+
+/**
+ * @brief Pushes the dimensions and resolution of the Cylinder into its pipeline.
+ *
+ * @param pipeline A pipeline created by createPipeline().
+ * @param policy How finely curved surfaces are tessellated.
+ */
+void Cylinder::configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& policy) const
+{
+    Primitive cylinder;
+    cylinder.kind = Primitive::Kind::Cylinder;
+    cylinder.radius = radius;
+    cylinder.height = height;
+    cylinder.resolution = policy.segmentsFor(radius, 50);
+    stage<PrimitiveSource>(pipeline, 0)->setPrimitive(cylinder);
 }
 
 
@@ -296,35 +769,70 @@ Tube::~Tube()
 }
 
 /**
- * @brief Generates and returns a Tube-shaped vtkPolyDataMapper object.
+ * @brief Returns the key identifying the geometry generated by this Tube.
  *
- * @return vtkSmartPointer<vtkPolyDataMapper> The mapper representing the Tube shape.
+ * @param policy How finely curved surfaces are tessellated.
+ * @return ShapeKey The type, dimensions and resolution of the Tube.
  */
-vtkSmartPointer<vtkPolyDataMapper> Tube::createShape() const
+ShapeKey Tube::key(const TessellationPolicy& policy) const
 {
+    return ShapeKey{ "Tube", { radius, length }, policy.segmentsFor(radius, 50) };
+}
 
-    // Create a line.
-    vtkNew<vtkLineSource> lineSource;
-    lineSource->SetPoint1(0.0, 0.0, 0.0);
-    lineSource->SetPoint2(0.0, length, 0.0);
-    
+/**
+ * @brief Returns a copy of this Tube.
+ */
+std::unique_ptr<Shape> Tube::clone() const
+{
+    return std::make_unique<Tube>(*this);
+}
 
-    // Create a mapper and actor.
-    vtkNew<vtkPolyDataMapper> lineMapper;
-    lineMapper->SetInputConnection(lineSource->GetOutputPort());
-    vtkNew<vtkActor> lineActor;
-    lineActor->SetMapper(lineMapper);
+/**
+ * @brief Returns the radius and length of the Tube.
+ */
+std::vector<ShapeParameter> Tube::parameters() const
+{
+    return { { "Radius", radius, 0.1, 20.0 },
+             { "Length", length, 0.5, 100.0 } };
+}
 
-    // Create a tube (cylinder) around the line.
-    vtkNew<vtkTubeFilter> tubeFilter;
-    tubeFilter->SetInputConnection(lineSource->GetOutputPort());
-    tubeFilter->SetRadius(radius);
-    tubeFilter->SetNumberOfSides(50);
-    tubeFilter->Update();
+/**
+ * @brief Changes the radius or the length of the Tube.
+ *
+ * @param index 0 for the radius, 1 for the length.
+ * @param value The new length.
+ */
+void Tube::setParameter(std::size_t index, double value)
+{
+    setClamped(parameters(), index, value, { &radius, &length });
+}
 
-    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-    mapper->SetInputData(tubeFilter->GetOutput());
-    return mapper;
+/**
+ * @brief Creates the pipeline of the Tube: a single PrimitiveSource.
+ *
+ * @return ShapePipeline The pipeline.
+ */
+ShapePipeline Tube::createPipeline() const
+{
+    vtkSmartPointer<PrimitiveSource> source = vtkSmartPointer<PrimitiveSource>::New();
+    return ShapePipeline{ { source }, source };
+}
+
+/**
+ * @brief Pushes the dimensions and resolution of the Tube into its pipeline.
+ *
+ * @param pipeline A pipeline created by createPipeline().
+ * @param policy How finely curved surfaces are tessellated.
+ */
+void Tube::configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& policy) const
+{
+    // An open cylinder along the y-axis from the origin, as a vtkTubeFilter around a line
+    Primitive tube;
+    tube.kind = Primitive::Kind::Tube;
+    tube.radius = radius;
+    tube.height = length;
+    tube.resolution = policy.segmentsFor(radius, 50);
+    stage<PrimitiveSource>(pipeline, 0)->setPrimitive(tube);
 }
 
 
@@ -347,26 +855,71 @@ Doughnut::~Doughnut()
 }
 
 /**
- * @brief Generates and returns a Doughnut-shaped vtkPolyDataMapper object.
+ * @brief Returns the key identifying the geometry generated by this Doughnut.
  *
- * @return vtkSmartPointer<vtkPolyDataMapper> The mapper representing the Doughnut shape.
+ * @param policy How finely curved surfaces are tessellated.
+ * @return ShapeKey The type, dimensions and resolution of the Doughnut.
  */
-vtkSmartPointer<vtkPolyDataMapper> Doughnut::createShape() const
+ShapeKey Doughnut::key(const TessellationPolicy& policy) const
 {
+    // Both resolutions are encoded; each is at most TessellationPolicy::maxSegments
+    return ShapeKey{ "Doughnut", { radius, height }, policy.segmentsFor(radius + height, 50) * 10000 + policy.segmentsFor(height, 50) };
+}
 
-    // Create a torus
-    vtkSmartPointer<vtkParametricTorus> torus = vtkSmartPointer<vtkParametricTorus>::New();
-    torus->SetRingRadius(radius);  // Radius from the center of the torus to the center of the tube
-    torus->SetCrossSectionRadius(height);  // Radius of the tube
+/**
+ * @brief Returns a copy of this Doughnut.
+ */
+std::unique_ptr<Shape> Doughnut::clone() const
+{
+    return std::make_unique<Doughnut>(*this);
+}
 
-    vtkSmartPointer<vtkParametricFunctionSource> functionSource = vtkSmartPointer<vtkParametricFunctionSource>::New();
-    functionSource->SetParametricFunction(torus);
+/**
+ * @brief Returns the ring and tube radii of the Doughnut.
+ */
+std::vector<ShapeParameter> Doughnut::parameters() const
+{
+    return { { "Ring radius", radius, 0.5, 50.0 },
+             { "Tube radius", height, 0.1, 20.0 } };
+}
 
-    // Mapper
-    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-    mapper->SetInputConnection(functionSource->GetOutputPort());
+/**
+ * @brief Changes the ring or the tube radius of the Doughnut.
+ *
+ * @param index 0 for the ring radius, 1 for the tube radius.
+ * @param value The new radius.
+ */
+void Doughnut::setParameter(std::size_t index, double value)
+{
+    setClamped(parameters(), index, value, { &radius, &height });
+}
 
-    return mapper;
+/**
+ * @brief Creates the pipeline of the Doughnut: a single PrimitiveSource.
+ *
+ * @return ShapePipeline The pipeline.
+ */
+ShapePipeline Doughnut::createPipeline() const
+{
+    vtkSmartPointer<PrimitiveSource> source = vtkSmartPointer<PrimitiveSource>::New();
+    return ShapePipeline{ { source }, source };
+}
+
+/**
+ * @brief Pushes the radii and resolution of the Doughnut into its pipeline.
+ *
+ * @param pipeline A pipeline created by createPipeline().
+ * @param policy How finely curved surfaces are tessellated.
+ */
+void Doughnut::configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& policy) const
+{
+    Primitive torus;
+    torus.kind = Primitive::Kind::Torus;
+    torus.radius = radius;  // Radius from the center of the torus to the center of the tube
+    torus.minorRadius = height;  // Radius of the tube
+    torus.resolution = policy.segmentsFor(radius + height, 50);
+    torus.secondaryResolution = policy.segmentsFor(height, 50);
+    stage<PrimitiveSource>(pipeline, 0)->setPrimitive(torus);
 }
 
 
@@ -374,7 +927,7 @@ vtkSmartPointer<vtkPolyDataMapper> Doughnut::createShape() const
 /**
  * @brief Constructor for the CurvedCylinder class.
  *
- * @param radius Radius of the Curved Cylinder.
+ * @param radius Radius of the tube swept along the curve.
  */
 CurvedCylinder::CurvedCylinder(double radius) : radius(radius)
 {
@@ -388,13 +941,50 @@ CurvedCylinder::~CurvedCylinder()
 }
 
 /**
- * @brief Generates and returns a CurvedCylinder-shaped vtkPolyDataMapper object.
+ * @brief Returns the key identifying the geometry generated by this CurvedCylinder.
+ *
+ * @param policy How finely curved surfaces are tessellated.
+ * @return ShapeKey The type, dimensions and resolution of the CurvedCylinder.
+ */
+ShapeKey CurvedCylinder::key(const TessellationPolicy& policy) const
+{
+    return ShapeKey{ "Curved Cylinder", { radius }, policy.segmentsFor(radius, 50) };
+}
+
+/**
+ * @brief Returns a copy of this CurvedCylinder.
+ */
+std::unique_ptr<Shape> CurvedCylinder::clone() const
+{
+    return std::make_unique<CurvedCylinder>(*this);
+}
+
+/**
+ * @brief Returns the radius of the CurvedCylinder's tube.
+ */
+std::vector<ShapeParameter> CurvedCylinder::parameters() const
+{
+    return { { "Radius", radius, 0.01, 0.5 } };
+}
+
+/**
+ * @brief Changes the radius of the CurvedCylinder's tube.
  *
- * @return vtkSmartPointer<vtkPolyDataMapper> The mapper representing the CurvedCylinder shape.
+ * @param index 0 for the radius.
+ * @param value The new radius.
  */
-vtkSmartPointer<vtkPolyDataMapper> CurvedCylinder::createShape() const
+void CurvedCylinder::setParameter(std::size_t index, double value)
 {
+    setClamped(parameters(), index, value, { &radius });
+}
 
+/**
+ * @brief Creates the pipeline of the CurvedCylinder: a spline sampled by a vtkParametricFunctionSource, swept by a vtkTubeFilter.
+ *
+ * @return ShapePipeline The pipeline.
+ */
+ShapePipeline CurvedCylinder::createPipeline() const
+{
     // 1. Use vtkParametricSpline to define the curve
     vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
     points->InsertNextPoint(0, 0, 0);
@@ -407,18 +997,25 @@ vtkSmartPointer<vtkPolyDataMapper> CurvedCylinder::createShape() const
     vtkSmartPointer<vtkParametricFunctionSource> functionSource = vtkSmartPointer<vtkParametricFunctionSource>::New();
     functionSource->SetParametricFunction(spline);
     functionSource->SetUResolution(50);
-    functionSource->Update();
 
     // 2. Use vtkTubeFilter to sweep a circle along the spline
     vtkSmartPointer<vtkTubeFilter> tubeFilter = vtkSmartPointer<vtkTubeFilter>::New();
     tubeFilter->SetInputConnection(functionSource->GetOutputPort());
-    tubeFilter->SetRadius(0.1);
-    tubeFilter->SetNumberOfSides(50);
-    tubeFilter->Update();
 
-    // Mapper
-    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-    mapper->SetInputConnection(tubeFilter->GetOutputPort());
+    return ShapePipeline{ { spline, functionSource, tubeFilter }, tubeFilter };
+}
 
-    return mapper;
-}
\ No newline at end of file
+/**
+ * @brief Pushes the radius and resolution of the CurvedCylinder into its pipeline.
+ *
+ * The curve does not depend on the radius, so an edit only re-executes the tube filter.
+ *
+ * @param pipeline A pipeline created by createPipeline().
+ * @param policy How finely curved surfaces are tessellated.
+ */
+void CurvedCylinder::configurePipeline(ShapePipeline& pipeline, const TessellationPolicy& policy) const
+{
+    vtkTubeFilter* tubeFilter = stage<vtkTubeFilter>(pipeline, 2);
+    tubeFilter->SetRadius(radius);
+    tubeFilter->SetNumberOfSides(policy.segmentsFor(radius, 50));
+}
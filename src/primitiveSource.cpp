@@ -0,0 +1,480 @@
+/**
+ * @file primitiveSource.cpp
+ * @brief Implementation of the PrimitiveSource class.
+ */
+
+#include "primitiveSource.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkInformationVector.h>
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkTypeInt32Array.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+
+namespace
+{
+
+/// Points a worker fills at least; smaller meshes are generated on the calling thread.
+constexpr std::size_t PointsPerBlock = 1 << 14;
+
+/**
+ * @brief Cosines and sines of evenly spaced angles, evaluated once per mesh.
+ */
+struct AngleTable
+{
+    std::vector<float> cos;
+    std::vector<float> sin;
+
+    /**
+     * @brief Evaluates count angles start, start + step, ...
+     */
+    AngleTable(int count, double start, double step) : cos(count), sin(count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            cos[i] = static_cast<float>(std::cos(start + step * i));
+            sin[i] = static_cast<float>(std::sin(start + step * i));
+        }
+    }
+};
+
+/**
+ * @brief Preallocated float32 points and normals of a mesh.
+ */
+struct Vertices
+{
+    vtkSmartPointer<vtkFloatArray> points = vtkSmartPointer<vtkFloatArray>::New();
+    vtkSmartPointer<vtkFloatArray> normals = vtkSmartPointer<vtkFloatArray>::New();
+    float* point = nullptr;
+    float* normal = nullptr;
+
+    explicit Vertices(vtkIdType count)
+    {
+        points->SetNumberOfComponents(3);
+        points->SetNumberOfTuples(count);
+        normals->SetName("Normals");
+        normals->SetNumberOfComponents(3);
+        normals->SetNumberOfTuples(count);
+        point = points->GetPointer(0);
+        normal = normals->GetPointer(0);
+    }
+
+    /// @brief Sets a point and its normal.
+    void set(vtkIdType index, float x, float y, float z, float nx, float ny, float nz)
+    {
+        float* p = point + 3 * index;
+        float* n = normal + 3 * index;
+        p[0] = x;
+        p[1] = y;
+        p[2] = z;
+        n[0] = nx;
+        n[1] = ny;
+        n[2] = nz;
+    }
+};
+
+/**
+ * @brief Preallocated 32-bit offsets and connectivity of a cell array.
+ */
+struct Cells
+{
+    vtkSmartPointer<vtkTypeInt32Array> offsetArray = vtkSmartPointer<vtkTypeInt32Array>::New();
+    vtkSmartPointer<vtkTypeInt32Array> connectivityArray = vtkSmartPointer<vtkTypeInt32Array>::New();
+    std::int32_t* offsets = nullptr;
+    std::int32_t* ids = nullptr;
+
+    Cells(vtkIdType cells, vtkIdType idCount)
+    {
+        offsetArray->SetNumberOfValues(cells + 1);
+        connectivityArray->SetNumberOfValues(idCount);
+        offsets = offsetArray->GetPointer(0);
+        ids = connectivityArray->GetPointer(0);
+        offsets[cells] = static_cast<std::int32_t>(idCount);
+    }
+
+    /// @brief Returns the cell array of the filled offsets and connectivity.
+    vtkSmartPointer<vtkCellArray> array() const
+    {
+        vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+        cells->SetData(offsetArray, connectivityArray);
+        return cells;
+    }
+};
+
+/**
+ * @brief Clamps a resolution to what the generators support.
+ */
+int clampResolution(int resolution)
+{
+    return std::clamp(resolution, 3, PrimitiveSource::MaxResolution);
+}
+
+/**
+ * @brief Returns how many rows of the given length a worker fills at least.
+ */
+std::size_t rowsPerBlock(int columns)
+{
+    return std::max<std::size_t>(1, PointsPerBlock / static_cast<std::size_t>(columns));
+}
+
+/**
+ * @brief Assembles a mesh from its vertices and cells.
+ */
+vtkSmartPointer<vtkPolyData> assemble(const Vertices& vertices, const Cells* strips, const Cells* polys)
+{
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetData(vertices.points);
+
+    vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
+    mesh->SetPoints(points);
+    mesh->GetPointData()->SetNormals(vertices.normals);
+    if (strips)
+        mesh->SetStrips(strips->array());
+    if (polys)
+        mesh->SetPolys(polys->array());
+    return mesh;
+}
+
+/**
+ * @brief Generates a sphere, or the wedge of it between two longitudes.
+ *
+ * Points are the two poles followed by the rings from north to south. Each band
+ * between two longitudes is one strip running from pole to pole.
+ */
+vtkSmartPointer<vtkPolyData> sphere(const Primitive& primitive, unsigned threads)
+{
+    const int thetaResolution = clampResolution(primitive.resolution);
+    const int phiResolution = clampResolution(primitive.secondaryResolution);
+    const double span = primitive.endTheta - primitive.startTheta;
+    const bool closed = std::abs(span) >= 360.0;
+
+    // A closed sphere shares its first longitude with its last one
+    const int columns = closed ? thetaResolution : thetaResolution + 1;
+    const int rings = phiResolution - 1;
+    const float radius = static_cast<float>(primitive.radius);
+
+    const AngleTable theta(columns, vtkMath::RadiansFromDegrees(primitive.startTheta),
+                           vtkMath::RadiansFromDegrees(closed ? 360.0 : span) / thetaResolution);
+    const AngleTable phi(rings, vtkMath::Pi() / phiResolution, vtkMath::Pi() / phiResolution);
+
+    Vertices vertices(2 + static_cast<vtkIdType>(rings) * columns);
+    vertices.set(0, 0.0f, 0.0f, radius, 0.0f, 0.0f, 1.0f);
+    vertices.set(1, 0.0f, 0.0f, -radius, 0.0f, 0.0f, -1.0f);
+
+    const float* cosTheta = theta.cos.data();
+    const float* sinTheta = theta.sin.data();
+    parallelFor(static_cast<std::size_t>(rings), rowsPerBlock(columns), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t ring = begin; ring < end; ++ring)
+        {
+            const float sinPhi = phi.sin[ring];
+            const float cosPhi = phi.cos[ring];
+            float* point = vertices.point + 3 * (2 + ring * columns);
+            float* normal = vertices.normal + 3 * (2 + ring * columns);
+            for (int column = 0; column < columns; ++column)
+            {
+                const float nx = sinPhi * cosTheta[column];
+                const float ny = sinPhi * sinTheta[column];
+                normal[3 * column] = nx;
+                normal[3 * column + 1] = ny;
+                normal[3 * column + 2] = cosPhi;
+                point[3 * column] = radius * nx;
+                point[3 * column + 1] = radius * ny;
+                point[3 * column + 2] = radius * cosPhi;
+            }
+        }
+    }, threads);
+
+    // North pole, then the band's two longitudes ring by ring, then the south pole
+    const int stripLength = 2 * rings + 2;
+    Cells strips(thetaResolution, static_cast<vtkIdType>(thetaResolution) * stripLength);
+    parallelFor(static_cast<std::size_t>(thetaResolution), rowsPerBlock(stripLength), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t band = begin; band < end; ++band)
+        {
+            const std::int32_t left = static_cast<std::int32_t>(band);
+            const std::int32_t right = static_cast<std::int32_t>(closed ? (band + 1) % columns : band + 1);
+            std::int32_t* ids = strips.ids + band * stripLength;
+            strips.offsets[band] = static_cast<std::int32_t>(band * stripLength);
+
+            ids[0] = 0;
+            for (int ring = 0; ring < rings; ++ring)
+            {
+                const std::int32_t first = 2 + ring * columns;
+                ids[1 + 2 * ring] = first + left;
+                ids[2 + 2 * ring] = first + right;
+            }
+            ids[stripLength - 1] = 1;
+        }
+    }, threads);
+
+    return assemble(vertices, &strips, nullptr);
+}
+
+/**
+ * @brief Generates the side and optionally the caps of a cylinder along the y-axis.
+ *
+ * The side is a single strip around the axis. Caps have their own points, so their
+ * normals stay flat, and are one polygon each.
+ *
+ * @param top The y of the top rim.
+ * @param bottom The y of the bottom rim.
+ * @param capped Close both ends.
+ */
+vtkSmartPointer<vtkPolyData> cylinder(const Primitive& primitive, double top, double bottom, bool capped)
+{
+    const int resolution = clampResolution(primitive.resolution);
+    const float radius = static_cast<float>(primitive.radius);
+    const float y[2] = { static_cast<float>(top), static_cast<float>(bottom) };
+    const AngleTable angle(resolution, 0.0, 2.0 * vtkMath::Pi() / resolution);
+
+    // Side rims, then the top and bottom caps
+    Vertices vertices(static_cast<vtkIdType>(resolution) * (capped ? 4 : 2));
+    for (int rim = 0; rim < (capped ? 4 : 2); ++rim)
+    {
+        const float rimY = y[rim % 2];
+        const float normalY = rim < 2 ? 0.0f : (rim == 2 ? 1.0f : -1.0f);
+        const float normalXZ = rim < 2 ? 1.0f : 0.0f;
+        float* point = vertices.point + 3 * rim * resolution;
+        float* normal = vertices.normal + 3 * rim * resolution;
+        for (int i = 0; i < resolution; ++i)
+        {
+            point[3 * i] = radius * angle.cos[i];
+            point[3 * i + 1] = rimY;
+            point[3 * i + 2] = -radius * angle.sin[i];
+            normal[3 * i] = normalXZ * angle.cos[i];
+            normal[3 * i + 1] = normalY;
+            normal[3 * i + 2] = -normalXZ * angle.sin[i];
+        }
+    }
+
+    // Top and bottom rim in turn, closing on the first pair
+    Cells strips(1, 2 * resolution + 2);
+    strips.offsets[0] = 0;
+    for (int i = 0; i <= resolution; ++i)
+    {
+        strips.ids[2 * i] = i % resolution;
+        strips.ids[2 * i + 1] = resolution + i % resolution;
+    }
+
+    if (!capped)
+        return assemble(vertices, &strips, nullptr);
+
+    // Counterclockwise seen from outside: the top in the order of the angles, the bottom reversed
+    Cells caps(2, 2 * resolution);
+    caps.offsets[0] = 0;
+    caps.offsets[1] = resolution;
+    for (int i = 0; i < resolution; ++i)
+    {
+        caps.ids[i] = 2 * resolution + i;
+        caps.ids[resolution + i] = 4 * resolution - 1 - i;
+    }
+
+    return assemble(vertices, &strips, &caps);
+}
+
+/**
+ * @brief Generates a capped cone along the x-axis, centered on the origin.
+ *
+ * The side is a fan of triangles. Each triangle has its own apex point, whose normal
+ * is taken halfway between the triangle's base points, so the side shades smoothly.
+ */
+vtkSmartPointer<vtkPolyData> cone(const Primitive& primitive)
+{
+    const int resolution = clampResolution(primitive.resolution);
+    const double radius = primitive.radius;
+    const double height = primitive.height;
+    const double slant = std::sqrt(radius * radius + height * height);
+
+    const double step = 2.0 * vtkMath::Pi() / resolution;
+    const AngleTable base(resolution, 0.0, step);
+    const AngleTable middle(resolution, step / 2.0, step);
+
+    // Normals of the side lean towards the apex by the cone's half-angle
+    const float normalX = static_cast<float>(slant > 0.0 ? radius / slant : 0.0);
+    const float normalYZ = static_cast<float>(slant > 0.0 ? height / slant : 1.0);
+    const float apexX = static_cast<float>(height / 2.0);
+    const float baseX = static_cast<float>(-height / 2.0);
+    const float baseRadius = static_cast<float>(radius);
+
+    // Apexes, then the side's base rim, then the cap's
+    Vertices vertices(3 * static_cast<vtkIdType>(resolution));
+    for (int i = 0; i < resolution; ++i)
+    {
+        vertices.set(i, apexX, 0.0f, 0.0f, normalX, normalYZ * middle.cos[i], normalYZ * middle.sin[i]);
+        vertices.set(resolution + i, baseX, baseRadius * base.cos[i], baseRadius * base.sin[i],
+                     normalX, normalYZ * base.cos[i], normalYZ * base.sin[i]);
+        vertices.set(2 * resolution + i, baseX, baseRadius * base.cos[i], baseRadius * base.sin[i], -1.0f, 0.0f, 0.0f);
+    }
+
+    // The side's triangles, then the cap in reverse so it faces -x
+    Cells polys(resolution + 1, 4 * resolution);
+    for (int i = 0; i < resolution; ++i)
+    {
+        polys.offsets[i] = 3 * i;
+        polys.ids[3 * i] = i;
+        polys.ids[3 * i + 1] = resolution + i;
+        polys.ids[3 * i + 2] = resolution + (i + 1) % resolution;
+        polys.ids[3 * resolution + i] = 3 * resolution - 1 - i;
+    }
+    polys.offsets[resolution] = 3 * resolution;
+
+    return assemble(vertices, nullptr, &polys);
+}
+
+/**
+ * @brief Generates a torus around the z-axis.
+ *
+ * Points are the tube's cross sections one after the other. Each band between two
+ * cross sections is one strip around the tube.
+ */
+vtkSmartPointer<vtkPolyData> torus(const Primitive& primitive, unsigned threads)
+{
+    const int uResolution = clampResolution(primitive.resolution);
+    const int vResolution = clampResolution(primitive.secondaryResolution);
+    const float ringRadius = static_cast<float>(primitive.radius);
+    const float tubeRadius = static_cast<float>(primitive.minorRadius);
+
+    const AngleTable u(uResolution, 0.0, 2.0 * vtkMath::Pi() / uResolution);
+    const AngleTable v(vResolution, 0.0, 2.0 * vtkMath::Pi() / vResolution);
+
+    Vertices vertices(static_cast<vtkIdType>(uResolution) * vResolution);
+    const float* cosV = v.cos.data();
+    const float* sinV = v.sin.data();
+    parallelFor(static_cast<std::size_t>(uResolution), rowsPerBlock(vResolution), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t section = begin; section < end; ++section)
+        {
+            const float cosU = u.cos[section];
+            const float sinU = u.sin[section];
+            float* point = vertices.point + 3 * section * vResolution;
+            float* normal = vertices.normal + 3 * section * vResolution;
+            for (int i = 0; i < vResolution; ++i)
+            {
+                const float distance = ringRadius + tubeRadius * cosV[i];
+                normal[3 * i] = cosV[i] * cosU;
+                normal[3 * i + 1] = cosV[i] * sinU;
+                normal[3 * i + 2] = sinV[i];
+                point[3 * i] = distance * cosU;
+                point[3 * i + 1] = distance * sinU;
+                point[3 * i + 2] = tubeRadius * sinV[i];
+            }
+        }
+    }, threads);
+
+    // Both cross sections in turn, closing on the first pair
+    const int stripLength = 2 * vResolution + 2;
+    Cells strips(uResolution, static_cast<vtkIdType>(uResolution) * stripLength);
+    parallelFor(static_cast<std::size_t>(uResolution), rowsPerBlock(stripLength), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t band = begin; band < end; ++band)
+        {
+            const std::int32_t first = static_cast<std::int32_t>(band * vResolution);
+            const std::int32_t second = static_cast<std::int32_t>(((band + 1) % uResolution) * vResolution);
+            std::int32_t* ids = strips.ids + band * stripLength;
+            strips.offsets[band] = static_cast<std::int32_t>(band * stripLength);
+
+            for (int i = 0; i < vResolution; ++i)
+            {
+                ids[2 * i] = first + i;
+                ids[2 * i + 1] = second + i;
+            }
+            ids[2 * vResolution] = first;
+            ids[2 * vResolution + 1] = second;
+        }
+    }, threads);
+
+    return assemble(vertices, &strips, nullptr);
+}
+
+} // namespace
+
+
+/**
+ * @brief Compares two primitives for equality.
+ *
+ * @param other The primitive to compare with.
+ * @return true if kind, dimensions and resolutions all match.
+ */
+bool Primitive::operator==(const Primitive& other) const
+{
+    return kind == other.kind && radius == other.radius && minorRadius == other.minorRadius
+        && height == other.height && resolution == other.resolution
+        && secondaryResolution == other.secondaryResolution
+        && startTheta == other.startTheta && endTheta == other.endTheta;
+}
+
+
+vtkStandardNewMacro(PrimitiveSource);
+
+
+/**
+ * @brief Constructs a source of a default sphere; it has no input.
+ */
+PrimitiveSource::PrimitiveSource()
+{
+    SetNumberOfInputPorts(0);
+}
+
+
+/**
+ * @brief Sets the primitive to generate.
+ *
+ * @param primitive The primitive; the source re-executes at the next update only if it differs.
+ */
+void PrimitiveSource::setPrimitive(const Primitive& primitive)
+{
+    if (primitive == mPrimitive)
+        return;
+
+    mPrimitive = primitive;
+    Modified();
+}
+
+
+/**
+ * @brief Generates a primitive into a new mesh.
+ *
+ * @param primitive The primitive.
+ * @param threads Worker threads for large meshes; 0 uses every core.
+ * @return vtkSmartPointer<vtkPolyData> The mesh.
+ */
+vtkSmartPointer<vtkPolyData> PrimitiveSource::generate(const Primitive& primitive, unsigned threads)
+{
+    TRACE_SCOPE("PrimitiveSource::generate", "shapes");
+
+    switch (primitive.kind)
+    {
+    case Primitive::Kind::Sphere:
+        return sphere(primitive, threads);
+    case Primitive::Kind::Cone:
+        return cone(primitive);
+    case Primitive::Kind::Cylinder:
+        return cylinder(primitive, primitive.height / 2.0, -primitive.height / 2.0, true);
+    case Primitive::Kind::Tube:
+        return cylinder(primitive, primitive.height, 0.0, false);
+    case Primitive::Kind::Torus:
+        return torus(primitive, threads);
+    }
+    return vtkSmartPointer<vtkPolyData>::New();
+}
+
+
+/**
+ * @brief Generates the primitive into the output; every execution allocates new arrays.
+ *
+ * @return int 1 on success.
+ */
+int PrimitiveSource::RequestData(vtkInformation* /*request*/, vtkInformationVector** /*inputVector*/, vtkInformationVector* outputVector)
+{
+    vtkPolyData* output = vtkPolyData::GetData(outputVector);
+    output->ShallowCopy(generate(mPrimitive));
+    return 1;
+}
@@ -0,0 +1,438 @@
+/**
+ * @file projectFile.cpp
+ * @brief Implementation of the ProjectFile class.
+ */
+
+#include "projectFile.h"
+#include "meshFile.h"
+#include "trace.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSaveFile>
+#include <QSet>
+#include <QStringList>
+
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkPoints.h>
+#include <vtkTypeInt32Array.h>
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+
+namespace
+{
+
+constexpr char Magic[8] = { 'Q', 'V', 'T', 'K', 'P', 'R', 'O', 'J' };
+constexpr std::uint32_t Version = 1;
+
+/// Written as is; reads as something else on a machine of the other byte order.
+constexpr std::uint32_t ByteOrderMark = 0x01020304u;
+
+/// Bits of ObjectRecord::flags.
+constexpr std::uint32_t Instanced = 1;
+
+/**
+ * @brief Start of every project file; the tables follow at the given offsets.
+ */
+struct Header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint32_t meshCount;
+    std::uint32_t objectCount;
+    std::uint64_t meshTable;
+    std::uint64_t objectTable;
+    std::uint64_t strings;
+    std::uint64_t stringBytes;
+};
+
+/**
+ * @brief Table of contents entry of a mesh; its file name is UTF-8 in the string table.
+ */
+struct MeshRecord
+{
+    double bounds[6];
+    std::uint64_t points;
+    std::uint64_t polys;
+    std::uint32_t name;
+    std::uint32_t nameBytes;
+};
+
+/**
+ * @brief Table of contents entry of an object.
+ */
+struct ObjectRecord
+{
+    std::uint32_t mesh;
+    std::uint32_t flags;
+    double position[3];
+    double orientation[3];
+    double scale;
+    double userMatrix[16];
+    double color[3];
+    double opacity;
+};
+
+static_assert(std::is_trivially_copyable<Header>::value && std::is_trivially_copyable<MeshRecord>::value
+              && std::is_trivially_copyable<ObjectRecord>::value, "The tables are written and read as raw bytes");
+
+/**
+ * @brief Returns true if [offset, offset + bytes) lies within a file of the given size.
+ */
+bool fits(std::uint64_t offset, std::uint64_t bytes, std::uint64_t size)
+{
+    return offset <= size && bytes <= size - offset;
+}
+
+
+/**
+ * @brief Returns the table of contents entry describing a mesh stored in file.
+ */
+ProjectFile::Mesh describe(vtkPolyData* mesh, const QString& file)
+{
+    ProjectFile::Mesh entry;
+    entry.file = file;
+    mesh->GetBounds(entry.bounds);
+    entry.points = static_cast<std::uint64_t>(mesh->GetNumberOfPoints());
+    entry.polys = static_cast<std::uint64_t>(mesh->GetNumberOfPolys());
+    return entry;
+}
+
+} // namespace
+
+
+/**
+ * @brief Reads the table of contents of a project; the meshes are not read.
+ *
+ * Every offset and count is checked against the file size before it is used.
+ *
+ * @param path Path of the project file.
+ * @return Contents The table, or an error message.
+ */
+ProjectFile::Contents ProjectFile::read(const QString& path)
+{
+    TRACE_SCOPE("ProjectFile::read", "io");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    Contents contents;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        contents.error = file.errorString();
+        return contents;
+    }
+
+    const QByteArray data = file.readAll();
+    const std::uint64_t size = static_cast<std::uint64_t>(data.size());
+    Header header;
+    if (size < sizeof header)
+    {
+        contents.error = "The file is not a project file.";
+        return contents;
+    }
+    std::memcpy(&header, data.constData(), sizeof header);
+    if (std::memcmp(header.magic, Magic, sizeof Magic) != 0 || header.version != Version || header.byteOrder != ByteOrderMark)
+    {
+        contents.error = "The file is not a project file of this version.";
+        return contents;
+    }
+    if (!fits(header.meshTable, std::uint64_t(header.meshCount) * sizeof(MeshRecord), size)
+        || !fits(header.objectTable, std::uint64_t(header.objectCount) * sizeof(ObjectRecord), size)
+        || !fits(header.strings, header.stringBytes, size))
+    {
+        contents.error = "The project file is damaged.";
+        return contents;
+    }
+
+    contents.meshes.resize(header.meshCount);
+    for (std::uint32_t i = 0; i < header.meshCount; ++i)
+    {
+        MeshRecord record;
+        std::memcpy(&record, data.constData() + header.meshTable + i * sizeof record, sizeof record);
+        if (!fits(record.name, record.nameBytes, header.stringBytes) || record.nameBytes == 0)
+        {
+            contents.error = "The project file is damaged.";
+            return contents;
+        }
+
+        Mesh& mesh = contents.meshes[i];
+        mesh.file = QString::fromUtf8(data.constData() + header.strings + record.name, static_cast<int>(record.nameBytes));
+        std::copy(record.bounds, record.bounds + 6, mesh.bounds);
+        mesh.points = record.points;
+        mesh.polys = record.polys;
+    }
+
+    contents.objects.resize(header.objectCount);
+    for (std::uint32_t i = 0; i < header.objectCount; ++i)
+    {
+        ObjectRecord record;
+        std::memcpy(&record, data.constData() + header.objectTable + i * sizeof record, sizeof record);
+        if (record.mesh >= header.meshCount)
+        {
+            contents.error = "The project file is damaged.";
+            return contents;
+        }
+
+        Object& object = contents.objects[i];
+        object.mesh = record.mesh;
+        object.instanced = (record.flags & Instanced) != 0;
+        std::copy(record.position, record.position + 3, object.position.begin());
+        std::copy(record.orientation, record.orientation + 3, object.orientation.begin());
+        object.scale = record.scale;
+        std::copy(record.userMatrix, record.userMatrix + 16, object.userMatrix.begin());
+        std::copy(record.color, record.color + 3, object.color.begin());
+        object.opacity = record.opacity;
+    }
+
+    contents.bytes = static_cast<std::size_t>(size);
+    contents.seconds = timer.nsecsElapsed() / 1.0e9;
+    return contents;
+}
+
+
+/**
+ * @brief Saves objects of a scene, writing only the meshes not saved to this path before.
+ *
+ * Objects sharing a mesh share its entry. A mesh is written again if it was destroyed
+ * and its address reused, if it was modified, or if its file disappeared; a mesh saved
+ * with another project has its file copied. The table is written under a temporary
+ * name and renamed into place before unused mesh files are removed.
+ *
+ * @param path Path of the project file; an existing project is replaced.
+ * @param scene The scene; it is only read.
+ * @param objects The objects to save, in the order they are opened again.
+ * @return SaveResult Statistics of the save, or an error message.
+ */
+ProjectFile::SaveResult ProjectFile::save(const QString& path, const Scene& scene, const std::vector<ObjectId>& objects)
+{
+    TRACE_SCOPE("ProjectFile::save", "io");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    SaveResult result;
+    const QString directoryPath = meshDirectory(path);
+    const QDir directory(directoryPath);
+    if (!directory.mkpath("."))
+    {
+        result.error = QString("Could not create %1.").arg(directoryPath);
+        return result;
+    }
+    mPath = path;
+
+    // Distinct meshes in order of first use, written if not saved in their current version
+    std::vector<Mesh> meshes;
+    std::unordered_map<vtkPolyData*, std::uint32_t> meshIndex;
+    std::vector<ObjectRecord> objectRecords(objects.size());
+    for (std::size_t i = 0; i < objects.size(); ++i)
+    {
+        const ObjectId id = objects[i];
+        vtkPolyData* mesh = scene.mesh(id);
+
+        auto found = meshIndex.find(mesh);
+        if (found == meshIndex.end())
+        {
+            Saved& saved = mSaved[mesh];
+            const QString savedFile = QDir(saved.directory).filePath(saved.entry.file);
+            const bool current = saved.mesh == mesh && saved.modified == mesh->GetMTime() && QFile::exists(savedFile);
+            if (!current || saved.directory != directoryPath)
+            {
+                QString name;
+                do
+                    name = QString("%1.mesh").arg(mNextFile++);
+                while (QFile::exists(directory.filePath(name)));
+
+                if (current)
+                {
+                    // Saved with another project, e.g. the one opened before a save under a new name
+                    if (!QFile::copy(savedFile, directory.filePath(name)))
+                    {
+                        result.error = QString("Could not copy %1.").arg(savedFile);
+                        return result;
+                    }
+                    result.bytesWritten += static_cast<std::size_t>(QFile(directory.filePath(name)).size());
+                    saved.entry.file = name;
+                }
+                else
+                {
+                    const MeshFile::Result written = MeshFile::write(directory.filePath(name), mesh, MeshFile::WriteOptions());
+                    if (!written.ok())
+                    {
+                        mSaved.erase(mesh);
+                        result.error = QString("Could not write the mesh of object %1: %2").arg(id).arg(written.error);
+                        return result;
+                    }
+
+                    saved.mesh = mesh;
+                    saved.modified = mesh->GetMTime();
+                    saved.entry = describe(mesh, name);
+                    result.bytesWritten += written.bytes;
+                }
+                saved.directory = directoryPath;
+                ++result.meshesWritten;
+            }
+
+            found = meshIndex.emplace(mesh, static_cast<std::uint32_t>(meshes.size())).first;
+            meshes.push_back(saved.entry);
+        }
+
+        ObjectRecord& record = objectRecords[i];
+        record.mesh = found->second;
+        record.flags = scene.isInstanced(id) ? Instanced : 0u;
+        scene.getPosition(id, record.position);
+        scene.getOrientation(id, record.orientation);
+        record.scale = scene.scale(id);
+        scene.getUserMatrix(id, record.userMatrix);
+        scene.getColor(id, record.color);
+        record.opacity = scene.opacity(id);
+    }
+
+    // Table of contents: header, mesh records, object records, file names
+    QByteArray strings;
+    std::vector<MeshRecord> meshRecords(meshes.size());
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+    {
+        const QByteArray name = meshes[i].file.toUtf8();
+        MeshRecord& record = meshRecords[i];
+        std::copy(meshes[i].bounds, meshes[i].bounds + 6, record.bounds);
+        record.points = meshes[i].points;
+        record.polys = meshes[i].polys;
+        record.name = static_cast<std::uint32_t>(strings.size());
+        record.nameBytes = static_cast<std::uint32_t>(name.size());
+        strings += name;
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, Magic, sizeof Magic);
+    header.version = Version;
+    header.byteOrder = ByteOrderMark;
+    header.meshCount = static_cast<std::uint32_t>(meshRecords.size());
+    header.objectCount = static_cast<std::uint32_t>(objectRecords.size());
+    header.meshTable = sizeof header;
+    header.objectTable = header.meshTable + meshRecords.size() * sizeof(MeshRecord);
+    header.strings = header.objectTable + objectRecords.size() * sizeof(ObjectRecord);
+    header.stringBytes = static_cast<std::uint64_t>(strings.size());
+
+    QByteArray table;
+    table.reserve(static_cast<int>(header.strings + header.stringBytes));
+    table.append(reinterpret_cast<const char*>(&header), sizeof header);
+    table.append(reinterpret_cast<const char*>(meshRecords.data()), static_cast<int>(meshRecords.size() * sizeof(MeshRecord)));
+    table.append(reinterpret_cast<const char*>(objectRecords.data()), static_cast<int>(objectRecords.size() * sizeof(ObjectRecord)));
+    table.append(strings);
+
+    // Renamed over the previous table only once written completely
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(table) != table.size())
+    {
+        result.error = file.errorString();
+        file.cancelWriting();
+        return result;
+    }
+    if (!file.commit())
+    {
+        result.error = QString("Could not replace %1: %2").arg(path, file.errorString());
+        return result;
+    }
+    result.bytesWritten += static_cast<std::size_t>(table.size());
+
+    // Mesh files of earlier saves that the project no longer references
+    QSet<QString> used;
+    for (const Mesh& mesh : meshes)
+        used.insert(mesh.file);
+    for (const QString& name : directory.entryList(QStringList() << "*.mesh", QDir::Files))
+    {
+        if (!used.contains(name) && QFile::remove(directory.filePath(name)))
+            ++result.filesRemoved;
+    }
+
+    // Forget meshes that were destroyed or are not part of this project
+    for (auto it = mSaved.begin(); it != mSaved.end();)
+    {
+        if (!it->second.mesh || it->second.directory != directoryPath || !used.contains(it->second.entry.file))
+            it = mSaved.erase(it);
+        else
+            ++it;
+    }
+
+    result.objects = objects.size();
+    result.meshes = meshes.size();
+    result.seconds = timer.nsecsElapsed() / 1.0e9;
+    return result;
+}
+
+
+/**
+ * @brief Forgets every saved mesh and makes path the project saved to.
+ */
+void ProjectFile::reset(const QString& path)
+{
+    mPath = path;
+    mSaved.clear();
+    mNextFile = 0;
+}
+
+
+/**
+ * @brief Records that a mesh, in its current version, is stored as an entry of a project.
+ */
+void ProjectFile::markSaved(vtkPolyData* mesh, const QString& path, const Mesh& entry)
+{
+    Saved& saved = mSaved[mesh];
+    saved.mesh = mesh;
+    saved.modified = mesh->GetMTime();
+    saved.directory = meshDirectory(path);
+    saved.entry = entry;
+}
+
+
+/**
+ * @brief Returns a closed box of 12 triangles spanning bounds, with float32 points and 32-bit ids.
+ */
+vtkSmartPointer<vtkPolyData> ProjectFile::boundsMesh(const double bounds[6])
+{
+    // Corner i takes the maximum along x, y and z for bits 0, 1 and 2 of i
+    vtkSmartPointer<vtkFloatArray> coordinates = vtkSmartPointer<vtkFloatArray>::New();
+    coordinates->SetNumberOfComponents(3);
+    coordinates->SetNumberOfTuples(8);
+    float* xyz = coordinates->GetPointer(0);
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+            xyz[3 * corner + axis] = static_cast<float>(bounds[2 * axis + ((corner >> axis) & 1)]);
+    }
+
+    // Two triangles per face, wound outwards
+    static const std::int32_t triangles[12][3] = {
+        { 0, 2, 1 }, { 1, 2, 3 },   // -z
+        { 4, 5, 6 }, { 5, 7, 6 },   // +z
+        { 0, 1, 4 }, { 1, 5, 4 },   // -y
+        { 2, 6, 3 }, { 3, 6, 7 },   // +y
+        { 0, 4, 2 }, { 2, 4, 6 },   // -x
+        { 1, 3, 5 }, { 3, 7, 5 } }; // +x
+
+    vtkSmartPointer<vtkTypeInt32Array> offsets = vtkSmartPointer<vtkTypeInt32Array>::New();
+    offsets->SetNumberOfValues(13);
+    for (std::int32_t cell = 0; cell <= 12; ++cell)
+        offsets->SetValue(cell, 3 * cell);
+    vtkSmartPointer<vtkTypeInt32Array> connectivity = vtkSmartPointer<vtkTypeInt32Array>::New();
+    connectivity->SetNumberOfValues(36);
+    std::copy(&triangles[0][0], &triangles[0][0] + 36, connectivity->GetPointer(0));
+
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetData(coordinates);
+    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+    polys->SetData(offsets, connectivity);
+
+    vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
+    mesh->SetPoints(points);
+    mesh->SetPolys(polys);
+    return mesh;
+}
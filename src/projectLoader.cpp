@@ -0,0 +1,231 @@
+/**
+ * @file projectLoader.cpp
+ * @brief Implementation of the ProjectLoader class.
+ */
+
+#include "projectLoader.h"
+#include "meshFile.h"
+#include "trace.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QMetaObject>
+
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+
+
+namespace
+{
+
+/// Stride of the reads that fault the pages of a mapped mesh in.
+constexpr std::size_t PageSize = 4096;
+
+/**
+ * @brief Reads one byte per page of an array and returns their sum.
+ */
+unsigned touchPages(vtkDataArray* array)
+{
+    if (!array)
+        return 0;
+
+    const unsigned char* data = static_cast<const unsigned char*>(array->GetVoidPointer(0));
+    const std::size_t bytes = static_cast<std::size_t>(array->GetNumberOfValues()) * static_cast<std::size_t>(array->GetDataTypeSize());
+    unsigned sum = 0;
+    for (std::size_t offset = 0; offset < bytes; offset += PageSize)
+        sum += data[offset];
+    return sum;
+}
+
+
+/**
+ * @brief Faults in every page of the points, normals and cells of a mapped mesh.
+ */
+unsigned touchMesh(vtkPolyData* mesh)
+{
+    unsigned sum = touchPages(mesh->GetPoints()->GetData()) + touchPages(mesh->GetPointData()->GetNormals());
+    for (vtkCellArray* cells : { mesh->GetPolys(), mesh->GetStrips() })
+        sum += touchPages(cells->GetOffsetsArray()) + touchPages(cells->GetConnectivityArray());
+    return sum;
+}
+
+} // namespace
+
+
+/**
+ * @brief Constructs an idle loader.
+ *
+ * @param parent Parent QObject.
+ */
+ProjectLoader::ProjectLoader(QObject* parent)
+    : QObject(parent)
+{
+}
+
+
+/**
+ * @brief Cancels any running load and waits for its worker thread.
+ */
+ProjectLoader::~ProjectLoader()
+{
+    if (mJob)
+        mJob->cancel = true;
+
+    if (mWorker.joinable())
+        mWorker.join();
+}
+
+
+/**
+ * @brief Starts reading the meshes of a project, canceling the load in progress if there is one.
+ *
+ * The previous worker is canceled and joined first; it checks the cancel flag
+ * between meshes, and reading one only maps it, so this blocks briefly.
+ *
+ * @param directory Directory holding the mesh files.
+ * @param files Names of the mesh files.
+ */
+void ProjectLoader::load(const QString& directory, const QStringList& files)
+{
+    cancel();
+
+    if (mWorker.joinable())
+        mWorker.join();
+
+    mJob = std::make_shared<Job>();
+    mJob->directory = directory;
+    mJob->files = files;
+    mJob->started.assign(static_cast<std::size_t>(files.size()), false);
+
+    const quint64 generation = ++mGeneration;
+    mWorker = std::thread(&ProjectLoader::run, this, mJob, generation);
+}
+
+
+/**
+ * @brief Reads a mesh next, before the ones not asked for.
+ *
+ * @param mesh Index of the mesh in the list passed to load().
+ */
+void ProjectLoader::prioritize(std::size_t mesh)
+{
+    if (!mJob)
+        return;
+
+    std::lock_guard<std::mutex> lock(mJob->mutex);
+    if (mesh < mJob->started.size() && !mJob->started[mesh])
+        mJob->wanted.push_front(mesh);
+}
+
+
+/**
+ * @brief Stops the load in progress, if any.
+ *
+ * The worker stops before its next mesh; anything it still delivers belongs to
+ * an old generation and is dropped.
+ */
+void ProjectLoader::cancel()
+{
+    if (!mJob)
+        return;
+
+    mJob->cancel = true;
+    ++mGeneration;
+    mJob.reset();
+}
+
+
+/**
+ * @brief Body of the worker thread: reads the wanted meshes first, then the others in order.
+ *
+ * Results are posted to the loader's thread and emitted there, provided the
+ * generation is still current when they arrive.
+ */
+void ProjectLoader::run(std::shared_ptr<Job> job, quint64 generation)
+{
+    Trace::setThreadName("ProjectLoader");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const QDir directory(job->directory);
+    std::size_t next = 0;
+    std::size_t loaded = 0;
+    std::size_t failed = 0;
+
+    // Summed into a volatile so the page reads are not optimized away
+    volatile unsigned touched = 0;
+    while (!job->cancel)
+    {
+        std::size_t mesh = job->started.size();
+        {
+            std::lock_guard<std::mutex> lock(job->mutex);
+            while (!job->wanted.empty() && mesh == job->started.size())
+            {
+                if (!job->started[job->wanted.front()])
+                    mesh = job->wanted.front();
+                job->wanted.pop_front();
+            }
+            while (mesh == job->started.size() && next < job->started.size())
+            {
+                if (!job->started[next])
+                    mesh = next;
+                ++next;
+            }
+            if (mesh == job->started.size())
+                break;
+            job->started[mesh] = true;
+        }
+
+        TRACE_SCOPE("ProjectLoader::readMesh", "io");
+        MeshFile::Result result = MeshFile::read(directory.filePath(job->files[static_cast<int>(mesh)]));
+        if (result.ok())
+        {
+            touched = touched + touchMesh(result.mesh);
+            ++loaded;
+            QMetaObject::invokeMethod(this, [this, generation, mesh, polyData = result.mesh]() {
+                if (generation == mGeneration)
+                    emit meshLoaded(mesh, polyData);
+            }, Qt::QueuedConnection);
+        }
+        else
+        {
+            ++failed;
+            QMetaObject::invokeMethod(this, [this, generation, mesh, error = result.error]() {
+                if (generation == mGeneration)
+                    emit meshFailed(mesh, error);
+            }, Qt::QueuedConnection);
+        }
+    }
+
+    if (job->cancel)
+        return;
+
+    const double seconds = timer.nsecsElapsed() / 1.0e9;
+    QMetaObject::invokeMethod(this, [this, generation, loaded, failed, seconds]() {
+        if (generation != mGeneration)
+            return;
+
+        finish(generation);
+        emit finished(loaded, failed, seconds);
+    }, Qt::QueuedConnection);
+}
+
+
+/**
+ * @brief Marks the load of the given generation as done and joins its worker.
+ *
+ * Called from a result posted by the worker as its last action, so the join
+ * only waits for the thread to return.
+ */
+void ProjectLoader::finish(quint64 generation)
+{
+    if (generation != mGeneration)
+        return;
+
+    mJob.reset();
+    if (mWorker.joinable())
+        mWorker.join();
+}
@@ -0,0 +1,98 @@
+/**
+ * @file renderScheduler.cpp
+ * @brief Implementation of the RenderScheduler class.
+ */
+
+#include "renderScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+/**
+ * @brief Constructs a scheduler for the given window.
+ *
+ * @param window The window to render.
+ * @param parent Parent QObject.
+ */
+RenderScheduler::RenderScheduler(vtkRenderWindow* window, QObject* parent)
+    : QObject(parent),
+    mRenderWindow(window)
+{
+    mTimer.setSingleShot(true);
+    mTimer.setTimerType(Qt::PreciseTimer);
+    connect(&mTimer, &QTimer::timeout, this, &RenderScheduler::onTimeout);
+}
+
+
+/**
+ * @brief Sets the maximum number of renders per second.
+ *
+ * @param fps The cap; values <= 0 remove it.
+ */
+void RenderScheduler::setMaxFps(double fps)
+{
+    mMaxFps = std::max(0.0, fps);
+}
+
+
+/**
+ * @brief Marks the view dirty and arms the timer if it is not already running.
+ *
+ * The timer fires when a full frame interval has passed since the last render,
+ * or on the next event loop iteration if it already has.
+ */
+void RenderScheduler::requestRender()
+{
+    ++mStatistics.requested;
+    mPending = true;
+
+    if (mTimer.isActive())
+        return;
+
+    int delayMs = 0;
+    if (mMaxFps > 0 && mSinceLastRender.isValid())
+    {
+        const double intervalMs = 1000.0 / mMaxFps;
+        delayMs = static_cast<int>(std::ceil(intervalMs - mSinceLastRender.elapsed()));
+    }
+
+    mTimer.start(std::max(0, delayMs));
+}
+
+
+/**
+ * @brief Renders immediately and cancels any pending deferred render.
+ */
+void RenderScheduler::renderNow()
+{
+    ++mStatistics.immediate;
+    mTimer.stop();
+    render();
+}
+
+
+/**
+ * @brief Executes the deferred render if it is still pending.
+ */
+void RenderScheduler::onTimeout()
+{
+    if (mPending)
+        render();
+}
+
+
+/**
+ * @brief Runs the before-render hook and renders the window.
+ */
+void RenderScheduler::render()
+{
+    if (mBeforeRender)
+        mBeforeRender();
+
+    mRenderWindow->Render();
+
+    ++mStatistics.executed;
+    mPending = false;
+    mSinceLastRender.start();
+}
@@ -0,0 +1,990 @@
+/**
+ * @file scene.cpp
+ * @brief Implementation of the Scene class.
+ */
+
+#include "scene.h"
+#include "meshNormals.h"
+#include "meshStorage.h"
+#include "trace.h"
+
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkProperty.h>
+#include <vtkTransform.h>
+#include <vtkTransformPolyDataFilter.h>
+
+#include <algorithm>
+
+
+/// Row-major 4x4 identity used as the default user matrix.
+static const std::array<double, 16> IdentityMatrix = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+/// Color highlighted objects are drawn in.
+static const double HighlightColor[3] = { 1.0, 0.1, 0.1 };
+
+
+/**
+ * @brief Constructs an empty scene rendering into the given renderer.
+ *
+ * @param renderer Renderer the objects' actors are added to. May be null.
+ */
+Scene::Scene(vtkRenderer* renderer) : mRenderer(renderer)
+{
+}
+
+
+/**
+ * @brief Removes all actors from the renderer.
+ */
+Scene::~Scene()
+{
+    clear();
+}
+
+
+/**
+ * @brief Adds an object with identity transform, black color and full opacity.
+ *
+ * The new object is dirty, so its actor is configured on the next sync.
+ *
+ * @param mesh The object's geometry.
+ * @return ObjectId Handle of the new object.
+ */
+ObjectId Scene::addObject(vtkSmartPointer<vtkPolyData> mesh)
+{
+    const ObjectId id = allocateSlot(mesh);
+    attachActor(id);
+    return id;
+}
+
+
+/**
+ * @brief Adds an object rendered through the instance batch of its mesh.
+ *
+ * @param mesh The object's geometry.
+ * @return ObjectId Handle of the new object.
+ */
+ObjectId Scene::addInstance(vtkSmartPointer<vtkPolyData> mesh)
+{
+    const ObjectId id = allocateSlot(mesh);
+    attachInstance(id);
+    return id;
+}
+
+
+/**
+ * @brief Adds an object under a given free id.
+ *
+ * Ids between the allocator's end and the given one become free ids.
+ *
+ * @param id The id the object gets.
+ * @param mesh The object's geometry.
+ * @param instanced Draw the object through the instance batch of its mesh.
+ * @return bool False if the id is in use or invalid.
+ */
+bool Scene::restoreObject(ObjectId id, vtkSmartPointer<vtkPolyData> mesh, bool instanced)
+{
+    if (id == InvalidObjectId || contains(id))
+        return false;
+
+    if (id >= mSlotOf.size())
+    {
+        for (ObjectId free = static_cast<ObjectId>(mSlotOf.size()); free < id; ++free)
+            mFreeIds.push_back(free);
+        mSlotOf.resize(static_cast<std::size_t>(id) + 1, InvalidObjectId);
+    }
+    else
+    {
+        const auto free = std::find(mFreeIds.begin(), mFreeIds.end(), id);
+        if (free != mFreeIds.end())
+            mFreeIds.erase(free);
+    }
+
+    allocateSlot(mesh, id);
+    if (instanced)
+        attachInstance(id);
+    else
+        attachActor(id);
+    return true;
+}
+
+
+/**
+ * @brief Allocates an id and appends a slot with default state to every column.
+ *
+ * The slot has neither an actor nor a batch yet; the new object is marked dirty.
+ *
+ * @param mesh The object's geometry.
+ * @param id An id already taken off the free list, or InvalidObjectId to allocate one.
+ * @return ObjectId Handle of the new object.
+ */
+ObjectId Scene::allocateSlot(vtkSmartPointer<vtkPolyData> mesh, ObjectId id)
+{
+    if (id == InvalidObjectId && !mFreeIds.empty())
+    {
+        id = mFreeIds.back();
+        mFreeIds.pop_back();
+    }
+    else if (id == InvalidObjectId)
+    {
+        id = static_cast<ObjectId>(mSlotOf.size());
+        mSlotOf.push_back(InvalidObjectId);
+    }
+
+    mSlotOf[id] = static_cast<std::uint32_t>(mIds.size());
+    mIds.push_back(id);
+    mPosition.push_back({ 0.0, 0.0, 0.0 });
+    mOrientation.push_back({ 0.0, 0.0, 0.0 });
+    mScale.push_back(1.0);
+    mUserMatrix.push_back(IdentityMatrix);
+    mColor.push_back({ 0.0, 0.0, 0.0 });
+    mOpacity.push_back(1.0);
+    mHighlighted.push_back(0);
+    mSelected.push_back(0);
+    mDirty.push_back(0);
+    mMesh.push_back(mesh);
+    mRenderMesh.push_back(nullptr);
+    mActor.push_back(nullptr);
+    mBatch.push_back(nullptr);
+    mInstance.push_back(0);
+    mRevision.push_back(0);
+
+    markDirty(id, DirtyTransform | DirtyMaterial);
+
+    return id;
+}
+
+
+/**
+ * @brief Gives an object without a batch its own actor and adds it to the renderer.
+ *
+ * @param id The object.
+ */
+void Scene::attachActor(ObjectId id)
+{
+    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    mapper->SetInputData(shadedMesh(mMesh[slotOf(id)]));
+
+    vtkSmartPointer<vtkActor> actor = vtkSmartPointer<vtkActor>::New();
+    actor->SetMapper(mapper);
+    mActor[slotOf(id)] = actor;
+
+    if (mRenderer)
+        mRenderer->AddViewProp(actor);
+}
+
+
+/**
+ * @brief Removes an object and frees its id.
+ *
+ * @param id The object to remove.
+ */
+void Scene::removeObject(ObjectId id)
+{
+    if (!contains(id))
+        return;
+
+    const std::uint32_t slot = slotOf(id);
+
+    if (mBatch[slot])
+        detachInstance(id);
+    else if (mRenderer)
+        mRenderer->RemoveViewProp(mActor[slot]);
+
+    const std::uint32_t last = static_cast<std::uint32_t>(mIds.size() - 1);
+    if (slot != last)
+        moveSlot(last, slot);
+    popSlot();
+
+    mSlotOf[id] = InvalidObjectId;
+    mFreeIds.push_back(id);
+    ++mGeometryRevision;
+    mPruneNormals = true;
+
+    if (mCurrent == id)
+        mCurrent = InvalidObjectId;
+}
+
+
+/**
+ * @brief Removes every object and resets the id allocator.
+ */
+void Scene::clear()
+{
+    if (mRenderer)
+    {
+        for (const vtkSmartPointer<vtkActor>& actor : mActor)
+        {
+            if (actor)
+                mRenderer->RemoveViewProp(actor);
+        }
+        for (const auto& batch : mBatches)
+            mRenderer->RemoveViewProp(batch.second->actor());
+    }
+
+    mSlotOf.clear();
+    mFreeIds.clear();
+    mIds.clear();
+    mPosition.clear();
+    mOrientation.clear();
+    mScale.clear();
+    mUserMatrix.clear();
+    mColor.clear();
+    mOpacity.clear();
+    mHighlighted.clear();
+    mSelected.clear();
+    mDirty.clear();
+    mMesh.clear();
+    mRenderMesh.clear();
+    mActor.clear();
+    mBatch.clear();
+    mInstance.clear();
+    mRevision.clear();
+    mBatches.clear();
+    mDirtyList.clear();
+    mCurrent = InvalidObjectId;
+    ++mGeometryRevision;
+    mPruneNormals = true;
+}
+
+
+/**
+ * @brief Checks whether an id refers to a live object.
+ *
+ * @param id The id to check.
+ * @return true if the object exists.
+ */
+bool Scene::contains(ObjectId id) const
+{
+    return id < mSlotOf.size() && mSlotOf[id] != InvalidObjectId;
+}
+
+
+/**
+ * @brief Moves an object.
+ *
+ * @param id The object.
+ * @param position The new position in world coordinates.
+ */
+void Scene::setPosition(ObjectId id, const double position[3])
+{
+    const std::uint32_t slot = slotOf(id);
+    mPosition[slot] = { position[0], position[1], position[2] };
+    markDirty(id, DirtyTransform);
+}
+
+
+/**
+ * @brief Reads the position of an object.
+ *
+ * @param id The object.
+ * @param position Receives the position.
+ */
+void Scene::getPosition(ObjectId id, double position[3]) const
+{
+    const std::array<double, 3>& value = mPosition[slotOf(id)];
+    position[0] = value[0];
+    position[1] = value[1];
+    position[2] = value[2];
+}
+
+
+/**
+ * @brief Rotates an object.
+ *
+ * @param id The object.
+ * @param orientation Rotations about X, Y and Z in degrees, applied as by vtkProp3D.
+ */
+void Scene::setOrientation(ObjectId id, const double orientation[3])
+{
+    const std::uint32_t slot = slotOf(id);
+    mOrientation[slot] = { orientation[0], orientation[1], orientation[2] };
+    markDirty(id, DirtyTransform);
+}
+
+
+/**
+ * @brief Reads the orientation of an object.
+ *
+ * @param id The object.
+ * @param orientation Receives the rotations about X, Y and Z in degrees.
+ */
+void Scene::getOrientation(ObjectId id, double orientation[3]) const
+{
+    const std::array<double, 3>& value = mOrientation[slotOf(id)];
+    orientation[0] = value[0];
+    orientation[1] = value[1];
+    orientation[2] = value[2];
+}
+
+
+/**
+ * @brief Sets the uniform scale of an object.
+ *
+ * @param id The object.
+ * @param scale The scale factor.
+ */
+void Scene::setScale(ObjectId id, double scale)
+{
+    mScale[slotOf(id)] = scale;
+    markDirty(id, DirtyTransform);
+}
+
+
+/**
+ * @brief Returns the uniform scale of an object.
+ *
+ * @param id The object.
+ * @return double The scale factor.
+ */
+double Scene::scale(ObjectId id) const
+{
+    return mScale[slotOf(id)];
+}
+
+
+/**
+ * @brief Sets the matrix applied in world space after the model matrix.
+ *
+ * The glyph mapper places instances by position, orientation and scale only, so an
+ * instance given a matrix other than identity leaves its batch for an actor of its
+ * own. Its mesh is kept; it stays a plain object if the matrix is reset later.
+ *
+ * @param id The object.
+ * @param matrix Row-major 4x4 matrix.
+ */
+void Scene::setUserMatrix(ObjectId id, const double matrix[16])
+{
+    const std::uint32_t slot = slotOf(id);
+    std::copy(matrix, matrix + 16, mUserMatrix[slot].begin());
+    if (mBatch[slot] && mUserMatrix[slot] != IdentityMatrix)
+    {
+        detachInstance(id);
+        attachActor(id);
+        markDirty(id, DirtyAll);
+        return;
+    }
+    markDirty(id, DirtyTransform);
+}
+
+
+/**
+ * @brief Reads the user matrix of an object.
+ *
+ * @param id The object.
+ * @param matrix Receives the row-major 4x4 matrix.
+ */
+void Scene::getUserMatrix(ObjectId id, double matrix[16]) const
+{
+    const std::array<double, 16>& value = mUserMatrix[slotOf(id)];
+    std::copy(value.begin(), value.end(), matrix);
+}
+
+
+/**
+ * @brief Checks whether an object has a user matrix other than identity.
+ *
+ * @param id The object.
+ * @return true if the user matrix is not identity.
+ */
+bool Scene::hasUserMatrix(ObjectId id) const
+{
+    return mUserMatrix[slotOf(id)] != IdentityMatrix;
+}
+
+
+/**
+ * @brief Computes the matrix built from position, orientation and scale.
+ *
+ * Rotations are applied in the same order as vtkProp3D: Y, then X, then Z.
+ *
+ * @param id The object.
+ * @param matrix Receives the model matrix.
+ */
+void Scene::getModelMatrix(ObjectId id, vtkMatrix4x4* matrix) const
+{
+    const std::uint32_t slot = slotOf(id);
+    const std::array<double, 3>& position = mPosition[slot];
+    const std::array<double, 3>& orientation = mOrientation[slot];
+
+    vtkNew<vtkTransform> transform;
+    transform->PostMultiply();
+    transform->Scale(mScale[slot], mScale[slot], mScale[slot]);
+    transform->RotateY(orientation[1]);
+    transform->RotateX(orientation[0]);
+    transform->RotateZ(orientation[2]);
+    transform->Translate(position[0], position[1], position[2]);
+
+    matrix->DeepCopy(transform->GetMatrix());
+}
+
+
+/**
+ * @brief Computes the matrix placing the object's mesh in the world.
+ *
+ * The user matrix acts in world space, after the model matrix.
+ *
+ * @param id The object.
+ * @param matrix Receives the row-major 4x4 world matrix.
+ */
+void Scene::getWorldMatrix(ObjectId id, double matrix[16]) const
+{
+    vtkNew<vtkMatrix4x4> model;
+    getModelMatrix(id, model);
+    vtkMatrix4x4::Multiply4x4(mUserMatrix[slotOf(id)].data(), model->GetData(), matrix);
+}
+
+
+/**
+ * @brief Sets the color of an object.
+ *
+ * @param id The object.
+ * @param rgb Red, green and blue in [0, 1].
+ */
+void Scene::setColor(ObjectId id, const double rgb[3])
+{
+    mColor[slotOf(id)] = { rgb[0], rgb[1], rgb[2] };
+    markDirty(id, DirtyMaterial);
+}
+
+
+/**
+ * @brief Reads the color of an object.
+ *
+ * @param id The object.
+ * @param rgb Receives red, green and blue in [0, 1].
+ */
+void Scene::getColor(ObjectId id, double rgb[3]) const
+{
+    const std::array<double, 3>& value = mColor[slotOf(id)];
+    rgb[0] = value[0];
+    rgb[1] = value[1];
+    rgb[2] = value[2];
+}
+
+
+/**
+ * @brief Sets the opacity of an object.
+ *
+ * @param id The object.
+ * @param opacity Opacity in [0, 1].
+ */
+void Scene::setOpacity(ObjectId id, double opacity)
+{
+    mOpacity[slotOf(id)] = opacity;
+    markDirty(id, DirtyMaterial);
+}
+
+
+/**
+ * @brief Returns the opacity of an object.
+ *
+ * @param id The object.
+ * @return double Opacity in [0, 1].
+ */
+double Scene::opacity(ObjectId id) const
+{
+    return mOpacity[slotOf(id)];
+}
+
+
+/**
+ * @brief Marks an object as highlighted, e.g. because it interferes with another.
+ *
+ * Only a change of state dirties the object's material.
+ *
+ * @param id The object.
+ * @param highlighted True to highlight the object.
+ */
+void Scene::setHighlighted(ObjectId id, bool highlighted)
+{
+    std::uint8_t& value = mHighlighted[slotOf(id)];
+    if (value == (highlighted ? 1 : 0))
+        return;
+    value = highlighted ? 1 : 0;
+    markDirty(id, DirtyMaterial);
+}
+
+
+/**
+ * @brief Checks whether an object is highlighted.
+ *
+ * @param id The object.
+ * @return true if the object is highlighted.
+ */
+bool Scene::isHighlighted(ObjectId id) const
+{
+    return mHighlighted[slotOf(id)] != 0;
+}
+
+
+/**
+ * @brief Replaces the geometry of an object.
+ *
+ * An instance moves to the batch of its new mesh. Any other object drops its render
+ * mesh and gets a new geometry revision.
+ *
+ * @param id The object.
+ * @param mesh The new geometry.
+ */
+void Scene::setMesh(ObjectId id, vtkSmartPointer<vtkPolyData> mesh)
+{
+    const std::uint32_t slot = slotOf(id);
+    if (mBatch[slot])
+    {
+        // Instances of a different mesh belong to a different batch
+        detachInstance(id);
+        mMesh[slot] = mesh;
+        attachInstance(id);
+        return;
+    }
+
+    mMesh[slot] = mesh;
+    mRenderMesh[slot] = nullptr;
+    mRevision[slot] = ++mGeometryRevision;
+    mPruneNormals = true;
+    markDirty(id, DirtyMesh);
+}
+
+
+/**
+ * @brief Draws an object with another mesh, e.g. a level of detail, while keeping its geometry.
+ *
+ * Ignored for instances.
+ *
+ * @param id The object.
+ * @param mesh The mesh to draw, or null to draw the object's own mesh.
+ */
+void Scene::setRenderMesh(ObjectId id, vtkSmartPointer<vtkPolyData> mesh)
+{
+    const std::uint32_t slot = slotOf(id);
+    if (mBatch[slot] || mRenderMesh[slot] == mesh)
+        return;
+
+    mRenderMesh[slot] = mesh;
+    markDirty(id, DirtyMesh);
+}
+
+
+/**
+ * @brief Returns the mesh drawn in place of an object's geometry.
+ *
+ * @param id The object.
+ * @return vtkPolyData* The render mesh, or null if the object's own mesh is drawn.
+ */
+vtkPolyData* Scene::renderMesh(ObjectId id) const
+{
+    return mRenderMesh[slotOf(id)];
+}
+
+
+/**
+ * @brief Returns the geometry of an object.
+ *
+ * @param id The object.
+ * @return vtkPolyData* The object's mesh.
+ */
+vtkPolyData* Scene::mesh(ObjectId id) const
+{
+    return mMesh[slotOf(id)];
+}
+
+/**
+ * @brief Returns the mesh with the user matrix applied in model space.
+ *
+ * The user matrix U acts in world space after the model matrix P, so the model-space
+ * equivalent is P^-1 * U * P. The connectivity of the result is shared with the original.
+ *
+ * If that transform keeps angles and the mesh is drawn with cached normals, the cached
+ * mesh is transformed instead, so its normals are rotated along with the points rather
+ * than computed again for the baked mesh. A mesh's own normals are transformed in any
+ * case.
+ *
+ * @param id The object.
+ * @return vtkSmartPointer<vtkPolyData> The transformed mesh, or the object's mesh if U is identity.
+ */
+vtkSmartPointer<vtkPolyData> Scene::bakedMesh(ObjectId id) const
+{
+    TRACE_SCOPE("Scene::bakedMesh", "scene");
+
+    const std::uint32_t slot = slotOf(id);
+    if (mUserMatrix[slot] == IdentityMatrix)
+        return mMesh[slot];
+
+    vtkNew<vtkMatrix4x4> model;
+    getModelMatrix(id, model);
+
+    vtkNew<vtkMatrix4x4> inverseModel;
+    vtkMatrix4x4::Invert(model, inverseModel);
+
+    vtkNew<vtkTransform> transform;
+    transform->PostMultiply();
+    transform->Concatenate(model);
+    transform->Concatenate(mUserMatrix[slot].data());
+    transform->Concatenate(inverseModel);
+
+    vtkPolyData* source = mMesh[slot];
+    if (!source->GetPointData()->GetNormals() && MeshNormals::preservesAngles(transform->GetMatrix()->GetData()))
+    {
+        if (vtkPolyData* shaded = mNormals.find(source))
+            source = shaded;
+    }
+
+    vtkNew<vtkTransformPolyDataFilter> transformFilter;
+    transformFilter->SetInputData(source);
+    transformFilter->SetTransform(transform);
+    transformFilter->Update();
+
+    vtkSmartPointer<vtkPolyData> baked = vtkSmartPointer<vtkPolyData>::New();
+    baked->ShallowCopy(transformFilter->GetOutput());
+    return MeshStorage::adapt(baked);
+}
+
+
+/**
+ * @brief Applies the user matrix to the object's mesh and resets it to identity.
+ *
+ * The object is drawn where it was before.
+ *
+ * @param id The object.
+ */
+void Scene::bakeUserMatrix(ObjectId id)
+{
+    if (!hasUserMatrix(id))
+        return;
+
+    setMesh(id, bakedMesh(id));
+    setUserMatrix(id, IdentityMatrix.data());
+}
+
+
+/**
+ * @brief Returns the actor of an object.
+ *
+ * @param id The object.
+ * @return vtkActor* The actor, or null for an instance.
+ */
+vtkActor* Scene::actor(ObjectId id) const
+{
+    return mActor[slotOf(id)];
+}
+
+
+/**
+ * @brief Checks whether an object is drawn through an instance batch.
+ *
+ * @param id The object.
+ * @return true if the object is an instance.
+ */
+bool Scene::isInstanced(ObjectId id) const
+{
+    return mBatch[slotOf(id)] != nullptr;
+}
+
+
+/**
+ * @brief Sets the current object.
+ *
+ * @param id The new current object, or InvalidObjectId to clear it.
+ */
+void Scene::setCurrent(ObjectId id)
+{
+    mCurrent = contains(id) ? id : InvalidObjectId;
+}
+
+
+/**
+ * @brief Adds an object to the selection or removes it.
+ *
+ * @param id The object.
+ * @param selected True to select the object.
+ */
+void Scene::setSelected(ObjectId id, bool selected)
+{
+    mSelected[slotOf(id)] = selected ? 1 : 0;
+}
+
+
+/**
+ * @brief Checks whether an object is selected.
+ *
+ * @param id The object.
+ * @return true if the object is selected.
+ */
+bool Scene::isSelected(ObjectId id) const
+{
+    return mSelected[slotOf(id)] != 0;
+}
+
+
+/**
+ * @brief Deselects every object.
+ */
+void Scene::clearSelection()
+{
+    std::fill(mSelected.begin(), mSelected.end(), std::uint8_t(0));
+}
+
+
+/**
+ * @brief Selects every object.
+ */
+void Scene::selectAll()
+{
+    std::fill(mSelected.begin(), mSelected.end(), std::uint8_t(1));
+}
+
+
+/**
+ * @brief Returns the selected objects.
+ *
+ * @return std::vector<ObjectId> The selected objects, in scene order.
+ */
+std::vector<ObjectId> Scene::selection() const
+{
+    std::vector<ObjectId> selected;
+    for (std::size_t slot = 0; slot < mIds.size(); ++slot)
+    {
+        if (mSelected[slot])
+            selected.push_back(mIds[slot]);
+    }
+    return selected;
+}
+
+
+/**
+ * @brief Adds dirty bits to an object and queues it for the next sync.
+ *
+ * @param id The object.
+ * @param flags Combination of DirtyFlag bits.
+ */
+void Scene::markDirty(ObjectId id, std::uint8_t flags)
+{
+    const std::uint32_t slot = slotOf(id);
+    std::uint8_t& dirty = mDirty[slot];
+    if (dirty == 0)
+        mDirtyList.push_back(id);
+    dirty |= flags;
+
+    if (flags & DirtyTransform)
+        mRevision[slot] = ++mGeometryRevision;
+}
+
+
+/**
+ * @brief Pushes the dirty columns of each queued object to its actor or instance batch.
+ *
+ * Objects that were removed after being queued are skipped. Each touched batch
+ * is committed once after all its instances were written.
+ *
+ * @return std::size_t Number of objects synced.
+ */
+std::size_t Scene::syncToVtk()
+{
+    TRACE_SCOPE("Scene::syncToVtk", "scene");
+
+    std::size_t synced = 0;
+    std::vector<InstanceBatch*> touchedBatches;
+
+    for (ObjectId id : mDirtyList)
+    {
+        if (!contains(id))
+            continue;
+
+        const std::uint32_t slot = slotOf(id);
+        const std::uint8_t dirty = mDirty[slot];
+        if (dirty == 0)
+            continue;
+
+        const double* color = mHighlighted[slot] ? HighlightColor : mColor[slot].data();
+
+        if (InstanceBatch* batch = mBatch[slot])
+        {
+            batch->set(mInstance[slot], mPosition[slot].data(), mOrientation[slot].data(),
+                       mScale[slot], color, mOpacity[slot]);
+
+            if (std::find(touchedBatches.begin(), touchedBatches.end(), batch) == touchedBatches.end())
+                touchedBatches.push_back(batch);
+
+            mDirty[slot] = 0;
+            ++synced;
+            continue;
+        }
+
+        vtkActor* actor = mActor[slot];
+
+        if (dirty & DirtyTransform)
+        {
+            actor->SetPosition(mPosition[slot].data());
+            actor->SetOrientation(mOrientation[slot].data());
+            actor->SetScale(mScale[slot]);
+
+            if (mUserMatrix[slot] == IdentityMatrix)
+            {
+                actor->SetUserMatrix(nullptr);
+            }
+            else
+            {
+                vtkNew<vtkMatrix4x4> userMatrix;
+                userMatrix->DeepCopy(mUserMatrix[slot].data());
+                actor->SetUserMatrix(userMatrix);
+            }
+        }
+
+        if (dirty & DirtyMaterial)
+        {
+            actor->GetProperty()->SetColor(color);
+            actor->GetProperty()->SetOpacity(mOpacity[slot]);
+        }
+
+        if (dirty & DirtyMesh)
+        {
+            vtkPolyData* mesh = mRenderMesh[slot] ? mRenderMesh[slot] : mMesh[slot];
+            vtkPolyDataMapper::SafeDownCast(actor->GetMapper())->SetInputData(shadedMesh(mesh));
+        }
+
+        mDirty[slot] = 0;
+        ++synced;
+    }
+
+    for (InstanceBatch* batch : touchedBatches)
+        batch->commit();
+
+    if (mPruneNormals)
+    {
+        mNormals.prune();
+        mPruneNormals = false;
+    }
+
+    mDirtyList.clear();
+    return synced;
+}
+
+
+/**
+ * @brief Copies every column of one slot into another and repoints the moved id.
+ *
+ * @param from Source slot.
+ * @param to Destination slot.
+ */
+void Scene::moveSlot(std::uint32_t from, std::uint32_t to)
+{
+    mIds[to] = mIds[from];
+    mPosition[to] = mPosition[from];
+    mOrientation[to] = mOrientation[from];
+    mScale[to] = mScale[from];
+    mUserMatrix[to] = mUserMatrix[from];
+    mColor[to] = mColor[from];
+    mOpacity[to] = mOpacity[from];
+    mHighlighted[to] = mHighlighted[from];
+    mSelected[to] = mSelected[from];
+    mDirty[to] = mDirty[from];
+    mMesh[to] = mMesh[from];
+    mRenderMesh[to] = mRenderMesh[from];
+    mActor[to] = mActor[from];
+    mBatch[to] = mBatch[from];
+    mInstance[to] = mInstance[from];
+    mRevision[to] = mRevision[from];
+
+    mSlotOf[mIds[to]] = to;
+}
+
+
+/**
+ * @brief Drops the last slot from every column.
+ */
+void Scene::popSlot()
+{
+    mIds.pop_back();
+    mPosition.pop_back();
+    mOrientation.pop_back();
+    mScale.pop_back();
+    mUserMatrix.pop_back();
+    mColor.pop_back();
+    mOpacity.pop_back();
+    mHighlighted.pop_back();
+    mSelected.pop_back();
+    mDirty.pop_back();
+    mMesh.pop_back();
+    mRenderMesh.pop_back();
+    mActor.pop_back();
+    mBatch.pop_back();
+    mInstance.pop_back();
+    mRevision.pop_back();
+}
+
+
+/**
+ * @brief Returns the batch drawing the given mesh, creating it on first use.
+ *
+ * @param mesh The shared mesh.
+ * @return InstanceBatch* The batch.
+ */
+InstanceBatch* Scene::batchFor(vtkPolyData* mesh)
+{
+    std::unique_ptr<InstanceBatch>& batch = mBatches[mesh];
+    if (!batch)
+    {
+        batch = std::make_unique<InstanceBatch>(shadedMesh(mesh));
+        if (mRenderer)
+            mRenderer->AddViewProp(batch->actor());
+    }
+    return batch.get();
+}
+
+
+/**
+ * @brief Returns the mesh to draw for an object's mesh: the mesh itself, or a copy with cached normals if it has none.
+ *
+ * Headless scenes are never drawn and skip the normals.
+ *
+ * @param mesh The object's mesh or render mesh.
+ * @return vtkSmartPointer<vtkPolyData> The mesh with normals.
+ */
+vtkSmartPointer<vtkPolyData> Scene::shadedMesh(vtkPolyData* mesh)
+{
+    return mRenderer ? mNormals.get(mesh) : mesh;
+}
+
+
+/**
+ * @brief Adds the object to the batch of its mesh and marks it fully dirty.
+ *
+ * @param id The object.
+ */
+void Scene::attachInstance(ObjectId id)
+{
+    const std::uint32_t slot = slotOf(id);
+    InstanceBatch* batch = batchFor(mMesh[slot]);
+
+    mBatch[slot] = batch;
+    mInstance[slot] = static_cast<std::uint32_t>(batch->add(id));
+    markDirty(id, DirtyAll);
+}
+
+
+/**
+ * @brief Removes the object from its batch, dropping the batch when it becomes empty.
+ *
+ * @param id The object.
+ */
+void Scene::detachInstance(ObjectId id)
+{
+    const std::uint32_t slot = slotOf(id);
+    InstanceBatch* batch = mBatch[slot];
+
+    const ObjectId moved = batch->remove(mInstance[slot]);
+    if (moved != id)
+        mInstance[slotOf(moved)] = mInstance[slot];
+
+    mBatch[slot] = nullptr;
+
+    if (batch->size() == 0)
+    {
+        if (mRenderer)
+            mRenderer->RemoveViewProp(batch->actor());
+        mBatches.erase(mMesh[slot]);
+    }
+}
@@ -0,0 +1,447 @@
+/**
+ * @file scenePicker.cpp
+ * @brief Implementation of the ScenePicker class.
+ */
+
+#include "scenePicker.h"
+#include "trace.h"
+
+#include <vtkMatrix4x4.h>
+
+#include <algorithm>
+#include <limits>
+
+
+namespace
+{
+
+/// Objects per leaf of the top level.
+constexpr std::uint32_t MaxLeafObjects = 2;
+
+/// Depth of the traversal stack; median splits keep the top level well below it.
+constexpr int StackSize = 64;
+
+/// Refitting may grow the total node area up to this factor before the top level is rebuilt.
+constexpr float RebuildAreaFactor = 2.0f;
+
+template <typename Node>
+void setEmpty(Node& node)
+{
+    std::fill(node.lower, node.lower + 3, std::numeric_limits<float>::max());
+    std::fill(node.upper, node.upper + 3, std::numeric_limits<float>::lowest());
+}
+
+template <typename Node>
+void grow(Node& node, const float lower[3], const float upper[3])
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        node.lower[axis] = std::min(node.lower[axis], lower[axis]);
+        node.upper[axis] = std::max(node.upper[axis], upper[axis]);
+    }
+}
+
+/// Half the surface area of a node's box.
+template <typename Node>
+float area(const Node& node)
+{
+    const float x = node.upper[0] - node.lower[0];
+    const float y = node.upper[1] - node.lower[1];
+    const float z = node.upper[2] - node.lower[2];
+    return x < 0.0f ? 0.0f : x * y + y * z + z * x;
+}
+
+/**
+ * @brief Enters the ray into a box.
+ *
+ * @return float The ray parameter where it enters the box, or a negative value if it misses it before tMax.
+ */
+float enterBox(const float lower[3], const float upper[3], const float origin[3], const float inverse[3], float tMax)
+{
+    float tNear = 0.0f;
+    float tFar = tMax;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float t0 = (lower[axis] - origin[axis]) * inverse[axis];
+        float t1 = (upper[axis] - origin[axis]) * inverse[axis];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        tNear = t0 > tNear ? t0 : tNear;
+        tFar = t1 < tFar ? t1 : tFar;
+    }
+    return tNear <= tFar ? tNear : -1.0f;
+}
+
+} // namespace
+
+
+/**
+ * @brief Constructs a picker for a scene.
+ *
+ * @param scene The scene to pick from.
+ * @param cache Cache of the mesh hierarchies.
+ */
+ScenePicker::ScenePicker(const Scene& scene, MeshBvhCache& cache) : mScene(scene), mCache(cache)
+{
+}
+
+
+/**
+ * @brief Finds the closest object along a ray.
+ *
+ * The top level is traversed nearer child first; at each object the ray is moved into
+ * model space and handed to the object's mesh hierarchy with the closest distance so
+ * far, so farther objects are culled as soon as a hit is found.
+ *
+ * @param origin Start of the ray in world coordinates.
+ * @param direction Direction of the ray.
+ * @return Hit The closest hit, if any.
+ */
+ScenePicker::Hit ScenePicker::pick(const double origin[3], const double direction[3])
+{
+    TRACE_SCOPE("ScenePicker::pick", "picking");
+
+    update();
+
+    Hit hit;
+    if (mNodes.empty())
+        return hit;
+
+    const float originF[3] = { static_cast<float>(origin[0]), static_cast<float>(origin[1]), static_cast<float>(origin[2]) };
+    const float inverse[3] = { 1.0f / static_cast<float>(direction[0]), 1.0f / static_cast<float>(direction[1]),
+                               1.0f / static_cast<float>(direction[2]) };
+
+    double best = std::numeric_limits<double>::infinity();
+    auto limit = [&]() { return std::min(static_cast<float>(best), std::numeric_limits<float>::max()); };
+
+    struct Entry
+    {
+        std::uint32_t node;
+        float t;
+    };
+    Entry stack[StackSize];
+    int top = 0;
+
+    const float tRoot = enterBox(mNodes[0].lower, mNodes[0].upper, originF, inverse, limit());
+    if (tRoot >= 0.0f)
+        stack[top++] = { 0, tRoot };
+
+    while (top > 0)
+    {
+        const Entry entry = stack[--top];
+        if (entry.t > best)
+            continue;
+
+        const Node& node = mNodes[entry.node];
+        if (node.count > 0)
+        {
+            for (std::uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                const std::array<float, 6>& bounds = mBounds[i];
+                if (enterBox(bounds.data(), bounds.data() + 3, originF, inverse, limit()) < 0.0f)
+                    continue;
+
+                const std::shared_ptr<const MeshBvh> bvh = mCache.get(mScene.mesh(mObjects[i]));
+                if (!bvh)
+                    continue;
+
+                // Points move with the translation, directions do not; t is unchanged
+                const double* m = mInverse[i].data();
+                const double modelOrigin[3] = {
+                    m[0] * origin[0] + m[1] * origin[1] + m[2] * origin[2] + m[3],
+                    m[4] * origin[0] + m[5] * origin[1] + m[6] * origin[2] + m[7],
+                    m[8] * origin[0] + m[9] * origin[1] + m[10] * origin[2] + m[11],
+                };
+                const double modelDirection[3] = {
+                    m[0] * direction[0] + m[1] * direction[1] + m[2] * direction[2],
+                    m[4] * direction[0] + m[5] * direction[1] + m[6] * direction[2],
+                    m[8] * direction[0] + m[9] * direction[1] + m[10] * direction[2],
+                };
+
+                MeshBvh::Hit meshHit;
+                if (bvh->intersect(modelOrigin, modelDirection, best, meshHit))
+                {
+                    best = meshHit.t;
+                    hit.object = mObjects[i];
+                    hit.cell = meshHit.cell;
+                    hit.t = meshHit.t;
+                }
+            }
+            continue;
+        }
+
+        const Node& left = mNodes[node.first];
+        const Node& right = mNodes[node.first + 1];
+        const float tLeft = enterBox(left.lower, left.upper, originF, inverse, limit());
+        const float tRight = enterBox(right.lower, right.upper, originF, inverse, limit());
+        const bool leftFirst = tLeft <= tRight;
+        const Entry nearer = { leftFirst ? node.first : node.first + 1, leftFirst ? tLeft : tRight };
+        const Entry farther = { leftFirst ? node.first + 1 : node.first, leftFirst ? tRight : tLeft };
+
+        if (farther.t >= 0.0f && top < StackSize)
+            stack[top++] = farther;
+        if (nearer.t >= 0.0f && top < StackSize)
+            stack[top++] = nearer;
+    }
+
+    if (hit.hit())
+    {
+        for (int axis = 0; axis < 3; ++axis)
+            hit.point[axis] = origin[axis] + hit.t * direction[axis];
+    }
+    return hit;
+}
+
+
+/**
+ * @brief Brings the top level up to date with the scene.
+ *
+ * Costs one comparison of revisions when nothing changed, and one pass over the
+ * scene's ids when something did. The top level is rebuilt if an id is new to it or
+ * the object count changed, and refit otherwise.
+ */
+void ScenePicker::update()
+{
+    if (mBuilt && mScene.geometryRevision() == mRevision)
+        return;
+
+    if (!mBuilt || mScene.size() != mObjects.size())
+    {
+        rebuild();
+        return;
+    }
+
+    bool moved = false;
+    for (ObjectId id : mScene.objects())
+    {
+        if (id >= mIndexOf.size() || mIndexOf[id] == InvalidObjectId)
+        {
+            rebuild();
+            return;
+        }
+
+        const std::uint32_t index = mIndexOf[id];
+        if (mScene.geometryRevision(id) != mObjectRevision[index])
+        {
+            computeObject(index);
+            moved = true;
+        }
+    }
+
+    mRevision = mScene.geometryRevision();
+    if (moved)
+        refit();
+}
+
+
+/**
+ * @brief Drops the top level.
+ */
+void ScenePicker::clear()
+{
+    mNodes.clear();
+    mObjects.clear();
+    mInverse.clear();
+    mBounds.clear();
+    mObjectRevision.clear();
+    mIndexOf.clear();
+    mBuilt = false;
+}
+
+
+/**
+ * @brief Returns a snapshot of the counters.
+ */
+ScenePicker::Statistics ScenePicker::statistics() const
+{
+    const MeshBvhCache::Statistics meshes = mCache.statistics();
+    Statistics statistics;
+    statistics.objects = mObjects.size();
+    statistics.meshes = meshes.meshes;
+    statistics.triangles = meshes.triangles;
+    statistics.bytes = meshes.bytes;
+    statistics.rebuilds = mRebuilds;
+    statistics.refits = mRefits;
+    return statistics;
+}
+
+
+/**
+ * @brief Rebuilds the top level over every object of the scene.
+ *
+ * Nodes are split at the median along the widest axis of their objects' centers.
+ * Hierarchies of meshes no object uses any more are released from the cache.
+ */
+void ScenePicker::rebuild()
+{
+    TRACE_SCOPE("ScenePicker::rebuild", "picking");
+
+    const std::vector<ObjectId>& ids = mScene.objects();
+    const std::uint32_t count = static_cast<std::uint32_t>(ids.size());
+
+    mObjects = ids;
+    mInverse.resize(count);
+    mBounds.resize(count);
+    mObjectRevision.resize(count);
+    for (std::uint32_t i = 0; i < count; ++i)
+        computeObject(i);
+
+    mNodes.clear();
+    if (count > 0)
+    {
+        std::vector<std::uint32_t> order(count);
+        for (std::uint32_t i = 0; i < count; ++i)
+            order[i] = i;
+
+        mNodes.reserve(2 * static_cast<std::size_t>(count));
+        mNodes.emplace_back();
+        buildNode(order, 0, 0, count);
+
+        // Store objects in leaf order
+        auto permute = [&order](auto& column) {
+            std::remove_reference_t<decltype(column)> sorted(column.size());
+            for (std::size_t i = 0; i < order.size(); ++i)
+                sorted[i] = column[order[i]];
+            column.swap(sorted);
+        };
+        permute(mObjects);
+        permute(mInverse);
+        permute(mBounds);
+        permute(mObjectRevision);
+    }
+
+    mIndexOf.assign(ids.empty() ? 0 : *std::max_element(ids.begin(), ids.end()) + 1, InvalidObjectId);
+    for (std::uint32_t i = 0; i < count; ++i)
+        mIndexOf[mObjects[i]] = i;
+    mCache.prune(mScene);
+
+    mBuiltArea = 0.0f;
+    for (const Node& node : mNodes)
+        mBuiltArea += area(node);
+
+    mRevision = mScene.geometryRevision();
+    mBuilt = true;
+    ++mRebuilds;
+}
+
+
+/**
+ * @brief Recomputes the boxes of every node from the objects' bounds, keeping the topology.
+ *
+ * Children always come after their parent, so one backward pass suffices. Falls back
+ * to a rebuild when the boxes grew too loose to cull well.
+ */
+void ScenePicker::refit()
+{
+    TRACE_SCOPE("ScenePicker::refit", "picking");
+
+    float total = 0.0f;
+    for (std::size_t i = mNodes.size(); i-- > 0;)
+    {
+        Node& node = mNodes[i];
+        setEmpty(node);
+        if (node.count > 0)
+        {
+            for (std::uint32_t object = node.first; object < node.first + node.count; ++object)
+                grow(node, mBounds[object].data(), mBounds[object].data() + 3);
+        }
+        else
+        {
+            grow(node, mNodes[node.first].lower, mNodes[node.first].upper);
+            grow(node, mNodes[node.first + 1].lower, mNodes[node.first + 1].upper);
+        }
+        total += area(node);
+    }
+
+    ++mRefits;
+    if (total > RebuildAreaFactor * mBuiltArea)
+        rebuild();
+}
+
+
+/**
+ * @brief Reads the world matrix and mesh bounds of an object and computes its world bounds.
+ *
+ * The bounds are those of the mesh's bounding box corners moved into the world, and
+ * empty for objects without geometry.
+ *
+ * @param index Position of the object in the leaf-ordered columns.
+ */
+void ScenePicker::computeObject(std::uint32_t index)
+{
+    const ObjectId id = mObjects[index];
+    mObjectRevision[index] = mScene.geometryRevision(id);
+
+    double world[16];
+    mScene.getWorldMatrix(id, world);
+    vtkMatrix4x4::Invert(world, mInverse[index].data());
+
+    std::array<float, 6>& bounds = mBounds[index];
+    std::fill(bounds.begin(), bounds.begin() + 3, std::numeric_limits<float>::max());
+    std::fill(bounds.begin() + 3, bounds.end(), std::numeric_limits<float>::lowest());
+
+    vtkPolyData* mesh = mScene.mesh(id);
+    if (!mesh || mesh->GetNumberOfPoints() == 0)
+        return;
+
+    double meshBounds[6];
+    mesh->GetBounds(meshBounds);
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        const double p[3] = { meshBounds[corner & 1], meshBounds[2 + ((corner >> 1) & 1)], meshBounds[4 + ((corner >> 2) & 1)] };
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const double* row = world + 4 * axis;
+            const float value = static_cast<float>(row[0] * p[0] + row[1] * p[1] + row[2] * p[2] + row[3]);
+            bounds[axis] = std::min(bounds[axis], value);
+            bounds[3 + axis] = std::max(bounds[3 + axis], value);
+        }
+    }
+}
+
+
+/**
+ * @brief Builds the node at index over the objects order[begin, end).
+ */
+void ScenePicker::buildNode(std::vector<std::uint32_t>& order, std::uint32_t index, std::uint32_t begin, std::uint32_t end)
+{
+    setEmpty(mNodes[index]);
+    Node centers;
+    setEmpty(centers);
+    for (std::uint32_t i = begin; i < end; ++i)
+    {
+        const std::array<float, 6>& bounds = mBounds[order[i]];
+        const float center[3] = { bounds[0] + bounds[3], bounds[1] + bounds[4], bounds[2] + bounds[5] };
+        grow(mNodes[index], bounds.data(), bounds.data() + 3);
+        grow(centers, center, center);
+    }
+
+    if (end - begin <= MaxLeafObjects)
+    {
+        mNodes[index].first = begin;
+        mNodes[index].count = end - begin;
+        return;
+    }
+
+    int axis = 0;
+    for (int candidate = 1; candidate < 3; ++candidate)
+    {
+        if (centers.upper[candidate] - centers.lower[candidate] > centers.upper[axis] - centers.lower[axis])
+            axis = candidate;
+    }
+
+    const std::uint32_t middle = begin + (end - begin) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+                     [&](std::uint32_t a, std::uint32_t b) {
+                         return mBounds[a][axis] + mBounds[a][3 + axis] < mBounds[b][axis] + mBounds[b][3 + axis];
+                     });
+
+    const std::uint32_t children = static_cast<std::uint32_t>(mNodes.size());
+    mNodes.emplace_back();
+    mNodes.emplace_back();
+    mNodes[index].first = children;
+    mNodes[index].count = 0;
+
+    buildNode(order, children, begin, middle);
+    buildNode(order, children + 1, middle, end);
+}
@@ -0,0 +1,199 @@
+/**
+ * @file shapeCache.cpp
+ * @brief Implementation of the ShapeCache class.
+ */
+
+#include "shapeCache.h"
+#include "trace.h"
+
+
+/**
+ * @brief Constructs an empty cache with the given memory cap.
+ *
+ * @param capacityBytes Maximum memory the cached meshes may use.
+ */
+ShapeCache::ShapeCache(std::size_t capacityBytes) : mCapacityBytes(capacityBytes)
+{
+}
+
+
+/**
+ * @brief Stops and joins the pre-warm thread.
+ */
+ShapeCache::~ShapeCache()
+{
+    mStopPrewarm = true;
+    waitForPrewarm();
+}
+
+
+/**
+ * @brief Looks up the shape's mesh, generating and caching it on a miss.
+ *
+ * Generation runs without holding the lock so that concurrent misses on
+ * different keys do not serialize. If two threads miss on the same key, the
+ * first mesh inserted wins and the other is discarded.
+ *
+ * @param shape The shape whose geometry is requested.
+ * @param policy How finely curved surfaces are tessellated.
+ * @return vtkSmartPointer<vtkPolyData> The shared, immutable mesh.
+ */
+vtkSmartPointer<vtkPolyData> ShapeCache::getOrCreate(const Shape& shape, const TessellationPolicy& policy)
+{
+    const ShapeKey key = shape.key(policy);
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto found = mIndex.find(key);
+        if (found != mIndex.end())
+        {
+            ++mHits;
+            mEntries.splice(mEntries.begin(), mEntries, found->second);
+            return found->second->mesh;
+        }
+
+        ++mMisses;
+    }
+
+    vtkSmartPointer<vtkPolyData> mesh;
+    {
+        TRACE_SCOPE("Shape::createMesh", "shapes");
+        mesh = shape.createMesh(policy);
+    }
+    insert(key, mesh);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto found = mIndex.find(key);
+    return found != mIndex.end() ? found->second->mesh : mesh;
+}
+
+
+/**
+ * @brief Sets the memory cap and evicts meshes until the cache fits.
+ *
+ * @param capacityBytes Maximum memory the cached meshes may use.
+ */
+void ShapeCache::setCapacity(std::size_t capacityBytes)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCapacityBytes = capacityBytes;
+    evictToCapacity();
+}
+
+
+/**
+ * @brief Returns a snapshot of the cache counters.
+ *
+ * @return Statistics The current counters.
+ */
+ShapeCache::Statistics ShapeCache::statistics() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    Statistics stats;
+    stats.hits = mHits;
+    stats.misses = mMisses;
+    stats.evictions = mEvictions;
+    stats.entries = mEntries.size();
+    stats.bytes = mBytes;
+    stats.capacityBytes = mCapacityBytes;
+    return stats;
+}
+
+
+/**
+ * @brief Drops every cached mesh.
+ */
+void ShapeCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mIndex.clear();
+    mEntries.clear();
+    mBytes = 0;
+}
+
+
+/**
+ * @brief Generates the given shapes on a background thread.
+ *
+ * Pre-warmed meshes are inserted without touching the hit/miss counters.
+ *
+ * @param shapes Shapes to generate.
+ */
+void ShapeCache::prewarm(std::vector<std::unique_ptr<Shape>> shapes)
+{
+    waitForPrewarm();
+    mStopPrewarm = false;
+
+    mPrewarmThread = std::thread([this, shapes = std::move(shapes)]() {
+        for (const std::unique_ptr<Shape>& shape : shapes)
+        {
+            if (mStopPrewarm)
+                return;
+
+            const ShapeKey key = shape->key();
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (mIndex.count(key))
+                    continue;
+            }
+
+            insert(key, shape->createMesh());
+        }
+    });
+}
+
+
+/**
+ * @brief Joins the pre-warm thread if it is running.
+ */
+void ShapeCache::waitForPrewarm()
+{
+    if (mPrewarmThread.joinable())
+        mPrewarmThread.join();
+}
+
+
+/**
+ * @brief Inserts a mesh as the most recently used entry, unless the key is already cached.
+ *
+ * Meshes larger than the whole capacity are not cached at all.
+ *
+ * @param key The key of the mesh.
+ * @param mesh The generated mesh.
+ */
+void ShapeCache::insert(const ShapeKey& key, vtkSmartPointer<vtkPolyData> mesh)
+{
+    // GetActualMemorySize() reports kibibytes.
+    const std::size_t bytes = static_cast<std::size_t>(mesh->GetActualMemorySize()) * 1024u;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mIndex.count(key) || bytes > mCapacityBytes)
+        return;
+
+    mEntries.push_front(Entry{ key, mesh, bytes });
+    mIndex[key] = mEntries.begin();
+    mBytes += bytes;
+
+    evictToCapacity();
+}
+
+
+/**
+ * @brief Removes least recently used entries until the cache fits its capacity.
+ *
+ * Must be called with the lock held.
+ */
+void ShapeCache::evictToCapacity()
+{
+    while (mBytes > mCapacityBytes && !mEntries.empty())
+    {
+        const Entry& victim = mEntries.back();
+        mBytes -= victim.bytes;
+        mIndex.erase(victim.key);
+        mEntries.pop_back();
+        ++mEvictions;
+    }
+}
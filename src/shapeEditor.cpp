@@ -0,0 +1,120 @@
+/**
+ * @file shapeEditor.cpp
+ * @brief Implementation of the ShapeEditor class.
+ */
+
+#include "shapeEditor.h"
+#include "trace.h"
+
+#include <chrono>
+
+
+/**
+ * @brief Starts editing an object.
+ *
+ * The pipeline is executed once here, so the first edit only re-executes the stages it modifies.
+ *
+ * @param scene The scene the object belongs to.
+ * @param id The object.
+ * @param shape The shape the object's mesh was generated from.
+ * @param policy How finely the edited shape is tessellated.
+ */
+void ShapeEditor::open(const Scene& scene, ObjectId id, std::unique_ptr<Shape> shape, const TessellationPolicy& policy)
+{
+    TRACE_SCOPE("ShapeEditor::open", "shapes");
+
+    close();
+
+    mPipeline = shape->createPipeline();
+    shape->configurePipeline(mPipeline, policy);
+    mPipeline.output->Update();
+
+    mObject = id;
+    mShape = std::move(shape);
+    mPolicy = policy;
+    mMesh = scene.mesh(id);
+}
+
+
+/**
+ * @brief Stops editing and releases the pipeline.
+ */
+void ShapeEditor::close()
+{
+    mObject = InvalidObjectId;
+    mShape.reset();
+    mPipeline = ShapePipeline();
+    mMesh = nullptr;
+    mPending = false;
+}
+
+
+/**
+ * @brief Returns the parameters of the edited shape with the values set so far.
+ *
+ * @return std::vector<ShapeParameter> The parameters, or none if closed.
+ */
+std::vector<ShapeParameter> ShapeEditor::parameters() const
+{
+    return mShape ? mShape->parameters() : std::vector<ShapeParameter>();
+}
+
+
+/**
+ * @brief Records a new value of a parameter.
+ *
+ * @param index Index of the parameter.
+ * @param value The new value.
+ */
+void ShapeEditor::setParameter(std::size_t index, double value)
+{
+    if (!mShape)
+        return;
+
+    const ShapeKey before = mShape->key(mPolicy);
+    mShape->setParameter(index, value);
+    if (mShape->key(mPolicy) != before)
+        mPending = true;
+}
+
+
+/**
+ * @brief Returns true if the edited object still exists and shows the editor's last mesh.
+ *
+ * @param scene The scene the object belongs to.
+ * @return bool False once the object was removed or got another mesh, or if closed.
+ */
+bool ShapeEditor::isCurrent(const Scene& scene) const
+{
+    return isOpen() && mMesh && scene.contains(mObject) && scene.mesh(mObject) == mMesh;
+}
+
+
+/**
+ * @brief Regenerates the edited object's mesh if a value changed.
+ *
+ * Nothing happens if the editing is no longer current.
+ *
+ * @param scene The scene the object belongs to.
+ * @return bool True if the object got a new mesh.
+ */
+bool ShapeEditor::update(Scene& scene)
+{
+    if (!mPending || !isCurrent(scene))
+        return false;
+
+    TRACE_SCOPE("ShapeEditor::update", "shapes");
+
+    const auto start = std::chrono::steady_clock::now();
+
+    mShape->configurePipeline(mPipeline, mPolicy);
+    vtkSmartPointer<vtkPolyData> mesh = mPipeline.update();
+    scene.setMesh(mObject, mesh);
+    mMesh = mesh;
+    mPending = false;
+
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    mStatistics.lastUpdateMs = elapsed.count();
+    ++mStatistics.updates;
+    return true;
+}
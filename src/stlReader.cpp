@@ -0,0 +1,573 @@
+/**
+ * @file stlReader.cpp
+ * @brief Implementation of the StlReader class.
+ */
+
+#include "stlReader.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkPoints.h>
+#include <vtkTypeInt32Array.h>
+
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+
+namespace
+{
+
+constexpr std::size_t BinaryHeaderSize = 84; // 80-byte header + uint32 facet count
+constexpr std::size_t BinaryFacetSize = 50;  // normal, 3 vertices (12 floats) + uint16 attribute
+constexpr std::size_t FacetsPerBlock = 1 << 16;
+
+/**
+ * @brief Preallocated output arrays: 3 float32 points and 3 int32 indices per facet.
+ */
+struct MeshArrays
+{
+    vtkSmartPointer<vtkFloatArray> coordinates = vtkSmartPointer<vtkFloatArray>::New();
+    vtkSmartPointer<vtkTypeInt32Array> offsets = vtkSmartPointer<vtkTypeInt32Array>::New();
+    vtkSmartPointer<vtkTypeInt32Array> connectivity = vtkSmartPointer<vtkTypeInt32Array>::New();
+
+    void allocate(std::size_t facets)
+    {
+        coordinates->SetNumberOfComponents(3);
+        coordinates->SetNumberOfTuples(static_cast<vtkIdType>(facets * 3));
+        offsets->SetNumberOfValues(static_cast<vtkIdType>(facets + 1));
+        connectivity->SetNumberOfValues(static_cast<vtkIdType>(facets * 3));
+    }
+
+    /// Writes the trivial connectivity of facets [begin, end): facet i uses points 3i, 3i+1, 3i+2.
+    void fillConnectivity(std::size_t begin, std::size_t end)
+    {
+        std::int32_t* offset = offsets->GetPointer(0);
+        std::int32_t* index = connectivity->GetPointer(0);
+        for (std::size_t facet = begin; facet < end; ++facet)
+        {
+            const std::int32_t first = static_cast<std::int32_t>(facet * 3);
+            offset[facet] = first;
+            index[3 * facet] = first;
+            index[3 * facet + 1] = first + 1;
+            index[3 * facet + 2] = first + 2;
+        }
+    }
+
+    vtkSmartPointer<vtkPolyData> toPolyData(std::size_t facets)
+    {
+        offsets->SetValue(static_cast<vtkIdType>(facets), static_cast<std::int32_t>(facets * 3));
+
+        vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+        points->SetData(coordinates);
+
+        vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+        polys->SetData(offsets, connectivity);
+
+        vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
+        mesh->SetPoints(points);
+        mesh->SetPolys(polys);
+        return mesh;
+    }
+};
+
+const char* skipBlanks(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        ++p;
+    return p;
+}
+
+bool startsWith(const char* p, const char* end, const char* word)
+{
+    const std::size_t length = std::strlen(word);
+    return static_cast<std::size_t>(end - p) >= length && std::memcmp(p, word, length) == 0;
+}
+
+/// Locale-independent float parsing; advances p past the number.
+bool parseFloat(const char*& p, const char* end, float& value)
+{
+    p = skipBlanks(p, end);
+    if (p < end && *p == '+')
+        ++p;
+
+    const std::from_chars_result parsed = std::from_chars(p, end, value);
+    if (parsed.ec != std::errc())
+        return false;
+
+    p = parsed.ptr;
+    return true;
+}
+
+/**
+ * @brief Calls fn(vertexKeywordEnd, lineEnd) for every "vertex" line in [begin, end).
+ */
+template <typename Function>
+void forEachVertexLine(const char* begin, const char* end, Function&& fn)
+{
+    const char* line = begin;
+    while (line < end)
+    {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (!lineEnd)
+            lineEnd = end;
+
+        const char* keyword = skipBlanks(line, lineEnd);
+        if (startsWith(keyword, lineEnd, "vertex"))
+            fn(keyword + 6, lineEnd);
+
+        line = lineEnd + 1;
+    }
+}
+
+/**
+ * @brief Detects the STL flavour of a mapped file.
+ *
+ * A file is binary if its size matches the facet count in its header. Otherwise it is
+ * ASCII if it starts with "solid"; anything else is treated as a truncated binary file.
+ *
+ * @param facets Receives the facet count for binary files.
+ * @return true for binary STL.
+ */
+bool detectBinary(const uchar* data, std::size_t size, std::size_t& facets)
+{
+    if (size >= BinaryHeaderSize)
+    {
+        std::uint32_t count = 0;
+        std::memcpy(&count, data + 80, sizeof(count));
+        if (BinaryHeaderSize + BinaryFacetSize * static_cast<std::size_t>(count) == size)
+        {
+            facets = count;
+            return true;
+        }
+    }
+
+    const char* text = reinterpret_cast<const char*>(data);
+    const char* end = text + size;
+    while (text < end && std::isspace(static_cast<unsigned char>(*text)))
+        ++text;
+    if (startsWith(text, end, "solid"))
+        return false;
+
+    facets = size >= BinaryHeaderSize ? (size - BinaryHeaderSize) / BinaryFacetSize : 0;
+    return true;
+}
+
+/**
+ * @brief Copies the vertices of every binary facet, in parallel blocks.
+ *
+ * STL is little-endian; the records are copied as-is, which assumes a little-endian host.
+ */
+bool readBinary(const uchar* data, std::size_t facets, MeshArrays& arrays, const StlReader::Options& options)
+{
+    ParallelProgress reporter(options.progress, options.cancel, facets);
+    float* xyz = arrays.coordinates->GetPointer(0);
+
+    parallelFor(facets, FacetsPerBlock, [&](std::size_t begin, std::size_t end) {
+        if (reporter.canceled())
+            return;
+
+        const uchar* record = data + BinaryHeaderSize + begin * BinaryFacetSize;
+        for (std::size_t facet = begin; facet < end; ++facet, record += BinaryFacetSize)
+        {
+            // Skip the 12-byte facet normal; copy the three vertices
+            std::memcpy(xyz + 9 * facet, record + 12, 9 * sizeof(float));
+        }
+        arrays.fillConnectivity(begin, end);
+
+        reporter.advance(end - begin);
+    }, options.threads);
+
+    return !reporter.canceled();
+}
+
+/**
+ * @brief Parses ASCII facets in two parallel passes over line-aligned chunks.
+ *
+ * The first pass counts "vertex" lines per chunk; a prefix sum gives each chunk its
+ * output offset; the second pass parses the coordinates straight into place.
+ */
+bool readAscii(const uchar* data, std::size_t size, MeshArrays& arrays, std::size_t& facets,
+               const StlReader::Options& options, QString& error)
+{
+    const char* text = reinterpret_cast<const char*>(data);
+    const char* textEnd = text + size;
+
+    // Chunk boundaries start right after a newline, so no line spans two chunks
+    const std::size_t chunkCount = std::max<std::size_t>(1, (options.threads > 0 ? options.threads : parallelThreadCount()) * 4);
+    std::vector<const char*> bounds(chunkCount + 1, textEnd);
+    bounds[0] = text;
+    for (std::size_t chunk = 1; chunk < chunkCount; ++chunk)
+    {
+        const char* nominal = std::max(text + size * chunk / chunkCount, bounds[chunk - 1]);
+        const char* newline = static_cast<const char*>(std::memchr(nominal, '\n', textEnd - nominal));
+        bounds[chunk] = newline ? newline + 1 : textEnd;
+    }
+
+    std::vector<std::size_t> vertexCounts(chunkCount, 0);
+    parallelFor(chunkCount, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t chunk = begin; chunk < end; ++chunk)
+            forEachVertexLine(bounds[chunk], bounds[chunk + 1], [&](const char*, const char*) { ++vertexCounts[chunk]; });
+    }, options.threads);
+
+    std::vector<std::size_t> firstVertex(chunkCount + 1, 0);
+    for (std::size_t chunk = 0; chunk < chunkCount; ++chunk)
+        firstVertex[chunk + 1] = firstVertex[chunk] + vertexCounts[chunk];
+
+    // Incomplete trailing facets are dropped
+    facets = firstVertex[chunkCount] / 3;
+    if (facets * 3 > static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max()))
+    {
+        error = "The file has too many facets for 32-bit indices.";
+        return false;
+    }
+
+    arrays.allocate(facets);
+    float* xyz = arrays.coordinates->GetPointer(0);
+    const std::size_t vertexCount = facets * 3;
+
+    ParallelProgress reporter(options.progress, options.cancel, chunkCount);
+    std::atomic<bool> malformed{ false };
+
+    parallelFor(chunkCount, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t chunk = begin; chunk < end && !reporter.canceled(); ++chunk)
+        {
+            std::size_t vertex = firstVertex[chunk];
+            forEachVertexLine(bounds[chunk], bounds[chunk + 1], [&](const char* p, const char* lineEnd) {
+                if (vertex >= vertexCount)
+                    return;
+
+                float* point = xyz + 3 * vertex++;
+                if (!parseFloat(p, lineEnd, point[0]) || !parseFloat(p, lineEnd, point[1]) || !parseFloat(p, lineEnd, point[2]))
+                    malformed = true;
+            });
+
+            reporter.advance(1);
+        }
+    }, options.threads);
+
+    if (malformed)
+    {
+        error = "The file contains malformed vertex coordinates.";
+        return false;
+    }
+
+    parallelFor(facets, FacetsPerBlock, [&](std::size_t begin, std::size_t end) {
+        arrays.fillConnectivity(begin, end);
+    }, options.threads);
+
+    return !reporter.canceled();
+}
+
+/**
+ * @brief Parses "outer loop" followed by three "vertex" lines, starting at the first
+ * line after p. Used to sample single ASCII facets at arbitrary file offsets.
+ *
+ * @param out Receives the nine vertex coordinates.
+ * @return false if no complete facet follows p.
+ */
+bool parseFacetAfter(const char* p, const char* end, float* out)
+{
+    const char* line = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    bool inLoop = false;
+    int vertex = 0;
+
+    while (line && ++line < end)
+    {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (!lineEnd)
+            lineEnd = end;
+
+        const char* keyword = skipBlanks(line, lineEnd);
+        if (!inLoop)
+        {
+            inLoop = startsWith(keyword, lineEnd, "outer");
+        }
+        else if (startsWith(keyword, lineEnd, "vertex"))
+        {
+            const char* q = keyword + 6;
+            float* point = out + 3 * vertex;
+            if (!parseFloat(q, lineEnd, point[0]) || !parseFloat(q, lineEnd, point[1]) || !parseFloat(q, lineEnd, point[2]))
+                return false;
+            if (++vertex == 3)
+                return true;
+        }
+        else
+        {
+            return false;
+        }
+
+        line = lineEnd;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Reads an evenly spread subset of facets, stopping when the time budget runs out.
+ *
+ * Sample k is taken by sample(k, xyz). The samples are split into interleaved rounds
+ * (round r holds samples r, r + Rounds, ...), so every finished round covers the whole
+ * model; rounds not started before the deadline are dropped. The first round always runs.
+ */
+template <typename Sampler>
+std::size_t readSample(std::size_t samples, double budgetSeconds, MeshArrays& arrays,
+                       const StlReader::Options& options, Sampler&& sample)
+{
+    constexpr std::size_t Rounds = 16;
+
+    std::vector<float> xyz(samples * 9);
+    std::vector<char> valid(samples, 0);
+    std::vector<char> roundDone(Rounds, 0);
+
+    QElapsedTimer timer;
+    timer.start();
+    const qint64 budget = static_cast<qint64>(budgetSeconds * 1.0e9);
+
+    parallelFor(Rounds, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t round = begin; round < end; ++round)
+        {
+            if (options.cancel && options.cancel->load())
+                return;
+            if (round > 0 && timer.nsecsElapsed() > budget)
+                return;
+
+            for (std::size_t k = round; k < samples; k += Rounds)
+                valid[k] = sample(k, xyz.data() + 9 * k);
+            roundDone[round] = 1;
+        }
+    }, options.threads);
+
+    std::size_t facets = 0;
+    for (std::size_t k = 0; k < samples; ++k)
+        facets += roundDone[k % Rounds] && valid[k];
+
+    arrays.allocate(facets);
+    float* out = arrays.coordinates->GetPointer(0);
+    for (std::size_t k = 0; k < samples; ++k)
+    {
+        if (roundDone[k % Rounds] && valid[k])
+        {
+            std::memcpy(out, xyz.data() + 9 * k, 9 * sizeof(float));
+            out += 9;
+        }
+    }
+    arrays.fillConnectivity(0, facets);
+
+    return facets;
+}
+
+/**
+ * @brief Holds an STL file mapped into memory for the lifetime of the object.
+ */
+class MappedFile
+{
+public:
+    /**
+     * @brief Opens and maps the file; on failure, data() is null and error() says why.
+     */
+    explicit MappedFile(const QString& path) : mFile(path)
+    {
+        if (!mFile.open(QIODevice::ReadOnly))
+        {
+            mError = mFile.errorString();
+            return;
+        }
+
+        mSize = static_cast<std::size_t>(mFile.size());
+        if (mSize == 0)
+        {
+            mError = "The file is empty.";
+            return;
+        }
+
+        mData = mFile.map(0, mFile.size());
+        if (!mData)
+            mError = mFile.errorString();
+    }
+
+    ~MappedFile()
+    {
+        if (mData)
+            mFile.unmap(const_cast<uchar*>(mData));
+    }
+
+    const uchar* data() const { return mData; }
+    std::size_t size() const { return mSize; }
+    const QString& error() const { return mError; }
+
+private:
+    QFile mFile;
+    const uchar* mData = nullptr;
+    std::size_t mSize = 0;
+    QString mError;
+};
+
+/**
+ * @brief Parses every facet of a mapped file into result.mesh, or sets result.error.
+ */
+void readAll(const MappedFile& file, StlReader::Result& result, const StlReader::Options& options)
+{
+    MeshArrays arrays;
+    std::size_t facets = 0;
+    bool ok = false;
+
+    result.binary = detectBinary(file.data(), file.size(), facets);
+    if (result.binary)
+    {
+        if (facets * 3 > static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max()))
+        {
+            result.error = "The file has too many facets for 32-bit indices.";
+        }
+        else
+        {
+            arrays.allocate(facets);
+            ok = readBinary(file.data(), facets, arrays, options);
+        }
+    }
+    else
+    {
+        ok = readAscii(file.data(), file.size(), arrays, facets, options, result.error);
+    }
+
+    if (!ok)
+    {
+        if (result.error.isEmpty())
+            result.error = "Loading was canceled.";
+        return;
+    }
+
+    if (facets == 0)
+    {
+        result.error = "The file contains no facets.";
+        return;
+    }
+
+    result.facets = facets;
+    result.mesh = arrays.toPolyData(facets);
+}
+
+} // namespace
+
+
+/**
+ * @brief Maps and parses an STL file.
+ *
+ * @param path Path of the file.
+ * @param options Threading, progress and cancellation settings.
+ * @return Result The mesh and statistics, or an error message.
+ */
+StlReader::Result StlReader::read(const QString& path, const Options& options)
+{
+    TRACE_SCOPE("StlReader::read", "io");
+
+    Result result;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const MappedFile file(path);
+    if (!file.data())
+    {
+        result.error = file.error();
+        return result;
+    }
+
+    result.bytes = file.size();
+    readAll(file, result, options);
+    result.seconds = timer.nsecsElapsed() / 1.0e9;
+    return result;
+}
+
+
+/**
+ * @brief Maps an STL file and reads an evenly spread sample of its facets.
+ *
+ * Binary facets are picked at a fixed stride; ASCII facets are picked by parsing the
+ * first facet after evenly spaced file offsets. Files with no more facets than the
+ * sample size (estimated for ASCII) are read completely instead.
+ *
+ * @param path Path of the file.
+ * @param maxFacets Maximum number of facets in the preview.
+ * @param budgetSeconds Time after which sampling stops with what it has.
+ * @param options Threading and cancellation settings; progress is not reported.
+ * @return Result The preview mesh, with sampled set if it is a subset of the file.
+ */
+StlReader::Result StlReader::readPreview(const QString& path, std::size_t maxFacets, double budgetSeconds, const Options& options)
+{
+    TRACE_SCOPE("StlReader::readPreview", "io");
+
+    // A rough lower bound of the size of an ASCII facet, used to estimate the facet count
+    constexpr std::size_t AsciiFacetBytes = 200;
+
+    Result result;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const MappedFile file(path);
+    if (!file.data())
+    {
+        result.error = file.error();
+        return result;
+    }
+
+    result.bytes = file.size();
+
+    std::size_t facets = 0;
+    result.binary = detectBinary(file.data(), file.size(), facets);
+    if (!result.binary)
+        facets = file.size() / AsciiFacetBytes;
+
+    if (facets <= maxFacets || maxFacets == 0)
+    {
+        readAll(file, result, options);
+        result.seconds = timer.nsecsElapsed() / 1.0e9;
+        return result;
+    }
+
+    MeshArrays arrays;
+    if (result.binary)
+    {
+        const uchar* records = file.data() + BinaryHeaderSize;
+        result.facets = readSample(maxFacets, budgetSeconds, arrays, options, [&](std::size_t k, float* xyz) {
+            const std::size_t facet = k * facets / maxFacets;
+            std::memcpy(xyz, records + facet * BinaryFacetSize + 12, 9 * sizeof(float));
+            return true;
+        });
+    }
+    else
+    {
+        const char* text = reinterpret_cast<const char*>(file.data());
+        const std::size_t size = file.size();
+        result.facets = readSample(maxFacets, budgetSeconds, arrays, options, [&](std::size_t k, float* xyz) {
+            return parseFacetAfter(text + size * k / maxFacets, text + size, xyz);
+        });
+    }
+
+    if (options.cancel && options.cancel->load())
+    {
+        result.facets = 0;
+        result.error = "Loading was canceled.";
+        return result;
+    }
+
+    if (result.facets == 0)
+    {
+        result.error = "The file contains no facets.";
+        return result;
+    }
+
+    result.sampled = true;
+    result.mesh = arrays.toPolyData(result.facets);
+    result.seconds = timer.nsecsElapsed() / 1.0e9;
+    return result;
+}
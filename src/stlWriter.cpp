@@ -0,0 +1,325 @@
+/**
+ * @file stlWriter.cpp
+ * @brief Implementation of the StlWriter class.
+ */
+
+#include "stlWriter.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdList.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+
+namespace
+{
+
+constexpr std::size_t HeaderSize = 84;            // 80-byte header + uint32 facet count
+constexpr std::size_t FacetSize = 50;             // normal, 3 vertices (12 floats) + uint16 attribute
+constexpr std::size_t CellsPerBlock = 1 << 15;
+constexpr std::size_t BufferBytes = 64 << 20;     // Size of the write buffers when the file cannot be mapped
+
+/**
+ * @brief Reads point coordinates as float32, straight from the array if it is float already.
+ */
+class PointSource
+{
+public:
+    explicit PointSource(vtkPoints* points) : mPoints(points)
+    {
+        if (vtkFloatArray* array = vtkFloatArray::SafeDownCast(points->GetData()))
+            mFloats = array->GetPointer(0);
+    }
+
+    void get(vtkIdType id, float* xyz) const
+    {
+        if (mFloats)
+        {
+            std::memcpy(xyz, mFloats + 3 * id, 3 * sizeof(float));
+            return;
+        }
+
+        double point[3];
+        mPoints->GetPoint(id, point);
+        xyz[0] = static_cast<float>(point[0]);
+        xyz[1] = static_cast<float>(point[1]);
+        xyz[2] = static_cast<float>(point[2]);
+    }
+
+private:
+    vtkPoints* mPoints;
+    const float* mFloats = nullptr;
+};
+
+/**
+ * @brief The polygons followed by the triangle strips of a mesh, as one range of cells.
+ */
+class CellSource
+{
+public:
+    explicit CellSource(vtkPolyData* mesh)
+        : mPolys(mesh->GetPolys()),
+        mStrips(mesh->GetStrips()),
+        mPolyCount(mPolys ? mPolys->GetNumberOfCells() : 0),
+        mStripCount(mStrips ? mStrips->GetNumberOfCells() : 0)
+    {
+    }
+
+    std::size_t size() const { return static_cast<std::size_t>(mPolyCount + mStripCount); }
+
+    /// Returns the number of triangles cell i contributes.
+    std::size_t facets(std::size_t i) const
+    {
+        const vtkIdType id = static_cast<vtkIdType>(i);
+        const vtkIdType points = id < mPolyCount ? mPolys->GetCellSize(id) : mStrips->GetCellSize(id - mPolyCount);
+        return points >= 3 ? static_cast<std::size_t>(points - 2) : 0;
+    }
+
+    /**
+     * @brief Serializes the triangles of cells [begin, end) as consecutive binary facets.
+     *
+     * Polygons are fan-triangulated; every other triangle of a strip is flipped so that
+     * all of them keep the strip's orientation.
+     *
+     * @param attribute Attribute word of every facet.
+     * @return uchar* The position after the last facet written.
+     */
+    uchar* serialize(std::size_t begin, std::size_t end, const PointSource& points, std::uint16_t attribute, uchar* out) const
+    {
+        vtkNew<vtkIdList> ids;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const vtkIdType id = static_cast<vtkIdType>(i);
+            const bool strip = id >= mPolyCount;
+            if (strip)
+                mStrips->GetCellAtId(id - mPolyCount, ids);
+            else
+                mPolys->GetCellAtId(id, ids);
+
+            const vtkIdType count = ids->GetNumberOfIds();
+            const vtkIdType* pts = ids->GetPointer(0);
+            for (vtkIdType t = 0; t + 2 < count; ++t)
+            {
+                vtkIdType a = strip ? pts[t] : pts[0];
+                vtkIdType b = pts[t + 1];
+                const vtkIdType c = pts[t + 2];
+                if (strip && (t % 2 == 1))
+                    std::swap(a, b);
+
+                out = writeFacet(points, a, b, c, attribute, out);
+            }
+        }
+        return out;
+    }
+
+private:
+    static uchar* writeFacet(const PointSource& points, vtkIdType a, vtkIdType b, vtkIdType c, std::uint16_t attribute, uchar* out)
+    {
+        // Record layout: normal, vertices a, b, c, attribute byte count
+        float record[12];
+        float* normal = record;
+        points.get(a, record + 3);
+        points.get(b, record + 6);
+        points.get(c, record + 9);
+
+        const float u[3] = { record[6] - record[3], record[7] - record[4], record[8] - record[5] };
+        const float v[3] = { record[9] - record[3], record[10] - record[4], record[11] - record[5] };
+        normal[0] = u[1] * v[2] - u[2] * v[1];
+        normal[1] = u[2] * v[0] - u[0] * v[2];
+        normal[2] = u[0] * v[1] - u[1] * v[0];
+
+        const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+        normal[0] *= scale;
+        normal[1] *= scale;
+        normal[2] *= scale;
+
+        std::memcpy(out, record, sizeof(record));
+        out[sizeof(record)] = static_cast<uchar>(attribute & 0xff);
+        out[sizeof(record) + 1] = static_cast<uchar>(attribute >> 8);
+        return out + FacetSize;
+    }
+
+    vtkCellArray* mPolys;
+    vtkCellArray* mStrips;
+    vtkIdType mPolyCount;
+    vtkIdType mStripCount;
+};
+
+/**
+ * @brief Writes the 84-byte header: a text that does not start with "solid", and the facet count.
+ */
+void writeHeader(uchar* out, std::size_t facets)
+{
+    std::memset(out, 0, HeaderSize);
+    const char text[] = "binary STL written by QtVTKProject";
+    std::memcpy(out, text, sizeof(text) - 1);
+
+    const std::uint32_t count = static_cast<std::uint32_t>(facets);
+    std::memcpy(out + 80, &count, sizeof(count));
+}
+
+} // namespace
+
+
+/**
+ * @brief Writes the triangles of a mesh as binary STL.
+ *
+ * Triangles are counted per block of cells first; the prefix sum of the counts gives
+ * every block its byte offset in the file, so blocks are then serialized independently.
+ *
+ * @param path Path of the file; an existing file is replaced.
+ * @param mesh The mesh to write.
+ * @param options Threading, progress and cancellation settings.
+ * @return Result Statistics of the write, or an error message.
+ */
+StlWriter::Result StlWriter::write(const QString& path, vtkPolyData* mesh, const Options& options)
+{
+    TRACE_SCOPE("StlWriter::write", "io");
+
+    Result result;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!mesh || !mesh->GetPoints())
+    {
+        result.error = "There is no mesh to write.";
+        return result;
+    }
+
+    const PointSource points(mesh->GetPoints());
+    const CellSource cells(mesh);
+
+    // Count the triangles of every block, then turn the counts into facet offsets
+    const std::size_t blocks = (cells.size() + CellsPerBlock - 1) / CellsPerBlock;
+    std::vector<std::size_t> firstFacet(blocks + 1, 0);
+    parallelFor(blocks, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t block = begin; block < end; ++block)
+        {
+            const std::size_t last = std::min(cells.size(), (block + 1) * CellsPerBlock);
+            for (std::size_t cell = block * CellsPerBlock; cell < last; ++cell)
+                firstFacet[block + 1] += cells.facets(cell);
+        }
+    }, options.threads);
+
+    for (std::size_t block = 0; block < blocks; ++block)
+        firstFacet[block + 1] += firstFacet[block];
+
+    const std::size_t facets = firstFacet[blocks];
+    if (facets == 0)
+    {
+        result.error = "The mesh has no triangles to write.";
+        return result;
+    }
+    if (facets > std::numeric_limits<std::uint32_t>::max())
+    {
+        result.error = "The mesh has too many triangles for a binary STL file.";
+        return result;
+    }
+
+    const std::size_t bytes = HeaderSize + FacetSize * facets;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate))
+    {
+        result.error = file.errorString();
+        return result;
+    }
+
+    ParallelProgress reporter(options.progress, options.cancel, facets);
+    auto serializeBlocks = [&](std::size_t firstBlock, std::size_t lastBlock, uchar* out) {
+        parallelFor(lastBlock - firstBlock, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end && !reporter.canceled(); ++i)
+            {
+                const std::size_t block = firstBlock + i;
+                uchar* blockOut = out + FacetSize * (firstFacet[block] - firstFacet[firstBlock]);
+                cells.serialize(block * CellsPerBlock, std::min(cells.size(), (block + 1) * CellsPerBlock), points, options.attribute, blockOut);
+                reporter.advance(firstFacet[block + 1] - firstFacet[block]);
+            }
+        }, options.threads);
+    };
+
+    uchar* mapped = file.resize(static_cast<qint64>(bytes)) ? file.map(0, static_cast<qint64>(bytes)) : nullptr;
+    if (mapped)
+    {
+        // Serialize straight into the page cache
+        writeHeader(mapped, facets);
+        serializeBlocks(0, blocks, mapped + HeaderSize);
+        file.unmap(mapped);
+    }
+    else
+    {
+        // Serialize groups of blocks into a large buffer and write each group with one call
+        file.resize(0);
+
+        std::vector<uchar> buffer(HeaderSize);
+        writeHeader(buffer.data(), facets);
+        file.write(reinterpret_cast<const char*>(buffer.data()), HeaderSize);
+
+        std::size_t firstBlock = 0;
+        while (firstBlock < blocks && !reporter.canceled() && file.error() == QFileDevice::NoError)
+        {
+            std::size_t lastBlock = firstBlock + 1;
+            while (lastBlock < blocks && FacetSize * (firstFacet[lastBlock + 1] - firstFacet[firstBlock]) <= BufferBytes)
+                ++lastBlock;
+
+            const std::size_t groupBytes = FacetSize * (firstFacet[lastBlock] - firstFacet[firstBlock]);
+            buffer.resize(groupBytes);
+            serializeBlocks(firstBlock, lastBlock, buffer.data());
+            file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<qint64>(groupBytes));
+
+            firstBlock = lastBlock;
+        }
+    }
+
+    if (reporter.canceled())
+        result.error = "Saving was canceled.";
+    else if (file.error() != QFileDevice::NoError)
+        result.error = file.errorString();
+
+    if (!result.ok())
+    {
+        file.remove();
+        return result;
+    }
+
+    file.close();
+
+    result.facets = facets;
+    result.bytes = bytes;
+    result.seconds = timer.nsecsElapsed() / 1.0e9;
+    return result;
+}
+
+
+/**
+ * @brief Encodes a color as a facet attribute word: 5 bits per channel, blue lowest, top bit set.
+ *
+ * @param rgb The color, each channel in [0, 1].
+ * @return std::uint16_t The attribute word.
+ */
+std::uint16_t StlWriter::colorAttribute(const double rgb[3])
+{
+    std::uint16_t word = 0x8000;
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        const double value = std::min(1.0, std::max(0.0, rgb[channel]));
+        word |= static_cast<std::uint16_t>(std::lround(value * 31.0) << (5 * (2 - channel)));
+    }
+    return word;
+}
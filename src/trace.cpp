@@ -0,0 +1,279 @@
+/**
+ * @file trace.cpp
+ * @brief Implementation of the Trace class.
+ */
+
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QFile>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace
+{
+
+const std::chrono::steady_clock::time_point Epoch = std::chrono::steady_clock::now();
+
+/**
+ * @brief One event of a ring buffer.
+ *
+ * The writer sets sequence to an odd value while it fills the slot and to
+ * 2 * (index + 1) once the slot holds event number index. Fields are atomics so the
+ * exporter may read them concurrently; a read is valid if the sequence was the
+ * expected one before and after it.
+ */
+struct Slot
+{
+    std::atomic<std::uint64_t> sequence{ 0 };
+    std::atomic<const char*> name{ nullptr };
+    std::atomic<const char*> category{ nullptr };
+    std::atomic<std::int64_t> start{ 0 };
+    std::atomic<std::int64_t> duration{ 0 };
+};
+
+/**
+ * @brief Ring buffer written by one thread at a time.
+ */
+struct ThreadBuffer
+{
+    explicit ThreadBuffer(int id) : tid(id), slots(Trace::EventsPerThread) {}
+
+    const int tid;
+    std::vector<Slot> slots;
+    std::atomic<std::uint64_t> written{ 0 };    ///< Events recorded so far; the last EventsPerThread are kept.
+    std::atomic<const char*> threadName{ nullptr };
+};
+
+/**
+ * @brief Every buffer ever created, and those whose thread has exited.
+ *
+ * Never destroyed, so threads exiting after main() can still return their buffer.
+ */
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::vector<ThreadBuffer*> available;
+    std::atomic<std::int64_t> clearedAt{ -1 }; ///< Events starting before this are dropped.
+};
+
+Registry& registry()
+{
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+/**
+ * @brief The calling thread's buffer, returned to the registry when the thread exits.
+ */
+class BufferLease
+{
+public:
+    ~BufferLease()
+    {
+        if (!mBuffer)
+            return;
+
+        mBuffer->threadName.store(nullptr, std::memory_order_relaxed);
+
+        Registry& shared = registry();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        shared.available.push_back(mBuffer);
+    }
+
+    ThreadBuffer* get()
+    {
+        if (mBuffer)
+            return mBuffer;
+
+        Registry& shared = registry();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        if (!shared.available.empty())
+        {
+            mBuffer = shared.available.back();
+            shared.available.pop_back();
+        }
+        else
+        {
+            shared.buffers.push_back(std::make_unique<ThreadBuffer>(static_cast<int>(shared.buffers.size()) + 1));
+            mBuffer = shared.buffers.back().get();
+        }
+        return mBuffer;
+    }
+
+private:
+    ThreadBuffer* mBuffer = nullptr;
+};
+
+thread_local BufferLease lease;
+
+/**
+ * @brief Appends s to out as a JSON string literal.
+ */
+void appendJsonString(QByteArray& out, const char* s)
+{
+    out += '"';
+    for (; *s; ++s)
+    {
+        const char c = *s;
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            out += ' ';
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+} // namespace
+
+
+/**
+ * @brief Returns nanoseconds elapsed since the trace clock started.
+ */
+std::int64_t Trace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Epoch).count();
+}
+
+
+/**
+ * @brief Appends a span to the calling thread's ring buffer.
+ *
+ * Takes no lock, except once per thread to obtain its buffer.
+ */
+void Trace::record(const char* name, const char* category, std::int64_t start, std::int64_t end)
+{
+    ThreadBuffer* buffer = lease.get();
+
+    const std::uint64_t index = buffer->written.load(std::memory_order_relaxed);
+    Slot& slot = buffer->slots[index % EventsPerThread];
+
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.category.store(category, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.duration.store(end - start, std::memory_order_relaxed);
+
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+    buffer->written.store(index + 1, std::memory_order_release);
+}
+
+
+/**
+ * @brief Names the calling thread in the exported trace.
+ *
+ * @param name A string literal, e.g. "GUI".
+ */
+void Trace::setThreadName(const char* name)
+{
+    lease.get()->threadName.store(name, std::memory_order_relaxed);
+}
+
+
+/**
+ * @brief Drops every event recorded so far.
+ *
+ * Buffers are not touched, since other threads may be writing them; events older
+ * than now are skipped by the export instead.
+ */
+void Trace::clear()
+{
+    registry().clearedAt.store(now(), std::memory_order_relaxed);
+}
+
+
+/**
+ * @brief Writes the recorded events as Chrome trace event JSON.
+ *
+ * Spans are written as complete ("X") events with microsecond timestamps, one row per
+ * thread, preceded by metadata events carrying the thread names.
+ *
+ * @param path Path of the file; an existing file is replaced.
+ * @return QString The reason for the failure, empty on success.
+ */
+QString Trace::exportChromeJson(const QString& path)
+{
+    Registry& shared = registry();
+    const std::int64_t clearedAt = shared.clearedAt.load(std::memory_order_relaxed);
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+
+    QByteArray json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto beginEvent = [&]() {
+        if (!first)
+            json += ",\n";
+        first = false;
+    };
+
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    for (const std::unique_ptr<ThreadBuffer>& buffer : shared.buffers)
+    {
+        const QByteArray tid = QByteArray::number(buffer->tid);
+
+        if (const char* threadName = buffer->threadName.load(std::memory_order_relaxed))
+        {
+            beginEvent();
+            json += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" + pid + ",\"tid\":" + tid + ",\"args\":{\"name\":";
+            appendJsonString(json, threadName);
+            json += "}}";
+        }
+
+        const std::uint64_t written = buffer->written.load(std::memory_order_acquire);
+        const std::uint64_t oldest = written > EventsPerThread ? written - EventsPerThread : 0;
+        for (std::uint64_t index = oldest; index < written; ++index)
+        {
+            const Slot& slot = buffer->slots[index % EventsPerThread];
+
+            const std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence != 2 * index + 2)
+                continue;
+
+            const char* name = slot.name.load(std::memory_order_relaxed);
+            const char* category = slot.category.load(std::memory_order_relaxed);
+            const std::int64_t start = slot.start.load(std::memory_order_relaxed);
+            const std::int64_t duration = slot.duration.load(std::memory_order_relaxed);
+
+            // Overwritten while being read
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+                continue;
+
+            if (start < clearedAt)
+                continue;
+
+            beginEvent();
+            json += "{\"ph\":\"X\",\"name\":";
+            appendJsonString(json, name);
+            json += ",\"cat\":";
+            appendJsonString(json, category);
+            json += ",\"pid\":" + pid + ",\"tid\":" + tid;
+            json += ",\"ts\":" + QByteArray::number(start / 1000.0, 'f', 3);
+            json += ",\"dur\":" + QByteArray::number(duration / 1000.0, 'f', 3) + "}";
+        }
+    }
+    json += "\n]}\n";
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return file.errorString();
+    if (file.write(json) != json.size())
+        return file.errorString();
+    return QString();
+}
@@ -7,6 +7,12 @@
 #include "./ui_widget.h"
 
 #include "boxWidgetCallback.h"
+#include "meshMerger.h"
+#include "meshRepair.h"
+#include "meshStorage.h"
+#include "screenSpace.h"
+#include "stlReader.h"
+#include "trace.h"
 
 #include <vtkActor.h>
 #include <vtkPolyDataMapper.h>
@@ -15,12 +21,25 @@
 #include <vtkProperty.h>
 #include <vtkTransform.h>
 #include <vtkTransformPolyDataFilter.h>
-#include <vtkPolyDataNormals.h>
 #include <vtkBoxRepresentation.h>
-#include <vtkSTLReader.h>
-#include <vtkSTLWriter.h>
 
+#include <QCursor>
+#include <QDebug>
+#include <QDoubleSpinBox>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QInputDialog>
+#include <QMessageBox>
+#include <QRegularExpression>
+#include <QShortcut>
+#include <QSignalBlocker>
+#include <QToolTip>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 
 
  /**
@@ -37,7 +56,8 @@ Widget::Widget(QWidget *parent)
     mInteractor(vtkSmartPointer<QVTKInteractor>::New()),
     mInteractorStyle(vtkSmartPointer<vtkInteractorStyle>::New()),
     mBoxWidget2(vtkSmartPointer<vtkBoxWidget2>::New()),
-    callback(vtkSmartPointer<BoxWidgetCallback>::New())
+    callback(vtkSmartPointer<BoxWidgetCallback>::New()),
+    mScene(mRenderer)
 {
     ui->setupUi(this);
 
@@ -52,6 +72,113 @@ Widget::Widget(QWidget *parent)
     connect(mLoadSTLAction, &QAction::triggered, this, &Widget::onLoadSTL);
     mToolButtonMenu->addAction(mLoadSTLAction);
 
+    mSaveProjectAction = new QAction("Save project...", this);
+    connect(mSaveProjectAction, &QAction::triggered, this, &Widget::onSaveProject);
+    mToolButtonMenu->addAction(mSaveProjectAction);
+
+    mOpenProjectAction = new QAction("Open project...", this);
+    connect(mOpenProjectAction, &QAction::triggered, this, &Widget::onOpenProject);
+    mToolButtonMenu->addAction(mOpenProjectAction);
+
+    mRepairAction = new QAction("Repair mesh", this);
+    connect(mRepairAction, &QAction::triggered, this, &Widget::onRepairMesh);
+    mToolButtonMenu->addAction(mRepairAction);
+
+    mRepairOnLoadAction = new QAction("Repair meshes on load", this);
+    mRepairOnLoadAction->setCheckable(true);
+    connect(mRepairOnLoadAction, &QAction::toggled, this, &Widget::onToggleRepairOnLoad);
+    mToolButtonMenu->addAction(mRepairOnLoadAction);
+
+    mCacheOnLoadAction = new QAction("Cache loaded meshes", this);
+    mCacheOnLoadAction->setCheckable(true);
+    mCacheOnLoadAction->setChecked(true);
+    connect(mCacheOnLoadAction, &QAction::toggled, this, &Widget::onToggleCacheOnLoad);
+    mToolButtonMenu->addAction(mCacheOnLoadAction);
+
+    mToolButtonMenu->addSeparator();
+
+    mInstancingAction = new QAction("Instanced rendering", this);
+    mInstancingAction->setCheckable(true);
+    mToolButtonMenu->addAction(mInstancingAction);
+
+    mArrayAction = new QAction("Array (NxMxK)...", this);
+    connect(mArrayAction, &QAction::triggered, this, &Widget::onCreateArray);
+    mToolButtonMenu->addAction(mArrayAction);
+
+    mShapeParametersAction = new QAction("Shape parameters...", this);
+    connect(mShapeParametersAction, &QAction::triggered, this, &Widget::onEditShapeParameters);
+    mToolButtonMenu->addAction(mShapeParametersAction);
+
+    // When box widget edits are baked into the geometry
+    QMenu* bakeMenu = mToolButtonMenu->addMenu("Box widget transform");
+    mBakeModeGroup = new QActionGroup(this);
+    const std::pair<const char*, BoxWidgetCallback::BakeMode> bakeModes[] = {
+        { "Bake on release", BoxWidgetCallback::BakeMode::OnRelease },
+        { "Bake on export", BoxWidgetCallback::BakeMode::OnExport },
+        { "Never bake (non-destructive)", BoxWidgetCallback::BakeMode::Never },
+    };
+    for (const auto& bakeMode : bakeModes)
+    {
+        QAction* action = bakeMenu->addAction(bakeMode.first);
+        action->setCheckable(true);
+        action->setChecked(bakeMode.second == callback->Mode);
+        action->setData(static_cast<int>(bakeMode.second));
+        mBakeModeGroup->addAction(action);
+    }
+    connect(mBakeModeGroup, &QActionGroup::triggered, this, &Widget::onBakeModeChanged);
+
+    mFrameRateAction = new QAction("Frame rate cap...", this);
+    connect(mFrameRateAction, &QAction::triggered, this, &Widget::onSetFrameRateCap);
+    mToolButtonMenu->addAction(mFrameRateAction);
+
+    mLodAction = new QAction("Level of detail", this);
+    mLodAction->setCheckable(true);
+    mLodAction->setChecked(mLod.isEnabled());
+    connect(mLodAction, &QAction::toggled, this, &Widget::onToggleLevelOfDetail);
+    mToolButtonMenu->addAction(mLodAction);
+
+    mLodMemoryAction = new QAction("Level of detail memory...", this);
+    connect(mLodMemoryAction, &QAction::triggered, this, &Widget::onSetLevelOfDetailMemory);
+    mToolButtonMenu->addAction(mLodMemoryAction);
+
+    mTessellationAction = new QAction("Adaptive tessellation", this);
+    mTessellationAction->setCheckable(true);
+    mTessellationAction->setChecked(mTessellation.isEnabled());
+    connect(mTessellationAction, &QAction::toggled, this, &Widget::onToggleAdaptiveTessellation);
+    mToolButtonMenu->addAction(mTessellationAction);
+
+    mTessellationErrorAction = new QAction("Tessellation pixel error...", this);
+    connect(mTessellationErrorAction, &QAction::triggered, this, &Widget::onSetTessellationPixelError);
+    mToolButtonMenu->addAction(mTessellationErrorAction);
+
+    mInterferenceAction = new QAction("Interference check", this);
+    mInterferenceAction->setCheckable(true);
+    mInterferenceAction->setChecked(mInterferenceEnabled);
+    connect(mInterferenceAction, &QAction::toggled, this, &Widget::onToggleInterferenceCheck);
+    mToolButtonMenu->addAction(mInterferenceAction);
+
+    mHistoryMemoryAction = new QAction("Undo history memory...", this);
+    connect(mHistoryMemoryAction, &QAction::triggered, this, &Widget::onSetHistoryMemory);
+    mToolButtonMenu->addAction(mHistoryMemoryAction);
+
+    mCompactStorageAction = new QAction("Compact mesh storage", this);
+    mCompactStorageAction->setCheckable(true);
+    mCompactStorageAction->setChecked(MeshStorage::mode() == MeshStorage::Mode::Compact);
+    connect(mCompactStorageAction, &QAction::toggled, this, &Widget::onToggleCompactStorage);
+    mToolButtonMenu->addAction(mCompactStorageAction);
+
+    mToolButtonMenu->addSeparator();
+
+    mTraceAction = new QAction("Record trace", this);
+    mTraceAction->setCheckable(true);
+    mTraceAction->setChecked(Trace::isEnabled());
+    connect(mTraceAction, &QAction::toggled, this, &Widget::onToggleTracing);
+    mToolButtonMenu->addAction(mTraceAction);
+
+    mTraceExportAction = new QAction("Export trace...", this);
+    connect(mTraceExportAction, &QAction::triggered, this, &Widget::onExportTrace);
+    mToolButtonMenu->addAction(mTraceExportAction);
+
     ui->toolButton->setMenu(mToolButtonMenu);
 
 
@@ -61,20 +188,112 @@ Widget::Widget(QWidget *parent)
 
     ui->viewWidget->setRenderWindow(mRenderWindow);
 
+    // Slider drags request renders; the scheduler coalesces them to one per frame
+    mRenderScheduler = new RenderScheduler(mRenderWindow, this);
+    mRenderScheduler->setBeforeRender([this]() { mScene.syncToVtk(); });
+
+    // STL files load on a worker thread; a sampled preview is shown until the full mesh is ready
+    mMeshLoader = new MeshLoader(this);
+    connect(mMeshLoader, &MeshLoader::previewReady, this, &Widget::onLoadPreview);
+    connect(mMeshLoader, &MeshLoader::progressChanged, this, &Widget::onLoadProgress);
+    connect(mMeshLoader, &MeshLoader::repaired, this, &Widget::onLoadRepaired);
+    connect(mMeshLoader, &MeshLoader::loaded, this, &Widget::onLoadFinished);
+    connect(mMeshLoader, &MeshLoader::failed, this, &Widget::onLoadFailed);
+    connect(mMeshLoader, &MeshLoader::canceled, this, &Widget::onLoadCanceled);
+
+    mLoadProgress = new QProgressDialog(this);
+    mLoadProgress->setWindowTitle("Load (STL)");
+    mLoadProgress->setRange(0, 100);
+    mLoadProgress->setMinimumDuration(500);
+    mLoadProgress->setAutoReset(false);
+    mLoadProgress->reset();
+    connect(mLoadProgress, &QProgressDialog::canceled, mMeshLoader, &MeshLoader::cancel);
+
+    // STL files are written on a worker thread; saves requested meanwhile are queued
+    mMeshSaver = new MeshSaver(this);
+    connect(mMeshSaver, &MeshSaver::progressChanged, this, &Widget::onSaveProgress);
+    connect(mMeshSaver, &MeshSaver::saved, this, &Widget::onSaveFinished);
+    connect(mMeshSaver, &MeshSaver::failed, this, &Widget::onSaveFailed);
+
+    mSaveProgress = new QProgressDialog(this);
+    mSaveProgress->setWindowTitle("Save (STL)");
+    mSaveProgress->setRange(0, 100);
+    mSaveProgress->setMinimumDuration(500);
+    mSaveProgress->setAutoReset(false);
+    mSaveProgress->reset();
+    connect(mSaveProgress, &QProgressDialog::canceled, mMeshSaver, &MeshSaver::cancel);
+
+    // Meshes of an opened project stream in on a worker thread while their bounds boxes stand in
+    mProjectLoader = new ProjectLoader(this);
+    connect(mProjectLoader, &ProjectLoader::meshLoaded, this, &Widget::onProjectMeshLoaded);
+    connect(mProjectLoader, &ProjectLoader::meshFailed, this, &Widget::onProjectMeshFailed);
+    connect(mProjectLoader, &ProjectLoader::finished, this, &Widget::onProjectLoaded);
+
+    // Levels of detail are picked before every render, including the interactor's own
+    mRenderStartObserver = mRenderer->AddObserver(vtkCommand::StartEvent, this, &Widget::onRenderStart);
+    mWindowStartObserver = mRenderWindow->AddObserver(vtkCommand::StartEvent, this, &Widget::onWindowRenderStart);
+    mWindowEndObserver = mRenderWindow->AddObserver(vtkCommand::EndEvent, this, &Widget::onWindowRenderEnd);
+    Trace::setThreadName("GUI");
+    mLod.setOnChainReady([this]() {
+        QMetaObject::invokeMethod(this, [this]() { render(); }, Qt::QueuedConnection);
+    });
+
+    mInteractorStyle->AddObserver(vtkCommand::StartInteractionEvent, this, &Widget::onInteractionStart);
+    mInteractorStyle->AddObserver(vtkCommand::EndInteractionEvent, this, &Widget::onInteractionEnd);
+
     mInteractor->SetInteractorStyle(mInteractorStyle);
     mInteractor->Initialize();
 
+    // Clicks select the object under the cursor; the box widget sees them first and keeps its own
+    mLeftPressObserver = mInteractor->AddObserver(vtkCommand::LeftButtonPressEvent, this, &Widget::onLeftButtonPress);
+    mLeftReleaseObserver = mInteractor->AddObserver(vtkCommand::LeftButtonReleaseEvent, this, &Widget::onLeftButtonRelease);
+
     vtkNew<vtkBoxRepresentation> boxRepresentation;
     boxRepresentation->HandlesOn();
     mBoxWidget2->SetRepresentation(boxRepresentation);
     mBoxWidget2->SetInteractor(mInteractor);
 
+    callback->TargetScene = &mScene;
+    callback->TargetHistory = &mHistory;
+    mBoxWidget2->AddObserver(vtkCommand::StartInteractionEvent, callback);
+    mBoxWidget2->AddObserver(vtkCommand::InteractionEvent, callback);
+    mBoxWidget2->AddObserver(vtkCommand::EndInteractionEvent, callback);
+    mBoxWidget2->AddObserver(vtkCommand::StartInteractionEvent, this, &Widget::onInteractionStart);
+    mBoxWidget2->AddObserver(vtkCommand::EndInteractionEvent, this, &Widget::onInteractionEnd);
+
 
     // Set the UI connections
     QObject::connect(ui->addButton, &QPushButton::clicked, this, &Widget::on_addButton_clicked);
     QObject::connect(ui->editButton, &QPushButton::clicked, this, &Widget::on_editButton_clicked);
     QObject::connect(ui->deleteButton, &QPushButton::clicked, this, &Widget::on_deleteButton_clicked);
     QObject::connect(ui->flipButton, &QPushButton::clicked, this, &Widget::on_flipButton_clicked);
+
+    // Slider drags count as interaction for the level of detail
+    for (QSlider* slider : { ui->rotateSlider, ui->scaleSlider, ui->xTranslateSlider, ui->yTranslateSlider, ui->zTranslateSlider })
+    {
+        connect(slider, &QSlider::sliderPressed, this, &Widget::onInteractionStart);
+        connect(slider, &QSlider::sliderReleased, this, &Widget::onInteractionEnd);
+    }
+
+    // Each slider drag becomes one undo step
+    for (QSlider* slider : { ui->rotateSlider, ui->scaleSlider, ui->opacitySlider,
+                             ui->redColorSlider, ui->greenColorSlider, ui->blueColorSlider,
+                             ui->xTranslateSlider, ui->yTranslateSlider, ui->zTranslateSlider })
+        connect(slider, &QSlider::sliderReleased, this, [this]() { mHistory.seal(); });
+
+    // Keyboard selection of scene objects
+    connect(new QShortcut(QKeySequence("Ctrl+N"), this), &QShortcut::activated, this, &Widget::onSelectNext);
+    connect(new QShortcut(QKeySequence("Ctrl+P"), this), &QShortcut::activated, this, &Widget::onSelectPrevious);
+    connect(new QShortcut(QKeySequence("Ctrl+Space"), this), &QShortcut::activated, this, &Widget::onToggleSelection);
+    connect(new QShortcut(QKeySequence::SelectAll, this), &QShortcut::activated, this, &Widget::onSelectAll);
+    connect(new QShortcut(QKeySequence(Qt::Key_Escape), this), &QShortcut::activated, this, &Widget::onClearSelection);
+
+    // Undo and redo of scene edits
+    connect(new QShortcut(QKeySequence::Undo, this), &QShortcut::activated, this, &Widget::onUndo);
+    connect(new QShortcut(QKeySequence::Redo, this), &QShortcut::activated, this, &Widget::onRedo);
+
+    // Generate the built-in shapes in the background so the first clicks hit the cache
+    shapeController.prewarmCache();
 }
 
 
@@ -85,10 +304,35 @@ Widget::Widget(QWidget *parent)
  */
 Widget::~Widget()
 {
+    mRenderer->RemoveObserver(mRenderStartObserver);
+    mRenderWindow->RemoveObserver(mWindowStartObserver);
+    mRenderWindow->RemoveObserver(mWindowEndObserver);
+    mInteractor->RemoveObserver(mLeftPressObserver);
+    mInteractor->RemoveObserver(mLeftReleaseObserver);
+    mLod.setOnChainReady(nullptr);
+
     delete ui;
     delete mToolButtonMenu;
     delete mSaveSTLAction;
     delete mLoadSTLAction;
+    delete mSaveProjectAction;
+    delete mOpenProjectAction;
+    delete mRepairAction;
+    delete mRepairOnLoadAction;
+    delete mCacheOnLoadAction;
+    delete mInstancingAction;
+    delete mArrayAction;
+    delete mShapeParametersAction;
+    delete mFrameRateAction;
+    delete mLodAction;
+    delete mLodMemoryAction;
+    delete mTessellationAction;
+    delete mTessellationErrorAction;
+    delete mInterferenceAction;
+    delete mHistoryMemoryAction;
+    delete mCompactStorageAction;
+    delete mTraceAction;
+    delete mTraceExportAction;
 }
 
 
@@ -109,13 +353,287 @@ void Widget::reset_sliders(void)
 }
 
 
+/**
+ * @brief Moves the sliders to the state of the current object.
+ *
+ * Signals are blocked so the slots do not write the values back.
+ */
+void Widget::update_sliders(void)
+{
+    const ObjectId current = mScene.current();
+    if (current == InvalidObjectId)
+        return;
+
+    const QSignalBlocker rotateBlocker(ui->rotateSlider);
+    const QSignalBlocker scaleBlocker(ui->scaleSlider);
+    const QSignalBlocker opacityBlocker(ui->opacitySlider);
+    const QSignalBlocker redBlocker(ui->redColorSlider);
+    const QSignalBlocker greenBlocker(ui->greenColorSlider);
+    const QSignalBlocker blueBlocker(ui->blueColorSlider);
+    const QSignalBlocker xBlocker(ui->xTranslateSlider);
+    const QSignalBlocker yBlocker(ui->yTranslateSlider);
+    const QSignalBlocker zBlocker(ui->zTranslateSlider);
+
+    double rgb[3];
+    double position[3];
+    mScene.getColor(current, rgb);
+    mScene.getPosition(current, position);
+
+    ui->rotateSlider->setValue(0);
+    ui->scaleSlider->setValue(qRound((mScene.scale(current) - 1) * 100.0));
+    ui->opacitySlider->setValue(qRound(mScene.opacity(current) * 100.0));
+    ui->redColorSlider->setValue(qRound(rgb[0] * 255.0));
+    ui->greenColorSlider->setValue(qRound(rgb[1] * 255.0));
+    ui->blueColorSlider->setValue(qRound(rgb[2] * 255.0));
+    ui->xTranslateSlider->setValue(qRound(position[0] * 10.0));
+    ui->yTranslateSlider->setValue(qRound(position[1] * 10.0));
+    ui->zTranslateSlider->setValue(qRound(position[2] * 10.0));
+}
+
+
+/**
+ * @brief Adds a mesh to the scene and makes it the current object.
+ * @param mesh The geometry of the new object.
+ * @param instanced Draw the object through the instance batch of its mesh.
+ */
+void Widget::addSceneObject(vtkSmartPointer<vtkPolyData> mesh, bool instanced)
+{
+    setCurrentObject(instanced ? mScene.addInstance(mesh) : mScene.addObject(mesh));
+}
+
+
+/**
+ * @brief Makes another object current.
+ *
+ * The box widget belongs to the previous current object, so it is switched off.
+ * If the object still shows the bounds box of a project mesh, that mesh is read next.
+ * @param id The new current object.
+ */
+void Widget::setCurrentObject(ObjectId id)
+{
+    if (id != mScene.current())
+        mBoxWidget2->Off();
+    if (mShapeEditor.isOpen() && id != mShapeEditor.object())
+        closeShapeEditor();
+
+    mScene.setCurrent(id);
+    update_sliders();
+
+    if (id != InvalidObjectId)
+        isMeshPending(id);
+}
+
+
+/**
+ * @brief Makes an object touched by an undo or redo current, keeping the current object if it still exists.
+ * @param objects Objects of the undone or redone edit that are in the scene.
+ */
+void Widget::showHistoryStep(const std::vector<ObjectId>& objects)
+{
+    if (mShapeEditor.isOpen() && !mShapeEditor.isCurrent(mScene))
+        closeShapeEditor();
+
+    const ObjectId current = mScene.current();
+    if (current != InvalidObjectId && mScene.contains(current))
+        update_sliders();
+    else if (!objects.empty())
+        setCurrentObject(objects.back());
+    else if (mScene.size() > 0)
+        setCurrentObject(mScene.objects().back());
+    else
+        reset_sliders();
+}
+
+
+/**
+ * @brief Gives the edited shape the mesh of its latest parameters.
+ *
+ * Edits share a merge key, so the frames of one drag become a single undo step.
+ */
+void Widget::applyShapeEdit(void)
+{
+    if (!mShapeEditor.hasPendingEdit() || !mShapeEditor.isCurrent(mScene))
+        return;
+
+    mHistory.begin("Edit shape", { mShapeEditor.object() }, "shape-parameters");
+    mShapeEditor.update(mScene);
+    mHistory.commit();
+}
+
+
+/**
+ * @brief Closes the shape parameter dialog and stops editing.
+ *
+ * Edits still pending are applied first. If the object still shows the edited mesh,
+ * the adaptive tessellation takes it over again with the edited dimensions.
+ */
+void Widget::closeShapeEditor(void)
+{
+    if (mShapeEditor.isOpen())
+    {
+        applyShapeEdit();
+        mHistory.seal();
+
+        const ObjectId id = mShapeEditor.object();
+        if (mShapeEditor.isCurrent(mScene))
+            mTessellation.track(id, mShapeEditor.shape()->clone(), mScene.mesh(id), mShapeEditor.policy().maxChordalError);
+        mShapeEditor.close();
+    }
+
+    if (mShapeParameterDialog)
+    {
+        QDialog* dialog = mShapeParameterDialog;
+        mShapeParameterDialog = nullptr;
+        dialog->close();
+    }
+}
+
+
+/**
+ * @brief Requests a render from the scheduler.
+ *
+ * Many slots may request renders within one frame; they are served by a single
+ * Render(), right before which the dirty scene objects are synced to their actors.
+ */
+void Widget::render(void)
+{
+    mRenderScheduler->requestRender();
+}
+
+
+/**
+ * @brief Applies shape parameter edits, adapts shape resolutions, picks the level of detail of every object and syncs the scene.
+ *
+ * Observes the renderer's StartEvent, so it also runs for renders triggered by the
+ * interactor during camera drags, which do not go through the render scheduler.
+ * Shape parameter edits are applied here, so the edited shape's pipeline runs at most
+ * once per frame however many values a drag produces.
+ * Shapes left over when the tessellation runs out of time are handled by another render.
+ * When the interference check is on, objects that started or stopped interfering since
+ * the last render, e.g. during a slider or box widget drag, get their highlight updated.
+ */
+void Widget::onRenderStart(void)
+{
+    TRACE_SCOPE("Widget::onRenderStart", "render");
+
+    if (mShapeEditor.isOpen() && !mShapeEditor.isCurrent(mScene))
+        QMetaObject::invokeMethod(this, [this]() { closeShapeEditor(); }, Qt::QueuedConnection);
+    else
+        applyShapeEdit();
+
+    mTessellation.update(mScene, mRenderer);
+    if (mTessellation.hasPendingWork())
+        QMetaObject::invokeMethod(this, [this]() { render(); }, Qt::QueuedConnection);
+
+    mLod.update(mScene, mRenderer);
+
+    if (mInterferenceEnabled)
+    {
+        for (ObjectId id : mInterference.update())
+            mScene.setHighlighted(id, mInterference.isColliding(id));
+    }
+
+    mScene.syncToVtk();
+}
+
+
+/**
+ * @brief Notes the trace clock when the render window starts rendering.
+ *
+ * Observes the window rather than the render scheduler, so renders triggered by the
+ * interactor are traced too.
+ */
+void Widget::onWindowRenderStart(void)
+{
+    mWindowRenderStart = Trace::isEnabled() ? Trace::now() : -1;
+}
+
+
+/**
+ * @brief Records the render that just finished as a trace span.
+ */
+void Widget::onWindowRenderEnd(void)
+{
+    if (mWindowRenderStart >= 0)
+        Trace::record("vtkRenderWindow::Render", "render", mWindowRenderStart, Trace::now());
+    mWindowRenderStart = -1;
+}
+
+
+/**
+ * @brief Notes where the left mouse button went down.
+ */
+void Widget::onLeftButtonPress(void)
+{
+    mInteractor->GetEventPosition(mLeftPressPosition);
+}
+
+
+/**
+ * @brief Makes the object under the cursor current if the button was released where it was pressed.
+ *
+ * Releases more than a few pixels away end a camera drag and are ignored. With Ctrl
+ * held, the object is also added to or removed from the selection. The hit object and
+ * cell are shown in a tooltip.
+ */
+void Widget::onLeftButtonRelease(void)
+{
+    TRACE_SCOPE("Widget::onLeftButtonRelease", "ui");
+
+    const int* position = mInteractor->GetEventPosition();
+    if (std::abs(position[0] - mLeftPressPosition[0]) > 3 || std::abs(position[1] - mLeftPressPosition[1]) > 3)
+        return;
+
+    double origin[3];
+    double direction[3];
+    displayRay(mRenderer, position[0], position[1], origin, direction);
+
+    const ScenePicker::Hit hit = mPicker.pick(origin, direction);
+    if (!hit.hit())
+        return;
+
+    setCurrentObject(hit.object);
+    if (mInteractor->GetControlKey())
+        mScene.setSelected(hit.object, !mScene.isSelected(hit.object));
+
+    QToolTip::showText(QCursor::pos(), QString("Object %1, cell %2").arg(hit.object).arg(hit.cell), ui->viewWidget);
+    render();
+}
+
+
+/**
+ * @brief Uses the interactive level of detail tolerance and holds shape resolutions while the user drags.
+ */
+void Widget::onInteractionStart(void)
+{
+    mLod.setInteracting(true);
+    mTessellation.setInteracting(true);
+}
+
+
+/**
+ * @brief Restores the idle level of detail tolerance and renders the refined view.
+ */
+void Widget::onInteractionEnd(void)
+{
+    mLod.setInteracting(false);
+    mTessellation.setInteracting(false);
+    render();
+}
+
+
 /**
  * @brief Slot triggered when 'addButton' is clicked.
  *
- * Creates a new shape based on the selected option from the combo box.
+ * Adds a new shape based on the selected option from the combo box
+ * to the scene and makes it the current object. In instanced rendering
+ * mode the shape shares one glyph mapper with all copies of its mesh;
+ * otherwise its resolution follows its size on screen.
  */
 void Widget::on_addButton_clicked()
 {
+    TRACE_SCOPE("Widget::on_addButton_clicked", "ui");
+
     vtkNew<vtkNamedColors> colors;
 
     vtkSmartPointer<vtkPolyDataMapper> shapeMapper = shapeController.createShape(ui->comboBox->currentText());
@@ -123,26 +641,19 @@ void Widget::on_addButton_clicked()
         return; // or handle the error
     }
 
-    if (mCurrentShapeActor)
-    {
-        reset_sliders();
-
-        mRenderer->RemoveViewProp(mCurrentShapeActor);
-        mBoxWidget2->Off();
-    }
-
-    vtkSmartPointer<vtkActor> shapeActor = vtkSmartPointer<vtkActor>::New();
-    shapeActor->SetMapper(shapeMapper);
-    shapeActor->GetProperty()->SetColor(0, 0, 0);
-    mCurrentShapeActor = shapeActor;
+    mHistory.begin("Add shape", {});
+    addSceneObject(shapeMapper->GetInput(), mInstancingAction->isChecked());
+    mHistory.commit({ mScene.current() });
+    if (!mInstancingAction->isChecked())
+        mTessellation.track(mScene.current(), ShapeController::makeShape(ui->comboBox->currentText()), shapeMapper->GetInput());
 
-    mRenderer->AddViewProp(shapeActor);
     mRenderer->SetBackground(colors->GetColor3d("Salmon").GetData());
+    mScene.syncToVtk();
     mRenderer->ResetCamera();
     mRenderer->GetActiveCamera()->Azimuth(5);
     mRenderer->GetActiveCamera()->Elevation(5);
 
-    mRenderWindow->Render();
+    render();
 }
 
 
@@ -153,12 +664,25 @@ void Widget::on_addButton_clicked()
  */
 void Widget::on_editButton_clicked()
 {
-    if (mCurrentShapeActor)
+    TRACE_SCOPE("Widget::on_editButton_clicked", "ui");
+
+    const ObjectId current = mScene.current();
+    if (current != InvalidObjectId)
     {
-        callback->Actor = mCurrentShapeActor;
-        mBoxWidget2->AddObserver(vtkCommand::InteractionEvent, callback);
+        mScene.syncToVtk();
+
+        // Instanced objects have no actor of their own to attach the box widget to
+        vtkActor* actor = mScene.actor(current);
+        if (!actor)
+            return;
+
+        // Releasing the box widget would bake the transform into the bounds box of a pending mesh
+        if (callback->Mode == BoxWidgetCallback::BakeMode::OnRelease && waitsForMesh(current, "Edit"))
+            return;
+
+        callback->TargetObject = current;
 
-        mBoxWidget2->GetRepresentation()->PlaceWidget(mCurrentShapeActor->GetBounds());
+        mBoxWidget2->GetRepresentation()->PlaceWidget(actor->GetBounds());
         mBoxWidget2->On();
     }
 }
@@ -167,20 +691,35 @@ void Widget::on_editButton_clicked()
 /**
  * @brief Slot triggered when 'deleteButton' is clicked.
  *
- * Removes the current shape from the scene.
+ * Removes the current shape from the scene. The most recently
+ * placed remaining object becomes current.
  */
 void Widget::on_deleteButton_clicked()
 {
-    if (mCurrentShapeActor)
+    TRACE_SCOPE("Widget::on_deleteButton_clicked", "ui");
+
+    const ObjectId current = mScene.current();
+    if (current != InvalidObjectId && current == mPreviewObject)
     {
-        reset_sliders();
+        // Deleting the preview of a file still loading cancels the load, which removes it
+        mMeshLoader->cancel();
+        return;
+    }
 
+    if (current != InvalidObjectId)
+    {
         mBoxWidget2->Off();
 
-        mRenderer->RemoveViewProp(mCurrentShapeActor);
-        mRenderWindow->Render();
+        mHistory.begin("Delete", { current });
+        mScene.removeObject(current);
+        mHistory.commit();
 
-        mCurrentShapeActor = nullptr;
+        if (mScene.size() > 0)
+            setCurrentObject(mScene.objects().back());
+        else
+            reset_sliders();
+
+        render();
     }
 }
 
@@ -188,11 +727,60 @@ void Widget::on_deleteButton_clicked()
 /**
  * @brief Slot triggered when 'mergeButton' is clicked.
  *
- * TODO: Add merge logic.
+ * Replaces the selected objects with one object whose mesh combines theirs, each
+ * transformed to where it is drawn, so they are rendered with a single mapper.
+ * Coincident points are welded. The merged object takes the material of the first
+ * selected object.
  */
 void Widget::on_mergeButton_clicked()
 {
+    TRACE_SCOPE("Widget::on_mergeButton_clicked", "ui");
+
+    const std::vector<ObjectId> selection = mScene.selection();
+    if (selection.size() < 2)
+        return; // nothing to merge
+
+    bool pending = false;
+    for (ObjectId id : selection)
+        pending = isMeshPending(id) || pending;
+    if (pending)
+    {
+        QMessageBox::information(this, "Merge", "Some of the selected meshes are still loading. Try again once they are shown.");
+        return;
+    }
+
+    std::vector<MeshMerger::Part> parts(selection.size());
+    for (std::size_t i = 0; i < selection.size(); ++i)
+    {
+        parts[i].mesh = mScene.mesh(selection[i]);
+        mScene.getWorldMatrix(selection[i], parts[i].matrix.data());
+    }
 
+    MeshMerger::Options options;
+    options.weldTolerance = MeshMerger::defaultWeldTolerance(parts);
+    const MeshMerger::Result result = MeshMerger::merge(parts, options);
+    if (!result.ok())
+    {
+        QMessageBox::warning(this, "Merge", result.error);
+        return;
+    }
+
+    double rgb[3];
+    mScene.getColor(selection.front(), rgb);
+    const double opacity = mScene.opacity(selection.front());
+
+    mBoxWidget2->Off();
+    mHistory.begin("Merge", selection);
+    for (ObjectId id : selection)
+        mScene.removeObject(id);
+
+    const ObjectId merged = mScene.addObject(result.mesh);
+    mScene.setColor(merged, rgb);
+    mScene.setOpacity(merged, opacity);
+    mHistory.commit({ merged });
+    setCurrentObject(merged);
+
+    render();
 }
 
 
@@ -203,10 +791,18 @@ void Widget::on_mergeButton_clicked()
  */
 void Widget::on_flipButton_clicked()
 {
-    if (mCurrentShapeActor)
+    TRACE_SCOPE("Widget::on_flipButton_clicked", "ui");
+
+    const ObjectId current = mScene.current();
+    if (current != InvalidObjectId)
     {
-        mCurrentShapeActor->RotateY(90);
-        mRenderWindow->Render();
+        double orientation[3];
+        mScene.getOrientation(current, orientation);
+        orientation[1] += 90;
+        mHistory.begin("Flip", { current });
+        mScene.setOrientation(current, orientation);
+        mHistory.commit();
+        render();
     }
 }
 
@@ -219,10 +815,18 @@ void Widget::on_flipButton_clicked()
  */
 void Widget::on_rotateSlider_valueChanged(int value)
 {
-    if (mCurrentShapeActor)
+    TRACE_SCOPE("Widget::on_rotateSlider_valueChanged", "ui");
+
+    const ObjectId current = mScene.current();
+    if (current != InvalidObjectId)
     {
-        mCurrentShapeActor->RotateY(value);
-        mRenderWindow->Render();
+        double orientation[3];
+        mScene.getOrientation(current, orientation);
+        orientation[1] += value;
+        mHistory.begin("Rotate", { current }, "rotate");
+        mScene.setOrientation(current, orientation);
+        mHistory.commit();
+        render();
     }
 }
 
@@ -235,15 +839,20 @@ void Widget::on_rotateSlider_valueChanged(int value)
  */
 void Widget::on_scaleSlider_valueChanged(int value)
 {
-    if (mCurrentShapeActor)
+    TRACE_SCOPE("Widget::on_scaleSlider_valueChanged", "ui");
+
+    const ObjectId current = mScene.current();
+    if (current != InvalidObjectId)
     {
         double scaleFactor = 1 + (value / 100.0);
 
-        // Adjust the scale of the shape actor
-        mCurrentShapeActor->SetScale(scaleFactor, scaleFactor, scaleFactor);
+        // Adjust the scale of the shape
+        mHistory.begin("Scale", { current }, "scale");
+        mScene.setScale(current, scaleFactor);
+        mHistory.commit();
 
         // Render the scene again to reflect the scaling change
-        mRenderWindow->Render();
+        render();
     }
 }
 
@@ -256,13 +865,18 @@ void Widget::on_scaleSlider_valueChanged(int value)
  */
 void Widget::on_opacitySlider_valueChanged(int value)
 {
+    TRACE_SCOPE("Widget::on_opacitySlider_valueChanged", "ui");
+
     // Convert slider value to opacity range [0, 1]
     double opacity = value / 100.0;
 
-    if (mCurrentShapeActor)
+    const ObjectId current = mScene.current();
+    if (current != InvalidObjectId)
     {
-        mCurrentShapeActor->GetProperty()->SetOpacity(opacity);
-        mRenderWindow->Render();
+        mHistory.begin("Opacity", { current }, "opacity");
+        mScene.setOpacity(current, opacity);
+        mHistory.commit();
+        render();
     }
 }
 
@@ -275,17 +889,21 @@ void Widget::on_opacitySlider_valueChanged(int value)
  */
 void Widget::on_redColorSlider_valueChanged(int value)
 {
+    TRACE_SCOPE("Widget::on_redColorSlider_valueChanged", "ui");
 
-    if (mCurrentShapeActor)
+    const ObjectId current = mScene.current();
+    if (current != InvalidObjectId)
     {
         double rgb[3];
 
-        mCurrentShapeActor->GetProperty()->GetColor(rgb);
+        mScene.getColor(current, rgb);
 
         rgb[0] = value / 255.0;
 
-        mCurrentShapeActor->GetProperty()->SetColor(rgb);
-        mRenderWindow->Render();
+        mHistory.begin("Color", { current }, "color");
+        mScene.setColor(current, rgb);
+        mHistory.commit();
+        render();
     }
 
 }
@@ -298,16 +916,21 @@ void Widget::on_redColorSlider_valueChanged(int value)
  */
 void Widget::on_greenColorSlider_valueChanged(int value)
 {
-    if (mCurrentShapeActor)
+    TRACE_SCOPE("Widget::on_greenColorSlider_valueChanged", "ui");
+
+    const ObjectId current = mScene.current();
+    if (current != InvalidObjectId)
     {
         double rgb[3];
 
-        mCurrentShapeActor->GetProperty()->GetColor(rgb);
+        mScene.getColor(current, rgb);
 
         rgb[1] = value / 255.0;
 
-        mCurrentShapeActor->GetProperty()->SetColor(rgb);
-        mRenderWindow->Render();
+        mHistory.begin("Color", { current }, "color");
+        mScene.setColor(current, rgb);
+        mHistory.commit();
+        render();
     }
 }
 
@@ -319,16 +942,21 @@ void Widget::on_greenColorSlider_valueChanged(int value)
  */
 void Widget::on_blueColorSlider_valueChanged(int value)
 {
-    if (mCurrentShapeActor)
+    TRACE_SCOPE("Widget::on_blueColorSlider_valueChanged", "ui");
+
+    const ObjectId current = mScene.current();
+    if (current != InvalidObjectId)
     {
         double rgb[3];
 
-        mCurrentShapeActor->GetProperty()->GetColor(rgb);
+        mScene.getColor(current, rgb);
 
         rgb[2] = value / 255.0;
 
-        mCurrentShapeActor->GetProperty()->SetColor(rgb);
-        mRenderWindow->Render();
+        mHistory.begin("Color", { current }, "color");
+        mScene.setColor(current, rgb);
+        mHistory.commit();
+        render();
     }
 }
 
@@ -341,19 +969,24 @@ void Widget::on_blueColorSlider_valueChanged(int value)
  */
 void Widget::on_xTranslateSlider_valueChanged(int value)
 {
-    if (mCurrentShapeActor)
+    TRACE_SCOPE("Widget::on_xTranslateSlider_valueChanged", "ui");
+
+    const ObjectId current = mScene.current();
+    if (current != InvalidObjectId)
     {
         // Get the current position
         double currentPosition[3];
-        mCurrentShapeActor->GetPosition(currentPosition);
+        mScene.getPosition(current, currentPosition);
 
         // Update the x-position (or y or z, depending on your needs)
         currentPosition[0] = value / 10.0;
 
         // Set the new position
-        mCurrentShapeActor->SetPosition(currentPosition);
+        mHistory.begin("Move", { current }, "translate-x");
+        mScene.setPosition(current, currentPosition);
+        mHistory.commit();
 
-        mRenderWindow->Render();
+        render();
     }
 }
 
@@ -366,19 +999,24 @@ void Widget::on_xTranslateSlider_valueChanged(int value)
  */
 void Widget::on_yTranslateSlider_valueChanged(int value)
 {
-    if (mCurrentShapeActor)
+    TRACE_SCOPE("Widget::on_yTranslateSlider_valueChanged", "ui");
+
+    const ObjectId current = mScene.current();
+    if (current != InvalidObjectId)
     {
         // Get the current position
         double currentPosition[3];
-        mCurrentShapeActor->GetPosition(currentPosition);
+        mScene.getPosition(current, currentPosition);
 
         // Update the x-position (or y or z, depending on your needs)
         currentPosition[1] = value / 10.0;
 
         // Set the new position
-        mCurrentShapeActor->SetPosition(currentPosition);
+        mHistory.begin("Move", { current }, "translate-y");
+        mScene.setPosition(current, currentPosition);
+        mHistory.commit();
 
-        mRenderWindow->Render();
+        render();
     }
 }
 
@@ -391,35 +1029,39 @@ void Widget::on_yTranslateSlider_valueChanged(int value)
  */
 void Widget::on_zTranslateSlider_valueChanged(int value)
 {
-    if (mCurrentShapeActor)
+    TRACE_SCOPE("Widget::on_zTranslateSlider_valueChanged", "ui");
+
+    const ObjectId current = mScene.current();
+    if (current != InvalidObjectId)
     {
         // Get the current position
         double currentPosition[3];
-        mCurrentShapeActor->GetPosition(currentPosition);
+        mScene.getPosition(current, currentPosition);
 
         // Update the x-position (or y or z, depending on your needs)
         currentPosition[2] = value / 10.0;
 
         // Set the new position
-        mCurrentShapeActor->SetPosition(currentPosition);
+        mHistory.begin("Move", { current }, "translate-z");
+        mScene.setPosition(current, currentPosition);
+        mHistory.commit();
 
-        mRenderWindow->Render();
+        render();
     }
 }
 
 
 /**
- * @brief Saves the current shape actor to an STL file.
+ * @brief Saves the current object to a binary STL file on a worker thread.
  */
 void Widget::onSaveSTL()
 {
-    // Your save STL logic here.
-    if (mCurrentShapeActor)
-    {
-        // Fetch the actor's geometry data
-        vtkPolyData* polyData = vtkPolyData::SafeDownCast(mCurrentShapeActor->GetMapper()->GetInput());
+    TRACE_SCOPE("Widget::onSaveSTL", "ui");
 
-        if (polyData)
+    const ObjectId current = mScene.current();
+    if (current != InvalidObjectId && !waitsForMesh(current, "Save STL"))
+    {
+        if (mScene.mesh(current))
         {
             // Open a save file dialog to choose the location and filename
             QString filePath = QFileDialog::getSaveFileName(
@@ -435,21 +1077,91 @@ void Widget::onSaveSTL()
             if (!filePath.endsWith(".stl", Qt::CaseInsensitive))
                 filePath += ".stl";  // Append STL extension if not present
 
-            // Use vtkSTLWriter to save the data
-            vtkSmartPointer<vtkSTLWriter> stlWriter = vtkSmartPointer<vtkSTLWriter>::New();
-            stlWriter->SetFileName(filePath.toStdString().c_str());
-            stlWriter->SetInputData(polyData);
-            stlWriter->Write();
+            // Box widget edits that were deferred until export are baked now, as an undoable step
+            if (callback->Mode == BoxWidgetCallback::BakeMode::OnExport && mScene.hasUserMatrix(current))
+            {
+                mHistory.begin("Bake transform", { current });
+                mScene.bakeUserMatrix(current);
+                mHistory.commit();
+                render();
+            }
+
+            // Fetch the object's geometry data, with any non-destructive transform applied
+            vtkSmartPointer<vtkPolyData> polyData = mScene.bakedMesh(current);
+
+            // Serialize the facets on all cores, off the GUI thread; a running save keeps its dialog
+            if (!mMeshSaver->isSaving())
+            {
+                mSaveProgress->setLabelText(QString("Saving %1...").arg(QFileInfo(filePath).fileName()));
+                mSaveProgress->setValue(0);
+            }
+            mMeshSaver->save(filePath, polyData);
         }
     }
 }
 
 
 /**
- * @brief Loads a shape from an STL file and sets it as the current shape actor.
+ * @brief Advances the progress dialog of the running save.
+ *
+ * @param fraction Fraction of the facets written so far.
+ */
+void Widget::onSaveProgress(double fraction)
+{
+    if (mMeshSaver->isSaving())
+        mSaveProgress->setValue(qRound(fraction * 100.0));
+}
+
+
+/**
+ * @brief Reports a completed save.
+ *
+ * @param path The written file.
+ * @param result Statistics of the write.
+ */
+void Widget::onSaveFinished(const QString& path, const StlWriter::Result& result)
+{
+    if (!mMeshSaver->isSaving())
+        mSaveProgress->reset();
+
+    qInfo().noquote() << QString("Saved %1 facets to %2 in %3 s (%4 MB/s)")
+        .arg(result.facets)
+        .arg(path)
+        .arg(result.seconds, 0, 'f', 3)
+        .arg(result.throughputMBps(), 0, 'f', 1);
+}
+
+
+/**
+ * @brief Reports a save that failed or was canceled.
+ *
+ * @param path The file that was not written.
+ * @param error Reason for the failure.
+ */
+void Widget::onSaveFailed(const QString& path, const QString& error)
+{
+    const bool canceled = mSaveProgress->wasCanceled();
+    if (!mMeshSaver->isSaving())
+        mSaveProgress->reset();
+
+    if (canceled)
+        qInfo().noquote() << QString("Canceled saving %1").arg(path);
+    else
+        QMessageBox::warning(this, "Save STL", QString("Could not save %1:\n%2").arg(path, error));
+}
+
+
+/**
+ * @brief Starts loading a shape from an STL file on a worker thread.
+ *
+ * The GUI stays responsive during the load: a sampled preview is added to the scene
+ * as soon as it is read and is replaced by the full mesh when that is ready. Opening
+ * another file while one is loading cancels the first load and removes its preview.
  */
 void Widget::onLoadSTL()
 {
+    TRACE_SCOPE("Widget::onLoadSTL", "ui");
+
     // Open a file dialog to choose the STL file to load
     QString filePath = QFileDialog::getOpenFileName(
         this,
@@ -461,31 +1173,975 @@ void Widget::onLoadSTL()
     if (filePath.isEmpty())
         return; // user canceled
 
-    // Use vtkSTLReader to read the STL file
-    vtkSmartPointer<vtkSTLReader> stlReader = vtkSmartPointer<vtkSTLReader>::New();
-    stlReader->SetFileName(filePath.toStdString().c_str());
+    mMeshLoader->load(filePath);
 
-    // Map the read data to an actor
-    vtkSmartPointer<vtkPolyDataMapper> shapeMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-    shapeMapper->SetInputConnection(stlReader->GetOutputPort());
+    mLoadProgress->setLabelText(QString("Loading %1...").arg(QFileInfo(filePath).fileName()));
+    mLoadProgress->setValue(0);
+}
+
+
+/**
+ * @brief Shows the sampled preview of the file being loaded as the current object.
+ *
+ * @param path The file being loaded.
+ * @param preview A subset of the file's facets.
+ */
+void Widget::onLoadPreview(const QString& path, vtkSmartPointer<vtkPolyData> preview)
+{
+    TRACE_SCOPE("Widget::onLoadPreview", "ui");
+
+    // Not an edit yet: the load is recorded once the full mesh replaces the preview
+    addSceneObject(preview);
+    mPreviewObject = mScene.current();
+
+    qInfo().noquote() << QString("Showing a %1 facet preview of %2").arg(preview->GetNumberOfCells()).arg(path);
+
+    // Update the rendering
+    mScene.syncToVtk();
+    mRenderer->ResetCamera();
+    render();
+}
+
+
+/**
+ * @brief Advances the progress dialog of the full read.
+ *
+ * @param fraction Fraction of the file read so far.
+ */
+void Widget::onLoadProgress(double fraction)
+{
+    if (mMeshLoader->isLoading())
+        mLoadProgress->setValue(qRound(fraction * 100.0));
+}
+
+
+/**
+ * @brief Logs what the repair of a loaded file changed; the repaired mesh arrives with onLoadFinished().
+ *
+ * @param path The loaded file.
+ * @param result What every repair step changed, or why the repair failed.
+ */
+void Widget::onLoadRepaired(const QString& path, const MeshRepair::Result& result)
+{
+    logRepair(path, result);
+}
+
+
+/**
+ * @brief Replaces the preview with the full mesh, or adds the mesh if there was no preview.
+ *
+ * Either way the history records a single step adding the object with its full mesh.
+ *
+ * @param path The loaded file.
+ * @param result The full mesh and read statistics.
+ */
+void Widget::onLoadFinished(const QString& path, const StlReader::Result& result)
+{
+    TRACE_SCOPE("Widget::onLoadFinished", "ui");
 
-    // Create an actor for the shape
-    vtkSmartPointer<vtkActor> shape = vtkSmartPointer<vtkActor>::New();
-    shape->SetMapper(shapeMapper);
+    mLoadProgress->reset();
 
-    // Remove the previous shape actor if exists
-    if (mCurrentShapeActor)
+    qInfo().noquote() << QString("Loaded %1 %2 facets from %3 in %4 s (%5 MB/s)")
+        .arg(result.facets)
+        .arg(result.cached ? "cached" : result.binary ? "binary" : "ASCII")
+        .arg(path)
+        .arg(result.seconds, 0, 'f', 3)
+        .arg(result.throughputMBps(), 0, 'f', 1);
+
+    if (mPreviewObject != InvalidObjectId && mScene.contains(mPreviewObject))
     {
-        mRenderer->RemoveActor(mCurrentShapeActor);
+        // Keep the transform and material the user may already have applied to the preview,
+        // and record the object as added with its full mesh, so undo never brings the preview back
+        mScene.setMesh(mPreviewObject, result.mesh);
+        mHistory.begin("Load", {});
+        mHistory.commit({ mPreviewObject });
+        mPreviewObject = InvalidObjectId;
+        render();
+        return;
     }
 
-    // Set the newly loaded actor as the current shape actor
-    mCurrentShapeActor = shape;
-
-    // Add the shape actor to the renderer
-    mRenderer->AddActor(mCurrentShapeActor);
+    // Add the loaded geometry to the scene as the current object
+    mPreviewObject = InvalidObjectId;
+    mHistory.begin("Load", {});
+    addSceneObject(result.mesh);
+    mHistory.commit({ mScene.current() });
 
     // Update the rendering
+    mScene.syncToVtk();
     mRenderer->ResetCamera();
-    mRenderWindow->Render();
+    render();
+}
+
+
+/**
+ * @brief Removes the preview of a file that could not be read and reports the error.
+ *
+ * @param path The file.
+ * @param error Reason for the failure.
+ */
+void Widget::onLoadFailed(const QString& path, const QString& error)
+{
+    mLoadProgress->reset();
+    removePreviewObject();
+    render();
+
+    QMessageBox::warning(this, "Open STL", QString("Could not load %1:\n%2").arg(path, error));
+}
+
+
+/**
+ * @brief Removes the preview of a load that was canceled or superseded by another file.
+ *
+ * @param path The file whose load was canceled.
+ */
+void Widget::onLoadCanceled(const QString& path)
+{
+    mLoadProgress->reset();
+    removePreviewObject();
+    render();
+
+    qInfo().noquote() << QString("Canceled loading %1").arg(path);
+}
+
+
+/**
+ * @brief Saves every object to a project file, writing only the meshes changed since the last save.
+ *
+ * The preview of an STL file still loading is left out. Objects still showing the
+ * bounds box of an opened project's mesh keep referring to that mesh's file.
+ */
+void Widget::onSaveProject()
+{
+    TRACE_SCOPE("Widget::onSaveProject", "ui");
+
+    QString filePath = QFileDialog::getSaveFileName(
+        this,
+        "Save project",
+        mProjectFile.path().isEmpty() ? QDir::homePath() : mProjectFile.path(),
+        "Projects (*.qvtk);;All Files (*)"
+    );
+
+    if (filePath.isEmpty())
+        return; // user canceled
+
+    if (!filePath.endsWith(".qvtk", Qt::CaseInsensitive))
+        filePath += ".qvtk";
+
+    std::vector<ObjectId> objects;
+    for (ObjectId id : mScene.objects())
+    {
+        if (id != mPreviewObject)
+            objects.push_back(id);
+    }
+
+    const ProjectFile::SaveResult result = mProjectFile.save(filePath, mScene, objects);
+    if (!result.ok())
+    {
+        QMessageBox::warning(this, "Save project", QString("Could not save %1:\n%2").arg(filePath, result.error));
+        return;
+    }
+
+    qInfo().noquote() << QString("Saved %1 objects with %2 meshes to %3 in %4 s: %5 meshes written, %6 MB, %7 unused mesh files removed")
+        .arg(result.objects)
+        .arg(result.meshes)
+        .arg(filePath)
+        .arg(result.seconds, 0, 'f', 3)
+        .arg(result.meshesWritten)
+        .arg(result.bytesWritten / 1.0e6, 0, 'f', 1)
+        .arg(result.filesRemoved);
+}
+
+
+/**
+ * @brief Replaces the scene with the objects of a project file.
+ *
+ * Only the table of contents is read here, so every object appears at once as the
+ * box of its mesh's bounds, with its transform and material. The meshes are then
+ * read on a worker thread, the current object's first, and replace the boxes as they
+ * arrive. Undo history does not reach across the open.
+ */
+void Widget::onOpenProject()
+{
+    TRACE_SCOPE("Widget::onOpenProject", "ui");
+
+    const QString filePath = QFileDialog::getOpenFileName(
+        this,
+        "Open project",
+        QDir::homePath(),
+        "Projects (*.qvtk);;All Files (*)"
+    );
+
+    if (filePath.isEmpty())
+        return; // user canceled
+
+    ProjectFile::Contents contents = ProjectFile::read(filePath);
+    if (!contents.ok())
+    {
+        QMessageBox::warning(this, "Open project", QString("Could not open %1:\n%2").arg(filePath, contents.error));
+        return;
+    }
+
+    // The project replaces the session
+    mMeshLoader->cancel();
+    mProjectLoader->cancel();
+    closeShapeEditor();
+    mBoxWidget2->Off();
+    for (ObjectId id : mScene.objects())
+        mTessellation.untrack(id);
+    mScene.clear();
+    mHistory.clear();
+    mBvhCache.clear();
+    mLod.clear();
+    mPreviewObject = InvalidObjectId;
+
+    // Boxes count as saved, so saving before their meshes arrive keeps the meshes' files
+    mProjectFile.reset(filePath);
+    mOpenedProject = filePath;
+    mProjectContents = std::move(contents);
+    mProjectPlaceholders.clear();
+    mProjectMeshes.assign(mProjectContents.meshes.size(), nullptr);
+    QStringList files;
+    for (const ProjectFile::Mesh& mesh : mProjectContents.meshes)
+    {
+        mProjectPlaceholders.push_back(ProjectFile::boundsMesh(mesh.bounds));
+        mProjectFile.markSaved(mProjectPlaceholders.back(), filePath, mesh);
+        files << mesh.file;
+    }
+
+    for (const ProjectFile::Object& object : mProjectContents.objects)
+    {
+        const vtkSmartPointer<vtkPolyData>& mesh = mProjectPlaceholders[object.mesh];
+        const ObjectId id = object.instanced ? mScene.addInstance(mesh) : mScene.addObject(mesh);
+        mScene.setPosition(id, object.position.data());
+        mScene.setOrientation(id, object.orientation.data());
+        mScene.setScale(id, object.scale);
+        mScene.setUserMatrix(id, object.userMatrix.data());
+        mScene.setColor(id, object.color.data());
+        mScene.setOpacity(id, object.opacity);
+    }
+
+    qInfo().noquote() << QString("Opened %1 objects with %2 meshes from %3 in %4 s")
+        .arg(mProjectContents.objects.size())
+        .arg(mProjectContents.meshes.size())
+        .arg(filePath)
+        .arg(mProjectContents.seconds, 0, 'f', 3);
+
+    mProjectLoader->load(ProjectFile::meshDirectory(filePath), files);
+    if (mScene.size() > 0)
+        setCurrentObject(mScene.objects().back());
+    else
+        reset_sliders();
+
+    // Update the rendering
+    mScene.syncToVtk();
+    mRenderer->ResetCamera();
+    render();
+}
+
+
+/**
+ * @brief Gives every object showing the bounds box of a project mesh the mesh itself.
+ *
+ * @param mesh Index of the mesh in the project's table of contents.
+ * @param polyData The mesh.
+ */
+void Widget::onProjectMeshLoaded(std::size_t mesh, vtkSmartPointer<vtkPolyData> polyData)
+{
+    TRACE_SCOPE("Widget::onProjectMeshLoaded", "ui");
+
+    if (mesh >= mProjectMeshes.size() || mProjectMeshes[mesh])
+        return;
+
+    mProjectMeshes[mesh] = polyData;
+    mProjectFile.markSaved(polyData, mOpenedProject, mProjectContents.meshes[mesh]);
+    showProjectMeshes();
+    render();
+}
+
+
+/**
+ * @brief Reports a project mesh that could not be read; its objects keep showing its bounds box.
+ *
+ * @param mesh Index of the mesh in the project's table of contents.
+ * @param error Reason for the failure.
+ */
+void Widget::onProjectMeshFailed(std::size_t mesh, const QString& error)
+{
+    if (mesh < mProjectContents.meshes.size())
+        qWarning().noquote() << QString("Could not load %1: %2").arg(mProjectContents.meshes[mesh].file, error);
+}
+
+
+/**
+ * @brief Logs the totals of a project's meshes streaming in.
+ *
+ * @param loaded Meshes read.
+ * @param failed Meshes that could not be read.
+ * @param seconds Wall-clock time from opening the project until the last mesh was read.
+ */
+void Widget::onProjectLoaded(std::size_t loaded, std::size_t failed, double seconds)
+{
+    qInfo().noquote() << QString("Loaded %1 project meshes in %2 s, %3 failed")
+        .arg(loaded)
+        .arg(seconds, 0, 'f', 3)
+        .arg(failed);
+}
+
+
+/**
+ * @brief Removes the preview object of the current load, if it is still in the scene.
+ */
+void Widget::removePreviewObject(void)
+{
+    if (mPreviewObject == InvalidObjectId)
+        return;
+
+    const ObjectId preview = mPreviewObject;
+    mPreviewObject = InvalidObjectId;
+    if (!mScene.contains(preview))
+        return;
+
+    if (mScene.current() == preview)
+        mBoxWidget2->Off();
+
+    // The preview was never recorded, so neither is its removal
+    mScene.removeObject(preview);
+
+    if (mScene.size() > 0)
+        setCurrentObject(mScene.objects().back());
+    else
+        reset_sliders();
+}
+
+
+/**
+ * @brief Returns true if an object still shows the bounds box of a project mesh that has not arrived.
+ *
+ * The loader is asked to read that mesh next. Edits that replace the mesh must wait
+ * for it: the box would not be replaced afterwards, and saving would store the box.
+ *
+ * @param id The object.
+ */
+bool Widget::isMeshPending(ObjectId id)
+{
+    const auto placeholder = std::find(mProjectPlaceholders.begin(), mProjectPlaceholders.end(), mScene.mesh(id));
+    if (placeholder == mProjectPlaceholders.end())
+        return false;
+
+    const std::size_t mesh = static_cast<std::size_t>(placeholder - mProjectPlaceholders.begin());
+    if (mProjectMeshes[mesh])
+        return false;
+
+    mProjectLoader->prioritize(mesh);
+    return true;
+}
+
+
+/**
+ * @brief Returns true, after telling the user, if an object's mesh is pending, so an edit of its mesh has to wait.
+ *
+ * @param id The object.
+ * @param title Title of the refused action.
+ */
+bool Widget::waitsForMesh(ObjectId id, const QString& title)
+{
+    if (!isMeshPending(id))
+        return false;
+
+    QMessageBox::information(this, title, "The mesh of this object is still loading. Try again once it is shown.");
+    return true;
+}
+
+
+/**
+ * @brief Gives every object showing the bounds box of a project mesh that has arrived the mesh itself.
+ *
+ * Not an edit: the objects only show what the project already holds. Undo and redo
+ * may bring boxes back from steps recorded before the mesh arrived, so this runs
+ * after them too.
+ */
+void Widget::showProjectMeshes(void)
+{
+    for (ObjectId id : mScene.objects())
+    {
+        const auto placeholder = std::find(mProjectPlaceholders.begin(), mProjectPlaceholders.end(), mScene.mesh(id));
+        if (placeholder == mProjectPlaceholders.end())
+            continue;
+
+        if (vtkPolyData* mesh = mProjectMeshes[static_cast<std::size_t>(placeholder - mProjectPlaceholders.begin())])
+            mScene.setMesh(id, mesh);
+    }
+}
+
+
+/**
+ * @brief Logs the time taken and the change made by every step of a repair, or why it failed.
+ *
+ * @param subject The repaired file or object, as shown in the log.
+ * @param result The outcome of the repair.
+ */
+void Widget::logRepair(const QString& subject, const MeshRepair::Result& result)
+{
+    if (!result.ok())
+    {
+        qInfo().noquote() << QString("Could not repair %1: %2").arg(subject, result.error);
+        return;
+    }
+
+    qInfo().noquote() << QString("Repaired %1 in %2 s: %3 triangles to %4")
+        .arg(subject)
+        .arg(result.seconds, 0, 'f', 3)
+        .arg(result.inputTriangles)
+        .arg(result.mesh->GetNumberOfPolys());
+    for (const MeshRepair::Step& step : result.steps)
+        qInfo().noquote() << QString("  %1 (%2 ms)").arg(step.description).arg(step.seconds * 1000.0, 0, 'f', 1);
+}
+
+
+/**
+ * @brief Creates an NxMxK grid of instances of the shape selected in the combo box.
+ *
+ * The grid spacing is one and a half times the largest extent of the shape, so
+ * neighbouring instances never touch. The last instance becomes current.
+ *
+ * Instances are added on the GUI thread, so grids of more than MaxInstances are
+ * refused rather than freezing the application.
+ */
+void Widget::onCreateArray()
+{
+    TRACE_SCOPE("Widget::onCreateArray", "ui");
+
+    constexpr long long MaxInstances = 1000000;
+
+    bool ok = false;
+    const QString label = QString("Grid size (NxMxK), at most %1 instances:").arg(MaxInstances);
+    const QString text = QInputDialog::getText(this, "Array", label, QLineEdit::Normal, "10x10x10", &ok);
+    if (!ok)
+        return; // user canceled
+
+    const QRegularExpressionMatch match = QRegularExpression("^\\s*(\\d+)\\s*[xX]\\s*(\\d+)\\s*[xX]\\s*(\\d+)\\s*$").match(text);
+    if (!match.hasMatch())
+        return;
+
+    // Each count is checked first so the product cannot overflow
+    long long total = 1;
+    int counts[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const long long count = match.captured(axis + 1).toLongLong(&ok);
+        total = (ok && count <= MaxInstances) ? total * count : MaxInstances + 1;
+        counts[axis] = static_cast<int>(std::min(count, MaxInstances));
+    }
+    if (total > MaxInstances)
+    {
+        QMessageBox::warning(this, "Array", QString("%1 is more than %2 instances. Choose a smaller grid.").arg(text.trimmed()).arg(MaxInstances));
+        return;
+    }
+
+    vtkSmartPointer<vtkPolyDataMapper> shapeMapper = shapeController.createShape(ui->comboBox->currentText());
+    if (!shapeMapper)
+        return;
+
+    vtkSmartPointer<vtkPolyData> mesh = shapeMapper->GetInput();
+
+    double bounds[6];
+    mesh->GetBounds(bounds);
+    const double spacing = 1.5 * std::max({ bounds[1] - bounds[0], bounds[3] - bounds[2], bounds[5] - bounds[4] });
+
+    std::vector<ObjectId> added;
+    added.reserve(static_cast<std::size_t>(total));
+
+    mHistory.begin("Array", {});
+    ObjectId last = InvalidObjectId;
+    for (int i = 0; i < counts[0]; ++i)
+    {
+        for (int j = 0; j < counts[1]; ++j)
+        {
+            for (int k = 0; k < counts[2]; ++k)
+            {
+                last = mScene.addInstance(mesh);
+                added.push_back(last);
+
+                const double position[3] = { i * spacing, j * spacing, k * spacing };
+                mScene.setPosition(last, position);
+            }
+        }
+    }
+
+    mHistory.commit(added);
+
+    if (last != InvalidObjectId)
+        setCurrentObject(last);
+
+    mScene.syncToVtk();
+    mRenderer->ResetCamera();
+    render();
+}
+
+
+/**
+ * @brief Opens a dialog editing the dimensions of the current shape live.
+ *
+ * Each parameter gets a slider and a spin box. Values only mark the shape as edited;
+ * the mesh follows at the next frame, so dragging a slider regenerates the shape at most
+ * once per frame, re-executing only the pipeline stages the parameter feeds. A slider
+ * drag counts as interaction and becomes one undo step.
+ *
+ * Only objects still showing the mesh of a generated shape can be edited; instanced,
+ * merged, baked or loaded objects cannot.
+ */
+void Widget::onEditShapeParameters()
+{
+    TRACE_SCOPE("Widget::onEditShapeParameters", "ui");
+
+    const ObjectId current = mScene.current();
+    if (current == InvalidObjectId)
+        return;
+
+    double error = 0.0;
+    std::unique_ptr<Shape> shape = mTessellation.trackedShape(mScene, current, &error);
+    if (!shape)
+    {
+        QMessageBox::information(this, "Shape parameters", "The current object is no longer a generated shape, so it has no parameters to edit.");
+        return;
+    }
+
+    // The editor owns the object's mesh until the dialog closes
+    closeShapeEditor();
+    mTessellation.untrack(current);
+    mShapeEditor.open(mScene, current, std::move(shape), TessellationPolicy::fromChordalError(error));
+    mHistory.seal();
+
+    // Sliders move in this many steps across a parameter's range
+    constexpr int SliderSteps = 1000;
+
+    QDialog* dialog = new QDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->setWindowTitle("Shape parameters");
+    QFormLayout* layout = new QFormLayout(dialog);
+
+    const std::vector<ShapeParameter> parameters = mShapeEditor.parameters();
+    for (std::size_t i = 0; i < parameters.size(); ++i)
+    {
+        const ShapeParameter parameter = parameters[i];
+        const double range = parameter.maximum - parameter.minimum;
+
+        QSlider* slider = new QSlider(Qt::Horizontal, dialog);
+        slider->setRange(0, SliderSteps);
+        slider->setValue(static_cast<int>(std::lround((parameter.value - parameter.minimum) / range * SliderSteps)));
+
+        QDoubleSpinBox* spinBox = new QDoubleSpinBox(dialog);
+        spinBox->setDecimals(range < 1.0 ? 3 : 2);
+        spinBox->setRange(parameter.minimum, parameter.maximum);
+        spinBox->setSingleStep(range / 100.0);
+        spinBox->setValue(parameter.value);
+
+        connect(slider, &QSlider::valueChanged, spinBox, [spinBox, parameter, range](int position) {
+            spinBox->setValue(parameter.minimum + range * position / SliderSteps);
+        });
+        connect(spinBox, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this, i, slider, parameter, range](double value) {
+            {
+                const QSignalBlocker blocker(slider);
+                slider->setValue(static_cast<int>(std::lround((value - parameter.minimum) / range * SliderSteps)));
+            }
+            mShapeEditor.setParameter(i, value);
+            render();
+        });
+        connect(spinBox, &QDoubleSpinBox::editingFinished, this, [this]() { mHistory.seal(); });
+        connect(slider, &QSlider::sliderPressed, this, &Widget::onInteractionStart);
+        connect(slider, &QSlider::sliderReleased, this, &Widget::onInteractionEnd);
+        connect(slider, &QSlider::sliderReleased, this, [this]() { mHistory.seal(); });
+
+        QHBoxLayout* row = new QHBoxLayout();
+        row->addWidget(slider, 1);
+        row->addWidget(spinBox);
+        layout->addRow(QString::fromStdString(parameter.name), row);
+    }
+
+    connect(dialog, &QDialog::finished, this, [this, dialog]() {
+        if (mShapeParameterDialog != dialog)
+            return;
+        mShapeParameterDialog = nullptr;
+        closeShapeEditor();
+    });
+
+    mShapeParameterDialog = dialog;
+    dialog->show();
+}
+
+
+/**
+ * @brief Switches when box widget edits are baked into the geometry.
+ *
+ * Switching to "Bake on release" bakes the current object's pending transform right away.
+ * @param action The checked bake mode action.
+ */
+void Widget::onBakeModeChanged(QAction* action)
+{
+    callback->Mode = static_cast<BoxWidgetCallback::BakeMode>(action->data().toInt());
+
+    const ObjectId current = mScene.current();
+    if (callback->Mode == BoxWidgetCallback::BakeMode::OnRelease && current != InvalidObjectId && isMeshPending(current))
+    {
+        // Keep the transform in the user matrix; the box widget would bake it into the bounds box
+        mBoxWidget2->Off();
+        return;
+    }
+    if (callback->Mode == BoxWidgetCallback::BakeMode::OnRelease && current != InvalidObjectId)
+    {
+        mHistory.begin("Bake transform", { current });
+        mScene.bakeUserMatrix(current);
+        mHistory.commit();
+        render();
+    }
+}
+
+
+/**
+ * @brief Asks for a new frame rate cap for slider-driven renders.
+ *
+ * The dialog also shows how many renders were requested and how many were executed.
+ */
+void Widget::onSetFrameRateCap()
+{
+    const RenderScheduler::Statistics stats = mRenderScheduler->statistics();
+    const QString label = QString("Maximum renders per second, 0 for no cap\n(%1 requested, %2 executed)")
+        .arg(stats.requested)
+        .arg(stats.executed);
+
+    bool ok = false;
+    const int fps = QInputDialog::getInt(this, "Frame rate cap", label, qRound(mRenderScheduler->maxFps()), 0, 1000, 1, &ok);
+    if (ok)
+        mRenderScheduler->setMaxFps(fps);
+}
+
+
+/**
+ * @brief Slot for the "Level of detail" action: enables or disables level switching.
+ *
+ * @param enabled True to draw distant objects with decimated levels.
+ */
+void Widget::onToggleLevelOfDetail(bool enabled)
+{
+    mLod.setEnabled(enabled);
+    render();
+}
+
+
+/**
+ * @brief Asks for the memory cap of the levels of detail, showing their current use.
+ */
+void Widget::onSetLevelOfDetailMemory()
+{
+    const LodManager::Statistics stats = mLod.statistics();
+    const QString label = QString("Maximum memory of decimated levels in MiB\n"
+                                  "(%1 MiB in %2 levels of %3 meshes, %4 building, %5 evicted;\n"
+                                  "%6 objects drawn reduced)")
+        .arg(stats.bytes / (1024.0 * 1024.0), 0, 'f', 1)
+        .arg(stats.levels)
+        .arg(stats.chains)
+        .arg(stats.pending)
+        .arg(stats.evictions)
+        .arg(stats.reducedObjects);
+
+    bool ok = false;
+    const int mebibytes = QInputDialog::getInt(this, "Level of detail memory", label,
+                                               static_cast<int>(stats.capacityBytes / (1024 * 1024)), 0, 65536, 16, &ok);
+    if (ok)
+    {
+        mLod.setCapacity(static_cast<std::size_t>(mebibytes) * 1024 * 1024);
+        render();
+    }
+}
+
+
+/**
+ * @brief Slot for the "Adaptive tessellation" action: enables or disables resolution adaptation.
+ *
+ * @param enabled True to tessellate shapes according to their size on screen.
+ */
+void Widget::onToggleAdaptiveTessellation(bool enabled)
+{
+    mTessellation.setEnabled(enabled);
+    render();
+}
+
+
+/**
+ * @brief Asks for the tolerated tessellation error in pixels, showing how often shapes were regenerated.
+ */
+void Widget::onSetTessellationPixelError()
+{
+    const AdaptiveTessellation::Statistics stats = mTessellation.statistics();
+    const QString label = QString("Maximum deviation of shapes from their true surface in pixels\n"
+                                  "(%1 shapes adapted, %2 regenerations)")
+        .arg(stats.tracked)
+        .arg(stats.regenerations);
+
+    bool ok = false;
+    const double pixels = QInputDialog::getDouble(this, "Tessellation pixel error", label,
+                                                  mTessellation.pixelError(), 0.05, 100.0, 2, &ok);
+    if (ok)
+    {
+        mTessellation.setPixelError(pixels);
+        render();
+    }
+}
+
+
+/**
+ * @brief Slot for the "Interference check" action: starts or stops highlighting interfering objects.
+ *
+ * Turning it off removes the highlights and forgets the checker's state, so turning it
+ * on again checks the whole scene once.
+ *
+ * @param enabled True to highlight objects whose surfaces intersect another object's.
+ */
+void Widget::onToggleInterferenceCheck(bool enabled)
+{
+    mInterferenceEnabled = enabled;
+    if (!enabled)
+    {
+        for (ObjectId id : mScene.objects())
+            mScene.setHighlighted(id, false);
+        mInterference.clear();
+    }
+    render();
+}
+
+
+/**
+ * @brief Reverts the last recorded edit of the scene.
+ */
+void Widget::onUndo()
+{
+    TRACE_SCOPE("Widget::onUndo", "ui");
+
+    if (!mHistory.canUndo())
+        return;
+
+    qInfo().noquote() << QString("Undo %1").arg(QString::fromStdString(mHistory.undoLabel()));
+
+    mBoxWidget2->Off();
+    const std::vector<ObjectId> objects = mHistory.undo();
+    showProjectMeshes();
+    showHistoryStep(objects);
+    render();
+}
+
+
+/**
+ * @brief Applies the last undone edit of the scene again.
+ */
+void Widget::onRedo()
+{
+    TRACE_SCOPE("Widget::onRedo", "ui");
+
+    if (!mHistory.canRedo())
+        return;
+
+    qInfo().noquote() << QString("Redo %1").arg(QString::fromStdString(mHistory.redoLabel()));
+
+    mBoxWidget2->Off();
+    const std::vector<ObjectId> objects = mHistory.redo();
+    showProjectMeshes();
+    showHistoryStep(objects);
+    render();
+}
+
+
+/**
+ * @brief Slot for the "Undo history memory..." action: asks for the memory cap of the undo history.
+ */
+void Widget::onSetHistoryMemory()
+{
+    const History::Statistics stats = mHistory.statistics();
+    const QString label = QString("Maximum memory of the undo history in MiB\n"
+                                  "(%1 MiB in %2 mesh arrays; %3 undo and %4 redo steps, %5 forgotten)")
+        .arg(stats.bytes / (1024.0 * 1024.0), 0, 'f', 1)
+        .arg(stats.buffers)
+        .arg(stats.undoSteps)
+        .arg(stats.redoSteps)
+        .arg(stats.forgotten);
+
+    bool ok = false;
+    const int mebibytes = QInputDialog::getInt(this, "Undo history memory", label,
+                                               static_cast<int>(stats.capacityBytes / (1024 * 1024)), 0, 65536, 16, &ok);
+    if (ok)
+        mHistory.setCapacity(static_cast<std::size_t>(mebibytes) * 1024 * 1024);
+}
+
+
+/**
+ * @brief Slot for the "Compact mesh storage" action: switches the storage of meshes built from now on.
+ *
+ * Cached shapes are dropped so new shapes are generated in the new storage; objects
+ * already in the scene keep theirs. The memory per triangle of the current object in
+ * both storages is logged.
+ * @param enabled True for float32 points and normals and 32-bit cell ids.
+ */
+void Widget::onToggleCompactStorage(bool enabled)
+{
+    MeshStorage::setMode(enabled ? MeshStorage::Mode::Compact : MeshStorage::Mode::Default);
+    shapeController.cache().clear();
+
+    const ObjectId current = mScene.current();
+    if (current == InvalidObjectId)
+        return;
+
+    vtkPolyData* mesh = mScene.mesh(current);
+    const MeshStorage::Footprint footprint = MeshStorage::measure(mesh);
+    const MeshStorage::Footprint compact = MeshStorage::measure(MeshStorage::compact(mesh));
+    qInfo().noquote() << QString("Current object: %1 triangles, %2 bytes/triangle as stored, %3 bytes/triangle compact")
+        .arg(footprint.triangles)
+        .arg(footprint.bytesPerTriangle(), 0, 'f', 1)
+        .arg(compact.bytesPerTriangle(), 0, 'f', 1);
+}
+
+
+/**
+ * @brief Slot for the "Repair mesh" action: repairs the mesh of the current object in place.
+ *
+ * The repair welds points, drops degenerate and duplicate triangles, orients the
+ * triangles consistently and closes small holes; the object keeps its transform and
+ * material, and the change can be undone.
+ */
+void Widget::onRepairMesh()
+{
+    TRACE_SCOPE("Widget::onRepairMesh", "ui");
+
+    const ObjectId current = mScene.current();
+    if (current == InvalidObjectId || current == mPreviewObject || waitsForMesh(current, "Repair mesh"))
+        return;
+
+    const MeshRepair::Result result = MeshRepair::repair(mScene.mesh(current));
+    logRepair(QString("object %1").arg(current), result);
+    if (!result.ok())
+    {
+        QMessageBox::warning(this, "Repair mesh", result.error);
+        return;
+    }
+    if (!result.changed())
+        return;
+
+    mHistory.begin("Repair", { current });
+    mScene.setMesh(current, result.mesh);
+    mHistory.commit();
+    render();
+}
+
+
+/**
+ * @brief Slot for the "Repair meshes on load" action: repairs STL files loaded from now on.
+ *
+ * @param enabled True to run every loaded mesh through MeshRepair on the loader's thread.
+ */
+void Widget::onToggleRepairOnLoad(bool enabled)
+{
+    mMeshLoader->setRepairEnabled(enabled);
+}
+
+
+/**
+ * @brief Slot for the "Cache loaded meshes" action: keeps a MeshFile next to each STL file loaded from now on.
+ *
+ * @param enabled True to map current caches instead of parsing, and to write them after parsing.
+ */
+void Widget::onToggleCacheOnLoad(bool enabled)
+{
+    mMeshLoader->setCacheEnabled(enabled);
+}
+
+
+/**
+ * @brief Slot for the "Record trace" action: starts or stops recording trace spans.
+ *
+ * Starting discards the spans of earlier recordings.
+ * @param enabled True to record.
+ */
+void Widget::onToggleTracing(bool enabled)
+{
+    if (enabled)
+        Trace::clear();
+    Trace::setEnabled(enabled);
+}
+
+
+/**
+ * @brief Asks for a file and writes the recorded trace spans to it as Chrome trace JSON.
+ */
+void Widget::onExportTrace()
+{
+    const QString path = QFileDialog::getSaveFileName(this, "Export trace", "trace.json", "Chrome trace (*.json)");
+    if (path.isEmpty())
+        return; // user canceled
+
+    const QString error = Trace::exportChromeJson(path);
+    if (!error.isEmpty())
+        QMessageBox::warning(this, "Export trace", QString("Could not write %1:\n%2").arg(path, error));
+}
+
+
+/**
+ * @brief Makes the object after the current one (in scene order) current.
+ */
+void Widget::onSelectNext()
+{
+    const std::vector<ObjectId>& objects = mScene.objects();
+    if (objects.empty())
+        return;
+
+    auto it = std::find(objects.begin(), objects.end(), mScene.current());
+    if (it == objects.end() || ++it == objects.end())
+        it = objects.begin();
+
+    setCurrentObject(*it);
+    render();
+}
+
+
+/**
+ * @brief Makes the object before the current one (in scene order) current.
+ */
+void Widget::onSelectPrevious()
+{
+    const std::vector<ObjectId>& objects = mScene.objects();
+    if (objects.empty())
+        return;
+
+    auto it = std::find(objects.begin(), objects.end(), mScene.current());
+    if (it == objects.end() || it == objects.begin())
+        it = objects.end();
+
+    setCurrentObject(*--it);
+    render();
+}
+
+
+/**
+ * @brief Adds the current object to the selection, or removes it if already selected.
+ */
+void Widget::onToggleSelection()
+{
+    const ObjectId current = mScene.current();
+    if (current != InvalidObjectId)
+        mScene.setSelected(current, !mScene.isSelected(current));
+}
+
+
+/**
+ * @brief Selects every object in the scene.
+ */
+void Widget::onSelectAll()
+{
+    mScene.selectAll();
+}
+
+
+/**
+ * @brief Clears the selection.
+ */
+void Widget::onClearSelection()
+{
+    mScene.clearSelection();
 }